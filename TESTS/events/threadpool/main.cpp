@@ -0,0 +1,258 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed_events.h"
+#include "mbed.h"
+#include "rtos.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#if !defined(MBED_CONF_RTOS_PRESENT)
+#error [NOT_SUPPORTED] test not supported
+#endif
+
+#if !DEVICE_USTICKER
+#error [NOT_SUPPORTED] test not supported
+#endif
+
+using namespace utest::v1;
+
+#define TEST_EQUEUE_SIZE (32*EVENTS_EVENT_SIZE)
+#define TEST_STACK_SIZE 1024
+#define TEST_EVENTS 200
+#define TEST_BLOCKING_EVENTS 40
+#define TEST_BLOCKING_MS 2
+
+static volatile int counter;
+
+static void count()
+{
+    core_util_atomic_incr_u32((volatile uint32_t *)&counter, 1);
+}
+
+static void count_blocking()
+{
+    ThisThread::sleep_for(TEST_BLOCKING_MS);
+    count();
+}
+
+static void wait_for(int n)
+{
+    for (int i = 0; i < 10000 && counter != n; i++) {
+        ThisThread::sleep_for(1);
+    }
+}
+
+// post events, backing off while the queue is full
+static void post_all(EventQueue *queue, void (*cb)(), int n)
+{
+    for (int i = 0; i < n; i++) {
+        while (!queue->call(cb)) {
+            ThisThread::sleep_for(1);
+        }
+    }
+}
+
+// time events dispatched by a single thread, in events per second
+static unsigned single_thread_rate(void (*cb)(), int n)
+{
+    EventQueue queue(TEST_EQUEUE_SIZE);
+    Thread thread(osPriorityNormal, TEST_STACK_SIZE);
+    thread.start(callback(&queue, &EventQueue::dispatch_forever));
+
+    Timer timer;
+    counter = 0;
+    timer.start();
+    post_all(&queue, cb, n);
+    wait_for(n);
+    timer.stop();
+    TEST_ASSERT_EQUAL(n, counter);
+
+    queue.break_dispatch();
+    thread.join();
+    return (unsigned)(1000000ULL * n / timer.read_high_resolution_us());
+}
+
+// time events dispatched by a pool of threads, in events per second
+static unsigned thread_pool_rate(unsigned threads, void (*cb)(), int n)
+{
+    ThreadPoolEventQueue pool(threads, TEST_EQUEUE_SIZE, NULL, 0,
+                              osPriorityNormal, TEST_STACK_SIZE);
+    TEST_ASSERT_EQUAL(osOK, pool.start());
+
+    Timer timer;
+    counter = 0;
+    timer.start();
+    post_all(&pool, cb, n);
+    wait_for(n);
+    timer.stop();
+    TEST_ASSERT_EQUAL(n, counter);
+
+    pool.stop();
+    unsigned executed = 0;
+    for (unsigned i = 0; i < threads; i++) {
+        executed += pool.executed(i);
+    }
+    TEST_ASSERT_EQUAL(n, executed);
+
+    return (unsigned)(1000000ULL * n / timer.read_high_resolution_us());
+}
+
+void thread_pool_run_test()
+{
+    ThreadPoolEventQueue pool(3, TEST_EQUEUE_SIZE, NULL, 0,
+                              osPriorityNormal, TEST_STACK_SIZE);
+    TEST_ASSERT_EQUAL(3, pool.threads());
+    TEST_ASSERT_EQUAL(osOK, pool.start());
+
+    counter = 0;
+    post_all(&pool, count, TEST_EVENTS);
+    wait_for(TEST_EVENTS);
+    TEST_ASSERT_EQUAL(TEST_EVENTS, counter);
+
+    // periodic events keep running across workers
+    counter = 0;
+    int id = pool.call_every(5, count);
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    wait_for(10);
+    pool.cancel(id);
+    TEST_ASSERT(counter >= 10);
+
+    pool.stop();
+}
+
+void thread_pool_restart_test()
+{
+    ThreadPoolEventQueue pool(2, TEST_EQUEUE_SIZE, NULL, 0,
+                              osPriorityNormal, TEST_STACK_SIZE);
+
+    // events posted while stopped run once the pool is started
+    counter = 0;
+    post_all(&pool, count, 10);
+    ThisThread::sleep_for(10);
+    TEST_ASSERT_EQUAL(0, counter);
+
+    TEST_ASSERT_EQUAL(osOK, pool.start());
+    wait_for(10);
+    TEST_ASSERT_EQUAL(10, counter);
+    pool.stop();
+
+    counter = 0;
+    TEST_ASSERT_EQUAL(osOK, pool.start());
+    post_all(&pool, count, 10);
+    wait_for(10);
+    TEST_ASSERT_EQUAL(10, counter);
+    pool.stop();
+}
+
+struct serial {
+    volatile int active;
+    volatile bool overlapped;
+    volatile int next;
+    volatile int misordered;
+};
+
+static void serial_func(serial *s, int index)
+{
+    if (core_util_atomic_incr_u32((volatile uint32_t *)&s->active, 1) != 1) {
+        s->overlapped = true;
+    }
+
+    if (index != s->next) {
+        s->misordered += 1;
+    }
+
+    s->next = index + 1;
+    ThisThread::yield();
+    core_util_atomic_decr_u32((volatile uint32_t *)&s->active, 1);
+}
+
+void thread_pool_chain_order_test()
+{
+    ThreadPoolEventQueue pool(3, TEST_EQUEUE_SIZE, NULL, 0,
+                              osPriorityNormal, TEST_STACK_SIZE);
+    EventQueue chained(TEST_EQUEUE_SIZE);
+    chained.chain(&pool);
+    TEST_ASSERT_EQUAL(osOK, pool.start());
+
+    // events from a chained queue run one at a time and in order, even with
+    // equal targets and several workers dispatching the chained queue
+    serial s = {0, false, 0, 0};
+    for (int i = 0; i < TEST_EVENTS; i++) {
+        while (!chained.call_in(i / 20, serial_func, &s, i)) {
+            ThisThread::sleep_for(1);
+        }
+        post_all(&pool, count, 1);
+    }
+
+    for (int i = 0; i < 10000 && s.next != TEST_EVENTS; i++) {
+        ThisThread::sleep_for(1);
+    }
+
+    pool.stop();
+    chained.chain(NULL);
+
+    TEST_ASSERT_EQUAL(TEST_EVENTS, s.next);
+    TEST_ASSERT_FALSE(s.overlapped);
+    TEST_ASSERT_EQUAL(0, s.misordered);
+}
+
+void thread_pool_throughput_test()
+{
+    unsigned single = single_thread_rate(count, TEST_EVENTS);
+    utest_printf("single thread:   %u events/s\r\n", single);
+    for (unsigned threads = 1; threads <= 3; threads++) {
+        unsigned rate = thread_pool_rate(threads, count, TEST_EVENTS);
+        utest_printf("%u worker pool:   %u events/s\r\n", threads, rate);
+    }
+}
+
+void thread_pool_blocking_throughput_test()
+{
+    unsigned single = single_thread_rate(count_blocking, TEST_BLOCKING_EVENTS);
+    utest_printf("single thread:   %u events/s\r\n", single);
+
+    unsigned rate = 0;
+    for (unsigned threads = 1; threads <= 3; threads++) {
+        rate = thread_pool_rate(threads, count_blocking, TEST_BLOCKING_EVENTS);
+        utest_printf("%u worker pool:   %u events/s\r\n", threads, rate);
+    }
+
+    // blocking events overlap across workers even on a single core
+    TEST_ASSERT(rate > 2 * single);
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+const Case cases[] = {
+    Case("Testing thread pool dispatch", thread_pool_run_test),
+    Case("Testing thread pool restart", thread_pool_restart_test),
+    Case("Testing chained queue ordering", thread_pool_chain_order_test),
+    Case("Testing throughput", thread_pool_throughput_test),
+    Case("Testing blocking throughput", thread_pool_blocking_throughput_test),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -0,0 +1,190 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "greentea-client/test_env.h"
+#include "utest/utest.h"
+#include "unity/unity.h"
+#include "mbed.h"
+
+#if !defined(MBED_CONF_RTOS_PRESENT)
+#error [NOT_SUPPORTED] poll test cases require RTOS to run
+#endif
+
+using utest::v1::Case;
+
+#define EVENT_DELAY_US      10000
+#define NUM_WAKEUPS         20
+
+/* Stub file handle, whose events are set by the test cases */
+class TestPollFile : public FileHandle {
+public:
+    TestPollFile(bool wakes) : _events(0), _wakes(wakes) {}
+
+    virtual ssize_t read(void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual ssize_t write(const void *buffer, size_t size)
+    {
+        return -EAGAIN;
+    }
+
+    virtual off_t seek(off_t offset, int whence)
+    {
+        return -ESPIPE;
+    }
+
+    virtual int close()
+    {
+        return 0;
+    }
+
+    virtual short poll(short events) const
+    {
+        return _events & events;
+    }
+
+    virtual bool poll_wakes() const
+    {
+        return _wakes;
+    }
+
+    void set_events(short events)
+    {
+        _events = events;
+        if (_wakes) {
+            poll_wake(this);
+        }
+    }
+
+private:
+    volatile short _events;
+    bool _wakes;
+};
+
+static Timer timer;
+static volatile int event_time;
+static TestPollFile *event_file;
+
+static void event_isr()
+{
+    event_time = timer.read_us();
+    event_file->set_events(POLLIN);
+}
+
+/** Test poll timeout
+ *
+ *  Given a file handle with no events
+ *  When poll is called with a timeout
+ *  Then poll returns 0 once the timeout expired
+ */
+void test_poll_timeout()
+{
+    TestPollFile fh(true);
+    pollfh fhs = { &fh, POLLIN, 0 };
+
+    timer.reset();
+    timer.start();
+    int ret = poll(&fhs, 1, 50);
+    int elapsed = timer.read_ms();
+    timer.stop();
+
+    TEST_ASSERT_EQUAL(0, ret);
+    TEST_ASSERT_EQUAL(0, fhs.revents);
+    TEST_ASSERT_INT_WITHIN(5, 50, elapsed);
+}
+
+/** Test poll wakeup latency
+ *
+ *  Given a file handle signalling its events
+ *  When an event occurs in interrupt context while poll is blocked on it
+ *  Then poll returns the event right away
+ */
+void test_poll_wakeup_latency()
+{
+    TestPollFile fh(true);
+    TestPollFile other(true);
+    pollfh fhs[2] = { { &other, POLLIN, 0 }, { &fh, POLLIN, 0 } };
+    Timeout timeout;
+    int latency, max_latency = 0, total_latency = 0;
+
+    event_file = &fh;
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < NUM_WAKEUPS; i++) {
+        fh.set_events(0);
+        timeout.attach_us(event_isr, EVENT_DELAY_US);
+
+        int ret = poll(fhs, 2, -1);
+        latency = timer.read_us() - event_time;
+
+        TEST_ASSERT_EQUAL(1, ret);
+        TEST_ASSERT_EQUAL(0, fhs[0].revents);
+        TEST_ASSERT_EQUAL(POLLIN, fhs[1].revents);
+        max_latency = std::max(max_latency, latency);
+        total_latency += latency;
+    }
+    timer.stop();
+
+    printf("Wakeup latency - average %d us, max %d us\r\n", total_latency / NUM_WAKEUPS, max_latency);
+    TEST_ASSERT_TRUE(max_latency < 1000);
+}
+
+/** Test poll on a file handle not signalling its events
+ *
+ *  Given a file handle not signalling its events
+ *  When an event occurs while poll is blocked on it
+ *  Then poll still returns the event, within the next millisecond
+ */
+void test_poll_no_wakeup()
+{
+    TestPollFile fh(false);
+    pollfh fhs = { &fh, POLLIN, 0 };
+    Timeout timeout;
+
+    event_file = &fh;
+    timer.reset();
+    timer.start();
+    timeout.attach_us(event_isr, EVENT_DELAY_US);
+
+    int ret = poll(&fhs, 1, 1000);
+    int latency = timer.read_us() - event_time;
+    timer.stop();
+
+    TEST_ASSERT_EQUAL(1, ret);
+    TEST_ASSERT_EQUAL(POLLIN, fhs.revents);
+    TEST_ASSERT_TRUE(latency < 3000);
+}
+
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(20, "default_auto");
+    return utest::v1::verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("Test poll timeout", test_poll_timeout),
+    Case("Test poll wakeup latency", test_poll_wakeup_latency),
+    Case("Test poll without wakeup", test_poll_no_wakeup)
+};
+
+utest::v1::Specification specification(test_setup, cases);
+
+int main()
+{
+    return !utest::v1::Harness::run(specification);
+}
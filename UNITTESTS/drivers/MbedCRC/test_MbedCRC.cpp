@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2019, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "drivers/MbedCRC.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+using namespace mbed;
+
+// Reference CRC computed bit by bit straight from the definition
+static uint32_t reference_crc(uint32_t polynomial, uint8_t width, uint32_t initial_xor,
+                              uint32_t final_xor, bool reflect_data, bool reflect_remainder,
+                              const uint8_t *data, size_t size)
+{
+    const uint32_t top = 1ul << (width - 1);
+    const uint32_t mask = (uint32_t)((1ull << width) - 1);
+    uint32_t crc = initial_xor & mask;
+
+    for (size_t i = 0; i < size; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            int in = reflect_data ? (data[i] >> bit) & 1 : (data[i] >> (7 - bit)) & 1;
+            bool feedback = ((crc & top) != 0) != (in != 0);
+            crc = (crc << 1) & mask;
+            if (feedback) {
+                crc ^= polynomial;
+            }
+        }
+    }
+
+    if (reflect_remainder) {
+        uint32_t reflection = 0;
+        for (int bit = 0; bit < width; bit++) {
+            if (crc & (1ul << bit)) {
+                reflection |= 1ul << (width - 1 - bit);
+            }
+        }
+        crc = reflection;
+    }
+
+    return (crc ^ final_xor) & mask;
+}
+
+class TestMbedCRC : public testing::Test {
+protected:
+    uint8_t data[1031];
+
+    virtual void SetUp()
+    {
+        uint32_t seed = 0x12345678;
+        for (size_t i = 0; i < sizeof(data); i++) {
+            seed = seed * 1103515245 + 12345;
+            data[i] = seed >> 16;
+        }
+    }
+
+    // Check whole and split computations of every length against the reference
+    template <uint32_t polynomial, uint8_t width, CrcTablePolicy policy>
+    void check(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder)
+    {
+        MbedCRC<polynomial, width, policy> ct(initial_xor, final_xor, reflect_data, reflect_remainder);
+        uint32_t poly = (POLY_32BIT_REV_ANSI == polynomial) ? POLY_32BIT_ANSI : polynomial;
+        bool rdata = (POLY_32BIT_REV_ANSI == polynomial) ? true : reflect_data;
+        bool rrem = (POLY_32BIT_REV_ANSI == polynomial) ? true : reflect_remainder;
+
+        // CRCs narrower than 8 bits are returned left aligned in a byte
+        const int align = width < 8 ? 8 - width : 0;
+
+        for (size_t size = 0; size < 40; size++) {
+            uint32_t crc;
+            EXPECT_EQ(0, ct.compute(data, size, &crc));
+            EXPECT_EQ(reference_crc(poly, width, initial_xor, final_xor, rdata, rrem, data, size) << align, crc)
+                    << "size " << size;
+        }
+
+        uint32_t crc;
+        EXPECT_EQ(0, ct.compute_partial_start(&crc));
+        EXPECT_EQ(0, ct.compute_partial(data, 13, &crc));
+        EXPECT_EQ(0, ct.compute_partial(data + 13, 500, &crc));
+        EXPECT_EQ(0, ct.compute_partial(data + 513, sizeof(data) - 513, &crc));
+        EXPECT_EQ(0, ct.compute_partial_stop(&crc));
+        EXPECT_EQ(reference_crc(poly, width, initial_xor, final_xor, rdata, rrem, data, sizeof(data)) << align, crc);
+    }
+
+    template <uint32_t polynomial, uint8_t width, CrcTablePolicy policy>
+    void check_all_modes()
+    {
+        check<polynomial, width, policy>(0, 0, false, false);
+        check<polynomial, width, policy>(0xFFFFFFFF, 0xFFFFFFFF, true, true);
+        check<polynomial, width, policy>(0x5A5A5A5A, 0, true, false);
+        check<polynomial, width, policy>(0, 0x12345678, false, true);
+    }
+
+    template <CrcTablePolicy policy>
+    void check_polynomials()
+    {
+        check_all_modes<POLY_8BIT_CCITT, 8, policy>();
+        check_all_modes<POLY_16BIT_CCITT, 16, policy>();
+        // The ROM table for POLY_16BIT_IBM only matches its default configuration
+        if (CRC_TABLE_DEFAULT != policy) {
+            check_all_modes<POLY_16BIT_IBM, 16, policy>();
+        }
+        check_all_modes<POLY_32BIT_ANSI, 32, policy>();
+        check_all_modes<0x1EDC6F41, 32, policy>();
+        check_all_modes<0x3D65, 16, policy>();
+        check<POLY_32BIT_REV_ANSI, 32, policy>(0xFFFFFFFF, 0xFFFFFFFF, false, false);
+        check<POLY_7BIT_SD, 7, policy>(0, 0, false, false);
+    }
+
+    template <CrcTablePolicy policy>
+    void check_defaults()
+    {
+        const char test[] = "123456789";
+        uint32_t crc;
+
+        MbedCRC<POLY_7BIT_SD, 7, policy> crc7;
+        EXPECT_EQ(0, crc7.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0xEAu, crc);
+
+        MbedCRC<POLY_8BIT_CCITT, 8, policy> crc8;
+        EXPECT_EQ(0, crc8.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0xF4u, crc);
+
+        MbedCRC<POLY_16BIT_CCITT, 16, policy> crc16;
+        EXPECT_EQ(0, crc16.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0x29B1u, crc);
+
+        MbedCRC<POLY_16BIT_IBM, 16, policy> crc16ibm;
+        EXPECT_EQ(0, crc16ibm.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0xBB3Du, crc);
+
+        MbedCRC<POLY_32BIT_ANSI, 32, policy> crc32;
+        EXPECT_EQ(0, crc32.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0xCBF43926u, crc);
+
+        MbedCRC<POLY_32BIT_REV_ANSI, 32, policy> crc32rev;
+        EXPECT_EQ(0, crc32rev.compute((void *)test, 9, &crc));
+        EXPECT_EQ(0xCBF43926u, crc);
+    }
+
+    template <uint32_t polynomial, uint8_t width, CrcTablePolicy policy>
+    void benchmark(const char *name)
+    {
+        static uint8_t buffer[4096];
+        const int rounds = 2000;
+        MbedCRC<polynomial, width, policy> ct(0xFFFFFFFF, 0, true, false);
+        uint32_t crc = 0;
+
+        clock_t start = clock();
+        for (int i = 0; i < rounds; i++) {
+            ct.compute(buffer, sizeof(buffer), &crc);
+            buffer[i % sizeof(buffer)] ^= crc;
+        }
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        printf("%-28s %8.1f MB/s\n", name,
+               seconds > 0 ? rounds * sizeof(buffer) / seconds / 1e6 : 0.0);
+    }
+};
+
+TEST_F(TestMbedCRC, default_policy)
+{
+    check_defaults<CRC_TABLE_DEFAULT>();
+    check_polynomials<CRC_TABLE_DEFAULT>();
+}
+
+TEST_F(TestMbedCRC, table_256)
+{
+    check_defaults<CRC_TABLE_256>();
+    check_polynomials<CRC_TABLE_256>();
+}
+
+TEST_F(TestMbedCRC, slice_by_4)
+{
+    check_defaults<CRC_TABLE_SLICE_BY_4>();
+    check_polynomials<CRC_TABLE_SLICE_BY_4>();
+}
+
+TEST_F(TestMbedCRC, slice_by_8)
+{
+    check_defaults<CRC_TABLE_SLICE_BY_8>();
+    check_polynomials<CRC_TABLE_SLICE_BY_8>();
+}
+
+TEST_F(TestMbedCRC, rom_tables)
+{
+    // ROM tables of the reflected 32-bit ANSI CRC match the generated ones
+    internal::MbedCRCTable<POLY_32BIT_ANSI, 32, 8, true> generated;
+    ASSERT_TRUE(generated.entries() != NULL);
+    EXPECT_EQ(0, memcmp(generated.entries(), Table_CRC_32bit_Rev_ANSI_Slice_By_8,
+                        sizeof(Table_CRC_32bit_Rev_ANSI_Slice_By_8)));
+}
+
+TEST_F(TestMbedCRC, policies_agree)
+{
+    MbedCRC<POLY_32BIT_ANSI, 32> def(0x12345678, 0, true, false);
+    MbedCRC<POLY_32BIT_ANSI, 32, CRC_TABLE_SLICE_BY_8> fast(0x12345678, 0, true, false);
+
+    // Chained computations as used by TDBStore, feeding each result back as the seed
+    uint32_t expected = 0x12345678;
+    uint32_t actual = 0x12345678;
+    for (size_t offset = 0; offset < sizeof(data); offset += 97) {
+        size_t size = sizeof(data) - offset < 97 ? sizeof(data) - offset : 97;
+        MbedCRC<POLY_32BIT_ANSI, 32> def_step(expected, 0, true, false);
+        MbedCRC<POLY_32BIT_ANSI, 32, CRC_TABLE_SLICE_BY_8> fast_step(actual, 0, true, false);
+        EXPECT_EQ(0, def_step.compute(data + offset, size, &expected));
+        EXPECT_EQ(0, fast_step.compute(data + offset, size, &actual));
+        EXPECT_EQ(expected, actual);
+    }
+}
+
+TEST_F(TestMbedCRC, crc32_ansi)
+{
+    MbedCRC<POLY_32BIT_ANSI, 32> def(0xFFFFFFFF, 0, true, false);
+    uint32_t expected;
+    EXPECT_EQ(0, def.compute(data, sizeof(data), &expected));
+
+    // Computed in two parts, the first result being the initial value of the second
+    uint32_t crc = crc32_ansi(0xFFFFFFFF, 100, data);
+    crc = crc32_ansi(crc, sizeof(data) - 100, data + 100);
+    EXPECT_EQ(expected, crc);
+}
+
+TEST_F(TestMbedCRC, benchmark)
+{
+    benchmark<POLY_32BIT_ANSI, 32, CRC_TABLE_DEFAULT>("crc32 default");
+    benchmark<POLY_32BIT_ANSI, 32, CRC_TABLE_256>("crc32 table 256");
+    benchmark<POLY_32BIT_ANSI, 32, CRC_TABLE_SLICE_BY_4>("crc32 slice-by-4");
+    benchmark<POLY_32BIT_ANSI, 32, CRC_TABLE_SLICE_BY_8>("crc32 slice-by-8");
+    benchmark<POLY_16BIT_CCITT, 16, CRC_TABLE_DEFAULT>("crc16 default");
+    benchmark<POLY_16BIT_CCITT, 16, CRC_TABLE_SLICE_BY_8>("crc16 slice-by-8");
+}
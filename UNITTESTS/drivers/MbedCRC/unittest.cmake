@@ -0,0 +1,14 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-sources
+  ../drivers/MbedCRC.cpp
+  ../drivers/TableCRC.cpp
+)
+
+set(unittest-test-sources
+  drivers/MbedCRC/test_MbedCRC.cpp
+  stubs/mbed_assert_stub.c
+)
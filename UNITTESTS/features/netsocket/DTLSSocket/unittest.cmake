@@ -6,11 +6,14 @@
 set(unittest-sources
   ../features/netsocket/SocketAddress.cpp
   ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/NetStackMemoryManager.cpp
+  ../features/netsocket/HeapMemoryManager.cpp
   ../features/netsocket/InternetSocket.cpp
   ../features/netsocket/UDPSocket.cpp
   ../features/netsocket/DTLSSocket.cpp
   ../features/netsocket/DTLSSocketWrapper.cpp
   ../features/netsocket/TLSSocketWrapper.cpp
+  ../features/netsocket/TLSSessionCache.cpp
   ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
   ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
   ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
@@ -18,6 +21,10 @@ set(unittest-sources
   ../features/frameworks/nanostack-libservice/source/libBits/common_functions.c
 )
 
+set(unittest-includes ${unittest-includes}
+  ../features/storage/kvstore
+)
+
 set(unittest-test-sources
   features/netsocket/DTLSSocket/test_DTLSSocket.cpp
   stubs/Mutex_stub.cpp
@@ -35,7 +42,5 @@ set(unittest-test-sources
 )
 
 set(MBEDTLS_USER_CONFIG_FILE_PATH "\"../UNITTESTS/features/netsocket/DTLSSocket/dtls_test_config.h\"")
-set_source_files_properties(features/netsocket/DTLSSocket/test_DTLSSocket.cpp PROPERTIES COMPILE_DEFINITIONS MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
-set_source_files_properties(../features/netsocket/DTLSSocket.cpp PROPERTIES COMPILE_DEFINITIONS MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
-set_source_files_properties(../features/netsocket/DTLSSocketWrapper.cpp PROPERTIES COMPILE_DEFINITIONS MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
+set(unittest-definitions MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
 
@@ -6,10 +6,13 @@
 set(unittest-sources
   ../features/netsocket/SocketAddress.cpp
   ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/NetStackMemoryManager.cpp
+  ../features/netsocket/HeapMemoryManager.cpp
   ../features/netsocket/InternetSocket.cpp
   ../features/netsocket/UDPSocket.cpp
   ../features/netsocket/DTLSSocketWrapper.cpp
   ../features/netsocket/TLSSocketWrapper.cpp
+  ../features/netsocket/TLSSessionCache.cpp
   ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
   ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
   ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
@@ -17,6 +20,10 @@ set(unittest-sources
   ../features/frameworks/nanostack-libservice/source/libBits/common_functions.c
 )
 
+set(unittest-includes ${unittest-includes}
+  ../features/storage/kvstore
+)
+
 set(unittest-test-sources
   features/netsocket/DTLSSocketWrapper/test_DTLSSocketWrapper.cpp
   stubs/Mutex_stub.cpp
@@ -34,6 +41,5 @@ set(unittest-test-sources
 )
 
 set(MBEDTLS_USER_CONFIG_FILE_PATH "\"../UNITTESTS/features/netsocket/DTLSSocketWrapper/dtls_test_config.h\"")
-set_source_files_properties(features/netsocket/DTLSSocketWrapper/test_DTLSSocketWrapper.cpp PROPERTIES COMPILE_DEFINITIONS MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
-set_source_files_properties(../features/netsocket/DTLSSocketWrapper.cpp PROPERTIES COMPILE_DEFINITIONS MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
+set(unittest-definitions MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
 
@@ -13,6 +13,8 @@ set(unittest-sources
   ../features/netsocket/EMACInterface.cpp
   ../features/netsocket/NetworkInterface.cpp
   ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/NetStackMemoryManager.cpp
+  ../features/netsocket/HeapMemoryManager.cpp
   ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
   ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
   ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
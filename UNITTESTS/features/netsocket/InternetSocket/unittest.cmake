@@ -6,6 +6,8 @@
 set(unittest-sources
   ../features/netsocket/SocketAddress.cpp
   ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/NetStackMemoryManager.cpp
+  ../features/netsocket/HeapMemoryManager.cpp
   ../features/netsocket/InternetSocket.cpp
   ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
   ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2019, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "features/netsocket/SocketFileHandle.h"
+#include "features/netsocket/TCPSocket.h"
+#include "NetworkStack_stub.h"
+
+// Control the rtos EventFlags stub. See EventFlags_stub.cpp
+extern std::list<uint32_t> eventFlagsStubNextRetval;
+
+static int sigio_count;
+
+static void sigio_handler()
+{
+    sigio_count++;
+}
+
+class TestSocketFileHandle : public testing::Test {
+public:
+    unsigned int dataSize = 10;
+    char dataBuf[10];
+protected:
+    NetworkStackstub stack;
+    TCPSocket socket;
+    SocketFileHandle *fh;
+
+    virtual void SetUp()
+    {
+        socket.open((NetworkStack *)&stack);
+        fh = new SocketFileHandle(&socket);
+        fh->set_blocking(false);
+        sigio_count = 0;
+    }
+
+    virtual void TearDown()
+    {
+        delete fh;
+        stack.return_values.clear();
+        eventFlagsStubNextRetval.clear();
+    }
+};
+
+TEST_F(TestSocketFileHandle, constructor)
+{
+    EXPECT_TRUE(fh);
+    EXPECT_TRUE(fh->poll_wakes());
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), POLLIN | POLLOUT);
+}
+
+TEST_F(TestSocketFileHandle, blocking)
+{
+    EXPECT_FALSE(fh->is_blocking());
+    EXPECT_EQ(fh->set_blocking(true), 0);
+    EXPECT_TRUE(fh->is_blocking());
+}
+
+TEST_F(TestSocketFileHandle, seek)
+{
+    EXPECT_EQ(fh->seek(0, SEEK_SET), -ESPIPE);
+}
+
+TEST_F(TestSocketFileHandle, read)
+{
+    stack.return_value = dataSize;
+    EXPECT_EQ(fh->read(dataBuf, dataSize), dataSize);
+    EXPECT_EQ(fh->poll(POLLIN), POLLIN);
+}
+
+TEST_F(TestSocketFileHandle, read_error)
+{
+    stack.return_value = NSAPI_ERROR_NO_CONNECTION;
+    EXPECT_EQ(fh->read(dataBuf, dataSize), -ENOTCONN);
+    stack.return_value = NSAPI_ERROR_DEVICE_ERROR;
+    EXPECT_EQ(fh->read(dataBuf, dataSize), -EIO);
+}
+
+TEST_F(TestSocketFileHandle, read_would_block)
+{
+    stack.return_value = NSAPI_ERROR_WOULD_BLOCK;
+    EXPECT_EQ(fh->read(dataBuf, dataSize), -EAGAIN);
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), POLLOUT);
+
+    // An event makes the socket readable again
+    stack.socket_event(0);
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), POLLIN | POLLOUT);
+}
+
+TEST_F(TestSocketFileHandle, write_would_block)
+{
+    stack.return_value = NSAPI_ERROR_WOULD_BLOCK;
+    EXPECT_EQ(fh->write(dataBuf, dataSize), -EAGAIN);
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), POLLIN);
+    EXPECT_EQ(fh->read(dataBuf, dataSize), -EAGAIN);
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), 0);
+
+    stack.socket_event(0);
+    EXPECT_EQ(fh->poll(POLLIN | POLLOUT), POLLIN | POLLOUT);
+    stack.return_value = dataSize;
+    EXPECT_EQ(fh->write(dataBuf, dataSize), dataSize);
+}
+
+TEST_F(TestSocketFileHandle, sigio)
+{
+    // Called right away as the socket may be ready
+    fh->sigio(sigio_handler);
+    EXPECT_EQ(sigio_count, 1);
+    stack.socket_event(0);
+    EXPECT_EQ(sigio_count, 2);
+
+    fh->sigio(NULL);
+    stack.socket_event(0);
+    EXPECT_EQ(sigio_count, 2);
+}
+
+TEST_F(TestSocketFileHandle, close)
+{
+    EXPECT_EQ(fh->close(), 0);
+    EXPECT_EQ(fh->read(dataBuf, dataSize), -EBADF);
+}
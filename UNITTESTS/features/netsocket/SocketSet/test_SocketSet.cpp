@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2019, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "features/netsocket/SocketSet.h"
+#include "features/netsocket/TCPSocket.h"
+#include "NetworkStack_stub.h"
+#include <cstdio>
+#include <ctime>
+
+// Control the rtos EventFlags stub. See EventFlags_stub.cpp
+extern std::list<uint32_t> eventFlagsStubNextRetval;
+
+// Stack whose sockets have data to receive once an event is reported on them
+class ReadyNetworkStack : public NetworkStackstub {
+public:
+    std::vector<bool> ready;
+    unsigned recv_calls;
+
+    ReadyNetworkStack() : recv_calls(0) {}
+
+    void data_received(unsigned index)
+    {
+        if (index >= ready.size()) {
+            ready.resize(index + 1);
+        }
+        ready[index] = true;
+        socket_event(index);
+    }
+
+protected:
+    virtual nsapi_size_or_error_t socket_recv(nsapi_socket_t handle, void *data, nsapi_size_t size)
+    {
+        size_t index = reinterpret_cast<size_t>(handle) - 1234;
+        recv_calls++;
+        if (index < ready.size() && ready[index]) {
+            ready[index] = false;
+            return 1;
+        }
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+};
+
+static const int num_sockets = 4;
+
+class TestSocketSet : public testing::Test {
+protected:
+    ReadyNetworkStack stack;
+    TCPSocket sockets[num_sockets];
+    SocketSet *set;
+
+    virtual void SetUp()
+    {
+        for (int i = 0; i < num_sockets; i++) {
+            sockets[i].open((NetworkStack *)&stack);
+            sockets[i].set_blocking(false);
+        }
+        set = new SocketSet();
+    }
+
+    virtual void TearDown()
+    {
+        delete set;
+        eventFlagsStubNextRetval.clear();
+    }
+};
+
+TEST_F(TestSocketSet, constructor)
+{
+    EXPECT_TRUE(set);
+}
+
+TEST_F(TestSocketSet, add_invalid)
+{
+    EXPECT_EQ(set->add(NULL, POLLIN), NSAPI_ERROR_PARAMETER);
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_PARAMETER);
+}
+
+TEST_F(TestSocketSet, wait_invalid)
+{
+    SocketSet::event_t events[num_sockets];
+    EXPECT_EQ(set->wait(NULL, num_sockets, 0), NSAPI_ERROR_PARAMETER);
+    EXPECT_EQ(set->wait(events, 0, 0), NSAPI_ERROR_PARAMETER);
+}
+
+TEST_F(TestSocketSet, wait_added)
+{
+    SocketSet::event_t events[num_sockets];
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->add(&sockets[1], POLLIN | POLLOUT), NSAPI_ERROR_OK);
+
+    // Added sockets are reported once, in order
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 2);
+    EXPECT_EQ(events[0].socket, &sockets[0]);
+    EXPECT_EQ(events[0].revents, POLLIN);
+    EXPECT_EQ(events[1].socket, &sockets[1]);
+    EXPECT_EQ(events[1].revents, POLLIN | POLLOUT);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 0);
+}
+
+TEST_F(TestSocketSet, wait_events)
+{
+    SocketSet::event_t events[num_sockets];
+    for (int i = 0; i < num_sockets; i++) {
+        EXPECT_EQ(set->add(&sockets[i], POLLIN), NSAPI_ERROR_OK);
+    }
+    EXPECT_EQ(set->wait(events, num_sockets, 0), num_sockets);
+
+    stack.data_received(2);
+    stack.data_received(1);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 2);
+    EXPECT_EQ(events[0].socket, &sockets[2]);
+    EXPECT_EQ(events[1].socket, &sockets[1]);
+
+    // Events are edge-triggered, the socket is reported again after it was read
+    stack.data_received(3);
+    stack.data_received(3);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[3]);
+    stack.data_received(3);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 0);
+    char data;
+    EXPECT_EQ(sockets[3].recv(&data, 1), 1);
+    EXPECT_EQ(sockets[3].recv(&data, 1), NSAPI_ERROR_WOULD_BLOCK);
+    stack.data_received(3);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[3]);
+}
+
+TEST_F(TestSocketSet, wait_max_events)
+{
+    SocketSet::event_t events[num_sockets];
+    for (int i = 0; i < num_sockets; i++) {
+        EXPECT_EQ(set->add(&sockets[i], POLLIN), NSAPI_ERROR_OK);
+    }
+    EXPECT_EQ(set->wait(events, 3, 0), 3);
+    EXPECT_EQ(set->wait(events, 3, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[3]);
+}
+
+TEST_F(TestSocketSet, wait_timeout)
+{
+    SocketSet::event_t events[num_sockets];
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+
+    eventFlagsStubNextRetval.push_back(osFlagsErrorTimeout);
+    EXPECT_EQ(set->wait(events, num_sockets, -1), 0);
+}
+
+TEST_F(TestSocketSet, modify)
+{
+    SocketSet::event_t events[num_sockets];
+    EXPECT_EQ(set->modify(&sockets[0], POLLIN), NSAPI_ERROR_PARAMETER);
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_OK);
+
+    // No events of interest, the socket is not reported
+    EXPECT_EQ(set->modify(&sockets[0], 0), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 0);
+    stack.data_received(0);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 0);
+
+    // The socket is reported again once there are events of interest
+    EXPECT_EQ(set->modify(&sockets[0], POLLOUT), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[0]);
+    EXPECT_EQ(events[0].revents, POLLOUT);
+}
+
+TEST_F(TestSocketSet, remove)
+{
+    SocketSet::event_t events[num_sockets];
+    EXPECT_EQ(set->remove(&sockets[0]), NSAPI_ERROR_PARAMETER);
+    for (int i = 0; i < num_sockets; i++) {
+        EXPECT_EQ(set->add(&sockets[i], POLLIN), NSAPI_ERROR_OK);
+    }
+
+    // Removed sockets are taken out of the ready list, wherever they are
+    EXPECT_EQ(set->remove(&sockets[3]), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->remove(&sockets[0]), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 2);
+    EXPECT_EQ(events[0].socket, &sockets[1]);
+    EXPECT_EQ(events[1].socket, &sockets[2]);
+
+    // Events of removed sockets are not reported
+    stack.data_received(0);
+    stack.data_received(2);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[2]);
+
+    EXPECT_EQ(set->add(&sockets[0], POLLIN), NSAPI_ERROR_OK);
+    EXPECT_EQ(set->wait(events, num_sockets, 0), 1);
+    EXPECT_EQ(events[0].socket, &sockets[0]);
+}
+
+// Serving many sockets from one thread, compared with scanning all the sockets
+TEST(TestSocketSetBenchmark, ready_list_vs_scan)
+{
+    const int num_sockets = 1000;
+    const int num_ready = 10;
+    const int num_rounds = 100;
+    ReadyNetworkStack stack;
+    TCPSocket *sockets = new TCPSocket[num_sockets];
+    SocketSet set;
+    SocketSet::event_t events[num_ready];
+    char data;
+
+    for (int i = 0; i < num_sockets; i++) {
+        sockets[i].open((NetworkStack *)&stack);
+        sockets[i].set_blocking(false);
+    }
+
+    // Non-blocking scan: every socket is read on each round
+    std::clock_t start = std::clock();
+    int received = 0;
+    stack.recv_calls = 0;
+    for (int round = 0; round < num_rounds; round++) {
+        for (int i = 0; i < num_ready; i++) {
+            stack.data_received((round * 37 + i * 101) % num_sockets);
+        }
+        for (int i = 0; i < num_sockets; i++) {
+            while (sockets[i].recv(&data, 1) == 1) {
+                received++;
+            }
+        }
+    }
+    long scan_us = (std::clock() - start) * 1000000L / CLOCKS_PER_SEC;
+    unsigned scan_calls = stack.recv_calls;
+    EXPECT_EQ(received, num_ready * num_rounds);
+
+    for (int i = 0; i < num_sockets; i++) {
+        EXPECT_EQ(set.add(&sockets[i], POLLIN), NSAPI_ERROR_OK);
+    }
+    while (set.wait(events, num_ready, 0) > 0) {
+    }
+
+    // Ready list: only the sockets with events are read
+    start = std::clock();
+    received = 0;
+    stack.recv_calls = 0;
+    for (int round = 0; round < num_rounds; round++) {
+        for (int i = 0; i < num_ready; i++) {
+            stack.data_received((round * 37 + i * 101) % num_sockets);
+        }
+        int count = set.wait(events, num_ready, 0);
+        EXPECT_EQ(count, num_ready);
+        for (int i = 0; i < count; i++) {
+            while (events[i].socket->recv(&data, 1) == 1) {
+                received++;
+            }
+        }
+    }
+    long set_us = (std::clock() - start) * 1000000L / CLOCKS_PER_SEC;
+    unsigned set_calls = stack.recv_calls;
+    EXPECT_EQ(received, num_ready * num_rounds);
+
+    printf("%d sockets, %d ready per round: scan %u recv calls in %ld us, SocketSet %u recv calls in %ld us\n",
+           num_sockets, num_ready, scan_calls, scan_us, set_calls, set_us);
+    EXPECT_EQ(set_calls, 2u * num_ready * num_rounds);
+    EXPECT_LT(set_calls * 10, scan_calls);
+
+    for (int i = 0; i < num_sockets; i++) {
+        set.remove(&sockets[i]);
+    }
+    delete[] sockets;
+}
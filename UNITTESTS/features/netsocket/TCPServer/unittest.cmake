@@ -9,6 +9,8 @@ set(TEST_SUITE_NAME "features_netsocket_TCPServer")
 set(unittest-sources
   ../features/netsocket/SocketAddress.cpp
   ../features/netsocket/NetworkStack.cpp
+  ../features/netsocket/NetStackMemoryManager.cpp
+  ../features/netsocket/HeapMemoryManager.cpp
   ../features/netsocket/InternetSocket.cpp
   ../features/netsocket/TCPSocket.cpp
   ../features/netsocket/TCPServer.cpp
@@ -18,6 +18,7 @@
 #include "gtest/gtest.h"
 #include "features/netsocket/TCPSocket.h"
 #include "NetworkStack_stub.h"
+#include "features/netsocket/NetStackMemoryManager.h"
 
 // Control the rtos EventFlags stub. See EventFlags_stub.cpp
 extern std::list<uint32_t> eventFlagsStubNextRetval;
@@ -286,3 +287,62 @@ TEST_F(TestTCPSocket, accept_would_block)
     EXPECT_EQ(socket->accept(&error), static_cast<TCPSocket *>(NULL));
     EXPECT_EQ(error, NSAPI_ERROR_WOULD_BLOCK);
 }
+
+/* zero-copy */
+
+TEST_F(TestTCPSocket, send_buf)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    net_stack_mem_buf_t *buf = memory_manager->alloc_pool(dataSize, 0);
+    memory_manager->cat(buf, memory_manager->alloc_pool(dataSize, 0));
+
+    // Each buffer of the chain is sent in turn
+    stack.return_value = dataSize;
+    EXPECT_EQ(socket->send_buf(buf), 2 * dataSize);
+
+    // A partial send stops at the buffer not sent completely
+    socket->set_blocking(false);
+    stack.return_values.push_back(dataSize - 1);
+    stack.return_values.push_back(dataSize);
+    EXPECT_EQ(socket->send_buf(buf), dataSize - 1);
+    stack.return_values.clear();
+
+    stack.return_value = NSAPI_ERROR_WOULD_BLOCK;
+    EXPECT_EQ(socket->send_buf(buf), NSAPI_ERROR_WOULD_BLOCK);
+    memory_manager->free(buf);
+}
+
+TEST_F(TestTCPSocket, send_buf_no_open)
+{
+    EXPECT_EQ(socket->send_buf(NULL), NSAPI_ERROR_NO_SOCKET);
+}
+
+TEST_F(TestTCPSocket, recv_buf)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    net_stack_mem_buf_t *buf;
+
+    stack.return_value = dataSize;
+    EXPECT_EQ(socket->recv_buf(&buf, 100), dataSize);
+    ASSERT_NE(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+    EXPECT_EQ(memory_manager->get_total_len(buf), dataSize);
+    memory_manager->free(buf);
+
+    // Orderly shutdown
+    stack.return_value = 0;
+    EXPECT_EQ(socket->recv_buf(&buf, 100), 0);
+    EXPECT_EQ(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+}
+
+TEST_F(TestTCPSocket, recv_buf_would_block)
+{
+    socket->open((NetworkStack *)&stack);
+    net_stack_mem_buf_t *buf;
+    stack.return_value = NSAPI_ERROR_WOULD_BLOCK;
+    eventFlagsStubNextRetval.push_back(0);
+    eventFlagsStubNextRetval.push_back(osFlagsError); // Break the wait loop
+    EXPECT_EQ(socket->recv_buf(&buf, 100), NSAPI_ERROR_WOULD_BLOCK);
+    EXPECT_EQ(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+}
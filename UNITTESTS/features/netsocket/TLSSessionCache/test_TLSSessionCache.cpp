@@ -0,0 +1,553 @@
+/*
+ * Copyright (c) 2019, Arm Limited and affiliates
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "features/netsocket/TLSSocketWrapper.h"
+#include "features/netsocket/TLSSessionCache.h"
+#include "KVStore.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/entropy_poll.h"
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mbed_error.h"
+mbed_error_status_t mbed_error(mbed_error_status_t error_status, const char *error_msg, unsigned int error_value, const char *filename, int line_number)
+{
+    return 0;
+}
+
+int mbedtls_hardware_poll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (!urandom) {
+        return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+    }
+    *olen = fread(output, 1, len, urandom);
+    fclose(urandom);
+    return 0;
+}
+
+/** KVStore kept in RAM */
+class MemoryKVStore : public mbed::KVStore {
+public:
+    struct value_t {
+        std::vector<unsigned char> data;
+        uint32_t flags;
+    };
+    std::map<std::string, value_t> values;
+
+    virtual int init()
+    {
+        return 0;
+    }
+    virtual int deinit()
+    {
+        return 0;
+    }
+    virtual int reset()
+    {
+        values.clear();
+        return 0;
+    }
+    virtual int set(const char *key, const void *buffer, size_t size, uint32_t create_flags)
+    {
+        if (!is_valid_key(key)) {
+            return MBED_ERROR_INVALID_ARGUMENT;
+        }
+        const unsigned char *data = static_cast<const unsigned char *>(buffer);
+        values[key].data.assign(data, data + size);
+        values[key].flags = create_flags;
+        return 0;
+    }
+    virtual int get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size = NULL, size_t offset = 0)
+    {
+        std::map<std::string, value_t>::iterator it = values.find(key);
+        if (it == values.end()) {
+            return MBED_ERROR_ITEM_NOT_FOUND;
+        }
+        size_t size = std::min(buffer_size, it->second.data.size() - offset);
+        memcpy(buffer, &it->second.data[offset], size);
+        if (actual_size) {
+            *actual_size = size;
+        }
+        return 0;
+    }
+    virtual int get_info(const char *key, info_t *info = NULL)
+    {
+        std::map<std::string, value_t>::iterator it = values.find(key);
+        if (it == values.end()) {
+            return MBED_ERROR_ITEM_NOT_FOUND;
+        }
+        if (info) {
+            info->size = it->second.data.size();
+            info->flags = it->second.flags;
+        }
+        return 0;
+    }
+    virtual int remove(const char *key)
+    {
+        return values.erase(key) ? 0 : MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    virtual int set_start(set_handle_t *handle, const char *key, size_t final_data_size, uint32_t create_flags)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    virtual int set_add_data(set_handle_t handle, const void *value_data, size_t data_size)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    virtual int set_finalize(set_handle_t handle)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    virtual int iterator_open(iterator_t *it, const char *prefix = NULL)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    virtual int iterator_next(iterator_t it, char *key, size_t key_size)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+    virtual int iterator_close(iterator_t it)
+    {
+        return MBED_ERROR_UNSUPPORTED;
+    }
+};
+
+/** Mbed TLS server stand-in, run by the client transport whenever it sends or lacks data */
+class TLSServer {
+public:
+    std::deque<unsigned char> to_server;
+    std::deque<unsigned char> to_client;
+    int cache_hits;
+    int ticket_hits;
+
+    TLSServer(bool tickets) : cache_hits(0), ticket_hits(0)
+    {
+        const char pers[] = "TLSServer";
+        mbedtls_entropy_init(&_entropy);
+        mbedtls_ctr_drbg_init(&_ctr_drbg);
+        mbedtls_x509_crt_init(&_crt);
+        mbedtls_pk_init(&_key);
+        mbedtls_ssl_config_init(&_conf);
+        mbedtls_ssl_cache_init(&_cache);
+        mbedtls_ssl_ticket_init(&_ticket);
+        mbedtls_ssl_init(&_ssl);
+
+        EXPECT_EQ(0, mbedtls_ctr_drbg_seed(&_ctr_drbg, mbedtls_entropy_func, &_entropy,
+                                           (const unsigned char *) pers, sizeof(pers)));
+        EXPECT_EQ(0, mbedtls_x509_crt_parse(&_crt, (const unsigned char *) mbedtls_test_srv_crt_ec,
+                                            mbedtls_test_srv_crt_ec_len));
+        EXPECT_EQ(0, mbedtls_pk_parse_key(&_key, (const unsigned char *) mbedtls_test_srv_key_ec,
+                                          mbedtls_test_srv_key_ec_len, NULL, 0));
+        EXPECT_EQ(0, mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                                 MBEDTLS_SSL_PRESET_DEFAULT));
+        mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_ctr_drbg);
+        EXPECT_EQ(0, mbedtls_ssl_conf_own_cert(&_conf, &_crt, &_key));
+        mbedtls_ssl_conf_session_cache(&_conf, this, cache_get, cache_set);
+        if (tickets) {
+            EXPECT_EQ(0, mbedtls_ssl_ticket_setup(&_ticket, mbedtls_ctr_drbg_random, &_ctr_drbg,
+                                                  MBEDTLS_CIPHER_AES_256_GCM, 86400));
+            mbedtls_ssl_conf_session_tickets_cb(&_conf, ticket_write, ticket_parse, this);
+        }
+        EXPECT_EQ(0, mbedtls_ssl_setup(&_ssl, &_conf));
+        mbedtls_ssl_set_bio(&_ssl, this, bio_send, bio_recv, NULL);
+    }
+
+    ~TLSServer()
+    {
+        mbedtls_ssl_free(&_ssl);
+        mbedtls_ssl_ticket_free(&_ticket);
+        mbedtls_ssl_cache_free(&_cache);
+        mbedtls_ssl_config_free(&_conf);
+        mbedtls_pk_free(&_key);
+        mbedtls_x509_crt_free(&_crt);
+        mbedtls_ctr_drbg_free(&_ctr_drbg);
+        mbedtls_entropy_free(&_entropy);
+    }
+
+    /** Accept a new connection */
+    void reset()
+    {
+        to_server.clear();
+        to_client.clear();
+        mbedtls_ssl_session_reset(&_ssl);
+    }
+
+    /** Handshake, then echo the application data */
+    void run()
+    {
+        if (_ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+            if (mbedtls_ssl_handshake(&_ssl) != 0) {
+                return;
+            }
+        }
+        unsigned char buf[64];
+        int ret = mbedtls_ssl_read(&_ssl, buf, sizeof(buf));
+        if (ret > 0) {
+            mbedtls_ssl_write(&_ssl, buf, ret);
+        }
+    }
+
+private:
+    static int bio_send(void *ctx, const unsigned char *buf, size_t len)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        server->to_client.insert(server->to_client.end(), buf, buf + len);
+        return len;
+    }
+
+    static int bio_recv(void *ctx, unsigned char *buf, size_t len)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        if (server->to_server.empty()) {
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        }
+        len = std::min(len, server->to_server.size());
+        std::copy(server->to_server.begin(), server->to_server.begin() + len, buf);
+        server->to_server.erase(server->to_server.begin(), server->to_server.begin() + len);
+        return len;
+    }
+
+    static int cache_get(void *ctx, mbedtls_ssl_session *session)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        int ret = mbedtls_ssl_cache_get(&server->_cache, session);
+        if (ret == 0) {
+            server->cache_hits++;
+        }
+        return ret;
+    }
+
+    static int cache_set(void *ctx, const mbedtls_ssl_session *session)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        return mbedtls_ssl_cache_set(&server->_cache, session);
+    }
+
+    static int ticket_write(void *ctx, const mbedtls_ssl_session *session, unsigned char *start,
+                            const unsigned char *end, size_t *tlen, uint32_t *lifetime)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        return mbedtls_ssl_ticket_write(&server->_ticket, session, start, end, tlen, lifetime);
+    }
+
+    static int ticket_parse(void *ctx, mbedtls_ssl_session *session, unsigned char *buf, size_t len)
+    {
+        TLSServer *server = static_cast<TLSServer *>(ctx);
+        int ret = mbedtls_ssl_ticket_parse(&server->_ticket, session, buf, len);
+        if (ret == 0) {
+            server->ticket_hits++;
+        }
+        return ret;
+    }
+
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _ctr_drbg;
+    mbedtls_x509_crt _crt;
+    mbedtls_pk_context _key;
+    mbedtls_ssl_config _conf;
+    mbedtls_ssl_cache_context _cache;
+    mbedtls_ssl_ticket_context _ticket;
+    mbedtls_ssl_context _ssl;
+};
+
+/** Client transport connected in-process to the server */
+class LoopbackSocket : public Socket {
+public:
+    LoopbackSocket(TLSServer *server) : _server(server) {}
+
+    virtual nsapi_error_t close()
+    {
+        return NSAPI_ERROR_OK;
+    }
+    virtual nsapi_error_t connect(const SocketAddress &address)
+    {
+        _server->reset();
+        return NSAPI_ERROR_OK;
+    }
+    virtual nsapi_size_or_error_t send(const void *data, nsapi_size_t size)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        _server->to_server.insert(_server->to_server.end(), p, p + size);
+        _server->run();
+        return size;
+    }
+    virtual nsapi_size_or_error_t recv(void *data, nsapi_size_t size)
+    {
+        if (_server->to_client.empty()) {
+            _server->run();
+        }
+        if (_server->to_client.empty()) {
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        size = std::min((size_t) size, _server->to_client.size());
+        std::copy(_server->to_client.begin(), _server->to_client.begin() + size, static_cast<unsigned char *>(data));
+        _server->to_client.erase(_server->to_client.begin(), _server->to_client.begin() + size);
+        return size;
+    }
+    virtual nsapi_size_or_error_t sendto(const SocketAddress &address, const void *data, nsapi_size_t size)
+    {
+        return send(data, size);
+    }
+    virtual nsapi_size_or_error_t recvfrom(SocketAddress *address, void *data, nsapi_size_t size)
+    {
+        return recv(data, size);
+    }
+    virtual nsapi_error_t bind(const SocketAddress &address)
+    {
+        return NSAPI_ERROR_OK;
+    }
+    virtual void set_blocking(bool blocking) {}
+    virtual void set_timeout(int timeout) {}
+    virtual void sigio(mbed::Callback<void()> func) {}
+    virtual nsapi_error_t setsockopt(int level, int optname, const void *optval, unsigned optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t getsockopt(int level, int optname, void *optval, unsigned *optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual Socket *accept(nsapi_error_t *error = NULL)
+    {
+        return NULL;
+    }
+    virtual nsapi_error_t listen(int backlog = 1)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t getpeername(SocketAddress *address)
+    {
+        return NSAPI_ERROR_OK;
+    }
+
+private:
+    TLSServer *_server;
+};
+
+class TestTLSSessionCache : public testing::Test {
+protected:
+    TLSSessionCache *cache;
+    TLSServer *server;
+    MemoryKVStore kvstore;
+
+    virtual void SetUp()
+    {
+        cache = new TLSSessionCache(3);
+        server = new TLSServer(true);
+    }
+
+    virtual void TearDown()
+    {
+        delete server;
+        delete cache;
+    }
+
+    /** Connect to the server, exchange data and close, returning the connect() result */
+    nsapi_error_t connect(TLSSessionCache *session_cache, const char *hostname = "localhost")
+    {
+        LoopbackSocket transport(server);
+        TLSSocketWrapper wrapper(&transport, hostname);
+        wrapper.set_session_cache(session_cache);
+        wrapper.set_root_ca_cert(mbedtls_test_ca_crt_ec, mbedtls_test_ca_crt_ec_len);
+
+        nsapi_error_t ret = wrapper.connect();
+        if (ret == NSAPI_ERROR_OK) {
+            char buf[4];
+            EXPECT_EQ(4, wrapper.send("ping", 4));
+            EXPECT_EQ(4, wrapper.recv(buf, 4));
+            EXPECT_EQ(0, memcmp(buf, "ping", 4));
+        }
+        wrapper.close();
+        return ret;
+    }
+
+    int resumptions()
+    {
+        return server->cache_hits + server->ticket_hits;
+    }
+};
+
+TEST_F(TestTLSSessionCache, constructor)
+{
+    EXPECT_TRUE(cache);
+}
+
+TEST_F(TestTLSSessionCache, resume_with_ticket)
+{
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(1, server->ticket_hits);
+    EXPECT_EQ(0, server->cache_hits);
+
+    // The renewed ticket is stored and used again
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(2, server->ticket_hits);
+}
+
+TEST_F(TestTLSSessionCache, resume_with_session_id)
+{
+    delete server;
+    server = new TLSServer(false);
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(1, server->cache_hits);
+    EXPECT_EQ(0, server->ticket_hits);
+}
+
+TEST_F(TestTLSSessionCache, no_cache)
+{
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(NULL));
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(NULL));
+    EXPECT_EQ(0, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, session_rejected)
+{
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+
+    // Restarted server, with new ticket keys and an empty cache
+    delete server;
+    server = new TLSServer(true);
+
+    // Falls back to a full handshake, and stores the new session
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(1, server->ticket_hits);
+}
+
+TEST_F(TestTLSSessionCache, unverified_host)
+{
+    LoopbackSocket transport(server);
+    TLSSocketWrapper wrapper(&transport, "localhost");
+    wrapper.set_session_cache(cache);
+    mbedtls_ssl_conf_authmode(wrapper.get_ssl_config(), MBEDTLS_SSL_VERIFY_OPTIONAL);
+    EXPECT_EQ(NSAPI_ERROR_OK, wrapper.connect());
+    wrapper.close();
+
+    // No root CA, so the session was not stored
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, remove)
+{
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    cache->remove("localhost");
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, clear)
+{
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    cache->clear();
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, least_recently_used_replaced)
+{
+    TLSSessionCache small_cache(1);
+
+    LoopbackSocket transport(server);
+    TLSSocketWrapper wrapper(&transport, "localhost");
+    wrapper.set_session_cache(&small_cache);
+    wrapper.set_root_ca_cert(mbedtls_test_ca_crt_ec, mbedtls_test_ca_crt_ec_len);
+    EXPECT_EQ(NSAPI_ERROR_OK, wrapper.connect());
+    EXPECT_EQ(NSAPI_ERROR_OK, small_cache.store("example.com", wrapper.get_ssl_context()));
+    wrapper.close();
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(&small_cache));
+    EXPECT_EQ(0, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, store_without_session)
+{
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_init(&ssl);
+    EXPECT_EQ(NSAPI_ERROR_PARAMETER, cache->store("localhost", &ssl));
+    EXPECT_EQ(NSAPI_ERROR_PARAMETER, cache->store(NULL, &ssl));
+    EXPECT_FALSE(cache->load(NULL, &ssl));
+    mbedtls_ssl_free(&ssl);
+}
+
+TEST_F(TestTLSSessionCache, kvstore)
+{
+    cache->set_kvstore(&kvstore);
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+
+    ASSERT_EQ(1, kvstore.values.count("tls_localhost"));
+    EXPECT_EQ(mbed::KVStore::REQUIRE_CONFIDENTIALITY_FLAG, kvstore.values["tls_localhost"].flags);
+
+    // A new cache, as after a reboot, reads the session back
+    TLSSessionCache new_cache(3);
+    new_cache.set_kvstore(&kvstore, "tls_", 0);
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(&new_cache));
+    EXPECT_EQ(1, resumptions());
+
+    new_cache.remove("localhost");
+    EXPECT_EQ(0, kvstore.values.count("tls_localhost"));
+}
+
+TEST_F(TestTLSSessionCache, kvstore_only)
+{
+    TLSSessionCache no_ram_cache(0);
+    no_ram_cache.set_kvstore(&kvstore);
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(&no_ram_cache));
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(&no_ram_cache));
+    EXPECT_EQ(1, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, kvstore_invalid_key)
+{
+    cache->set_kvstore(&kvstore, "tls:");
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_TRUE(kvstore.values.empty());
+
+    // Still kept in RAM
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(1, resumptions());
+}
+
+TEST_F(TestTLSSessionCache, kvstore_invalid_session)
+{
+    kvstore.values["tls_localhost"].data.assign(200, 0x55);
+    cache->set_kvstore(&kvstore);
+
+    EXPECT_EQ(NSAPI_ERROR_OK, connect(cache));
+    EXPECT_EQ(0, resumptions());
+
+    // Replaced by the new session
+    ASSERT_EQ(1, kvstore.values.count("tls_localhost"));
+    EXPECT_NE(std::vector<unsigned char>(200, 0x55), kvstore.values["tls_localhost"].data);
+}
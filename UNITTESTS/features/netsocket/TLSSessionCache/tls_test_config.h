@@ -0,0 +1,27 @@
+/*
+ * tls_test_config.h
+ *
+ * Real Mbed TLS client and server, on top of the no-entropy configuration
+ * used by the unit tests. Entropy comes from mbedtls_hardware_poll(), as on
+ * targets with a TRNG, implemented by the test on the host.
+ */
+
+#ifndef UNITTESTS_FEATURES_NETSOCKET_TLSSESSIONCACHE_TLS_TEST_CONFIG_H_
+#define UNITTESTS_FEATURES_NETSOCKET_TLSSESSIONCACHE_TLS_TEST_CONFIG_H_
+
+#define MBEDTLS_NO_PLATFORM_ENTROPY
+#define MBEDTLS_ENTROPY_HARDWARE_ALT
+#define MBEDTLS_ENTROPY_C
+#define MBEDTLS_CTR_DRBG_C
+#define MBEDTLS_ECDH_C
+#define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
+#define MBEDTLS_SSL_PROTO_TLS1_2
+#define MBEDTLS_SSL_TLS_C
+#define MBEDTLS_SSL_CLI_C
+#define MBEDTLS_SSL_SRV_C
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_SESSION_TICKETS
+#define MBEDTLS_CERTS_C
+
+#endif /* UNITTESTS_FEATURES_NETSOCKET_TLSSESSIONCACHE_TLS_TEST_CONFIG_H_ */
@@ -0,0 +1,71 @@
+
+####################
+# UNIT TESTS
+####################
+
+set(unittest-sources
+  ../features/netsocket/SocketAddress.cpp
+  ../features/netsocket/TLSSocketWrapper.cpp
+  ../features/netsocket/TLSSessionCache.cpp
+  ../features/storage/kvstore/KVStore.cpp
+  ../features/mbedtls/src/aes.c
+  ../features/mbedtls/src/asn1parse.c
+  ../features/mbedtls/src/asn1write.c
+  ../features/mbedtls/src/base64.c
+  ../features/mbedtls/src/bignum.c
+  ../features/mbedtls/src/ccm.c
+  ../features/mbedtls/src/certs.c
+  ../features/mbedtls/src/cipher.c
+  ../features/mbedtls/src/cipher_wrap.c
+  ../features/mbedtls/src/cmac.c
+  ../features/mbedtls/src/ctr_drbg.c
+  ../features/mbedtls/src/ecdh.c
+  ../features/mbedtls/src/ecdsa.c
+  ../features/mbedtls/src/ecp.c
+  ../features/mbedtls/src/ecp_curves.c
+  ../features/mbedtls/src/entropy.c
+  ../features/mbedtls/src/entropy_poll.c
+  ../features/mbedtls/src/gcm.c
+  ../features/mbedtls/src/hmac_drbg.c
+  ../features/mbedtls/src/md.c
+  ../features/mbedtls/src/md_wrap.c
+  ../features/mbedtls/src/oid.c
+  ../features/mbedtls/src/pem.c
+  ../features/mbedtls/src/pk.c
+  ../features/mbedtls/src/pk_wrap.c
+  ../features/mbedtls/src/pkparse.c
+  ../features/mbedtls/src/platform.c
+  ../features/mbedtls/src/platform_util.c
+  ../features/mbedtls/src/rsa.c
+  ../features/mbedtls/src/rsa_internal.c
+  ../features/mbedtls/src/sha256.c
+  ../features/mbedtls/src/sha512.c
+  ../features/mbedtls/src/ssl_cache.c
+  ../features/mbedtls/src/ssl_ciphersuites.c
+  ../features/mbedtls/src/ssl_cli.c
+  ../features/mbedtls/src/ssl_srv.c
+  ../features/mbedtls/src/ssl_ticket.c
+  ../features/mbedtls/src/ssl_tls.c
+  ../features/mbedtls/src/x509.c
+  ../features/mbedtls/src/x509_crl.c
+  ../features/mbedtls/src/x509_crt.c
+  ../features/frameworks/nanostack-libservice/source/libip4string/ip4tos.c
+  ../features/frameworks/nanostack-libservice/source/libip6string/ip6tos.c
+  ../features/frameworks/nanostack-libservice/source/libip4string/stoip4.c
+  ../features/frameworks/nanostack-libservice/source/libip6string/stoip6.c
+  ../features/frameworks/nanostack-libservice/source/libBits/common_functions.c
+)
+
+set(unittest-includes ${unittest-includes}
+  ../features/storage/kvstore
+)
+
+set(unittest-test-sources
+  features/netsocket/TLSSessionCache/test_TLSSessionCache.cpp
+  stubs/Mutex_stub.cpp
+  stubs/mbed_assert_stub.c
+  stubs/EventFlags_stub.cpp
+)
+
+set(MBEDTLS_USER_CONFIG_FILE_PATH "\"../UNITTESTS/features/netsocket/TLSSessionCache/tls_test_config.h\"")
+set(unittest-definitions MBEDTLS_USER_CONFIG_FILE=${MBEDTLS_USER_CONFIG_FILE_PATH})
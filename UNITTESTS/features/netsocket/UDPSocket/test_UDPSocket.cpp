@@ -19,6 +19,7 @@
 #include "features/netsocket/UDPSocket.h"
 #include "features/netsocket/nsapi_dns.h"
 #include "NetworkStack_stub.h"
+#include "features/netsocket/NetStackMemoryManager.h"
 
 /**
  * This test needs to access a private function
@@ -34,6 +35,41 @@ class UDPSocketFriend : public UDPSocket {
 // Control the rtos EventFlags stub. See EventFlags_stub.cpp
 extern std::list<uint32_t> eventFlagsStubNextRetval;
 
+// Stack keeping the datagrams sent, and delivering the incoming ones in turn
+class DatagramNetworkStack : public NetworkStackstub {
+public:
+    typedef std::pair<SocketAddress, std::string> datagram_t;
+    std::vector<datagram_t> sent;
+    std::list<datagram_t> incoming;
+    unsigned send_limit;
+
+    DatagramNetworkStack() : send_limit(100) {}
+
+protected:
+    virtual nsapi_size_or_error_t socket_sendto(nsapi_socket_t handle, const SocketAddress &address,
+                                                const void *data, nsapi_size_t size)
+    {
+        if (sent.size() >= send_limit) {
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        sent.push_back(datagram_t(address, std::string(static_cast<const char *>(data), size)));
+        return size;
+    }
+
+    virtual nsapi_size_or_error_t socket_recvfrom(nsapi_socket_t handle, SocketAddress *address,
+                                                  void *buffer, nsapi_size_t size)
+    {
+        if (incoming.empty()) {
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        *address = incoming.front().first;
+        nsapi_size_t len = std::min<nsapi_size_t>(size, incoming.front().second.size());
+        memcpy(buffer, incoming.front().second.data(), len);
+        incoming.pop_front();
+        return len;
+    }
+};
+
 class TestUDPSocket : public testing::Test {
 protected:
     UDPSocket *socket;
@@ -142,6 +178,227 @@ TEST_F(TestUDPSocket, recv_address_filtering)
     EXPECT_EQ(socket->recvfrom(&a1, &dataBuf, dataSize), 100);
 }
 
+/* zero-copy */
+
+TEST_F(TestUDPSocket, get_memory_manager)
+{
+    EXPECT_EQ(socket->get_memory_manager(), static_cast<NetStackMemoryManager *>(NULL));
+    socket->open((NetworkStack *)&stack);
+    EXPECT_NE(socket->get_memory_manager(), static_cast<NetStackMemoryManager *>(NULL));
+}
+
+TEST_F(TestUDPSocket, sendto_buf)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    SocketAddress a("127.0.0.1", 1024);
+
+    // Contiguous buffer, and chain gathered by the stack
+    net_stack_mem_buf_t *buf = memory_manager->alloc_pool(dataSize, 0);
+    stack.return_value = dataSize;
+    EXPECT_EQ(socket->sendto_buf(a, buf), dataSize);
+    memory_manager->cat(buf, memory_manager->alloc_heap(dataSize, 4));
+    EXPECT_EQ(memory_manager->get_total_len(buf), 2 * dataSize);
+    stack.return_value = 2 * dataSize;
+    EXPECT_EQ(socket->sendto_buf(a, buf), 2 * dataSize);
+    memory_manager->free(buf);
+}
+
+TEST_F(TestUDPSocket, send_buf_no_address)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    net_stack_mem_buf_t *buf = memory_manager->alloc_pool(dataSize, 0);
+    EXPECT_EQ(socket->send_buf(buf), NSAPI_ERROR_NO_ADDRESS);
+    memory_manager->free(buf);
+}
+
+TEST_F(TestUDPSocket, recv_buf)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    net_stack_mem_buf_t *buf;
+
+    stack.return_value = dataSize;
+    EXPECT_EQ(socket->recv_buf(&buf, 100), dataSize);
+    ASSERT_NE(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+    EXPECT_EQ(memory_manager->get_total_len(buf), dataSize);
+    memory_manager->free(buf);
+
+    socket->set_blocking(false);
+    stack.return_value = NSAPI_ERROR_WOULD_BLOCK;
+    EXPECT_EQ(socket->recv_buf(&buf, 100), NSAPI_ERROR_WOULD_BLOCK);
+    EXPECT_EQ(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+}
+
+TEST_F(TestUDPSocket, recvfrom_buf_address_filtering)
+{
+    socket->open((NetworkStack *)&stack);
+    NetStackMemoryManager *memory_manager = socket->get_memory_manager();
+    const nsapi_addr_t addr1 = {NSAPI_IPv4, {127, 0, 0, 1} };
+    const nsapi_addr_t addr2 = {NSAPI_IPv4, {127, 0, 0, 2} };
+    SocketAddress a1(addr1, 1024);
+    SocketAddress a2(addr2, 1024);
+    SocketAddress from;
+    net_stack_mem_buf_t *buf;
+
+    EXPECT_EQ(socket->connect(a1), NSAPI_ERROR_OK);
+
+    // The buffer of the filtered packet is freed
+    stack.return_socketAddress = a2;
+    stack.return_values.push_back(100);
+    stack.return_values.push_back(NSAPI_ERROR_NO_MEMORY);
+    EXPECT_EQ(socket->recvfrom_buf(&from, &buf, 100), NSAPI_ERROR_NO_MEMORY);
+    EXPECT_EQ(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+
+    stack.return_socketAddress = a1;
+    stack.return_values.push_back(100);
+    EXPECT_EQ(socket->recvfrom_buf(&from, &buf, 100), 100);
+    EXPECT_EQ(from, a1);
+    ASSERT_NE(buf, static_cast<net_stack_mem_buf_t *>(NULL));
+    memory_manager->free(buf);
+}
+
+TEST_F(TestUDPSocket, sendto_batch)
+{
+    DatagramNetworkStack dgram_stack;
+    UDPSocket udp;
+    udp.open((NetworkStack *)&dgram_stack);
+    SocketAddress a1("127.0.0.1", 1024);
+    SocketAddress a2("127.0.0.2", 1025);
+    char header[] = "hdr:";
+    char body[] = "body";
+    nsapi_iovec_t iov1[] = {{header, 4}, {body, 4}};
+    nsapi_iovec_t iov2[] = {{body, 4}};
+    nsapi_datagram_t datagrams[3];
+    datagrams[0].address = a1;
+    datagrams[0].iov = iov1;
+    datagrams[0].iov_count = 2;
+    datagrams[1].address = a2;
+    datagrams[1].iov = iov2;
+    datagrams[1].iov_count = 1;
+    datagrams[2].address = a1;
+    datagrams[2].iov = NULL;
+    datagrams[2].iov_count = 0;
+
+    EXPECT_EQ(udp.sendto_batch(datagrams, 0), 0);
+
+    // Buffers are gathered, and empty datagrams are sent too
+    EXPECT_EQ(udp.sendto_batch(datagrams, 3), 3);
+    ASSERT_EQ(dgram_stack.sent.size(), 3u);
+    EXPECT_EQ(dgram_stack.sent[0].first, a1);
+    EXPECT_EQ(dgram_stack.sent[0].second, "hdr:body");
+    EXPECT_EQ(datagrams[0].size, 8u);
+    EXPECT_EQ(dgram_stack.sent[1].first, a2);
+    EXPECT_EQ(dgram_stack.sent[1].second, "body");
+    EXPECT_EQ(datagrams[1].size, 4u);
+    EXPECT_EQ(dgram_stack.sent[2].second, "");
+    EXPECT_EQ(datagrams[2].size, 0u);
+}
+
+TEST_F(TestUDPSocket, sendto_batch_would_block)
+{
+    DatagramNetworkStack dgram_stack;
+    UDPSocket udp;
+    EXPECT_EQ(udp.sendto_batch(NULL, 0), 0);
+    nsapi_datagram_t datagrams[3];
+    char data[] = "data";
+    nsapi_iovec_t iov = {data, 4};
+    for (int i = 0; i < 3; i++) {
+        datagrams[i].address = SocketAddress("127.0.0.1", 1024);
+        datagrams[i].iov = &iov;
+        datagrams[i].iov_count = 1;
+    }
+    EXPECT_EQ(udp.sendto_batch(datagrams, 3), NSAPI_ERROR_NO_SOCKET);
+    udp.open((NetworkStack *)&dgram_stack);
+
+    // The datagrams sent before the stack blocks are reported
+    udp.set_blocking(false);
+    dgram_stack.send_limit = 1;
+    EXPECT_EQ(udp.sendto_batch(datagrams, 3), 1);
+    EXPECT_EQ(udp.sendto_batch(datagrams + 1, 2), NSAPI_ERROR_WOULD_BLOCK);
+
+    udp.set_blocking(true);
+    eventFlagsStubNextRetval.push_back(osFlagsErrorTimeout);
+    dgram_stack.send_limit = 2;
+    EXPECT_EQ(udp.sendto_batch(datagrams + 1, 2), 1);
+    EXPECT_EQ(dgram_stack.sent.size(), 2u);
+}
+
+TEST_F(TestUDPSocket, recvfrom_batch)
+{
+    DatagramNetworkStack dgram_stack;
+    UDPSocket udp;
+    udp.open((NetworkStack *)&dgram_stack);
+    udp.set_blocking(false);
+    SocketAddress a1("127.0.0.1", 1024);
+    SocketAddress a2("127.0.0.2", 1025);
+    char buf[3][2][4];
+    nsapi_iovec_t iov[3][2];
+    nsapi_datagram_t datagrams[3];
+    for (int i = 0; i < 3; i++) {
+        iov[i][0].iov_base = buf[i][0];
+        iov[i][0].iov_len = 4;
+        iov[i][1].iov_base = buf[i][1];
+        iov[i][1].iov_len = 4;
+        datagrams[i].iov = iov[i];
+        datagrams[i].iov_count = 2;
+    }
+
+    EXPECT_EQ(udp.recvfrom_batch(datagrams, 3), NSAPI_ERROR_WOULD_BLOCK);
+
+    // Data is scattered to the buffers and truncated to their size,
+    // the pending datagrams are returned
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a1, "abcdef"));
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a2, "0123456789"));
+    EXPECT_EQ(udp.recvfrom_batch(datagrams, 3), 2);
+    EXPECT_EQ(datagrams[0].address, a1);
+    EXPECT_EQ(datagrams[0].size, 6u);
+    EXPECT_EQ(std::string(buf[0][0], 4), "abcd");
+    EXPECT_EQ(std::string(buf[0][1], 2), "ef");
+    EXPECT_EQ(datagrams[1].address, a2);
+    EXPECT_EQ(datagrams[1].size, 8u);
+    EXPECT_EQ(std::string(buf[1][0], 4), "0123");
+    EXPECT_EQ(std::string(buf[1][1], 4), "4567");
+}
+
+TEST_F(TestUDPSocket, recvfrom_batch_address_filtering)
+{
+    DatagramNetworkStack dgram_stack;
+    UDPSocket udp;
+    udp.open((NetworkStack *)&dgram_stack);
+    udp.set_blocking(false);
+    SocketAddress a1("127.0.0.1", 1024);
+    SocketAddress a2("127.0.0.2", 1024);
+    char buf[2][4];
+    nsapi_iovec_t iov[2] = {{buf[0], 4}, {buf[1], 4}};
+    nsapi_datagram_t datagrams[2];
+    datagrams[0].iov = &iov[0];
+    datagrams[0].iov_count = 1;
+    datagrams[1].iov = &iov[1];
+    datagrams[1].iov_count = 1;
+
+    EXPECT_EQ(udp.connect(a1), NSAPI_ERROR_OK);
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a2, "drop"));
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a1, "keep"));
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a2, "drop"));
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a1, "more"));
+
+    // Datagrams from other peers are dropped, and replaced by the following ones.
+    // The entries are reordered, each one keeps its buffer.
+    EXPECT_EQ(udp.recvfrom_batch(datagrams, 2), 2);
+    EXPECT_EQ(datagrams[0].address, a1);
+    EXPECT_EQ(datagrams[0].iov, &iov[1]);
+    EXPECT_EQ(std::string(buf[1], 4), "keep");
+    EXPECT_EQ(datagrams[1].address, a1);
+    EXPECT_EQ(datagrams[1].iov, &iov[0]);
+    EXPECT_EQ(std::string(buf[0], 4), "more");
+    EXPECT_TRUE(dgram_stack.incoming.empty());
+
+    dgram_stack.incoming.push_back(DatagramNetworkStack::datagram_t(a2, "drop"));
+    EXPECT_EQ(udp.recvfrom_batch(datagrams, 2), NSAPI_ERROR_WOULD_BLOCK);
+}
+
 TEST_F(TestUDPSocket, unsupported_api)
 {
     nsapi_error_t error;
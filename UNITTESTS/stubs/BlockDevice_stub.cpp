@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2019, Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlockDevice.h"
+
+namespace mbed {
+
+int BlockDevice::read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int BlockDevice::program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int BlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+} // namespace mbed
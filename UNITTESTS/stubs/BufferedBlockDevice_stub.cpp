@@ -69,6 +69,21 @@ int BufferedBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int BufferedBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int BufferedBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int BufferedBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
 int BufferedBlockDevice::trim(bd_addr_t addr, bd_size_t size)
 {
     return 0;
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) , Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CachingBlockDevice.h"
+
+CachingBlockDevice::CachingBlockDevice(BlockDevice *bd, uint32_t line_count, uint32_t ways)
+{
+}
+
+CachingBlockDevice::~CachingBlockDevice()
+{
+}
+
+int CachingBlockDevice::init()
+{
+    return 0;
+}
+
+int CachingBlockDevice::deinit()
+{
+    return 0;
+}
+
+int CachingBlockDevice::find_line(bd_addr_t addr) const
+{
+    return -1;
+}
+
+int CachingBlockDevice::alloc_line(bd_addr_t addr, bool fill, int &line)
+{
+    return 0;
+}
+
+int CachingBlockDevice::write_back(int line)
+{
+    return 0;
+}
+
+int CachingBlockDevice::flush()
+{
+    return 0;
+}
+
+void CachingBlockDevice::invalidate(bd_addr_t addr, bd_size_t size)
+{
+}
+
+int CachingBlockDevice::sync()
+{
+    return 0;
+}
+
+int CachingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int CachingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int CachingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int CachingBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_read_size() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_program_size() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_erase_size() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return 0;
+}
+
+int CachingBlockDevice::get_erase_value() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::size() const
+{
+    return 0;
+}
+
+void CachingBlockDevice::reset_stats()
+{
+}
+
+bd_size_t CachingBlockDevice::get_hit_count() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_miss_count() const
+{
+    return 0;
+}
+
+bd_size_t CachingBlockDevice::get_evict_count() const
+{
+    return 0;
+}
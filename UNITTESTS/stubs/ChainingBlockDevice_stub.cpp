@@ -58,6 +58,21 @@ int ChainingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int ChainingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int ChainingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int ChainingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
 bd_size_t ChainingBlockDevice::get_read_size() const
 {
     return 0;
@@ -26,7 +26,8 @@ unsigned EventQueue_stub::unsigned_value = 0;
 
 namespace events {
 
-EventQueue::EventQueue(unsigned event_size, unsigned char *event_pointer)
+EventQueue::EventQueue(unsigned event_size, unsigned char *event_pointer,
+                       unsigned flags)
 {
 }
 
@@ -60,6 +61,11 @@ void EventQueue::background(Callback<void(int)> update)
 {
 }
 
+int EventQueue::reserve(unsigned count, unsigned size)
+{
+    return EventQueue_stub::int_value;
+}
+
 void EventQueue::chain(EventQueue *target)
 {
 }
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) , Arm Limited and affiliates.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FTLBlockDevice.h"
+
+FTLBlockDevice::FTLBlockDevice(BlockDevice *bd, bd_size_t sector_size, uint32_t spare_units,
+                               uint32_t wear_threshold)
+{
+}
+
+FTLBlockDevice::~FTLBlockDevice()
+{
+}
+
+int FTLBlockDevice::init()
+{
+    return 0;
+}
+
+int FTLBlockDevice::deinit()
+{
+    return 0;
+}
+
+int FTLBlockDevice::sync()
+{
+    return 0;
+}
+
+int FTLBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int FTLBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int FTLBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int FTLBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    return 0;
+}
+
+int FTLBlockDevice::reclaim()
+{
+    return 0;
+}
+
+bd_size_t FTLBlockDevice::get_read_size() const
+{
+    return 0;
+}
+
+bd_size_t FTLBlockDevice::get_program_size() const
+{
+    return 0;
+}
+
+bd_size_t FTLBlockDevice::get_erase_size() const
+{
+    return 0;
+}
+
+bd_size_t FTLBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return 0;
+}
+
+int FTLBlockDevice::get_erase_value() const
+{
+    return 0;
+}
+
+bd_size_t FTLBlockDevice::size() const
+{
+    return 0;
+}
+
+uint32_t FTLBlockDevice::get_min_erase_count() const
+{
+    return 0;
+}
+
+uint32_t FTLBlockDevice::get_max_erase_count() const
+{
+    return 0;
+}
@@ -106,6 +106,21 @@ int MBRBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int MBRBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int MBRBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int MBRBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
 bd_size_t MBRBlockDevice::get_read_size() const
 {
     return 0;
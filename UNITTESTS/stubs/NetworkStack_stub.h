@@ -20,6 +20,7 @@
 
 #include "netsocket/NetworkStack.h"
 #include <list>
+#include <vector>
 
 class NetworkStackstub : public NetworkStack {
 public:
@@ -32,6 +33,17 @@ public:
         return_value = 0;
     }
 
+    /** Report an event on a socket, as the network stack would
+     *
+     *  @param index    Index of the socket, in order of opening
+     */
+    void socket_event(unsigned index)
+    {
+        if (index < callbacks.size() && callbacks[index].first) {
+            callbacks[index].first(callbacks[index].second);
+        }
+    }
+
     virtual const char *get_ip_address()
     {
         return "127.0.0.1";
@@ -54,9 +66,11 @@ public:
 protected:
     virtual nsapi_error_t socket_open(nsapi_socket_t *handle, nsapi_protocol_t proto)
     {
-        if (return_value == NSAPI_ERROR_OK && return_values.front() == NSAPI_ERROR_OK) {
-            // Make sure a non-NULL value is returned if error is not expected
-            *handle = reinterpret_cast<nsapi_socket_t *>(1234);
+        if (return_value == NSAPI_ERROR_OK && (return_values.empty() || return_values.front() == NSAPI_ERROR_OK)) {
+            // Make sure a non-NULL value is returned if error is not expected,
+            // distinct for each socket so that events can be reported on it
+            *handle = reinterpret_cast<nsapi_socket_t *>(1234 + callbacks.size());
+            callbacks.push_back(std::make_pair((void (*)(void *))NULL, (void *)NULL));
         }
         return return_value;
     };
@@ -124,9 +138,17 @@ protected:
         }
         return return_value;
     };
-    virtual void socket_attach(nsapi_socket_t handle, void (*callback)(void *), void *data) {};
+    virtual void socket_attach(nsapi_socket_t handle, void (*callback)(void *), void *data)
+    {
+        size_t index = reinterpret_cast<size_t>(handle) - 1234;
+        if (index < callbacks.size()) {
+            callbacks[index] = std::make_pair(callback, data);
+        }
+    };
 
 private:
+    std::vector<std::pair<void (*)(void *), void *> > callbacks;
+
     virtual nsapi_error_t call_in(int delay, mbed::Callback<void()> func)
     {
         return return_value;
@@ -18,7 +18,11 @@
 #include "ProfilingBlockDevice.h"
 
 
-ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd)
+ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd, bool erase_map)
+{
+}
+
+ProfilingBlockDevice::~ProfilingBlockDevice()
 {
 }
 
@@ -52,6 +56,21 @@ int ProfilingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int ProfilingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int ProfilingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int ProfilingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
 bd_size_t ProfilingBlockDevice::get_read_size() const
 {
     return 0;
@@ -100,3 +119,23 @@ bd_size_t ProfilingBlockDevice::get_erase_count() const
 {
     return 0;
 }
+
+uint32_t ProfilingBlockDevice::get_latency_histogram(op_t op, int bucket) const
+{
+    return 0;
+}
+
+uint32_t ProfilingBlockDevice::get_size_histogram(op_t op, int bucket) const
+{
+    return 0;
+}
+
+uint32_t ProfilingBlockDevice::get_block_erase_count(bd_addr_t addr) const
+{
+    return 0;
+}
+
+int ProfilingBlockDevice::dump_csv(FILE *file) const
+{
+    return 0;
+}
@@ -53,6 +53,21 @@ int SlicingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int SlicingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int SlicingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
+int SlicingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return 0;
+}
+
 bd_size_t SlicingBlockDevice::get_read_size() const
 {
     return 0;
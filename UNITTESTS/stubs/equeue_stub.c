@@ -32,6 +32,17 @@ int equeue_create_inplace(equeue_t *queue, size_t size, void *buffer)
     return 0;
 }
 
+int equeue_create_flags(equeue_t *queue, size_t size, unsigned flags)
+{
+    return 0;
+}
+
+int equeue_create_inplace_flags(equeue_t *queue, size_t size, void *buffer,
+                                unsigned flags)
+{
+    return 0;
+}
+
 void equeue_destroy(equeue_t *queue)
 {
 
@@ -47,6 +58,16 @@ void equeue_break(equeue_t *queue)
 
 }
 
+int equeue_take(equeue_t *queue, void **events, int count, int ms)
+{
+    return 0;
+}
+
+void equeue_run(equeue_t *queue, void *event)
+{
+
+}
+
 int equeue_call(equeue_t *queue, void (*cb)(void *), void *data)
 {
     return 0;
@@ -113,3 +134,8 @@ int equeue_call_in(equeue_t *q, int ms, void (*cb)(void *), void *data)
     // The stub does not implement the delay mechanism.
     return equeue_post(q, cb, data);
 }
+
+int equeue_reserve(equeue_t *queue, unsigned count, size_t size)
+{
+    return 0;
+}
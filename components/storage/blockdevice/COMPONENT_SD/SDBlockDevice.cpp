@@ -146,6 +146,7 @@
 #endif
 #include <inttypes.h>
 #include <errno.h>
+#include <string.h>
 
 using namespace mbed;
 
@@ -161,11 +162,16 @@ using namespace mbed;
 #define MBED_CONF_SD_INIT_FREQUENCY              100000 /*!< Initialization frequency Range (100KHz-400KHz) */
 #endif
 
+#ifndef MBED_CONF_SD_DMA_ENABLED
+#define MBED_CONF_SD_DMA_ENABLED                 0      /*!< Move data blocks with non-blocking (DMA) SPI transfers */
+#endif
+
 
 #define SD_COMMAND_TIMEOUT                       MBED_CONF_SD_CMD_TIMEOUT
 #define SD_CMD0_GO_IDLE_STATE_RETRIES            MBED_CONF_SD_CMD0_IDLE_STATE_RETRIES
 #define SD_DBG                                   0      /*!< 1 - Enable debugging */
 #define SD_CMD_TRACE                             0      /*!< 1 - Enable SD command tracing */
+#define SD_DMA_TRANSFER                          (DEVICE_SPI_ASYNCH && MBED_CONF_SD_DMA_ENABLED)
 
 #define SD_BLOCK_DEVICE_ERROR_WOULD_BLOCK        -5001  /*!< operation would block */
 #define SD_BLOCK_DEVICE_ERROR_UNSUPPORTED        -5002  /*!< unsupported operation */
@@ -228,6 +234,16 @@ using namespace mbed;
 /* R7 response pattern for CMD8 */
 #define CMD8_PATTERN             (0xAA)
 
+/* CMD6 (SWITCH_FUNC) */
+#define CMD6_SWITCH_HIGH_SPEED   (0x80FFFFF1) /*!< Mode 1 (switch), function group 1 = high speed, others unchanged */
+#define CMD6_STATUS_SIZE         64          /*!< Switch function status: 512 bits */
+#define CMD6_STATUS_GRP1_BYTE    16          /*!< Bits [379:376]: function selected in group 1 */
+#define CMD6_HIGH_SPEED          (0x1)
+
+/* Clock limits */
+#define SD_DEFAULT_SPEED_MAX     25000000    /*!< Default speed mode: up to 25MHz */
+#define SD_HIGH_SPEED_MAX        50000000    /*!< High speed mode (after CMD6 switch): up to 50MHz */
+
 /*  CRC Enable  */
 #define CRC_ENABLE               (0)         /*!< CRC 1 - Enable 0 - Disable */
 
@@ -269,6 +285,15 @@ SDBlockDevice::SDBlockDevice(PinName mosi, PinName miso, PinName sclk, PinName c
     _transfer_sck = hz;
 
     _erase_size = BLOCK_SIZE_HC;
+    _high_speed = false;
+
+#if DEVICE_SPI_ASYNCH
+    _transfer_done = true;
+    _transfer_event = 0;
+#if SD_DMA_TRANSFER
+    _spi.set_dma_usage(DMA_USAGE_OPPORTUNISTIC);
+#endif
+#endif
 }
 
 SDBlockDevice::~SDBlockDevice()
@@ -285,6 +310,9 @@ int SDBlockDevice::_initialise_card()
     int32_t status = BD_ERROR_OK;
     uint32_t response, arg;
 
+    // The card may have been swapped or reset: high speed mode must be selected again
+    _high_speed = false;
+
     // Initialize the SPI interface: Card by default is in SD mode
     _spi_init();
 
@@ -439,6 +467,7 @@ int SDBlockDevice::deinit()
     }
 
     _is_initialized = false;
+    _high_speed = false;
     _sectors = 0;
 
 end:
@@ -503,6 +532,7 @@ int SDBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
             response = _write(buffer, SPI_START_BLK_MUL_WRITE, _block_size);
             if (response != SPI_DATA_ACCEPTED) {
                 debug_if(SD_DBG, "Multiple Block Write failed: 0x%x \n", response);
+                status = SD_BLOCK_DEVICE_ERROR_WRITE;
                 break;
             }
             buffer += _block_size;
@@ -554,19 +584,15 @@ int SDBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
     }
 
     // receive the data : one block at a time
-    while (blockCnt) {
-        if (0 != _read(buffer, _block_size)) {
-            status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
-            break;
-        }
-        buffer += _block_size;
-        --blockCnt;
-    }
+    status = _read(buffer, blockCnt);
     _deselect();
 
     // Send CMD12(0x00000000) to stop the transmission for multi-block transfer
     if (size > _block_size) {
-        status = _cmd(CMD12_STOP_TRANSMISSION, 0x0);
+        int stop_status = _cmd(CMD12_STOP_TRANSMISSION, 0x0);
+        if (BD_ERROR_OK == status) {
+            status = stop_status;
+        }
     }
     unlock();
     return status;
@@ -649,15 +675,60 @@ int SDBlockDevice::frequency(uint64_t freq)
 // PRIVATE FUNCTIONS
 int SDBlockDevice::_freq(void)
 {
-    // Max frequency supported is 25MHZ
-    if (_transfer_sck <= 25000000) {
+    // Default speed mode supports up to 25MHZ
+    if (_transfer_sck <= SD_DEFAULT_SPEED_MAX) {
         _spi.frequency(_transfer_sck);
         return 0;
-    } else {  // TODO: Switch function to be implemented for higher frequency
-        _transfer_sck = 25000000;
-        _spi.frequency(_transfer_sck);
-        return -EINVAL;
     }
+
+    // Card is switched when it gets initialized
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    // Higher frequencies need the card in high speed mode, which stays
+    // selected until the card is power cycled
+    if (!_high_speed) {
+        _high_speed = (BD_ERROR_OK == _switch_high_speed());
+    }
+
+    int err = 0;
+    if (!_high_speed) {
+        _transfer_sck = SD_DEFAULT_SPEED_MAX;
+        err = -EINVAL;
+    } else if (_transfer_sck > SD_HIGH_SPEED_MAX) {
+        _transfer_sck = SD_HIGH_SPEED_MAX;
+        err = -EINVAL;
+    }
+    _spi.frequency(_transfer_sck);
+    return err;
+}
+
+int SDBlockDevice::_switch_high_speed(void)
+{
+    uint8_t status[CMD6_STATUS_SIZE];
+
+    // CMD6 is not supported by Ver1.0 cards, which report an illegal command
+    int err = _cmd(CMD6_SWITCH_FUNC, CMD6_SWITCH_HIGH_SPEED);
+    if (BD_ERROR_OK != err) {
+        debug_if(SD_DBG, "High speed switch not supported\n");
+        return err;
+    }
+
+    // Response R1 is followed by the 512-bit switch function status
+    err = _read_bytes(status, CMD6_STATUS_SIZE);
+    if (BD_ERROR_OK != err) {
+        return err;
+    }
+
+    // Group 1 reports 0xF if the function could not be switched
+    if ((status[CMD6_STATUS_GRP1_BYTE] & 0x0F) != CMD6_HIGH_SPEED) {
+        debug_if(SD_DBG, "High speed switch failed: 0x%x\n", status[CMD6_STATUS_GRP1_BYTE]);
+        return SD_BLOCK_DEVICE_ERROR_UNSUPPORTED;
+    }
+
+    debug_if(_dbg, "Switched to high speed mode\n");
+    return BD_ERROR_OK;
 }
 
 uint8_t SDBlockDevice::_cmd_spi(SDBlockDevice::cmdSupported cmd, uint32_t arg)
@@ -821,7 +892,7 @@ int SDBlockDevice::_cmd(SDBlockDevice::cmdSupported cmd, uint32_t arg, bool isAc
     }
 
     // Do not deselect card if read is in progress.
-    if (((CMD9_SEND_CSD == cmd) || (ACMD22_SEND_NUM_WR_BLOCKS == cmd) ||
+    if (((CMD6_SWITCH_FUNC == cmd) || (CMD9_SEND_CSD == cmd) || (ACMD22_SEND_NUM_WR_BLOCKS == cmd) ||
             (CMD24_WRITE_BLOCK == cmd) || (CMD25_WRITE_MULTIPLE_BLOCK == cmd) ||
             (CMD17_READ_SINGLE_BLOCK == cmd) || (CMD18_READ_MULTIPLE_BLOCK == cmd))
             && (BD_ERROR_OK == status)) {
@@ -910,39 +981,116 @@ int SDBlockDevice::_read_bytes(uint8_t *buffer, uint32_t length)
     return 0;
 }
 
-int SDBlockDevice::_read(uint8_t *buffer, uint32_t length)
+int SDBlockDevice::_read(uint8_t *buffer, uint32_t count)
 {
-    uint16_t crc;
+    uint8_t *last = NULL;
+    uint16_t last_crc = 0;
+    int status = 0;
+
+    while (count--) {
+        // read until start byte (0xFE)
+        if (false == _wait_token(SPI_START_BLOCK)) {
+            debug_if(SD_DBG, "Read timeout\n");
+            status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+            break;
+        }
 
-    // read until start byte (0xFE)
-    if (false == _wait_token(SPI_START_BLOCK)) {
-        debug_if(SD_DBG, "Read timeout\n");
-        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
-    }
+        // read data, the previous block is verified while this one is in flight
+        _start_transfer(NULL, buffer, _block_size);
+        if (last) {
+            status = _verify_crc(last, last_crc);
+        }
+        if (0 != _finish_transfer()) {
+            status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+        if (0 != status) {
+            break;
+        }
 
-    // read data
-    _spi.write(NULL, 0, (char *)buffer, length);
+        // Read the CRC16 checksum for the data block
+        last_crc = (_spi.write(SPI_FILL_CHAR) << 8);
+        last_crc |= _spi.write(SPI_FILL_CHAR);
+        last = buffer;
+        buffer += _block_size;
+    }
 
-    // Read the CRC16 checksum for the data block
-    crc = (_spi.write(SPI_FILL_CHAR) << 8);
-    crc |= _spi.write(SPI_FILL_CHAR);
+    if ((0 == status) && last) {
+        status = _verify_crc(last, last_crc);
+    }
+    return status;
+}
 
+int SDBlockDevice::_verify_crc(const uint8_t *buffer, uint16_t crc)
+{
 #if MBED_CONF_SD_CRC_ENABLED
     if (_crc_on) {
         uint32_t crc_result;
         // Compute and verify checksum
-        _crc16.compute((void *)buffer, length, &crc_result);
+        _crc16.compute((void *)buffer, _block_size, &crc_result);
         if ((uint16_t)crc_result != crc) {
-            debug_if(SD_DBG, "_read_bytes: Invalid CRC received 0x%" PRIx16 " result of computation 0x%" PRIx16 "\n",
+            debug_if(SD_DBG, "_read: Invalid CRC received 0x%" PRIx16 " result of computation 0x%" PRIx16 "\n",
                      crc, (uint16_t)crc_result);
             return SD_BLOCK_DEVICE_ERROR_CRC;
         }
     }
 #endif
+    return 0;
+}
+
+void SDBlockDevice::_start_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t length)
+{
+    if (NULL == tx_buffer) {
+        // Receive in place: the card expects the fill character on MOSI, and
+        // each byte is clocked out before its slot is overwritten
+        memset(rx_buffer, SPI_FILL_CHAR, length);
+        tx_buffer = rx_buffer;
+    }
+
+#if SD_DMA_TRANSFER
+    _transfer_done = false;
+    _transfer_event = 0;
+    if (0 == _spi.transfer<uint8_t>(tx_buffer, length, rx_buffer, rx_buffer ? length : 0,
+                                    mbed::callback(this, &SDBlockDevice::_transfer_complete),
+                                    SPI_EVENT_ALL)) {
+        return;
+    }
+    // Peripheral is busy with a transfer of another SPI object, fall back to blocking write
+    _transfer_done = true;
+#endif
+    _spi.write((const char *)tx_buffer, length, (char *)rx_buffer, rx_buffer ? length : 0);
+}
 
+int SDBlockDevice::_finish_transfer()
+{
+#if SD_DMA_TRANSFER
+    _spi_timer.reset();
+    _spi_timer.start();
+    while (!_transfer_done) {
+        if (_spi_timer.read_ms() > SD_COMMAND_TIMEOUT) {
+            _spi_timer.stop();
+            _spi.abort_transfer();
+            _transfer_done = true;
+            debug_if(SD_DBG, "_finish_transfer: timeout\n");
+            return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        }
+    }
+    _spi_timer.stop();
+    if (_transfer_event & (SPI_EVENT_ERROR | SPI_EVENT_RX_OVERFLOW)) {
+        debug_if(SD_DBG, "_finish_transfer: event 0x%x\n", _transfer_event);
+        return SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    }
+#endif
     return 0;
 }
 
+#if DEVICE_SPI_ASYNCH
+void SDBlockDevice::_transfer_complete(int event)
+{
+    _transfer_event = event;
+    _transfer_done = true;
+}
+#endif
+
 uint8_t SDBlockDevice::_write(const uint8_t *buffer, uint8_t token, uint32_t length)
 {
 
@@ -952,8 +1100,8 @@ uint8_t SDBlockDevice::_write(const uint8_t *buffer, uint8_t token, uint32_t len
     // indicate start of block
     _spi.write(token);
 
-    // write the data
-    _spi.write((char *)buffer, length, NULL, 0);
+    // write the data, CRC is computed while the block is in flight
+    _start_transfer(buffer, NULL, length);
 
 #if MBED_CONF_SD_CRC_ENABLED
     if (_crc_on) {
@@ -962,6 +1110,10 @@ uint8_t SDBlockDevice::_write(const uint8_t *buffer, uint8_t token, uint32_t len
     }
 #endif
 
+    if (0 != _finish_transfer()) {
+        return SPI_DATA_WRITE_ERROR;
+    }
+
     // write the checksum CRC16
     _spi.write(crc >> 8);
     _spi.write(crc);
@@ -112,7 +112,8 @@ public:
     /** Set the transfer frequency
      *
      *  @param freq     Transfer frequency
-     *  @note Max frequency supported is 25MHZ
+     *  @note Frequencies above 25MHZ switch the card to high speed mode (CMD6),
+     *        max frequency supported is 50MHZ
      */
     virtual int frequency(uint64_t freq);
 
@@ -193,10 +194,22 @@ private:
 
     bool _wait_token(uint8_t token);        /**< Wait for token */
     bool _wait_ready(uint16_t ms = 300);    /**< 300ms default wait for card to be ready */
-    int _read(uint8_t *buffer, uint32_t length);
+    int _read(uint8_t *buffer, uint32_t count);   /**< Read count data blocks */
+    int _verify_crc(const uint8_t *buffer, uint16_t crc);
     int _read_bytes(uint8_t *buffer, uint32_t length);
     uint8_t _write(const uint8_t *buffer, uint8_t token, uint32_t length);
     int _freq(void);
+    int _switch_high_speed(void);
+    bool _high_speed;               /**< Card switched to high speed mode */
+
+    /* Data block transfer, non-blocking when DMA is enabled */
+    void _start_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t length);
+    int _finish_transfer();
+#if DEVICE_SPI_ASYNCH
+    void _transfer_complete(int event);
+    volatile bool _transfer_done;
+    volatile int _transfer_event;
+#endif
 
     /* Chip Select and SPI mode select */
     mbed::DigitalOut _cs;
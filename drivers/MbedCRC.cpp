@@ -19,60 +19,22 @@
 #include "drivers/TableCRC.h"
 #include "drivers/MbedCRC.h"
 
+#ifndef MBED_CONF_DRIVERS_CRC32_TABLE_POLICY
+#define MBED_CONF_DRIVERS_CRC32_TABLE_POLICY    CRC_TABLE_DEFAULT
+#endif
+
 namespace mbed {
 /** \addtogroup drivers */
 /** @{*/
 
 SingletonPtr<PlatformMutex> mbed_crc_mutex;
 
-/* Default values for different types of polynomials
-*/
-template<>
-MbedCRC<POLY_32BIT_ANSI, 32>::MbedCRC():
-    _initial_value(~(0x0)), _final_xor(~(0x0)), _reflect_data(true), _reflect_remainder(true),
-    _crc_table((uint32_t *)Table_CRC_32bit_ANSI)
-{
-    mbed_crc_ctor();
-}
-
-template<>
-MbedCRC<POLY_32BIT_REV_ANSI, 32>::MbedCRC():
-    _initial_value(~(0x0)), _final_xor(~(0x0)), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_32bit_Rev_ANSI)
-{
-    mbed_crc_ctor();
-}
-
-template<>
-MbedCRC<POLY_16BIT_IBM, 16>::MbedCRC():
-    _initial_value(0), _final_xor(0), _reflect_data(true), _reflect_remainder(true),
-    _crc_table((uint32_t *)Table_CRC_16bit_IBM)
-{
-    mbed_crc_ctor();
-}
-
-template<>
-MbedCRC<POLY_16BIT_CCITT, 16>::MbedCRC():
-    _initial_value(~(0x0)), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_16bit_CCITT)
-{
-    mbed_crc_ctor();
-}
-
-template<>
-MbedCRC<POLY_7BIT_SD, 7>::MbedCRC():
-    _initial_value(0), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_7Bit_SD)
-{
-    mbed_crc_ctor();
-}
-
-template<>
-MbedCRC<POLY_8BIT_CCITT, 8>::MbedCRC():
-    _initial_value(0), _final_xor(0), _reflect_data(false), _reflect_remainder(false),
-    _crc_table((uint32_t *)Table_CRC_8bit_CCITT)
+uint32_t crc32_ansi(uint32_t init_crc, uint32_t data_size, const void *data_buf)
 {
-    mbed_crc_ctor();
+    uint32_t crc;
+    MbedCRC<POLY_32BIT_ANSI, 32, MBED_CONF_DRIVERS_CRC32_TABLE_POLICY> ct(init_crc, 0x0, true, false);
+    ct.compute(const_cast<void *>(data_buf), data_size, &crc);
+    return crc;
 }
 
 /** @}*/
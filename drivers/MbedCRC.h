@@ -22,6 +22,7 @@
 #include "platform/mbed_assert.h"
 #include "platform/SingletonPtr.h"
 #include "platform/PlatformMutex.h"
+#include <new>
 
 /* This is invalid warning from the compiler for below section of code
 if ((width < 8) && (NULL == _crc_table)) {
@@ -43,15 +44,163 @@ namespace mbed {
 /** \addtogroup drivers */
 /** @{*/
 
+/** Software CRC engine used by MbedCRC
+ *
+ *  The reflected 32-bit ANSI CRC (POLY_32BIT_ANSI with reflected data, as used
+ *  by default, or POLY_32BIT_REV_ANSI) uses tables precomputed in ROM. For other
+ *  polynomials of 8 bits or wider, the tables are built in RAM on first use and
+ *  shared by all MbedCRC objects with the same polynomial, width and policy; if
+ *  they can't be allocated, the default engine is used. Tables process data in
+ *  its natural bit order, so reflected data costs no extra work. CRCs narrower
+ *  than 8 bits always use the default engine.
+ */
+enum CrcTablePolicy {
+    CRC_TABLE_DEFAULT = 0,  /**< ROM tables for supported polynomials, bit by bit otherwise */
+    CRC_TABLE_256,          /**< 256-entry table (1KB), one lookup per byte */
+    CRC_TABLE_SLICE_BY_4,   /**< 4 x 256-entry tables (4KB), 4 bytes per step */
+    CRC_TABLE_SLICE_BY_8    /**< 8 x 256-entry tables (8KB), 8 bytes per step */
+};
+
+#if !defined(DOXYGEN_ONLY)
+namespace internal {
+/* Initial values for the default constructor of MbedCRC, only the supported
+ * polynomials (:: crc_polynomial_t) with their natural width are defined. */
+template <uint32_t polynomial, uint8_t width>
+struct MbedCRCDefaults;
+
+template <>
+struct MbedCRCDefaults<POLY_32BIT_ANSI, 32> {
+    static const uint32_t initial_xor = 0xFFFFFFFF;
+    static const uint32_t final_xor = 0xFFFFFFFF;
+    static const bool reflect_data = true;
+    static const bool reflect_remainder = true;
+};
+
+template <>
+struct MbedCRCDefaults<POLY_32BIT_REV_ANSI, 32> {
+    static const uint32_t initial_xor = 0xFFFFFFFF;
+    static const uint32_t final_xor = 0xFFFFFFFF;
+    static const bool reflect_data = false;
+    static const bool reflect_remainder = false;
+};
+
+template <>
+struct MbedCRCDefaults<POLY_16BIT_IBM, 16> {
+    static const uint32_t initial_xor = 0;
+    static const uint32_t final_xor = 0;
+    static const bool reflect_data = true;
+    static const bool reflect_remainder = true;
+};
+
+template <>
+struct MbedCRCDefaults<POLY_16BIT_CCITT, 16> {
+    static const uint32_t initial_xor = 0xFFFFFFFF;
+    static const uint32_t final_xor = 0;
+    static const bool reflect_data = false;
+    static const bool reflect_remainder = false;
+};
+
+template <>
+struct MbedCRCDefaults<POLY_7BIT_SD, 7> {
+    static const uint32_t initial_xor = 0;
+    static const uint32_t final_xor = 0;
+    static const bool reflect_data = false;
+    static const bool reflect_remainder = false;
+};
+
+template <>
+struct MbedCRCDefaults<POLY_8BIT_CCITT, 8> {
+    static const uint32_t initial_xor = 0;
+    static const uint32_t final_xor = 0;
+    static const bool reflect_data = false;
+    static const bool reflect_remainder = false;
+};
+
+template <CrcTablePolicy policy>
+struct CrcTablePolicyTag {
+};
+
+/* CRC lookup tables generated at runtime, for polynomials without ROM tables.
+ * Table k holds the CRC of each byte followed by k zero bytes, which lets
+ * slicing process several bytes per step. Reflected tables work least
+ * significant bit first with the reflected polynomial, POLY_32BIT_REV_ANSI is
+ * already reflected. entries() returns NULL if the tables can't be allocated. */
+template <uint32_t polynomial, uint8_t width, unsigned slices, bool reflected>
+class MbedCRCTable {
+public:
+    MbedCRCTable() : _entries(new (std::nothrow) uint32_t[slices * MBED_CRC_TABLE_SIZE])
+    {
+        if (!_entries) {
+            return;
+        }
+
+        const uint32_t mask = (uint32_t)((1ull << width) - 1);
+        uint32_t poly = polynomial;
+        if (reflected && POLY_32BIT_REV_ANSI != polynomial) {
+            poly = 0;
+            for (uint8_t bit = 0; bit < width; bit++) {
+                if (polynomial & (1ul << bit)) {
+                    poly |= 1ul << (width - 1 - bit);
+                }
+            }
+        }
+
+        for (uint32_t byte = 0; byte < MBED_CRC_TABLE_SIZE; byte++) {
+            uint32_t crc;
+            if (reflected) {
+                crc = byte;
+                for (uint8_t bit = 0; bit < 8; bit++) {
+                    crc = (crc & 1) ? (crc >> 1) ^ poly : (crc >> 1);
+                }
+            } else {
+                crc = byte << (width - 8);
+                for (uint8_t bit = 0; bit < 8; bit++) {
+                    crc = (crc & (1ul << (width - 1))) ? (crc << 1) ^ poly : (crc << 1);
+                }
+            }
+            _entries[byte] = crc & mask;
+        }
+
+        for (unsigned k = 1; k < slices; k++) {
+            const uint32_t *prev = &_entries[(k - 1) * MBED_CRC_TABLE_SIZE];
+            uint32_t *next = &_entries[k * MBED_CRC_TABLE_SIZE];
+            for (uint32_t byte = 0; byte < MBED_CRC_TABLE_SIZE; byte++) {
+                if (reflected) {
+                    next[byte] = (prev[byte] >> 8) ^ _entries[prev[byte] & 0xff];
+                } else {
+                    next[byte] = ((prev[byte] << 8) ^ _entries[(prev[byte] >> (width - 8)) & 0xff]) & mask;
+                }
+            }
+        }
+    }
+
+    ~MbedCRCTable()
+    {
+        delete[] _entries;
+    }
+
+    const uint32_t *entries() const
+    {
+        return _entries;
+    }
+
+private:
+    uint32_t *_entries;
+};
+} // namespace internal
+#endif
+
 /** CRC object provides CRC generation through hardware/software
  *
  *  ROM polynomial tables for supported polynomials (:: crc_polynomial_t) will be used for
  *  software CRC computation, if ROM tables are not available then CRC is computed runtime
- *  bit by bit for all data input.
+ *  bit by bit for all data input. Faster software engines for any polynomial can be
+ *  selected with the table policy (:: CrcTablePolicy), trading memory for speed.
  *  @note Synchronization level: Thread safe
  *
  *  @tparam  polynomial CRC polynomial value in hex
  *  @tparam  width CRC polynomial width
+ *  @tparam  table_policy Software engine used when the CRC is not computed by hardware
  *
  * Example: Compute CRC data
  * @code
@@ -96,7 +245,8 @@ namespace mbed {
 
 extern SingletonPtr<PlatformMutex> mbed_crc_mutex;
 
-template <uint32_t polynomial = POLY_32BIT_ANSI, uint8_t width = 32>
+template <uint32_t polynomial = POLY_32BIT_ANSI, uint8_t width = 32,
+          CrcTablePolicy table_policy = CRC_TABLE_DEFAULT>
 class MbedCRC {
 
 public:
@@ -105,7 +255,8 @@ public:
         HARDWARE = 0,
 #endif
         TABLE = 1,
-        BITWISE
+        BITWISE,
+        GENERATED_TABLE
     };
 
     typedef uint64_t crc_data_size_t;
@@ -131,7 +282,14 @@ public:
     {
         mbed_crc_ctor();
     }
-    MbedCRC();
+    MbedCRC() :
+        _initial_value(internal::MbedCRCDefaults<polynomial, width>::initial_xor),
+        _final_xor(internal::MbedCRCDefaults<polynomial, width>::final_xor),
+        _reflect_data(internal::MbedCRCDefaults<polynomial, width>::reflect_data),
+        _reflect_remainder(internal::MbedCRCDefaults<polynomial, width>::reflect_remainder)
+    {
+        mbed_crc_ctor();
+    }
     virtual ~MbedCRC()
     {
         // Do nothing
@@ -210,6 +368,9 @@ public:
             case BITWISE:
                 status = bitwise_compute_partial(buffer, size, crc);
                 break;
+            case GENERATED_TABLE:
+                status = generated_compute_partial(buffer, size, crc);
+                break;
             default:
                 status = -1;
                 break;
@@ -247,7 +408,12 @@ public:
         }
 #endif
 
-        *crc = _initial_value;
+        // Generated reflected tables keep the remainder reflected until the end
+        if ((GENERATED_TABLE == _mode) && _reflected_table && (POLY_32BIT_REV_ANSI != polynomial)) {
+            *crc = reflect(_initial_value);
+        } else {
+            *crc = _initial_value;
+        }
         return 0;
     }
 
@@ -278,6 +444,12 @@ public:
         // Optimized algorithm for 32BitANSI does not need additional reflect_remainder
         if ((TABLE == _mode) && (POLY_32BIT_REV_ANSI == polynomial)) {
             *crc = (p_crc ^ _final_xor) & get_crc_mask();
+        } else if ((GENERATED_TABLE == _mode) && _reflected_table) {
+            if (_reflect_remainder || (POLY_32BIT_REV_ANSI == polynomial)) {
+                *crc = (p_crc ^ _final_xor) & get_crc_mask();
+            } else {
+                *crc = (reflect(p_crc) ^ _final_xor) & get_crc_mask();
+            }
         } else {
             *crc = (reflect_remainder(p_crc) ^ _final_xor) & get_crc_mask();
         }
@@ -311,6 +483,16 @@ private:
     bool _reflect_remainder;
     uint32_t *_crc_table;
     CrcMode _mode;
+    bool _reflected_table;
+
+    // Number of generated tables, one per byte processed in each step
+    enum {
+        slices = (CRC_TABLE_SLICE_BY_8 == table_policy) ? 8 :
+                 (CRC_TABLE_SLICE_BY_4 == table_policy) ? 4 : 1
+    };
+
+    static SingletonPtr<internal::MbedCRCTable<polynomial, width, slices, false> > _tables;
+    static SingletonPtr<internal::MbedCRCTable<polynomial, width, slices, true> > _reflected_tables;
 
     /** Acquire exclusive access to CRC hardware/software.
      */
@@ -385,6 +567,24 @@ private:
         }
     }
 
+    /** Reflect all bits of a CRC value.
+     *
+     * @param  data CRC value of the current width
+     * @return  Reflected CRC value
+     */
+    uint32_t reflect(uint32_t data) const
+    {
+        uint32_t reflection = 0x0;
+
+        for (uint8_t bit = 0; bit < width; ++bit) {
+            if (data & 0x01) {
+                reflection |= (1ul << ((width - 1) - bit));
+            }
+            data = (data >> 1);
+        }
+        return reflection;
+    }
+
     /** Data bytes are reflected.
      *
      * @param  data value to be reflected
@@ -496,17 +696,101 @@ private:
         return 0;
     }
 
+    /** CRC computation using generated tables.
+     *
+     * @param  buffer  data buffer
+     * @param  size  size of the data
+     * @param  crc  CRC value is filled in, but the value is not the final
+     * @return  0  on success or a negative error code on failure
+     */
+    int32_t generated_compute_partial(const void *buffer, crc_data_size_t size, uint32_t *crc) const
+    {
+        MBED_ASSERT(crc != NULL);
+
+        const uint8_t *data = static_cast<const uint8_t *>(buffer);
+        const uint32_t *t0 = _crc_table;
+        uint32_t p_crc = *crc;
+
+        if (_reflected_table) {
+            // The reflected remainder lines up with the next bytes in little-endian order
+            if (slices == 8) {
+                const uint32_t *t4 = &t0[4 * MBED_CRC_TABLE_SIZE];
+                for (; size >= 8; size -= 8, data += 8) {
+                    uint32_t lo = p_crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+                    uint32_t hi = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+                    p_crc = t4[3 * MBED_CRC_TABLE_SIZE + (lo & 0xff)] ^
+                            t4[2 * MBED_CRC_TABLE_SIZE + ((lo >> 8) & 0xff)] ^
+                            t4[1 * MBED_CRC_TABLE_SIZE + ((lo >> 16) & 0xff)] ^
+                            t4[lo >> 24] ^
+                            t0[3 * MBED_CRC_TABLE_SIZE + (hi & 0xff)] ^
+                            t0[2 * MBED_CRC_TABLE_SIZE + ((hi >> 8) & 0xff)] ^
+                            t0[1 * MBED_CRC_TABLE_SIZE + ((hi >> 16) & 0xff)] ^
+                            t0[hi >> 24];
+                }
+            } else if (slices == 4) {
+                for (; size >= 4; size -= 4, data += 4) {
+                    uint32_t lo = p_crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+                    p_crc = t0[3 * MBED_CRC_TABLE_SIZE + (lo & 0xff)] ^
+                            t0[2 * MBED_CRC_TABLE_SIZE + ((lo >> 8) & 0xff)] ^
+                            t0[1 * MBED_CRC_TABLE_SIZE + ((lo >> 16) & 0xff)] ^
+                            t0[lo >> 24];
+                }
+            }
+
+            for (; size > 0; size--, data++) {
+                p_crc = (p_crc >> 8) ^ t0[(p_crc ^ *data) & 0xff];
+            }
+        } else {
+            // The remainder lines up with the next bytes in big-endian order
+            if (slices == 8) {
+                const uint32_t *t4 = &t0[4 * MBED_CRC_TABLE_SIZE];
+                for (; size >= 8; size -= 8, data += 8) {
+                    uint32_t hi = (p_crc << (32 - width)) ^
+                                  (((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+                    uint32_t lo = ((uint32_t)data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7];
+                    p_crc = t4[3 * MBED_CRC_TABLE_SIZE + (hi >> 24)] ^
+                            t4[2 * MBED_CRC_TABLE_SIZE + ((hi >> 16) & 0xff)] ^
+                            t4[1 * MBED_CRC_TABLE_SIZE + ((hi >> 8) & 0xff)] ^
+                            t4[hi & 0xff] ^
+                            t0[3 * MBED_CRC_TABLE_SIZE + (lo >> 24)] ^
+                            t0[2 * MBED_CRC_TABLE_SIZE + ((lo >> 16) & 0xff)] ^
+                            t0[1 * MBED_CRC_TABLE_SIZE + ((lo >> 8) & 0xff)] ^
+                            t0[lo & 0xff];
+                }
+            } else if (slices == 4) {
+                for (; size >= 4; size -= 4, data += 4) {
+                    uint32_t hi = (p_crc << (32 - width)) ^
+                                  (((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+                    p_crc = t0[3 * MBED_CRC_TABLE_SIZE + (hi >> 24)] ^
+                            t0[2 * MBED_CRC_TABLE_SIZE + ((hi >> 16) & 0xff)] ^
+                            t0[1 * MBED_CRC_TABLE_SIZE + ((hi >> 8) & 0xff)] ^
+                            t0[hi & 0xff];
+                }
+            }
+
+            for (; size > 0; size--, data++) {
+                p_crc = (p_crc << 8) ^ t0[((p_crc >> (width - 8)) ^ *data) & 0xff];
+            }
+        }
+
+        *crc = p_crc & get_crc_mask();
+        return 0;
+    }
+
     /** Constructor init called from all specialized cases of constructor.
      *  Note: All construtor common code should be in this function.
      */
     void mbed_crc_ctor(void)
     {
         MBED_STATIC_ASSERT(width <= 32, "Max 32-bit CRC supported");
+        _crc_table = NULL;
+        _reflected_table = false;
 
 #if DEVICE_CRC
         if (POLY_32BIT_REV_ANSI == polynomial) {
             _crc_table = (uint32_t *)Table_CRC_32bit_Rev_ANSI;
             _mode = TABLE;
+            generated_table_init(internal::CrcTablePolicyTag<table_policy>());
             return;
         }
         crc_mbed_config_t config;
@@ -547,10 +831,71 @@ private:
                 break;
         }
         _mode = (_crc_table != NULL) ? TABLE : BITWISE;
+
+        generated_table_init(internal::CrcTablePolicyTag<table_policy>());
+    }
+
+    /** Select the ROM or generated tables if a table policy other than the default is used.
+     *  Tables are only instantiated for the policies that need them. The default engine
+     *  is kept if generated tables can't be allocated.
+     */
+    void generated_table_init(internal::CrcTablePolicyTag<CRC_TABLE_DEFAULT>)
+    {
+    }
+
+    template <CrcTablePolicy policy>
+    void generated_table_init(internal::CrcTablePolicyTag<policy>)
+    {
+        if (width < 8) {
+            return;
+        }
+
+        bool reflected = _reflect_data || (POLY_32BIT_REV_ANSI == polynomial);
+        const uint32_t *entries;
+        if (reflected && (32 == width) &&
+                ((POLY_32BIT_ANSI == polynomial) || (POLY_32BIT_REV_ANSI == polynomial))) {
+            // Slice-by-8 ROM tables start with the slice-by-4 and 256-entry ones
+            entries = Table_CRC_32bit_Rev_ANSI_Slice_By_8;
+        } else if (reflected) {
+            entries = _reflected_tables->entries();
+        } else {
+            entries = _tables->entries();
+        }
+        if (!entries) {
+            return;
+        }
+
+        _reflected_table = reflected;
+        _crc_table = const_cast<uint32_t *>(entries);
+        _mode = GENERATED_TABLE;
     }
 #endif
 };
 
+#if !defined(DOXYGEN_ONLY)
+template <uint32_t polynomial, uint8_t width, CrcTablePolicy table_policy>
+SingletonPtr<internal::MbedCRCTable<polynomial, width, MbedCRC<polynomial, width, table_policy>::slices, false> >
+MbedCRC<polynomial, width, table_policy>::_tables;
+
+template <uint32_t polynomial, uint8_t width, CrcTablePolicy table_policy>
+SingletonPtr<internal::MbedCRCTable<polynomial, width, MbedCRC<polynomial, width, table_policy>::slices, true> >
+MbedCRC<polynomial, width, table_policy>::_reflected_tables;
+#endif
+
+/** Compute the 32-bit ANSI CRC of a buffer, as used by the storage stack
+ *
+ *  Data is reflected, the remainder is not, and there is no final XOR, so a
+ *  result can be passed as the initial value of the next call to cover data
+ *  in several parts. The software engine is set by the drivers.crc32-table-policy
+ *  configuration option.
+ *
+ *  @param  init_crc  Initial value, or result of the previous part
+ *  @param  data_size Size of the data
+ *  @param  data_buf  Data buffer
+ *  @return CRC of the data
+ */
+uint32_t crc32_ansi(uint32_t init_crc, uint32_t data_size, const void *data_buf);
+
 #if   defined ( __CC_ARM )
 #elif defined ( __GNUC__ )
 #pragma GCC diagnostic pop
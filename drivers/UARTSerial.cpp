@@ -255,6 +255,7 @@ void UARTSerial::wake()
     if (_sigio_cb) {
         _sigio_cb();
     }
+    poll_wake(this);
 }
 
 short UARTSerial::poll(short events) const
@@ -64,6 +64,13 @@ public:
      */
     virtual short poll(short events) const;
 
+    /** Events are signalled to poll() along with the sigio() callback, so it blocks until they occur.
+     */
+    virtual bool poll_wakes() const
+    {
+        return true;
+    }
+
     /* Resolve ambiguities versus our private SerialBase
      * (for writable, spelling differs, but just in case)
      */
@@ -21,12 +21,13 @@ using mbed::Callback;
 
 namespace events {
 
-EventQueue::EventQueue(unsigned event_size, unsigned char *event_pointer)
+EventQueue::EventQueue(unsigned event_size, unsigned char *event_pointer,
+                       unsigned flags)
 {
     if (!event_pointer) {
-        equeue_create(&_equeue, event_size);
+        equeue_create_flags(&_equeue, event_size, flags);
     } else {
-        equeue_create_inplace(&_equeue, event_size, event_pointer);
+        equeue_create_inplace_flags(&_equeue, event_size, event_pointer, flags);
     }
 }
 
@@ -71,6 +72,11 @@ void EventQueue::background(Callback<void(int)> update)
     }
 }
 
+int EventQueue::reserve(unsigned count, unsigned size)
+{
+    return equeue_reserve(&_equeue, count, size);
+}
+
 void EventQueue::chain(EventQueue *target)
 {
     if (target) {
@@ -60,8 +60,12 @@ public:
      *                  (default to EVENTS_QUEUE_SIZE)
      *  @param buffer   Pointer to buffer to use for events
      *                  (default to NULL)
+     *  @param flags    Bitmask of EQUEUE_* creation flags, for example
+     *                  EQUEUE_HEAP to schedule events with a pairing heap
+     *                  when many events are pending (default to 0)
      */
-    EventQueue(unsigned size = EVENTS_QUEUE_SIZE, unsigned char *buffer = NULL);
+    EventQueue(unsigned size = EVENTS_QUEUE_SIZE, unsigned char *buffer = NULL,
+               unsigned flags = 0);
 
     /** Destroy an EventQueue
      */
@@ -184,6 +188,26 @@ public:
      */
     void chain(EventQueue *target);
 
+    /** Reserve event slots for lock-free posting
+     *
+     *  Sets aside a number of fixed-size event slots in the event queue's
+     *  buffer. Events that fit in a slot are then allocated, posted and
+     *  freed without taking the event queue's lock, which is a critical
+     *  section, reducing interrupt latency when calling from IRQ context.
+     *  Once all slots are in use, events fall back to the regular allocator.
+     *
+     *  The reserve function should be called once, before any events are
+     *  posted. Slots are not used while the queue is backgrounded or
+     *  chained onto another queue.
+     *
+     *  @param count    Number of slots to reserve
+     *  @param size     Size of the event that fits in each slot in bytes
+     *                  (default to the size of a Callback<void()>)
+     *  @return         0 on success or a negative error code if there is
+     *                  not enough space in the event queue's buffer
+     */
+    int reserve(unsigned count, unsigned size = sizeof(mbed::Callback<void()>));
+
 
 
 #if defined(DOXYGEN_ONLY)
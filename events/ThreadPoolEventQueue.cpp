@@ -0,0 +1,221 @@
+/* events
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "events/ThreadPoolEventQueue.h"
+
+#if MBED_CONF_RTOS_PRESENT
+
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+
+using mbed::callback;
+using rtos::Thread;
+
+namespace events {
+
+ThreadPoolEventQueue::ThreadPoolEventQueue(unsigned threads, unsigned size,
+                                           unsigned char *buffer, unsigned flags,
+                                           osPriority priority, uint32_t stack_size)
+    : EventQueue(size, buffer, flags), _threads(threads), _priority(priority),
+      _stack_size(stack_size), _idle(0), _waiting(0), _stopping(false)
+{
+    MBED_ASSERT(threads > 0);
+    _workers = new worker[threads];
+    for (unsigned i = 0; i < threads; i++) {
+        _workers[i].pool = this;
+        _workers[i].thread = NULL;
+        _workers[i].head = 0;
+        _workers[i].tail = 0;
+        _workers[i].executed = 0;
+        _workers[i].stolen = 0;
+    }
+}
+
+ThreadPoolEventQueue::~ThreadPoolEventQueue()
+{
+    stop();
+    delete[] _workers;
+}
+
+osStatus ThreadPoolEventQueue::start()
+{
+    for (unsigned i = 0; i < _threads; i++) {
+        if (_workers[i].thread) {
+            continue;
+        }
+
+        _workers[i].thread = new Thread(_priority, _stack_size);
+        osStatus status = _workers[i].thread->start(
+                              callback(&ThreadPoolEventQueue::work, &_workers[i]));
+        if (status != osOK) {
+            stop();
+            return status;
+        }
+    }
+
+    return osOK;
+}
+
+void ThreadPoolEventQueue::stop()
+{
+    _stopping = true;
+
+    // kick the worker waiting on the queue and any idle workers
+    equeue_break(&_equeue);
+    for (unsigned i = 0; i < _threads; i++) {
+        _idle.release();
+    }
+
+    for (unsigned i = 0; i < _threads; i++) {
+        if (_workers[i].thread) {
+            _workers[i].thread->join();
+            delete _workers[i].thread;
+            _workers[i].thread = NULL;
+        }
+    }
+
+    // drop the wakeups and the break no worker consumed, so they don't
+    // cut the first waits short after a restart
+    while (_idle.wait(0) > 0) {
+    }
+    _waiting = 0;
+    equeue_mutex_lock(&_equeue.queuelock);
+    _equeue.break_requested = false;
+    equeue_mutex_unlock(&_equeue.queuelock);
+
+    _stopping = false;
+}
+
+unsigned ThreadPoolEventQueue::threads() const
+{
+    return _threads;
+}
+
+unsigned ThreadPoolEventQueue::executed(unsigned worker) const
+{
+    MBED_ASSERT(worker < _threads);
+    return _workers[worker].executed;
+}
+
+unsigned ThreadPoolEventQueue::stolen(unsigned worker) const
+{
+    MBED_ASSERT(worker < _threads);
+    return _workers[worker].stolen;
+}
+
+bool ThreadPoolEventQueue::pop(worker *w, void **event)
+{
+    bool found = false;
+    core_util_critical_section_enter();
+    if (w->head != w->tail) {
+        *event = w->deque[w->head];
+        w->head += 1;
+        found = true;
+    }
+    core_util_critical_section_exit();
+    return found;
+}
+
+bool ThreadPoolEventQueue::steal(worker *thief, void **event)
+{
+    unsigned index = thief - _workers;
+    for (unsigned i = 1; i < _threads; i++) {
+        worker *w = &_workers[(index + i) % _threads];
+
+        bool found = false;
+        core_util_critical_section_enter();
+        if (w->head != w->tail) {
+            w->tail -= 1;
+            *event = w->deque[w->tail];
+            found = true;
+        }
+        core_util_critical_section_exit();
+
+        if (found) {
+            thief->stolen += 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPoolEventQueue::wake(unsigned count)
+{
+    // only release workers actually waiting, extra releases would pile up
+    // in the semaphore and let later idle workers spin on the queue lock
+    while (count > 0) {
+        uint32_t waiting = _waiting;
+        if (!waiting) {
+            return;
+        }
+
+        if (core_util_atomic_cas_u32(&_waiting, &waiting, waiting - 1)) {
+            _idle.release();
+            count -= 1;
+        }
+    }
+}
+
+void ThreadPoolEventQueue::work(worker *w)
+{
+    ThreadPoolEventQueue *pool = w->pool;
+
+    while (true) {
+        // run our own events first, then help out other workers
+        void *event;
+        if (pool->pop(w, &event) || pool->steal(w, &event)) {
+            equeue_run(&pool->_equeue, event);
+            w->executed += 1;
+            continue;
+        }
+
+        if (pool->_stopping) {
+            return;
+        }
+
+        // only one worker waits on the queue, the others sleep until it
+        // has events to share or hands the queue over
+        if (!pool->_take_lock.trylock()) {
+            core_util_atomic_incr_u32(&pool->_waiting, 1);
+            pool->_idle.wait();
+            continue;
+        }
+
+        // our deque is empty so nobody can steal from it while we fill it
+        int count = 0;
+        if (!pool->_stopping) {
+            count = equeue_take(&pool->_equeue, w->deque,
+                                THREAD_POOL_EVENT_QUEUE_BATCH, -1);
+        }
+        pool->_take_lock.unlock();
+
+        if (count > 0) {
+            core_util_critical_section_enter();
+            w->head = 0;
+            w->tail = count;
+            core_util_critical_section_exit();
+
+            // wake idle workers to steal from the batch, the first one also
+            // takes over waiting on the queue
+            pool->wake(count);
+        }
+    }
+}
+
+}
+
+#endif
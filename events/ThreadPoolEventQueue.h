@@ -0,0 +1,168 @@
+/* events
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef THREAD_POOL_EVENT_QUEUE_H
+#define THREAD_POOL_EVENT_QUEUE_H
+
+#include "events/EventQueue.h"
+
+#if MBED_CONF_RTOS_PRESENT || defined(DOXYGEN_ONLY)
+
+#include "rtos/Thread.h"
+#include "rtos/Mutex.h"
+#include "rtos/Semaphore.h"
+
+namespace events {
+/** \addtogroup events */
+
+/** THREAD_POOL_EVENT_QUEUE_BATCH
+ *  Maximum number of due events a worker takes out of the queue at once
+ */
+#ifdef MBED_CONF_EVENTS_THREAD_POOL_BATCH_SIZE
+#define THREAD_POOL_EVENT_QUEUE_BATCH MBED_CONF_EVENTS_THREAD_POOL_BATCH_SIZE
+#else
+#define THREAD_POOL_EVENT_QUEUE_BATCH 4
+#endif
+
+/** ThreadPoolEventQueue
+ *
+ *  Event queue dispatched by a pool of threads
+ *
+ *  One worker at a time waits on the queue and takes a batch of due events
+ *  into its own deque, then hands the queue over to an idle worker while it
+ *  runs the batch from the front. Idle workers steal from the back of busy
+ *  workers' deques, so a long running event does not hold up the rest of
+ *  the batch.
+ *
+ *  Events posted directly to a ThreadPoolEventQueue may run concurrently and
+ *  in any order, even when they share the same target time. Work that must
+ *  stay ordered should be posted to a separate EventQueue chained onto the
+ *  pool, the chained queue is dispatched by one worker at a time and keeps
+ *  its ordering guarantees.
+ *
+ *  @note The dispatch functions inherited from EventQueue must not be used
+ *  on a started ThreadPoolEventQueue.
+ *
+ * @ingroup events
+ */
+class ThreadPoolEventQueue : public EventQueue {
+public:
+    /** Create a ThreadPoolEventQueue
+     *
+     *  The worker threads are not started until start is called.
+     *
+     *  @param threads      Number of worker threads (default to 2)
+     *  @param size         Size of buffer to use for events in bytes
+     *                      (default to EVENTS_QUEUE_SIZE)
+     *  @param buffer       Pointer to buffer to use for events
+     *                      (default to NULL)
+     *  @param flags        Bitmask of EQUEUE_* creation flags (default to 0)
+     *  @param priority     Priority of the worker threads
+     *                      (default to osPriorityNormal)
+     *  @param stack_size   Stack size of each worker thread in bytes
+     *                      (default to OS_STACK_SIZE)
+     */
+    ThreadPoolEventQueue(unsigned threads = 2,
+                         unsigned size = EVENTS_QUEUE_SIZE,
+                         unsigned char *buffer = NULL,
+                         unsigned flags = 0,
+                         osPriority priority = osPriorityNormal,
+                         uint32_t stack_size = OS_STACK_SIZE);
+
+    /** Destroy a ThreadPoolEventQueue
+     *
+     *  Stops the worker threads before destroying the queue.
+     */
+    ~ThreadPoolEventQueue();
+
+    /** Start the worker threads
+     *
+     *  @return         status code that indicates the execution status of
+     *                  the function
+     */
+    osStatus start();
+
+    /** Stop the worker threads
+     *
+     *  Waits for the workers to finish the events they have already taken
+     *  out of the queue. Any other events stay in the queue and run once
+     *  the pool is started again.
+     */
+    void stop();
+
+    /** Number of worker threads in the pool
+     *
+     *  @return         Number of worker threads
+     */
+    unsigned threads() const;
+
+    /** Number of events run by a worker thread
+     *
+     *  @param worker   Index of the worker thread
+     *  @return         Number of events run by the worker, including stolen
+     *                  events
+     */
+    unsigned executed(unsigned worker) const;
+
+    /** Number of events stolen by a worker thread
+     *
+     *  @param worker   Index of the worker thread
+     *  @return         Number of events the worker took from the deques of
+     *                  other workers
+     */
+    unsigned stolen(unsigned worker) const;
+
+#if !defined(DOXYGEN_ONLY)
+protected:
+    struct worker {
+        ThreadPoolEventQueue *pool;
+        rtos::Thread *thread;
+
+        // events taken out of the queue, the owner runs from the front and
+        // other workers steal from the back
+        void *deque[THREAD_POOL_EVENT_QUEUE_BATCH];
+        unsigned head;
+        unsigned tail;
+
+        unsigned executed;
+        unsigned stolen;
+    };
+
+    static void work(worker *w);
+    bool pop(worker *w, void **event);
+    bool steal(worker *thief, void **event);
+    void wake(unsigned count);
+
+    worker *_workers;
+    unsigned _threads;
+    osPriority _priority;
+    uint32_t _stack_size;
+
+    rtos::Mutex _take_lock;
+    rtos::Semaphore _idle;
+    volatile uint32_t _waiting;
+    volatile bool _stopping;
+#endif
+};
+
+}
+
+#endif
+
+#endif
+
+/** @}*/
@@ -48,6 +48,11 @@ static inline void equeue_incid(equeue_t *q, struct equeue_event *e)
 
 // equeue lifetime management
 int equeue_create(equeue_t *q, size_t size)
+{
+    return equeue_create_flags(q, size, 0);
+}
+
+int equeue_create_flags(equeue_t *q, size_t size, unsigned flags)
 {
     // dynamically allocate the specified buffer
     void *buffer = malloc(size);
@@ -55,12 +60,18 @@ int equeue_create(equeue_t *q, size_t size)
         return -1;
     }
 
-    int err = equeue_create_inplace(q, size, buffer);
+    int err = equeue_create_inplace_flags(q, size, buffer, flags);
     q->allocated = buffer;
     return err;
 }
 
 int equeue_create_inplace(equeue_t *q, size_t size, void *buffer)
+{
+    return equeue_create_inplace_flags(q, size, buffer, 0);
+}
+
+int equeue_create_inplace_flags(equeue_t *q, size_t size, void *buffer,
+                                unsigned flags)
 {
     // setup queue around provided buffer
     q->buffer = buffer;
@@ -71,19 +82,43 @@ int equeue_create_inplace(equeue_t *q, size_t size, void *buffer)
         q->npw2++;
     }
 
-    q->chunks = 0;
+    for (unsigned i = 0; i < EQUEUE_BINS; i++) {
+        q->bins[i] = 0;
+    }
+    q->binmap = 0;
     q->slab.size = size;
     q->slab.data = buffer;
 
+    q->memstats.used = 0;
+    q->memstats.used_max = 0;
+    q->memstats.allocs = 0;
+    q->memstats.failures = 0;
+    q->memstats.reserved = 0;
+
+    q->lockfree.slots = 0;
+    q->lockfree.size = 0;
+    q->lockfree.count = 0;
+    q->lockfree.free = 0;
+    q->lockfree.ring = 0;
+    q->lockfree.mask = 0;
+    q->lockfree.tail = 0;
+    q->lockfree.head = 0;
+
     q->queue = 0;
+    q->ready = 0;
     q->tick = equeue_tick();
     q->generation = 0;
     q->break_requested = false;
+    q->flags = flags;
+    q->seq = 0;
 
     q->background.active = false;
     q->background.update = 0;
     q->background.timer = 0;
 
+    q->chain.busy = false;
+    q->chain.pending = false;
+
     // initialize platform resources
     int err;
     err = equeue_sema_create(&q->eventsema);
@@ -104,17 +139,51 @@ int equeue_create_inplace(equeue_t *q, size_t size, void *buffer)
     return 0;
 }
 
+static void equeue_lockfree_drain(equeue_t *q, unsigned tick);
+
 void equeue_destroy(equeue_t *q)
 {
+    // move any lock-free posts into the queue
+    equeue_mutex_lock(&q->queuelock);
+    equeue_lockfree_drain(q, equeue_tick());
+    equeue_mutex_unlock(&q->queuelock);
+
+    // call destructors on events taken but not yet handed out
+    for (struct equeue_event *e = q->ready; e; e = e->next) {
+        if (e->dtor) {
+            e->dtor(e + 1);
+        }
+    }
+
     // call destructors on pending events
-    for (struct equeue_event *es = q->queue; es; es = es->next) {
-        for (struct equeue_event *e = es->sibling; e; e = e->sibling) {
+    if (q->flags & EQUEUE_HEAP) {
+        // flatten the heap by splicing each node's children after it
+        for (struct equeue_event *e = q->queue; e; e = e->next) {
+            if (e->sibling) {
+                struct equeue_event *tail = e->sibling;
+                while (tail->next) {
+                    tail = tail->next;
+                }
+
+                tail->next = e->next;
+                e->next = e->sibling;
+                e->sibling = 0;
+            }
+
             if (e->dtor) {
                 e->dtor(e + 1);
             }
         }
-        if (es->dtor) {
-            es->dtor(es + 1);
+    } else {
+        for (struct equeue_event *es = q->queue; es; es = es->next) {
+            for (struct equeue_event *e = es->sibling; e; e = e->sibling) {
+                if (e->dtor) {
+                    e->dtor(e + 1);
+                }
+            }
+            if (es->dtor) {
+                es->dtor(es + 1);
+            }
         }
     }
     // notify background timer
@@ -130,65 +199,287 @@ void equeue_destroy(equeue_t *q)
 }
 
 
+// equeue lock-free slot functions
+//
+// Reserved slots are contiguous chunks of equal size. Free slots form a
+// Treiber stack whose head packs a 16-bit tag above the slot index plus one,
+// the tag is bumped on every update to avoid ABA problems. Posted slots are
+// pushed into a ring of slot indexes plus one, which has room for every slot
+// and so can never overflow. The ring is drained under the queuelock.
+#define EQUEUE_LOCKFREE_INDEX 0xffff
+#define EQUEUE_LOCKFREE_TAG   0x10000
+
+static inline bool equeue_lockfree_owns(equeue_t *q, struct equeue_event *e)
+{
+    return (unsigned char *)e >= q->lockfree.slots &&
+           (unsigned char *)e < q->lockfree.slots
+           + q->lockfree.count * q->lockfree.size;
+}
+
+static inline unsigned equeue_lockfree_index(equeue_t *q,
+                                             struct equeue_event *e)
+{
+    return ((unsigned char *)e - q->lockfree.slots) / q->lockfree.size;
+}
+
+static inline struct equeue_event *equeue_lockfree_slot(equeue_t *q,
+                                                        unsigned i)
+{
+    return (struct equeue_event *)&q->lockfree.slots[i * q->lockfree.size];
+}
+
+static struct equeue_event *equeue_lockfree_alloc(equeue_t *q)
+{
+    unsigned top = q->lockfree.free;
+    while (top & EQUEUE_LOCKFREE_INDEX) {
+        // next may be stale if the slot was taken concurrently, in which
+        // case the tag will have changed and the cas fails
+        struct equeue_event *e = equeue_lockfree_slot(q,
+                                 (top & EQUEUE_LOCKFREE_INDEX) - 1);
+        struct equeue_event *next = e->next;
+        unsigned ntop = ((top + EQUEUE_LOCKFREE_TAG) & ~EQUEUE_LOCKFREE_INDEX)
+                        | (next ? equeue_lockfree_index(q, next) + 1 : 0);
+
+        if (equeue_atomic_cas(&q->lockfree.free, &top, ntop)) {
+            return e;
+        }
+    }
+
+    return 0;
+}
+
+static void equeue_lockfree_dealloc(equeue_t *q, struct equeue_event *e)
+{
+    unsigned top = q->lockfree.free;
+    unsigned ntop;
+    do {
+        e->next = (top & EQUEUE_LOCKFREE_INDEX)
+                  ? equeue_lockfree_slot(q, (top & EQUEUE_LOCKFREE_INDEX) - 1)
+                  : 0;
+        ntop = ((top + EQUEUE_LOCKFREE_TAG) & ~EQUEUE_LOCKFREE_INDEX)
+               | (equeue_lockfree_index(q, e) + 1);
+    } while (!equeue_atomic_cas(&q->lockfree.free, &top, ntop));
+}
+
+static void equeue_lockfree_push(equeue_t *q, struct equeue_event *e)
+{
+    // claim a position in the ring
+    unsigned pos = q->lockfree.tail;
+    while (!equeue_atomic_cas(&q->lockfree.tail, &pos, pos + 1));
+
+    // and publish the slot, the cell is always empty as the ring has
+    // room for every slot
+    unsigned empty = 0;
+    equeue_atomic_cas(&q->lockfree.ring[pos & q->lockfree.mask], &empty,
+                      equeue_lockfree_index(q, e) + 1);
+}
+
+int equeue_reserve(equeue_t *q, unsigned count, size_t size)
+{
+    if (q->lockfree.count || count == 0 || count > EQUEUE_LOCKFREE_INDEX) {
+        return -1;
+    }
+
+    // add event overhead
+    size += sizeof(struct equeue_event);
+    size = (size + sizeof(void *) -1) & ~(sizeof(void *) -1);
+
+    unsigned ringsize = 1;
+    while (ringsize < count) {
+        ringsize <<= 1;
+    }
+
+    equeue_mutex_lock(&q->memlock);
+
+    // carve the ring and slots out of the slab
+    size_t align = (sizeof(void *) - ((uintptr_t)q->slab.data
+                                      & (sizeof(void *) - 1))) & (sizeof(void *) - 1);
+    size_t total = align + ringsize * sizeof(unsigned) + count * size;
+    total = (total + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (q->slab.size < total) {
+        equeue_mutex_unlock(&q->memlock);
+        return -1;
+    }
+
+    q->lockfree.ring = (volatile unsigned *)(q->slab.data + align);
+    q->lockfree.slots = q->slab.data + total - count * size;
+    q->slab.data += total;
+    q->slab.size -= total;
+    q->memstats.reserved = total;
+
+    for (unsigned i = 0; i < ringsize; i++) {
+        q->lockfree.ring[i] = 0;
+    }
+
+    q->lockfree.size = size;
+    q->lockfree.count = count;
+    q->lockfree.mask = ringsize - 1;
+    q->lockfree.tail = 0;
+    q->lockfree.head = 0;
+
+    // chain the slots into the free stack
+    for (unsigned i = 0; i < count; i++) {
+        struct equeue_event *e = equeue_lockfree_slot(q, i);
+        e->size = size;
+        e->id = 1;
+        e->next = (i + 1 < count) ? equeue_lockfree_slot(q, i + 1) : 0;
+    }
+    q->lockfree.free = 1;
+
+    equeue_mutex_unlock(&q->memlock);
+    return 0;
+}
+
+
 // equeue chunk allocation functions
+//
+// Free chunks are kept in bins by the floor of their size's log2, and a
+// bitmap tracks which bins are non-empty. Every chunk in a bin above the
+// requested size's bin is guaranteed to fit.
+static inline unsigned equeue_bin(size_t size)
+{
+    if (size > (unsigned)-1) {
+        return EQUEUE_BINS - 1;
+    }
+
+#if defined(__GNUC__)
+    return (EQUEUE_BINS - 1) - __builtin_clz((unsigned)size | 1);
+#else
+    unsigned bin = 0;
+    while (size >>= 1) {
+        bin++;
+    }
+
+    return bin;
+#endif
+}
+
+static inline void equeue_mem_take(equeue_t *q, struct equeue_event **p,
+                                   unsigned bin)
+{
+    struct equeue_event *e = *p;
+    *p = e->next;
+    if (!q->bins[bin]) {
+        q->binmap &= ~(1U << bin);
+    }
+}
+
 static struct equeue_event *equeue_mem_alloc(equeue_t *q, size_t size)
 {
     // add event overhead
     size += sizeof(struct equeue_event);
     size = (size + sizeof(void *) -1) & ~(sizeof(void *) -1);
 
+    // try a lock-free slot first, unless a background timer needs updating
+    if (size <= q->lockfree.size && !q->background.update) {
+        struct equeue_event *e = equeue_lockfree_alloc(q);
+        if (e) {
+            return e;
+        }
+    }
+
     equeue_mutex_lock(&q->memlock);
 
-    // check if a good chunk is available
-    for (struct equeue_event **p = &q->chunks; *p; p = &(*p)->next) {
-        if ((*p)->size >= size) {
-            struct equeue_event *e = *p;
-            if (e->sibling) {
-                *p = e->sibling;
-                (*p)->next = e->next;
-            } else {
-                *p = e->next;
-            }
+    // check the most recently freed chunk of the same size class, this
+    // gives exact reuse for repeatedly allocated event sizes
+    unsigned bin = equeue_bin(size);
+    struct equeue_event *e = q->bins[bin];
+    if (e && e->size >= size) {
+        equeue_mem_take(q, &q->bins[bin], bin);
+        goto found;
+    }
 
-            equeue_mutex_unlock(&q->memlock);
-            return e;
+    // check for any chunk in a larger size class
+    unsigned map = (bin + 1 < EQUEUE_BINS) ? q->binmap & ~((2U << bin) - 1) : 0;
+    if (map) {
+        unsigned big = equeue_bin(map & -map);
+        e = q->bins[big];
+        if (e->size >= size) {
+            equeue_mem_take(q, &q->bins[big], big);
+            goto found;
         }
     }
 
     // otherwise allocate a new chunk out of the slab
     if (q->slab.size >= size) {
-        struct equeue_event *e = (struct equeue_event *)q->slab.data;
+        e = (struct equeue_event *)q->slab.data;
         q->slab.data += size;
         q->slab.size -= size;
         e->size = size;
         e->id = 1;
+        goto found;
+    }
 
-        equeue_mutex_unlock(&q->memlock);
-        return e;
+    // as a last resort search the rest of the same size class
+    if (q->bins[bin]) {
+        for (struct equeue_event **p = &q->bins[bin]->next; *p; p = &(*p)->next) {
+            if ((*p)->size >= size) {
+                e = *p;
+                equeue_mem_take(q, p, bin);
+                goto found;
+            }
+        }
     }
 
+    q->memstats.failures += 1;
     equeue_mutex_unlock(&q->memlock);
     return 0;
+
+found:
+    q->memstats.allocs += 1;
+    q->memstats.used += e->size;
+    if (q->memstats.used > q->memstats.used_max) {
+        q->memstats.used_max = q->memstats.used;
+    }
+
+    equeue_mutex_unlock(&q->memlock);
+    return e;
 }
 
 static void equeue_mem_dealloc(equeue_t *q, struct equeue_event *e)
 {
+    if (equeue_lockfree_owns(q, e)) {
+        equeue_lockfree_dealloc(q, e);
+        return;
+    }
+
     equeue_mutex_lock(&q->memlock);
 
-    // stick chunk into list of chunks
-    struct equeue_event **p = &q->chunks;
-    while (*p && (*p)->size < e->size) {
-        p = &(*p)->next;
-    }
+    // push chunk onto its size class
+    unsigned bin = equeue_bin(e->size);
+    e->next = q->bins[bin];
+    q->bins[bin] = e;
+    q->binmap |= 1U << bin;
 
-    if (*p && (*p)->size == e->size) {
-        e->sibling = *p;
-        e->next = (*p)->next;
-    } else {
-        e->sibling = 0;
-        e->next = *p;
+    q->memstats.used -= e->size;
+
+    equeue_mutex_unlock(&q->memlock);
+}
+
+void equeue_stats(equeue_t *q, equeue_stats_t *stats)
+{
+    equeue_mutex_lock(&q->memlock);
+
+    stats->size = (q->slab.data - q->buffer) + q->slab.size;
+    stats->used = q->memstats.used;
+    stats->used_max = q->memstats.used_max;
+    stats->free = 0;
+    stats->free_chunks = 0;
+    stats->free_max = 0;
+    stats->slab = q->slab.size;
+    stats->reserved = q->memstats.reserved;
+    stats->allocs = q->memstats.allocs;
+    stats->failures = q->memstats.failures;
+
+    for (unsigned i = 0; i < EQUEUE_BINS; i++) {
+        for (struct equeue_event *e = q->bins[i]; e; e = e->next) {
+            stats->free += e->size;
+            stats->free_chunks += 1;
+            if (e->size > stats->free_max) {
+                stats->free_max = e->size;
+            }
+        }
     }
-    *p = e;
 
     equeue_mutex_unlock(&q->memlock);
 }
@@ -219,15 +510,133 @@ void equeue_dealloc(equeue_t *q, void *p)
 }
 
 
+// equeue heap functions
+//
+// In heap mode the pending events form a pairing heap ordered by target
+// tick and then by posting order. The event fields are reused as follows:
+// - sibling points to the first child of the event
+// - next points to the next child of the event's parent
+// - ref points to the pointer that references the event
+static inline bool equeue_heap_before(struct equeue_event *a,
+                                      struct equeue_event *b)
+{
+    int diff = equeue_tickdiff(a->target, b->target);
+    return diff < 0 || (diff == 0 && (int)(a->seq - b->seq) < 0);
+}
+
+// link two detached heaps, returning the new detached root
+static struct equeue_event *equeue_heap_meld(struct equeue_event *a,
+                                             struct equeue_event *b)
+{
+    if (!a) {
+        return b;
+    } else if (!b) {
+        return a;
+    }
+
+    if (equeue_heap_before(b, a)) {
+        struct equeue_event *t = a;
+        a = b;
+        b = t;
+    }
+
+    // b becomes the first child of a
+    b->next = a->sibling;
+    if (b->next) {
+        b->next->ref = &b->next;
+    }
+
+    a->sibling = b;
+    b->ref = &a->sibling;
+    return a;
+}
+
+// combine a list of sibling heaps using the two-pass pairing strategy
+static struct equeue_event *equeue_heap_pair(struct equeue_event *es)
+{
+    // first pass, meld pairs left to right, collecting them in reverse
+    struct equeue_event *pairs = 0;
+    while (es) {
+        struct equeue_event *a = es;
+        struct equeue_event *b = a->next;
+        es = b ? b->next : 0;
+
+        a = equeue_heap_meld(a, b);
+        a->next = pairs;
+        pairs = a;
+    }
+
+    // second pass, meld the pairs right to left into a single heap
+    struct equeue_event *root = 0;
+    while (pairs) {
+        struct equeue_event *a = pairs;
+        pairs = a->next;
+        root = equeue_heap_meld(a, root);
+    }
+
+    return root;
+}
+
+static inline void equeue_heap_setroot(equeue_t *q, struct equeue_event *root)
+{
+    q->queue = root;
+    if (root) {
+        root->next = 0;
+        root->ref = &q->queue;
+    }
+}
+
+static void equeue_heap_insert(equeue_t *q, struct equeue_event *e)
+{
+    e->next = 0;
+    e->sibling = 0;
+    equeue_heap_setroot(q, equeue_heap_meld(q->queue, e));
+}
+
+static void equeue_heap_remove(equeue_t *q, struct equeue_event *e)
+{
+    if (q->queue == e) {
+        equeue_heap_setroot(q, equeue_heap_pair(e->sibling));
+        return;
+    }
+
+    // unlink the subtree from its parent, then merge the children back in
+    *e->ref = e->next;
+    if (e->next) {
+        e->next->ref = e->ref;
+    }
+
+    struct equeue_event *children = equeue_heap_pair(e->sibling);
+    equeue_heap_setroot(q, equeue_heap_meld(q->queue, children));
+}
+
+
 // equeue scheduling functions
-static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick)
+static inline int equeue_id(equeue_t *q, struct equeue_event *e)
+{
+    // hash local id with buffer offset for unique id
+    return (e->id << q->npw2) | ((unsigned char *)e - q->buffer);
+}
+
+// insert an event into the queue, must be called with the queuelock held
+static void equeue_insert(equeue_t *q, struct equeue_event *e, unsigned tick)
 {
-    // setup event and hash local id with buffer offset for unique id
-    int id = (e->id << q->npw2) | ((unsigned char *)e - q->buffer);
     e->target = tick + equeue_clampdiff(e->target, tick);
     e->generation = q->generation;
 
-    equeue_mutex_lock(&q->queuelock);
+    if (q->flags & EQUEUE_HEAP) {
+        e->seq = q->seq++;
+        equeue_heap_insert(q, e);
+
+        // notify background timer
+        if ((q->background.update && q->background.active) &&
+                q->queue == e) {
+            q->background.update(q->background.timer,
+                                 equeue_clampdiff(e->target, tick));
+        }
+
+        return;
+    }
 
     // find the event slot
     struct equeue_event **p = &q->queue;
@@ -262,6 +671,40 @@ static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick)
         q->background.update(q->background.timer,
                              equeue_clampdiff(e->target, tick));
     }
+}
+
+// move lock-free posts into the queue in the order they were posted, must
+// be called with the queuelock held
+static void equeue_lockfree_drain(equeue_t *q, unsigned tick)
+{
+    if (!q->lockfree.count) {
+        return;
+    }
+
+    while (1) {
+        volatile unsigned *cell = &q->lockfree.ring[
+                                      q->lockfree.head & q->lockfree.mask];
+        unsigned i = *cell;
+        if (!i) {
+            // empty, or claimed but not yet published
+            break;
+        }
+
+        equeue_atomic_cas(cell, &i, 0);
+        q->lockfree.head += 1;
+        equeue_insert(q, equeue_lockfree_slot(q, i - 1), tick);
+    }
+}
+
+static int equeue_enqueue(equeue_t *q, struct equeue_event *e, unsigned tick)
+{
+    int id = equeue_id(q, e);
+
+    equeue_mutex_lock(&q->queuelock);
+
+    // earlier lock-free posts go first to preserve posting order
+    equeue_lockfree_drain(q, tick);
+    equeue_insert(q, e, tick);
 
     equeue_mutex_unlock(&q->queuelock);
 
@@ -275,6 +718,7 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id)
                              &q->buffer[id & ((1 << q->npw2) - 1)];
 
     equeue_mutex_lock(&q->queuelock);
+    equeue_lockfree_drain(q, equeue_tick());
     if (e->id != id >> q->npw2) {
         equeue_mutex_unlock(&q->queuelock);
         return 0;
@@ -284,6 +728,13 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id)
     e->cb = 0;
     e->period = -1;
 
+    // lock-free posts that are not yet published in the ring are treated
+    // as in-flight, the dispatch loop will clean them up
+    if (equeue_lockfree_owns(q, e) && !e->ref) {
+        equeue_mutex_unlock(&q->queuelock);
+        return 0;
+    }
+
     int diff = equeue_tickdiff(e->target, q->tick);
     if (diff < 0 || (diff == 0 && e->generation != q->generation)) {
         equeue_mutex_unlock(&q->queuelock);
@@ -291,7 +742,9 @@ static struct equeue_event *equeue_unqueue(equeue_t *q, int id)
     }
 
     // disentangle from queue
-    if (e->sibling) {
+    if (q->flags & EQUEUE_HEAP) {
+        equeue_heap_remove(q, e);
+    } else if (e->sibling) {
         e->sibling->next = e->next;
         if (e->sibling->next) {
             e->sibling->next->ref = &e->sibling->next;
@@ -316,12 +769,32 @@ static struct equeue_event *equeue_dequeue(equeue_t *q, unsigned target)
 {
     equeue_mutex_lock(&q->queuelock);
 
-    // find all expired events and mark a new generation
+    // collect lock-free posts, find all expired events and mark a new
+    // generation
+    equeue_lockfree_drain(q, target);
     q->generation += 1;
     if (equeue_tickdiff(q->tick, target) <= 0) {
         q->tick = target;
     }
 
+    if (q->flags & EQUEUE_HEAP) {
+        // pop expired events in order, heap order already matches
+        // insertion order for events with equal targets
+        struct equeue_event *head = 0;
+        struct equeue_event **tail = &head;
+        while (q->queue && equeue_tickdiff(q->queue->target, target) <= 0) {
+            struct equeue_event *e = q->queue;
+            equeue_heap_setroot(q, equeue_heap_pair(e->sibling));
+
+            *tail = e;
+            tail = &e->next;
+        }
+
+        *tail = 0;
+        equeue_mutex_unlock(&q->queuelock);
+        return head;
+    }
+
     struct equeue_event *head = q->queue;
     struct equeue_event **p = &head;
     while (*p && equeue_tickdiff((*p)->target, target) <= 0) {
@@ -364,7 +837,16 @@ int equeue_post(equeue_t *q, void (*cb)(void *), void *p)
     e->cb = cb;
     e->target = tick + e->target;
 
-    int id = equeue_enqueue(q, e, tick);
+    int id;
+    if (equeue_lockfree_owns(q, e)) {
+        // leave enqueueing to whoever next holds the queuelock
+        id = equeue_id(q, e);
+        e->ref = 0;
+        equeue_lockfree_push(q, e);
+    } else {
+        id = equeue_enqueue(q, e, tick);
+    }
+
     equeue_sema_signal(&q->eventsema);
     return id;
 }
@@ -409,6 +891,77 @@ void equeue_break(equeue_t *q)
     equeue_sema_signal(&q->eventsema);
 }
 
+static void equeue_run_event(equeue_t *q, struct equeue_event *e)
+{
+    // actually dispatch the callbacks
+    void (*cb)(void *) = e->cb;
+    if (cb) {
+        cb(e + 1);
+    }
+
+    // reenqueue periodic events or deallocate
+    if (e->period >= 0) {
+        e->target += e->period;
+        equeue_enqueue(q, e, equeue_tick());
+    } else {
+        equeue_incid(q, e);
+        equeue_dealloc(q, e + 1);
+    }
+}
+
+// wait for the next event or the timeout, returns false if the caller
+// should stop waiting
+static bool equeue_wait(equeue_t *q, int ms, unsigned timeout)
+{
+    int deadline = -1;
+    unsigned tick = equeue_tick();
+
+    // check if we should stop dispatching soon
+    if (ms >= 0) {
+        deadline = equeue_tickdiff(timeout, tick);
+        if (deadline <= 0) {
+            // update background timer if necessary
+            if (q->background.update) {
+                equeue_mutex_lock(&q->queuelock);
+                if (q->background.update && q->queue) {
+                    q->background.update(q->background.timer,
+                                         equeue_clampdiff(q->queue->target, tick));
+                }
+                q->background.active = true;
+                equeue_mutex_unlock(&q->queuelock);
+            }
+            q->break_requested = false;
+            return false;
+        }
+    }
+
+    // find closest deadline
+    equeue_mutex_lock(&q->queuelock);
+    if (q->queue) {
+        int diff = equeue_clampdiff(q->queue->target, tick);
+        if ((unsigned)diff < (unsigned)deadline) {
+            deadline = diff;
+        }
+    }
+    equeue_mutex_unlock(&q->queuelock);
+
+    // wait for events
+    equeue_sema_wait(&q->eventsema, deadline);
+
+    // check if we were notified to break out of dispatch
+    if (q->break_requested) {
+        equeue_mutex_lock(&q->queuelock);
+        if (q->break_requested) {
+            q->break_requested = false;
+            equeue_mutex_unlock(&q->queuelock);
+            return false;
+        }
+        equeue_mutex_unlock(&q->queuelock);
+    }
+
+    return true;
+}
+
 void equeue_dispatch(equeue_t *q, int ms)
 {
     unsigned tick = equeue_tick();
@@ -423,67 +976,44 @@ void equeue_dispatch(equeue_t *q, int ms)
         while (es) {
             struct equeue_event *e = es;
             es = e->next;
+            equeue_run_event(q, e);
+        }
 
-            // actually dispatch the callbacks
-            void (*cb)(void *) = e->cb;
-            if (cb) {
-                cb(e + 1);
-            }
-
-            // reenqueue periodic events or deallocate
-            if (e->period >= 0) {
-                e->target += e->period;
-                equeue_enqueue(q, e, equeue_tick());
-            } else {
-                equeue_incid(q, e);
-                equeue_dealloc(q, e + 1);
-            }
+        if (!equeue_wait(q, ms, timeout)) {
+            return;
         }
 
-        int deadline = -1;
+        // update tick for next iteration
         tick = equeue_tick();
+    }
+}
 
-        // check if we should stop dispatching soon
-        if (ms >= 0) {
-            deadline = equeue_tickdiff(timeout, tick);
-            if (deadline <= 0) {
-                // update background timer if necessary
-                if (q->background.update) {
-                    equeue_mutex_lock(&q->queuelock);
-                    if (q->background.update && q->queue) {
-                        q->background.update(q->background.timer,
-                                             equeue_clampdiff(q->queue->target, tick));
-                    }
-                    q->background.active = true;
-                    equeue_mutex_unlock(&q->queuelock);
-                }
-                q->break_requested = false;
-                return;
-            }
+int equeue_take(equeue_t *q, void **events, int count, int ms)
+{
+    unsigned tick = equeue_tick();
+    unsigned timeout = tick + ms;
+    q->background.active = false;
+
+    while (1) {
+        // only collect new events once the previous batch is handed out,
+        // events left over stay in-flight with the old generation
+        if (!q->ready) {
+            q->ready = equeue_dequeue(q, tick);
         }
 
-        // find closest deadline
-        equeue_mutex_lock(&q->queuelock);
-        if (q->queue) {
-            int diff = equeue_clampdiff(q->queue->target, tick);
-            if ((unsigned)diff < (unsigned)deadline) {
-                deadline = diff;
-            }
+        int n = 0;
+        while (q->ready && n < count) {
+            struct equeue_event *e = q->ready;
+            q->ready = e->next;
+            events[n++] = e + 1;
         }
-        equeue_mutex_unlock(&q->queuelock);
 
-        // wait for events
-        equeue_sema_wait(&q->eventsema, deadline);
+        if (n > 0) {
+            return n;
+        }
 
-        // check if we were notified to break out of dispatch
-        if (q->break_requested) {
-            equeue_mutex_lock(&q->queuelock);
-            if (q->break_requested) {
-                q->break_requested = false;
-                equeue_mutex_unlock(&q->queuelock);
-                return;
-            }
-            equeue_mutex_unlock(&q->queuelock);
+        if (!equeue_wait(q, ms, timeout)) {
+            return 0;
         }
 
         // update tick for next iteration
@@ -491,6 +1021,12 @@ void equeue_dispatch(equeue_t *q, int ms)
     }
 }
 
+void equeue_run(equeue_t *q, void *p)
+{
+    struct equeue_event *e = (struct equeue_event *)p - 1;
+    equeue_run_event(q, e);
+}
+
 
 // event functions
 void equeue_event_delay(void *p, int ms)
@@ -592,7 +1128,27 @@ struct equeue_chain_context {
 
 static void equeue_chain_dispatch(void *p)
 {
-    equeue_dispatch((equeue_t *)p, 0);
+    equeue_t *q = (equeue_t *)p;
+
+    // the target may run this from several threads, only one dispatches
+    // and any others ask it to go around again
+    equeue_mutex_lock(&q->queuelock);
+    if (q->chain.busy) {
+        q->chain.pending = true;
+        equeue_mutex_unlock(&q->queuelock);
+        return;
+    }
+
+    q->chain.busy = true;
+    do {
+        q->chain.pending = false;
+        equeue_mutex_unlock(&q->queuelock);
+        equeue_dispatch(q, 0);
+        equeue_mutex_lock(&q->queuelock);
+    } while (q->chain.pending);
+
+    q->chain.busy = false;
+    equeue_mutex_unlock(&q->queuelock);
 }
 
 static void equeue_chain_update(void *p, int ms)
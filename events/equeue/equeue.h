@@ -47,6 +47,7 @@ struct equeue_event {
     struct equeue_event **ref;
 
     unsigned target;
+    unsigned seq;       // posting order of equal targets, only used by EQUEUE_HEAP
     int period;
     void (*dtor)(void *);
 
@@ -54,45 +55,96 @@ struct equeue_event {
     // data follows
 };
 
+// Number of size classes used by the event allocator, free chunks are
+// binned by the floor of their size's log2
+#define EQUEUE_BINS (8*sizeof(unsigned))
+
 // Event queue structure
 typedef struct equeue {
     struct equeue_event *queue;
+    struct equeue_event *ready;
     unsigned tick;
     bool break_requested;
     uint8_t generation;
+    unsigned flags;
+    unsigned seq;
 
     unsigned char *buffer;
     unsigned npw2;
     void *allocated;
 
-    struct equeue_event *chunks;
+    struct equeue_event *bins[EQUEUE_BINS];
+    unsigned binmap;
     struct equeue_slab {
         size_t size;
         unsigned char *data;
     } slab;
 
+    struct equeue_memstats {
+        size_t used;
+        size_t used_max;
+        size_t reserved;
+        unsigned allocs;
+        unsigned failures;
+    } memstats;
+
+    struct equeue_lockfree {
+        unsigned char *slots;
+        size_t size;
+        unsigned count;
+        volatile unsigned free;
+        volatile unsigned *ring;
+        unsigned mask;
+        volatile unsigned tail;
+        unsigned head;
+    } lockfree;
+
     struct equeue_background {
         bool active;
         void (*update)(void *timer, int ms);
         void *timer;
     } background;
 
+    struct equeue_chain {
+        bool busy;
+        bool pending;
+    } chain;
+
     equeue_sema_t eventsema;
     equeue_mutex_t queuelock;
     equeue_mutex_t memlock;
 } equeue_t;
 
 
+// Queue creation flags
+//
+// EQUEUE_HEAP - Schedule pending events in a pairing heap instead of a
+//               sorted list. Posting an event is constant time and
+//               cancelling or dispatching an event is amortized logarithmic
+//               in the number of pending events, where the sorted list is
+//               linear. Events with equal targets are still dispatched in
+//               the order they were posted, through a sequence number kept
+//               in every event, which makes EQUEUE_EVENT_SIZE 4 bytes larger
+//               whichever scheduler is used.
+#define EQUEUE_HEAP 0x1
+
 // Queue lifetime operations
 //
 // Creates and destroys an event queue. The event queue either allocates a
 // buffer of the specified size with malloc or uses a user provided buffer
 // if constructed with equeue_create_inplace.
 //
+// The equeue_create_flags and equeue_create_inplace_flags variants accept
+// a bitmask of the EQUEUE_* creation flags above. The plain variants use
+// the default sorted list scheduler.
+//
 // If the event queue creation fails, equeue_create returns a negative,
 // platform-specific error code.
 int equeue_create(equeue_t *queue, size_t size);
 int equeue_create_inplace(equeue_t *queue, size_t size, void *buffer);
+int equeue_create_flags(equeue_t *queue, size_t size, unsigned flags);
+int equeue_create_inplace_flags(equeue_t *queue, size_t size, void *buffer,
+                                unsigned flags);
 void equeue_destroy(equeue_t *queue);
 
 // Dispatch events
@@ -112,6 +164,27 @@ void equeue_dispatch(equeue_t *queue, int ms);
 // events may finish executing, but no new events will be executed.
 void equeue_break(equeue_t *queue);
 
+// Take and run events on external threads
+//
+// The equeue_take function waits up to the specified milliseconds for
+// events to become due and moves up to count of them out of the queue,
+// storing their handles in the events array. Events that are due but do not
+// fit in the array are kept in order for the next call. A negative timeout
+// waits indefinitely or until equeue_break is called on this queue. Returns
+// the number of events taken, or 0 on timeout or break.
+//
+// The equeue_run function executes a taken event and then either reschedules
+// it if it is periodic or frees it. Taken events are in-flight and can no
+// longer be cancelled, but every taken event must be passed to equeue_run
+// exactly once.
+//
+// Together these allow a pool of threads to share one event queue. Only one
+// thread may take events at a time and equeue_take must not be used on a
+// queue that is also being dispatched with equeue_dispatch. Taken events may
+// be run from any thread, and in any order.
+int equeue_take(equeue_t *queue, void **events, int count, int ms);
+void equeue_run(equeue_t *queue, void *event);
+
 // Simple event calls
 //
 // The specified callback will be executed in the context of the event queue's
@@ -141,9 +214,11 @@ int equeue_call_every(equeue_t *queue, int ms, void (*cb)(void *), void *data);
 // Both equeue_alloc and equeue_dealloc are irq safe.
 //
 // The equeue allocator is designed to minimize jitter in interrupt contexts as
-// well as avoid memory fragmentation on small devices. The allocator achieves
-// both constant-runtime and zero-fragmentation for fixed-size events, however
-// grows linearly as the quantity of different sized allocations increases.
+// well as avoid memory fragmentation on small devices. Freed chunks are kept
+// in power-of-two size-class bins, so both allocation and deallocation run in
+// constant time, and fixed-size events are reused without fragmentation. Only
+// when the buffer is exhausted does the allocator fall back to searching the
+// bin of the requested size for a chunk that fits.
 //
 // The equeue_alloc function returns a pointer to the event's allocated memory
 // and acts as a handle to the underlying event. If there is not enough memory
@@ -151,6 +226,63 @@ int equeue_call_every(equeue_t *queue, int ms, void (*cb)(void *), void *data);
 void *equeue_alloc(equeue_t *queue, size_t size);
 void equeue_dealloc(equeue_t *queue, void *event);
 
+// Allocator statistics
+//
+// The equeue_stats function fills in a snapshot of the event queue's memory
+// usage, which can be used to size the event queue's buffer from real data.
+// All sizes are in bytes and include the per-event overhead. Events
+// allocated from lock-free slots are not included in used or allocs.
+//
+// size        - Total size of the event queue's buffer
+// used        - Memory currently held by allocated events
+// used_max    - High-water mark of used
+// free        - Memory held by freed chunks available for reuse
+// free_chunks - Number of freed chunks available for reuse
+// free_max    - Size of the largest freed chunk
+// slab        - Memory never handed out, available for chunks of any size
+// reserved    - Memory reserved for lock-free posting with equeue_reserve
+// allocs      - Number of successful allocations
+// failures    - Number of allocations that failed due to lack of memory
+//
+// A large free compared to slab with failures indicates fragmentation from
+// differently-sized events. The equeue_stats function is irq safe, but runs
+// in time linear to the number of free chunks.
+typedef struct equeue_stats {
+    size_t size;
+    size_t used;
+    size_t used_max;
+    size_t free;
+    size_t free_chunks;
+    size_t free_max;
+    size_t slab;
+    size_t reserved;
+    unsigned allocs;
+    unsigned failures;
+} equeue_stats_t;
+
+void equeue_stats(equeue_t *queue, equeue_stats_t *stats);
+
+// Reserve event slots for lock-free posting
+//
+// The equeue_reserve function sets aside count fixed-size event slots, each
+// able to hold an event of up to size bytes, out of the event queue's
+// buffer. Once reserved, equeue_alloc hands out these slots without taking
+// any locks whenever the requested size fits, and equeue_post and
+// equeue_dealloc of these events are also lock-free. Posted slots are
+// pushed through an atomic ring which is drained into the timed queue
+// by the dispatch loop. When all slots are in use, equeue_alloc falls back
+// to the regular allocator.
+//
+// This avoids the equeue mutex, which is a critical section on mbed, in the
+// interrupt path at the cost of a fixed amount of memory. Slots are only
+// handed out while the queue is not backgrounded or chained, as updating
+// the background timer requires the lock.
+//
+// The equeue_reserve function should be called once, before any events are
+// posted, and is not irq safe. If there is not enough memory, equeue_reserve
+// returns a negative error code.
+int equeue_reserve(equeue_t *queue, unsigned count, size_t size);
+
 // Configure an allocated event
 //
 // equeue_event_delay  - Millisecond delay before dispatching an event
@@ -218,6 +350,10 @@ void equeue_background(equeue_t *queue,
 //
 // Passing a null queue as the target will unchain the existing queue.
 //
+// If the target queue is serviced by several threads at once, dispatches of
+// the chained queue are serialized so that its events still run one at a
+// time and in order.
+//
 // The equeue_chain function allows multiple equeues to be composed, sharing
 // the context of a dispatch loop while still being managed independently.
 void equeue_chain(equeue_t *queue, equeue_t *target);
@@ -119,6 +119,15 @@ void equeue_mutex_unlock(equeue_mutex_t *m)
 }
 
 
+// Atomic operations
+bool equeue_atomic_cas(volatile unsigned *ptr, unsigned *expected,
+                       unsigned desired)
+{
+    return core_util_atomic_cas_u32((volatile uint32_t *)ptr,
+                                    (uint32_t *)expected, desired);
+}
+
+
 // Semaphore operations
 #ifdef MBED_CONF_RTOS_PRESENT
 
@@ -97,6 +97,20 @@ void equeue_mutex_lock(equeue_mutex_t *mutex);
 void equeue_mutex_unlock(equeue_mutex_t *mutex);
 
 
+// Platform atomic operations
+//
+// The equeue_atomic_cas function atomically compares the value pointed to
+// by ptr with the value pointed to by expected and, if they are equal,
+// replaces it with desired and returns true. Otherwise the current value is
+// written back to expected and false is returned. The operation must be irq
+// safe, must not spuriously fail, and must act as a full memory barrier.
+//
+// Atomic operations are only used by the lock-free posting path, which
+// never takes the equeue mutexes.
+bool equeue_atomic_cas(volatile unsigned *ptr, unsigned *expected,
+                       unsigned desired);
+
+
 // Platform semaphore type
 //
 // The equeue library requires a binary semaphore type that can be safely
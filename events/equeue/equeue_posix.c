@@ -55,6 +55,15 @@ void equeue_mutex_unlock(equeue_mutex_t *m)
 }
 
 
+// Atomic operations
+bool equeue_atomic_cas(volatile unsigned *ptr, unsigned *expected,
+                       unsigned desired)
+{
+    return __atomic_compare_exchange_n(ptr, expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+
 // Semaphore operations
 int equeue_sema_create(equeue_sema_t *s)
 {
@@ -67,7 +67,7 @@ static const char *prof_units;
 })
 
 #define prof_measure(func, ...) ({                                          \
-    printf("%s: ...", #func);                                               \
+    printf("%s(%s): ...", #func, #__VA_ARGS__);                             \
     fflush(stdout);                                                         \
                                                                             \
     prof_units = "cycles";                                                  \
@@ -86,11 +86,11 @@ static const char *prof_units;
         }                                                                   \
     }                                                                       \
     res -= prof_baseline_cycle;                                             \
-    printf("\r%s: %"PRIu64" %s", #func, res, prof_units);                   \
+    printf("\r%s(%s): %"PRIu64" %s", #func, #__VA_ARGS__, res, prof_units); \
                                                                             \
     if (!isatty(0)) {                                                       \
         prof_cycle_t prev;                                                  \
-        while (scanf("%*[^0-9]%"PRIu64, &prev) == 0);                       \
+        while (scanf("%*[^:]:%"PRIu64, &prev) == 0);                       \
         int64_t perc = 100*((int64_t)prev - (int64_t)res) / (int64_t)prev;  \
                                                                             \
         if (perc > 10) {                                                    \
@@ -180,6 +180,32 @@ void equeue_alloc_many_prof(int count)
     equeue_destroy(&q);
 }
 
+void equeue_alloc_sizes_prof(int count)
+{
+    struct equeue q;
+    equeue_create(&q, count * (EQUEUE_EVENT_SIZE + count * sizeof(int)));
+
+    void *es[count];
+
+    for (int i = 0; i < count; i++) {
+        es[i] = equeue_alloc(&q, i * sizeof(int));
+    }
+
+    for (int i = 0; i < count; i++) {
+        equeue_dealloc(&q, es[i]);
+    }
+
+    prof_loop() {
+        prof_start();
+        void *e = equeue_alloc(&q, (count - 1) * sizeof(int));
+        prof_stop();
+
+        equeue_dealloc(&q, e);
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_post_prof(void)
 {
     struct equeue q;
@@ -332,6 +358,70 @@ void equeue_cancel_many_prof(int count)
     equeue_destroy(&q);
 }
 
+// Pending events with spread out targets, as created by many periodic timers
+static void equeue_spread(equeue_t *q, int count)
+{
+    for (int i = 0; i < count; i++) {
+        equeue_call_in(q, 1000 + (i * 7919) % 10000, no_func, 0);
+    }
+}
+
+void equeue_post_spread_prof(int count, unsigned flags)
+{
+    struct equeue q;
+    equeue_create_flags(&q, (count + 1) * EQUEUE_EVENT_SIZE, flags);
+    equeue_spread(&q, count);
+
+    unsigned i = 0;
+    prof_loop() {
+        void *e = equeue_alloc(&q, 0);
+        equeue_event_delay(e, 1000 + (i++ * 7919) % 10000);
+
+        prof_start();
+        int id = equeue_post(&q, no_func, e);
+        prof_stop();
+
+        equeue_cancel(&q, id);
+    }
+
+    equeue_destroy(&q);
+}
+
+void equeue_cancel_spread_prof(int count, unsigned flags)
+{
+    struct equeue q;
+    equeue_create_flags(&q, (count + 1) * EQUEUE_EVENT_SIZE, flags);
+    equeue_spread(&q, count);
+
+    unsigned i = 0;
+    prof_loop() {
+        int id = equeue_call_in(&q, 1000 + (i++ * 7919) % 10000, no_func, 0);
+
+        prof_start();
+        equeue_cancel(&q, id);
+        prof_stop();
+    }
+
+    equeue_destroy(&q);
+}
+
+void equeue_dispatch_spread_prof(int count, unsigned flags)
+{
+    struct equeue q;
+    equeue_create_flags(&q, (count + 1) * EQUEUE_EVENT_SIZE, flags);
+    equeue_spread(&q, count);
+
+    prof_loop() {
+        equeue_call(&q, no_func, 0);
+
+        prof_start();
+        equeue_dispatch(&q, 0);
+        prof_stop();
+    }
+
+    equeue_destroy(&q);
+}
+
 void equeue_alloc_size_prof(void)
 {
     size_t size = 32 * EQUEUE_EVENT_SIZE;
@@ -411,11 +501,31 @@ int main()
     prof_measure(equeue_cancel_prof);
 
     prof_measure(equeue_alloc_many_prof, 1000);
+    prof_measure(equeue_alloc_sizes_prof, 100);
     prof_measure(equeue_post_many_prof, 1000);
     prof_measure(equeue_post_future_many_prof, 1000);
     prof_measure(equeue_dispatch_many_prof, 100);
     prof_measure(equeue_cancel_many_prof, 100);
 
+    prof_measure(equeue_post_spread_prof, 10, 0);
+    prof_measure(equeue_post_spread_prof, 10, EQUEUE_HEAP);
+    prof_measure(equeue_post_spread_prof, 100, 0);
+    prof_measure(equeue_post_spread_prof, 100, EQUEUE_HEAP);
+    prof_measure(equeue_post_spread_prof, 1000, 0);
+    prof_measure(equeue_post_spread_prof, 1000, EQUEUE_HEAP);
+    prof_measure(equeue_cancel_spread_prof, 10, 0);
+    prof_measure(equeue_cancel_spread_prof, 10, EQUEUE_HEAP);
+    prof_measure(equeue_cancel_spread_prof, 100, 0);
+    prof_measure(equeue_cancel_spread_prof, 100, EQUEUE_HEAP);
+    prof_measure(equeue_cancel_spread_prof, 1000, 0);
+    prof_measure(equeue_cancel_spread_prof, 1000, EQUEUE_HEAP);
+    prof_measure(equeue_dispatch_spread_prof, 10, 0);
+    prof_measure(equeue_dispatch_spread_prof, 10, EQUEUE_HEAP);
+    prof_measure(equeue_dispatch_spread_prof, 100, 0);
+    prof_measure(equeue_dispatch_spread_prof, 100, EQUEUE_HEAP);
+    prof_measure(equeue_dispatch_spread_prof, 1000, 0);
+    prof_measure(equeue_dispatch_spread_prof, 1000, EQUEUE_HEAP);
+
     prof_measure(equeue_alloc_size_prof);
     prof_measure(equeue_alloc_many_size_prof, 1000);
     prof_measure(equeue_alloc_fragmented_size_prof, 1000);
@@ -28,6 +28,7 @@
 static jmp_buf test_buf;
 static int test_line;
 static int test_failure;
+static unsigned test_flags;
 
 #define test_assert(test) ({                                                \
     if (!(test)) {                                                          \
@@ -145,7 +146,7 @@ void nest_func(void *p)
 void simple_call_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -159,7 +160,7 @@ void simple_call_test(void)
 void simple_call_in_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -175,7 +176,7 @@ void simple_call_in_test(void)
 void simple_call_every_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -191,7 +192,7 @@ void simple_call_every_test(void)
 void simple_post_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int touched = false;
@@ -212,7 +213,7 @@ void simple_post_test(void)
 void destructor_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int touched;
@@ -269,7 +270,7 @@ void destructor_test(void)
 void allocation_failure_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     void *p = equeue_alloc(&q, 4096);
@@ -286,7 +287,7 @@ void allocation_failure_test(void)
 void cancel_test(int N)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -311,7 +312,7 @@ void cancel_test(int N)
 void cancel_inflight_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -347,7 +348,7 @@ void cancel_inflight_test(void)
 void cancel_unnecessarily_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int id = equeue_call(&q, pass_func, 0);
@@ -376,7 +377,7 @@ void cancel_unnecessarily_test(void)
 void loop_protect_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -397,7 +398,7 @@ void loop_protect_test(void)
 void break_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     bool touched = false;
@@ -413,7 +414,7 @@ void break_test(void)
 void break_no_windup_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int count = 0;
@@ -434,7 +435,7 @@ void break_no_windup_test(void)
 void period_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int count = 0;
@@ -449,7 +450,7 @@ void period_test(void)
 void nested_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int touched = 0;
@@ -487,7 +488,7 @@ void nested_test(void)
 void sloth_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int touched = 0;
@@ -516,7 +517,7 @@ void *multithread_thread(void *p)
 void multithread_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int touched = 0;
@@ -544,7 +545,7 @@ void background_func(void *p, int ms)
 void background_test(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     int id = equeue_call_in(&q, 20, pass_func, 0);
@@ -572,11 +573,11 @@ void background_test(void)
 void chain_test(void)
 {
     equeue_t q1;
-    int err = equeue_create(&q1, 2048);
+    int err = equeue_create_flags(&q1, 2048, test_flags);
     test_assert(!err);
 
     equeue_t q2;
-    err = equeue_create(&q2, 2048);
+    err = equeue_create_flags(&q2, 2048, test_flags);
     test_assert(!err);
 
     equeue_chain(&q2, &q1);
@@ -613,11 +614,11 @@ void chain_test(void)
 void unchain_test(void)
 {
     equeue_t q1;
-    int err = equeue_create(&q1, 2048);
+    int err = equeue_create_flags(&q1, 2048, test_flags);
     test_assert(!err);
 
     equeue_t q2;
-    err = equeue_create(&q2, 2048);
+    err = equeue_create_flags(&q2, 2048, test_flags);
     test_assert(!err);
 
     equeue_chain(&q2, &q1);
@@ -648,7 +649,8 @@ void unchain_test(void)
 void simple_barrage_test(int N)
 {
     equeue_t q;
-    int err = equeue_create(&q, N * (EQUEUE_EVENT_SIZE + sizeof(struct timing)));
+    int err = equeue_create_flags(&q,
+                                  N * (EQUEUE_EVENT_SIZE + sizeof(struct timing)), test_flags);
     test_assert(!err);
 
     for (int i = 0; i < N; i++) {
@@ -672,8 +674,9 @@ void simple_barrage_test(int N)
 void fragmenting_barrage_test(int N)
 {
     equeue_t q;
-    int err = equeue_create(&q,
-                            2 * N * (EQUEUE_EVENT_SIZE + sizeof(struct fragment) + N * sizeof(int)));
+    int err = equeue_create_flags(&q,
+                                  2 * N * (EQUEUE_EVENT_SIZE + sizeof(struct fragment) + N * sizeof(int)),
+                                  test_flags);
     test_assert(!err);
 
     for (int i = 0; i < N; i++) {
@@ -712,7 +715,8 @@ static void *ethread_dispatch(void *p)
 void multithreaded_barrage_test(int N)
 {
     equeue_t q;
-    int err = equeue_create(&q, N * (EQUEUE_EVENT_SIZE + sizeof(struct timing)));
+    int err = equeue_create_flags(&q,
+                                  N * (EQUEUE_EVENT_SIZE + sizeof(struct timing)), test_flags);
     test_assert(!err);
 
     struct ethread t;
@@ -756,7 +760,7 @@ void simple_breaker(void *p)
 void break_request_cleared_on_timeout(void)
 {
     equeue_t q;
-    int err = equeue_create(&q, 2048);
+    int err = equeue_create_flags(&q, 2048, test_flags);
     test_assert(!err);
 
     struct count_and_queue pq;
@@ -802,10 +806,605 @@ void sibling_test(void)
     equeue_destroy(&q);
 }
 
-int main()
+struct order {
+    int *log;
+    int *count;
+    int index;
+};
+
+void order_func(void *p)
 {
-    printf("beginning tests...\n");
+    struct order *o = (struct order *)p;
+    o->log[(*o->count)++] = o->index;
+}
+
+void order_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, N * (EQUEUE_EVENT_SIZE + sizeof(struct order)),
+                                  test_flags);
+    test_assert(!err);
+
+    int log[N];
+    int count = 0;
+
+    // interleave a handful of distinct targets, each posted several times
+    for (int i = 0; i < N; i++) {
+        struct order *o = equeue_alloc(&q, sizeof(struct order));
+        test_assert(o);
+
+        o->log = log;
+        o->count = &count;
+        o->index = i;
+        equeue_event_delay(o, 10 * ((i * 7) % 5));
+
+        int id = equeue_post(&q, order_func, o);
+        test_assert(id);
+    }
+
+    equeue_dispatch(&q, 100);
+    test_assert(count == N);
+
+    // events must run ordered by delay, and by posting order within a delay
+    for (int i = 1; i < N; i++) {
+        int prev = 10 * ((log[i - 1] * 7) % 5);
+        int next = 10 * ((log[i] * 7) % 5);
+        test_assert(prev < next || (prev == next && log[i - 1] < log[i]));
+    }
+
+    equeue_destroy(&q);
+}
+
+void cancel_order_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, N * (EQUEUE_EVENT_SIZE + sizeof(struct order)),
+                                  test_flags);
+    test_assert(!err);
+
+    int log[N];
+    int count = 0;
+    int ids[N];
+
+    for (int i = 0; i < N; i++) {
+        struct order *o = equeue_alloc(&q, sizeof(struct order));
+        test_assert(o);
+
+        o->log = log;
+        o->count = &count;
+        o->index = i;
+        equeue_event_delay(o, 10 * ((N - i) % 7));
+
+        ids[i] = equeue_post(&q, order_func, o);
+        test_assert(ids[i]);
+    }
+
+    // cancel every third event, scattered across the pending set
+    for (int i = 0; i < N; i += 3) {
+        equeue_cancel(&q, ids[i]);
+    }
+
+    equeue_dispatch(&q, 100);
+    test_assert(count == N - (N + 2) / 3);
+
+    for (int i = 0; i < count; i++) {
+        test_assert(log[i] % 3 != 0);
+    }
+
+    for (int i = 1; i < count; i++) {
+        int prev = (N - log[i - 1]) % 7;
+        int next = (N - log[i]) % 7;
+        test_assert(prev < next || (prev == next && log[i - 1] < log[i]));
+    }
+
+    equeue_destroy(&q);
+}
+
+void pending_destructor_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, N * (EQUEUE_EVENT_SIZE + sizeof(int)),
+                                  test_flags);
+    test_assert(!err);
+
+    int touched = 0;
+    for (int i = 0; i < N; i++) {
+        struct indirect *e = equeue_alloc(&q, sizeof(struct indirect));
+        test_assert(e);
+
+        e->touched = &touched;
+        equeue_event_delay(e, 1000 + (i * 13) % 17);
+        equeue_event_dtor(e, indirect_func);
+
+        int id = equeue_post(&q, pass_func, e);
+        test_assert(id);
+    }
+
+    equeue_destroy(&q);
+    test_assert(touched == N);
+}
+
+void stats_test(void)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 2048, test_flags);
+    test_assert(!err);
+
+    equeue_stats_t stats;
+    equeue_stats(&q, &stats);
+    test_assert(stats.size == 2048);
+    test_assert(stats.used == 0 && stats.used_max == 0);
+    test_assert(stats.free == 0 && stats.free_chunks == 0);
+    test_assert(stats.slab == 2048);
+
+    void *es[8];
+    for (int i = 0; i < 8; i++) {
+        es[i] = equeue_alloc(&q, i * sizeof(int));
+        test_assert(es[i]);
+    }
+
+    equeue_stats(&q, &stats);
+    test_assert(stats.allocs == 8);
+    test_assert(stats.used == stats.used_max);
+    test_assert(stats.used + stats.slab == 2048);
+    size_t used = stats.used;
+
+    for (int i = 0; i < 8; i++) {
+        equeue_dealloc(&q, es[i]);
+    }
+
+    equeue_stats(&q, &stats);
+    test_assert(stats.used == 0 && stats.used_max == used);
+    test_assert(stats.free == used && stats.free_chunks == 8);
+    test_assert(stats.free_max >= EQUEUE_EVENT_SIZE);
+
+    test_assert(!equeue_alloc(&q, 4096));
+    equeue_stats(&q, &stats);
+    test_assert(stats.failures == 1);
+
+    equeue_destroy(&q);
+}
+
+void size_class_reuse_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, N * (EQUEUE_EVENT_SIZE + N * sizeof(int)),
+                                  test_flags);
+    test_assert(!err);
+
+    void *es[N];
+    for (int i = 0; i < N; i++) {
+        es[i] = equeue_alloc(&q, i * sizeof(int));
+        test_assert(es[i]);
+    }
+
+    equeue_stats_t stats;
+    equeue_stats(&q, &stats);
+    size_t slab = stats.slab;
+
+    // freed chunks of every size must be found again, in any order
+    for (int i = 0; i < N; i++) {
+        equeue_dealloc(&q, es[i]);
+    }
+
+    for (int i = N - 1; i >= 0; i--) {
+        es[i] = equeue_alloc(&q, i * sizeof(int));
+        test_assert(es[i]);
+    }
+
+    equeue_stats(&q, &stats);
+    test_assert(stats.slab == slab);
+    test_assert(stats.free_chunks == 0);
+
+    for (int i = 0; i < N; i++) {
+        equeue_dealloc(&q, es[i]);
+    }
+
+    equeue_destroy(&q);
+}
+
+void lockfree_test(void)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 2048, test_flags);
+    test_assert(!err);
+
+    err = equeue_reserve(&q, 4, 2 * sizeof(void *));
+    test_assert(!err);
+    err = equeue_reserve(&q, 4, 2 * sizeof(void *));
+    test_assert(err < 0);
+
+    equeue_stats_t stats;
+    equeue_stats(&q, &stats);
+    test_assert(stats.reserved >= 4 * EQUEUE_EVENT_SIZE);
+    test_assert(stats.slab + stats.reserved == 2048);
+
+    // slots are handed out without touching the regular allocator
+    int touched = 0;
+    int ids[4];
+    for (int i = 0; i < 4; i++) {
+        ids[i] = equeue_call(&q, simple_func, &touched);
+        test_assert(ids[i]);
+    }
+
+    equeue_stats(&q, &stats);
+    test_assert(stats.allocs == 0 && stats.used == 0);
+
+    // once exhausted, the regular allocator takes over
+    int id = equeue_call(&q, simple_func, &touched);
+    test_assert(id);
+    equeue_stats(&q, &stats);
+    test_assert(stats.allocs == 1);
+
+    equeue_cancel(&q, ids[1]);
+    test_assert(equeue_timeleft(&q, ids[2]) == 0);
+
+    equeue_dispatch(&q, 0);
+    test_assert(touched == 4);
+
+    // and the slots are reused after dispatch
+    for (int i = 0; i < 4; i++) {
+        ids[i] = equeue_call_in(&q, 10, simple_func, &touched);
+        test_assert(ids[i]);
+    }
+
+    equeue_stats(&q, &stats);
+    test_assert(stats.allocs == 1 && stats.used == 0);
+
+    equeue_cancel(&q, ids[0]);
+    equeue_dispatch(&q, 20);
+    test_assert(touched == 7);
+
+    equeue_destroy(&q);
+}
+
+void lockfree_order_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, N * (EQUEUE_EVENT_SIZE + 2 * sizeof(struct order)),
+                                  test_flags);
+    test_assert(!err);
+
+    err = equeue_reserve(&q, N / 2, sizeof(struct order));
+    test_assert(!err);
+
+    int log[N];
+    int count = 0;
+
+    // mix lock-free slots with larger events from the regular allocator
+    for (int i = 0; i < N; i++) {
+        struct order *o = equeue_alloc(&q,
+                                       (i % 3) ? sizeof(struct order) : 2 * sizeof(struct order));
+        test_assert(o);
+
+        o->log = log;
+        o->count = &count;
+        o->index = i;
+
+        int id = equeue_post(&q, order_func, o);
+        test_assert(id);
+    }
+
+    equeue_dispatch(&q, 0);
+    test_assert(count == N);
+
+    for (int i = 1; i < N; i++) {
+        test_assert(log[i - 1] < log[i]);
+    }
+
+    equeue_destroy(&q);
+}
+
+struct lockfree_producer {
+    pthread_t thread;
+    equeue_t *q;
+    int n;
+    int next;
+    int posted;
+    int misordered;
+};
+
+struct lockfree_post {
+    struct lockfree_producer *producer;
+    int index;
+};
+
+void lockfree_post_func(void *p)
+{
+    struct lockfree_post *post = (struct lockfree_post *)p;
+    if (post->index != post->producer->next) {
+        post->producer->misordered += 1;
+    }
+
+    post->producer->next = post->index + 1;
+}
+
+static void *lockfree_producer_thread(void *p)
+{
+    struct lockfree_producer *producer = (struct lockfree_producer *)p;
+
+    for (int i = 0; i < producer->n; i++) {
+        struct lockfree_post *post;
+        while (!(post = equeue_alloc(producer->q, sizeof(struct lockfree_post)))) {
+            usleep(100);
+        }
+
+        post->producer = producer;
+        post->index = i;
+        if (equeue_post(producer->q, lockfree_post_func, post)) {
+            producer->posted += 1;
+        }
+    }
+
+    return 0;
+}
+
+void lockfree_stress_test(int P, int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 64 * (EQUEUE_EVENT_SIZE + sizeof(struct lockfree_post)),
+                                  test_flags);
+    test_assert(!err);
+
+    err = equeue_reserve(&q, 16, sizeof(struct lockfree_post));
+    test_assert(!err);
+
+    struct ethread t;
+    t.q = &q;
+    t.ms = -1;
+    err = pthread_create(&t.thread, 0, ethread_dispatch, &t);
+    test_assert(!err);
+
+    struct lockfree_producer producers[P];
+    for (int i = 0; i < P; i++) {
+        producers[i].q = &q;
+        producers[i].n = N;
+        producers[i].next = 0;
+        producers[i].posted = 0;
+        producers[i].misordered = 0;
+        err = pthread_create(&producers[i].thread, 0,
+                             lockfree_producer_thread, &producers[i]);
+        test_assert(!err);
+    }
+
+    for (int i = 0; i < P; i++) {
+        err = pthread_join(producers[i].thread, 0);
+        test_assert(!err);
+    }
+
+    // wait for the dispatch thread to catch up
+    for (int i = 0; i < 1000; i++) {
+        bool done = true;
+        for (int j = 0; j < P; j++) {
+            done = done && producers[j].next == N;
+        }
+
+        if (done) {
+            break;
+        }
 
+        usleep(1000);
+    }
+
+    equeue_break(&q);
+    err = pthread_join(t.thread, 0);
+    test_assert(!err);
+
+    for (int i = 0; i < P; i++) {
+        test_assert(producers[i].posted == N);
+        test_assert(producers[i].next == N);
+        test_assert(producers[i].misordered == 0);
+    }
+
+    equeue_stats_t stats;
+    equeue_stats(&q, &stats);
+    test_assert(stats.used == 0);
+
+    equeue_destroy(&q);
+}
+
+void take_run_test(void)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 2048, test_flags);
+    test_assert(!err);
+
+    int touched = 0;
+    int periodic = 0;
+    for (int i = 0; i < 3; i++) {
+        int id = equeue_call(&q, simple_func, &touched);
+        test_assert(id);
+    }
+
+    int id = equeue_call_every(&q, 10, simple_func, &periodic);
+    test_assert(id);
+
+    int cancelled = equeue_call_in(&q, 5, simple_func, &touched);
+    test_assert(cancelled);
+
+    // events that do not fit are kept for the next take
+    void *events[2];
+    int n = equeue_take(&q, events, 2, 0);
+    test_assert(n == 2);
+    equeue_run(&q, events[0]);
+    equeue_run(&q, events[1]);
+    test_assert(touched == 2);
+
+    n = equeue_take(&q, events, 2, 0);
+    test_assert(n == 1);
+    equeue_run(&q, events[0]);
+    test_assert(touched == 3);
+
+    // cancel the pending event before it becomes due
+    equeue_cancel(&q, cancelled);
+
+    // periodic events are rescheduled after running
+    n = equeue_take(&q, events, 2, 20);
+    test_assert(n == 1);
+    equeue_run(&q, events[0]);
+    test_assert(periodic == 1);
+
+    n = equeue_take(&q, events, 2, 20);
+    test_assert(n == 1);
+    equeue_run(&q, events[0]);
+    test_assert(periodic == 2);
+    test_assert(touched == 3);
+
+    // timeout and break both return no events
+    equeue_cancel(&q, id);
+    n = equeue_take(&q, events, 2, 20);
+    test_assert(n == 0);
+
+    equeue_break(&q);
+    n = equeue_take(&q, events, 2, -1);
+    test_assert(n == 0);
+
+    equeue_stats_t stats;
+    equeue_stats(&q, &stats);
+    test_assert(stats.used == 0);
+
+    equeue_destroy(&q);
+}
+
+void take_destructor_test(void)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 2048, test_flags);
+    test_assert(!err);
+
+    int touched = 0;
+    for (int i = 0; i < 3; i++) {
+        struct indirect *e = equeue_alloc(&q, sizeof(struct indirect));
+        test_assert(e);
+
+        e->touched = &touched;
+        equeue_event_dtor(e, indirect_func);
+        int id = equeue_post(&q, pass_func, e);
+        test_assert(id);
+    }
+
+    // destroying the queue still destroys events that were not taken out
+    void *events[1];
+    int n = equeue_take(&q, events, 1, 0);
+    test_assert(n == 1);
+    equeue_run(&q, events[0]);
+    test_assert(touched == 1);
+
+    equeue_destroy(&q);
+    test_assert(touched == 3);
+}
+
+struct pool {
+    equeue_t *q;
+    pthread_mutex_t lock;
+    volatile bool stop;
+};
+
+struct serial {
+    int active;
+    int overlapped;
+    int next;
+    int misordered;
+};
+
+struct serial_post {
+    struct serial *serial;
+    int index;
+};
+
+void serial_func(void *p)
+{
+    struct serial_post *post = (struct serial_post *)p;
+    struct serial *serial = post->serial;
+    if (__atomic_add_fetch(&serial->active, 1, __ATOMIC_SEQ_CST) != 1) {
+        __atomic_store_n(&serial->overlapped, 1, __ATOMIC_SEQ_CST);
+    }
+
+    if (post->index != serial->next) {
+        serial->misordered += 1;
+    }
+
+    serial->next = post->index + 1;
+    usleep(100);
+    __atomic_sub_fetch(&serial->active, 1, __ATOMIC_SEQ_CST);
+}
+
+static void *pool_thread(void *p)
+{
+    struct pool *pool = (struct pool *)p;
+    while (!pool->stop) {
+        void *event;
+        pthread_mutex_lock(&pool->lock);
+        int n = equeue_take(pool->q, &event, 1, 1);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (n) {
+            equeue_run(pool->q, event);
+        }
+    }
+
+    return 0;
+}
+
+void chain_pool_test(int N)
+{
+    equeue_t q;
+    int err = equeue_create_flags(&q, 2048, test_flags);
+    test_assert(!err);
+
+    equeue_t chained;
+    err = equeue_create_flags(&chained, N * (EQUEUE_EVENT_SIZE + sizeof(struct serial_post)),
+                              test_flags);
+    test_assert(!err);
+    equeue_chain(&chained, &q);
+
+    struct pool pool;
+    pool.q = &q;
+    pool.stop = false;
+    pthread_mutex_init(&pool.lock, 0);
+
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        err = pthread_create(&threads[i], 0, pool_thread, &pool);
+        test_assert(!err);
+    }
+
+    // every post updates the chain's timer, which posts a new dispatch of
+    // the chained queue that may land on any thread
+    struct serial serial = {0, 0, 0, 0};
+    for (int i = 0; i < N; i++) {
+        struct serial_post *post = equeue_alloc(&chained, sizeof(struct serial_post));
+        test_assert(post);
+
+        post->serial = &serial;
+        post->index = i;
+        int id = equeue_post(&chained, serial_func, post);
+        test_assert(id);
+        usleep(50);
+    }
+
+    for (int i = 0; i < 1000 && __atomic_load_n(&serial.next, __ATOMIC_SEQ_CST) != N; i++) {
+        usleep(1000);
+    }
+
+    pool.stop = true;
+    for (int i = 0; i < 4; i++) {
+        err = pthread_join(threads[i], 0);
+        test_assert(!err);
+    }
+
+    test_assert(serial.next == N);
+    test_assert(!serial.overlapped);
+    test_assert(!serial.misordered);
+
+    pthread_mutex_destroy(&pool.lock);
+    equeue_chain(&chained, 0);
+    equeue_destroy(&chained);
+    equeue_destroy(&q);
+}
+
+void run_tests(void)
+{
     test_run(simple_call_test);
     test_run(simple_call_in_test);
     test_run(simple_call_every_test);
@@ -829,7 +1428,31 @@ int main()
     test_run(fragmenting_barrage_test, 20);
     test_run(multithreaded_barrage_test, 20);
     test_run(break_request_cleared_on_timeout);
+    test_run(order_test, 100);
+    test_run(cancel_order_test, 100);
+    test_run(pending_destructor_test, 100);
+    test_run(stats_test);
+    test_run(size_class_reuse_test, 20);
+    test_run(lockfree_test);
+    test_run(lockfree_order_test, 20);
+    test_run(lockfree_stress_test, 4, 10000);
+    test_run(take_run_test);
+    test_run(take_destructor_test);
+    test_run(chain_pool_test, 200);
+}
+
+int main()
+{
+    printf("beginning tests...\n");
+
+    run_tests();
     test_run(sibling_test);
+
+    printf("beginning heap tests...\n");
+
+    test_flags = EQUEUE_HEAP;
+    run_tests();
+
     printf("done!\n");
     return test_failure;
 }
@@ -28,6 +28,7 @@
 
 #include "events/EventQueue.h"
 #include "events/Event.h"
+#include "events/ThreadPoolEventQueue.h"
 
 #include "events/mbed_shared_queues.h"
 
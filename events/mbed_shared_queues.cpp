@@ -15,6 +15,7 @@
  */
 
 #include "events/mbed_shared_queues.h"
+#include "platform/mbed_assert.h"
 
 #ifdef MBED_CONF_RTOS_PRESENT
 #include "rtos/Thread.h"
@@ -36,6 +37,11 @@ EventQueue *do_shared_event_queue_with_thread(const char *name)
 {
     static uint64_t queue_buffer[QueueSize / sizeof(uint64_t)];
     static EventQueue queue(sizeof queue_buffer, (unsigned char *) queue_buffer);
+#if MBED_CONF_EVENTS_SHARED_LOCKFREE_SLOTS
+    static int reserved = queue.reserve(MBED_CONF_EVENTS_SHARED_LOCKFREE_SLOTS);
+    MBED_ASSERT(reserved == 0);
+    (void)reserved;
+#endif
 
     static uint64_t stack[StackSize / sizeof(uint64_t)];
     static Thread thread(Priority, StackSize, (unsigned char *) stack, name);
@@ -59,6 +65,11 @@ EventQueue *mbed_event_queue()
     /* Only create the EventQueue, but no dispatching thread */
     static unsigned char queue_buffer[MBED_CONF_EVENTS_SHARED_EVENTSIZE];
     static EventQueue queue(sizeof queue_buffer, queue_buffer);
+#if MBED_CONF_EVENTS_SHARED_LOCKFREE_SLOTS
+    static int reserved = queue.reserve(MBED_CONF_EVENTS_SHARED_LOCKFREE_SLOTS);
+    MBED_ASSERT(reserved == 0);
+    (void)reserved;
+#endif
 
     return &queue;
 #else
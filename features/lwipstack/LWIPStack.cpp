@@ -485,6 +485,235 @@ nsapi_size_or_error_t LWIP::socket_recvfrom(nsapi_socket_t handle, SocketAddress
     return recv;
 }
 
+NetStackMemoryManager *LWIP::get_memory_manager()
+{
+    return &memory_manager;
+}
+
+nsapi_size_or_error_t LWIP::socket_recv_buf(nsapi_socket_t handle, net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+
+    *buf = NULL;
+    if (!s->buf) {
+        err_t err = netconn_recv(s->conn, &s->buf);
+        s->offset = 0;
+
+        if (err != ERR_OK) {
+            return err_remap(err);
+        }
+    }
+
+    struct pbuf *p;
+    u16_t recv = netbuf_len(s->buf) - s->offset;
+    if (s->offset == 0 && recv <= size) {
+        // Hand the received chain over, the netbuf no longer owns it
+        p = s->buf->p;
+        s->buf->p = s->buf->ptr = NULL;
+    } else {
+        // Part of the chain was read already or does not fit, copy the data
+        if (recv > size) {
+            recv = (u16_t)size;
+        }
+        p = pbuf_alloc(PBUF_RAW, recv, PBUF_RAM);
+        if (!p) {
+            return NSAPI_ERROR_NO_MEMORY;
+        }
+        netbuf_copy_partial(s->buf, p->payload, recv, s->offset);
+        s->offset += recv;
+    }
+
+    if (!s->buf->p || s->offset >= netbuf_len(s->buf)) {
+        netbuf_delete(s->buf);
+        s->buf = 0;
+    }
+
+    *buf = p;
+    return recv;
+}
+
+nsapi_size_or_error_t LWIP::socket_sendto_buf(nsapi_socket_t handle, const SocketAddress &address, net_stack_mem_buf_t *buf)
+{
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+    ip_addr_t ip_addr;
+
+    nsapi_addr_t addr = address.get_addr();
+    if (!convert_mbed_addr_to_lwip(&ip_addr, &addr)) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    // Headers go in a separate pbuf in front of the chain, which is left unmodified
+    struct pbuf *p = static_cast<struct pbuf *>(buf);
+    struct pbuf *header = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_RAM);
+    if (!header) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    pbuf_chain(header, p);
+
+    struct netbuf *nbuf = netbuf_new();
+    if (!nbuf) {
+        pbuf_free(header);
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    nbuf->p = nbuf->ptr = header;
+
+    err_t err = netconn_sendto(s->conn, nbuf, &ip_addr, address.get_port());
+    netbuf_delete(nbuf);
+    if (err != ERR_OK) {
+        return err_remap(err);
+    }
+
+    return p->tot_len;
+}
+
+nsapi_size_or_error_t LWIP::socket_recvfrom_buf(nsapi_socket_t handle, SocketAddress *address, net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+    struct netbuf *nbuf;
+
+    *buf = NULL;
+    err_t err = netconn_recv(s->conn, &nbuf);
+    if (err != ERR_OK) {
+        return err_remap(err);
+    }
+
+    if (address) {
+        nsapi_addr_t addr;
+        convert_lwip_addr_to_mbed(&addr, netbuf_fromaddr(nbuf));
+        address->set_addr(addr);
+        address->set_port(netbuf_fromport(nbuf));
+    }
+
+    // Hand the received chain over, the netbuf no longer owns it
+    struct pbuf *p = nbuf->p;
+    nbuf->p = nbuf->ptr = NULL;
+    netbuf_delete(nbuf);
+
+    if (p->tot_len > size) {
+        pbuf_realloc(p, (u16_t)size);
+    }
+    if (!p->tot_len) {
+        pbuf_free(p);
+        return 0;
+    }
+
+    *buf = p;
+    return p->tot_len;
+}
+
+// Chain of pbufs referencing the buffers of an iov list, behind an empty pbuf
+// with room for the headers
+static nsapi_error_t iov_to_pbuf(const nsapi_iovec_t *iov, unsigned count, struct pbuf **chain)
+{
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_RAM);
+    if (!p) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        if (!iov[i].iov_len) {
+            continue;
+        }
+        if (p->tot_len + iov[i].iov_len > 0xFFFF) {
+            pbuf_free(p);
+            return NSAPI_ERROR_PARAMETER;
+        }
+
+        struct pbuf *q = pbuf_alloc(PBUF_RAW, (u16_t)iov[i].iov_len, PBUF_REF);
+        if (!q) {
+            pbuf_free(p);
+            return NSAPI_ERROR_NO_MEMORY;
+        }
+        q->payload = iov[i].iov_base;
+        pbuf_cat(p, q);
+    }
+
+    *chain = p;
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t LWIP::socket_sendto_batch(nsapi_socket_t handle, nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+#if LWIP_TCPIP_CORE_LOCKING
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t sent;
+
+    // Datagrams go to the UDP layer as netconn_sendto() does, but the core
+    // is locked once for the batch. The data is referenced, lwIP copies it
+    // if the packet has to be queued.
+    LOCK_TCPIP_CORE();
+    for (sent = 0; sent < count; sent++) {
+        nsapi_datagram_t *datagram = &datagrams[sent];
+        ip_addr_t ip_addr;
+
+        nsapi_addr_t addr = datagram->address.get_addr();
+        if (!convert_mbed_addr_to_lwip(&ip_addr, &addr)) {
+            ret = NSAPI_ERROR_PARAMETER;
+            break;
+        }
+        if (!s->conn->pcb.udp) {
+            ret = err_remap(ERR_CONN);
+            break;
+        }
+
+        struct pbuf *p;
+        ret = iov_to_pbuf(datagram->iov, datagram->iov_count, &p);
+        if (ret < 0) {
+            break;
+        }
+
+        err_t err = udp_sendto(s->conn->pcb.udp, p, &ip_addr, datagram->address.get_port());
+        datagram->size = p->tot_len;
+        pbuf_free(p);
+        if (err != ERR_OK) {
+            ret = err_remap(err);
+            break;
+        }
+    }
+    UNLOCK_TCPIP_CORE();
+
+    return sent ? sent : ret;
+#else
+    return NetworkStack::socket_sendto_batch(handle, datagrams, count);
+#endif
+}
+
+nsapi_size_or_error_t LWIP::socket_recvfrom_batch(nsapi_socket_t handle, nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    struct mbed_lwip_socket *s = (struct mbed_lwip_socket *)handle;
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t received;
+
+    // Received UDP netbufs are taken from the mailbox of the netconn,
+    // which does not lock the core
+    for (received = 0; received < count; received++) {
+        nsapi_datagram_t *datagram = &datagrams[received];
+        struct netbuf *buf;
+
+        err_t err = netconn_recv(s->conn, &buf);
+        if (err != ERR_OK) {
+            ret = err_remap(err);
+            break;
+        }
+
+        nsapi_addr_t addr;
+        convert_lwip_addr_to_mbed(&addr, netbuf_fromaddr(buf));
+        datagram->address.set_addr(addr);
+        datagram->address.set_port(netbuf_fromport(buf));
+
+        u16_t offset = 0;
+        for (unsigned i = 0; i < datagram->iov_count && offset < netbuf_len(buf); i++) {
+            u16_t len = datagram->iov[i].iov_len > 0xFFFF ? 0xFFFF : (u16_t)datagram->iov[i].iov_len;
+            offset += netbuf_copy_partial(buf, datagram->iov[i].iov_base, len, offset);
+        }
+        netbuf_delete(buf);
+        datagram->size = offset;
+    }
+
+    return received ? received : ret;
+}
+
 int32_t LWIP::find_multicast_member(const struct mbed_lwip_socket *s, const nsapi_ip_mreq_t *imr)
 {
     uint32_t count = 0;
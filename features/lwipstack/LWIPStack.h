@@ -262,6 +262,14 @@ public:
      */
     virtual const char *get_ip_address();
 
+    /** Get the memory manager of the stack
+     *
+     *  Buffers passed to the zero-copy socket calls are lwIP pbuf chains.
+     *
+     *  @return         Memory manager of the stack
+     */
+    virtual NetStackMemoryManager *get_memory_manager();
+
 protected:
     LWIP();
     virtual ~LWIP() {}
@@ -415,6 +423,79 @@ protected:
     virtual nsapi_size_or_error_t socket_recvfrom(nsapi_socket_t handle, SocketAddress *address,
                                                   void *buffer, nsapi_size_t size);
 
+    /** Receive data over a TCP socket into a memory buffer chain
+     *
+     *  The received pbuf chain is handed over without copying, unless it
+     *  was partly read by socket_recv() or is larger than size.
+     *
+     *  @param handle   Socket handle
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received
+     *  @param size     Maximum number of bytes to receive
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recv_buf(nsapi_socket_t handle,
+                                                  net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Send a packet from a memory buffer chain over a UDP socket
+     *
+     *  The pbuf chain is sent without copying, behind a header pbuf, so
+     *  it is not modified. The stack holds references to it until it is sent.
+     *
+     *  @param handle   Socket handle
+     *  @param address  The SocketAddress of the remote host
+     *  @param buf      Buffer chain of data to send to the host
+     *  @return         Number of sent bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_sendto_buf(nsapi_socket_t handle, const SocketAddress &address,
+                                                    net_stack_mem_buf_t *buf);
+
+    /** Receive a packet over a UDP socket into a memory buffer chain
+     *
+     *  The received pbuf chain is handed over without copying, truncated
+     *  to size.
+     *
+     *  @param handle   Socket handle
+     *  @param address  Destination for the source address or NULL
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received
+     *  @param size     Maximum number of bytes to receive
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recvfrom_buf(nsapi_socket_t handle, SocketAddress *address,
+                                                      net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Send a batch of packets over a UDP socket
+     *
+     *  The iov list of each datagram is referenced by a pbuf chain without
+     *  copying, and the whole batch is sent under a single core lock.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Datagrams to send
+     *  @param count     Number of datagrams
+     *  @return          Number of sent datagrams on success, or the negative
+     *                   error code of the first datagram on failure
+     */
+    virtual nsapi_size_or_error_t socket_sendto_batch(nsapi_socket_t handle,
+                                                      nsapi_datagram_t *datagrams, nsapi_size_t count);
+
+    /** Receive a batch of packets over a UDP socket
+     *
+     *  Each received netbuf is scattered to the iov list of the datagram
+     *  directly.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Destination for the received datagrams
+     *  @param count     Maximum number of datagrams
+     *  @return          Number of received datagrams on success, negative
+     *                   error code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recvfrom_batch(nsapi_socket_t handle,
+                                                        nsapi_datagram_t *datagrams, nsapi_size_t count);
+
     /** Register a callback on state change of the socket
      *
      *  The specified callback will be called on state changes such as when
@@ -384,5 +384,30 @@ int mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl)
     return mbedtls_stub.expected_int;
 }
 
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
+{
+
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
+{
+
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session)
+{
+    return mbedtls_stub.expected_int;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session)
+{
+    return mbedtls_stub.expected_int;
+}
+
+void mbedtls_platform_zeroize(void *buf, size_t len)
+{
+
+}
+
 void mbedtls_strerror( int ret, char *buf, size_t buflen ){
 }
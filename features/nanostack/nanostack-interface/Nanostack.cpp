@@ -718,6 +718,141 @@ out:
     return ret;
 }
 
+// Room for the largest iov list of a batch, in the iovec type of the stack
+static ns_iovec_t *alloc_batch_iov(const nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    unsigned iov_max = 1;
+    for (nsapi_size_t i = 0; i < count; i++) {
+        if (datagrams[i].iov_count > iov_max) {
+            iov_max = datagrams[i].iov_count;
+        }
+    }
+    return static_cast<ns_iovec_t *>(MALLOC(iov_max * sizeof(ns_iovec_t)));
+}
+
+static void convert_iov_to_ns(ns_msghdr_t *msg, ns_iovec_t *ns_iov, const nsapi_datagram_t *datagram)
+{
+    for (unsigned i = 0; i < datagram->iov_count; i++) {
+        ns_iov[i].iov_base = datagram->iov[i].iov_base;
+        ns_iov[i].iov_len = datagram->iov[i].iov_len;
+    }
+    msg->msg_iov = ns_iov;
+    msg->msg_iovlen = datagram->iov_count;
+    msg->msg_control = NULL;
+    msg->msg_controllen = 0;
+    msg->msg_flags = 0;
+}
+
+nsapi_size_or_error_t Nanostack::socket_sendto_batch(void *handle, nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    // Validate parameters
+    NanostackSocket *socket = static_cast<NanostackSocket *>(handle);
+    if (handle == NULL) {
+        MBED_ASSERT(false);
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+
+    ns_iovec_t *ns_iov = alloc_batch_iov(datagrams, count);
+    if (!ns_iov) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t sent = 0;
+
+    {
+        NanostackLockGuard lock;
+
+        if (socket->closed()) {
+            ret = NSAPI_ERROR_NO_CONNECTION;
+        }
+
+        for (; ret == NSAPI_ERROR_OK && sent < count; sent++) {
+            nsapi_datagram_t *datagram = &datagrams[sent];
+
+            if (datagram->address.get_ip_version() != NSAPI_IPv6) {
+                ret = NSAPI_ERROR_UNSUPPORTED;
+                break;
+            }
+
+            ns_address_t ns_address;
+            ns_msghdr_t msg;
+            convert_mbed_addr_to_ns(&ns_address, &datagram->address);
+            convert_iov_to_ns(&msg, ns_iov, datagram);
+            msg.msg_name = &ns_address;
+            msg.msg_namelen = sizeof ns_address;
+
+            int retcode = ::socket_sendmsg(socket->socket_id, &msg, 0);
+            if (retcode == NS_EWOULDBLOCK) {
+                ret = NSAPI_ERROR_WOULD_BLOCK;
+                break;
+            } else if (retcode < 0) {
+                tr_error("socket_sendmsg: error=%d", retcode);
+                ret = NSAPI_ERROR_DEVICE_ERROR;
+                break;
+            }
+            datagram->size = retcode;
+        }
+    }
+
+    FREE(ns_iov);
+    tr_debug("socket_sendto_batch(socket=%p) sock_id=%d, sent=%u, ret=%i", socket, socket->socket_id, sent, ret);
+
+    return sent ? sent : ret;
+}
+
+nsapi_size_or_error_t Nanostack::socket_recvfrom_batch(void *handle, nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    // Validate parameters
+    NanostackSocket *socket = static_cast<NanostackSocket *>(handle);
+    if (handle == NULL) {
+        MBED_ASSERT(false);
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+
+    ns_iovec_t *ns_iov = alloc_batch_iov(datagrams, count);
+    if (!ns_iov) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t received = 0;
+
+    {
+        NanostackLockGuard lock;
+
+        if (socket->closed()) {
+            ret = NSAPI_ERROR_NO_CONNECTION;
+        }
+
+        for (; ret == NSAPI_ERROR_OK && received < count; received++) {
+            nsapi_datagram_t *datagram = &datagrams[received];
+
+            ns_address_t ns_address;
+            ns_msghdr_t msg;
+            convert_iov_to_ns(&msg, ns_iov, datagram);
+            msg.msg_name = &ns_address;
+            msg.msg_namelen = sizeof ns_address;
+
+            int retcode = ::socket_recvmsg(socket->socket_id, &msg, 0);
+            if (retcode == NS_EWOULDBLOCK) {
+                ret = NSAPI_ERROR_WOULD_BLOCK;
+                break;
+            } else if (retcode < 0) {
+                ret = NSAPI_ERROR_PARAMETER;
+                break;
+            }
+            convert_ns_addr_to_mbed(&datagram->address, &ns_address);
+            datagram->size = retcode;
+        }
+    }
+
+    FREE(ns_iov);
+    tr_debug("socket_recvfrom_batch(socket=%p) sock_id=%d, received=%u, ret=%i", socket, socket->socket_id, received, ret);
+
+    return received ? received : ret;
+}
+
 nsapi_error_t Nanostack::socket_bind(void *handle, const SocketAddress &address)
 {
     // Validate parameters
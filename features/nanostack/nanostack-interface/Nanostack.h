@@ -199,6 +199,32 @@ protected:
      */
     virtual nsapi_size_or_error_t socket_recvfrom(void *handle, SocketAddress *address, void *buffer, nsapi_size_t size);
 
+    /** Send a batch of packets over a UDP socket
+     *
+     *  The iov list of each datagram is passed to socket_sendmsg(), and the
+     *  whole batch is sent under a single lock of the stack.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Datagrams to send
+     *  @param count     Number of datagrams
+     *  @return          Number of sent datagrams on success, or the negative
+     *                   error code of the first datagram on failure
+     */
+    virtual nsapi_size_or_error_t socket_sendto_batch(void *handle, nsapi_datagram_t *datagrams, nsapi_size_t count);
+
+    /** Receive a batch of packets over a UDP socket
+     *
+     *  The iov list of each datagram is passed to socket_recvmsg(), and the
+     *  whole batch is received under a single lock of the stack.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Destination for the received datagrams
+     *  @param count     Maximum number of datagrams
+     *  @return          Number of received datagrams on success, negative
+     *                   error code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recvfrom_batch(void *handle, nsapi_datagram_t *datagrams, nsapi_size_t count);
+
     /** Register a callback on state change of the socket
      *
      *  The specified callback will be called on state changes such as when
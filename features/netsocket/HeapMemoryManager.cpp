@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HeapMemoryManager.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct heap_mem_buf_t {
+    heap_mem_buf_t *next;
+    uint8_t *ptr;
+    uint32_t len;
+};
+
+net_stack_mem_buf_t *HeapMemoryManager::alloc_heap(uint32_t size, uint32_t align)
+{
+    heap_mem_buf_t *buf = static_cast<heap_mem_buf_t *>(malloc(sizeof(heap_mem_buf_t) + size + align));
+    if (!buf) {
+        return NULL;
+    }
+
+    buf->next = NULL;
+    buf->ptr = reinterpret_cast<uint8_t *>(buf + 1);
+    if (align) {
+        uint32_t remainder = reinterpret_cast<uintptr_t>(buf->ptr) % align;
+        if (remainder) {
+            buf->ptr += align - remainder;
+        }
+    }
+    buf->len = size;
+    return buf;
+}
+
+net_stack_mem_buf_t *HeapMemoryManager::alloc_pool(uint32_t size, uint32_t align)
+{
+    return alloc_heap(size, align);
+}
+
+uint32_t HeapMemoryManager::get_pool_alloc_unit(uint32_t align) const
+{
+    return UINT32_MAX - align;
+}
+
+void HeapMemoryManager::free(net_stack_mem_buf_t *buf)
+{
+    heap_mem_buf_t *heap_buf = static_cast<heap_mem_buf_t *>(buf);
+    while (heap_buf) {
+        heap_mem_buf_t *next = heap_buf->next;
+        ::free(heap_buf);
+        heap_buf = next;
+    }
+}
+
+uint32_t HeapMemoryManager::get_total_len(const net_stack_mem_buf_t *buf) const
+{
+    uint32_t total_len = 0;
+    for (const heap_mem_buf_t *heap_buf = static_cast<const heap_mem_buf_t *>(buf); heap_buf; heap_buf = heap_buf->next) {
+        total_len += heap_buf->len;
+    }
+    return total_len;
+}
+
+void HeapMemoryManager::copy(net_stack_mem_buf_t *to_buf, const net_stack_mem_buf_t *from_buf)
+{
+    heap_mem_buf_t *to = static_cast<heap_mem_buf_t *>(to_buf);
+    const heap_mem_buf_t *from = static_cast<const heap_mem_buf_t *>(from_buf);
+    uint32_t to_offset = 0, from_offset = 0;
+
+    while (to && from) {
+        uint32_t len = to->len - to_offset;
+        if (len > from->len - from_offset) {
+            len = from->len - from_offset;
+        }
+        memcpy(to->ptr + to_offset, from->ptr + from_offset, len);
+        to_offset += len;
+        from_offset += len;
+        if (to_offset == to->len) {
+            to = to->next;
+            to_offset = 0;
+        }
+        if (from_offset == from->len) {
+            from = from->next;
+            from_offset = 0;
+        }
+    }
+}
+
+void HeapMemoryManager::cat(net_stack_mem_buf_t *to_buf, net_stack_mem_buf_t *cat_buf)
+{
+    heap_mem_buf_t *last = static_cast<heap_mem_buf_t *>(to_buf);
+    while (last->next) {
+        last = last->next;
+    }
+    last->next = static_cast<heap_mem_buf_t *>(cat_buf);
+}
+
+net_stack_mem_buf_t *HeapMemoryManager::get_next(const net_stack_mem_buf_t *buf) const
+{
+    if (!buf) {
+        return NULL;
+    }
+    return static_cast<const heap_mem_buf_t *>(buf)->next;
+}
+
+void *HeapMemoryManager::get_ptr(const net_stack_mem_buf_t *buf) const
+{
+    return static_cast<const heap_mem_buf_t *>(buf)->ptr;
+}
+
+uint32_t HeapMemoryManager::get_len(const net_stack_mem_buf_t *buf) const
+{
+    return static_cast<const heap_mem_buf_t *>(buf)->len;
+}
+
+void HeapMemoryManager::set_len(net_stack_mem_buf_t *buf, uint32_t len)
+{
+    static_cast<heap_mem_buf_t *>(buf)->len = len;
+}
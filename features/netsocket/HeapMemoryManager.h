@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEAP_MEMORY_MANAGER_H
+#define HEAP_MEMORY_MANAGER_H
+
+#include "NetStackMemoryManager.h"
+
+/**
+ * Heap memory manager
+ *
+ * Memory manager for network stacks without buffers of their own. Both heap and pool
+ * allocations are made from the heap, so buffers are always contiguous. Chains are only
+ * made by concatenation.
+ *
+ * It is the default memory manager of NetworkStack, used by the zero-copy socket calls
+ * of stacks which copy the data to and from the buffers.
+ */
+class HeapMemoryManager : public NetStackMemoryManager {
+public:
+    virtual net_stack_mem_buf_t *alloc_heap(uint32_t size, uint32_t align);
+    virtual net_stack_mem_buf_t *alloc_pool(uint32_t size, uint32_t align);
+    virtual uint32_t get_pool_alloc_unit(uint32_t align) const;
+    virtual void free(net_stack_mem_buf_t *buf);
+    virtual uint32_t get_total_len(const net_stack_mem_buf_t *buf) const;
+    virtual void copy(net_stack_mem_buf_t *to_buf, const net_stack_mem_buf_t *from_buf);
+    virtual void cat(net_stack_mem_buf_t *to_buf, net_stack_mem_buf_t *cat_buf);
+    virtual net_stack_mem_buf_t *get_next(const net_stack_mem_buf_t *buf) const;
+    virtual void *get_ptr(const net_stack_mem_buf_t *buf) const;
+    virtual uint32_t get_len(const net_stack_mem_buf_t *buf) const;
+    virtual void set_len(net_stack_mem_buf_t *buf, uint32_t len);
+};
+
+#endif /* HEAP_MEMORY_MANAGER_H */
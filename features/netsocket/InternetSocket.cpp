@@ -228,3 +228,11 @@ nsapi_error_t InternetSocket::getpeername(SocketAddress *address)
     *address = _remote_peer;
     return NSAPI_ERROR_OK;
 }
+
+NetStackMemoryManager *InternetSocket::get_memory_manager()
+{
+    _lock.lock();
+    NetStackMemoryManager *memory_manager = _stack ? _stack->get_memory_manager() : NULL;
+    _lock.unlock();
+    return memory_manager;
+}
@@ -122,6 +122,15 @@ public:
      */
     virtual nsapi_error_t getpeername(SocketAddress *address);
 
+    /** Get the memory manager of the network stack of the socket
+     *
+     *  Buffers passed to the zero-copy calls of the socket, such as
+     *  TCPSocket::recv_buf(), are allocated and freed with this memory manager.
+     *
+     *  @return         Memory manager, or NULL if the socket is not open
+     */
+    NetStackMemoryManager *get_memory_manager();
+
     /** Register a callback on state change of the socket.
      *
      *  @see Socket::sigio
@@ -15,10 +15,12 @@
  */
 
 #include "NetworkStack.h"
+#include "HeapMemoryManager.h"
 #include "nsapi_dns.h"
 #include "mbed.h"
 #include "stddef.h"
 #include <new>
+#include <algorithm>
 
 // Default NetworkStack operations
 const char *NetworkStack::get_ip_address()
@@ -110,6 +112,179 @@ nsapi_error_t NetworkStack::getstackopt(int level, int optname, void *optval, un
     return NSAPI_ERROR_UNSUPPORTED;
 }
 
+NetStackMemoryManager *NetworkStack::get_memory_manager()
+{
+    static HeapMemoryManager heap_memory_manager;
+    return &heap_memory_manager;
+}
+
+nsapi_size_or_error_t NetworkStack::socket_recv_buf(nsapi_socket_t handle, net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    NetStackMemoryManager *memory_manager = get_memory_manager();
+
+    *buf = NULL;
+    net_stack_mem_buf_t *recv_buf = memory_manager->alloc_heap(size, 0);
+    if (!recv_buf) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    nsapi_size_or_error_t ret = socket_recv(handle, memory_manager->get_ptr(recv_buf), size);
+    if (ret <= 0) {
+        memory_manager->free(recv_buf);
+        return ret;
+    }
+
+    memory_manager->set_len(recv_buf, ret);
+    *buf = recv_buf;
+    return ret;
+}
+
+nsapi_size_or_error_t NetworkStack::socket_sendto_buf(nsapi_socket_t handle, const SocketAddress &address,
+                                                      net_stack_mem_buf_t *buf)
+{
+    NetStackMemoryManager *memory_manager = get_memory_manager();
+
+    // Contiguous buffers are sent as they are, chains are gathered first
+    if (!memory_manager->get_next(buf)) {
+        return socket_sendto(handle, address, memory_manager->get_ptr(buf), memory_manager->get_len(buf));
+    }
+
+    uint32_t size = memory_manager->get_total_len(buf);
+    uint8_t *data = new (std::nothrow) uint8_t[size];
+    if (!data) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    memory_manager->copy_from_buf(data, size, buf);
+    nsapi_size_or_error_t ret = socket_sendto(handle, address, data, size);
+    delete[] data;
+    return ret;
+}
+
+nsapi_size_or_error_t NetworkStack::socket_recvfrom_buf(nsapi_socket_t handle, SocketAddress *address,
+                                                        net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    NetStackMemoryManager *memory_manager = get_memory_manager();
+
+    *buf = NULL;
+    net_stack_mem_buf_t *recv_buf = memory_manager->alloc_heap(size, 0);
+    if (!recv_buf) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    nsapi_size_or_error_t ret = socket_recvfrom(handle, address, memory_manager->get_ptr(recv_buf), size);
+    if (ret <= 0) {
+        memory_manager->free(recv_buf);
+        return ret;
+    }
+
+    memory_manager->set_len(recv_buf, ret);
+    *buf = recv_buf;
+    return ret;
+}
+
+static nsapi_size_t iov_size(const nsapi_iovec_t *iov, unsigned count)
+{
+    nsapi_size_t size = 0;
+    for (unsigned i = 0; i < count; i++) {
+        size += iov[i].iov_len;
+    }
+    return size;
+}
+
+static uint8_t *iov_reserve(uint8_t *data, nsapi_size_t *data_size, nsapi_size_t size)
+{
+    if (size <= *data_size) {
+        return data;
+    }
+
+    delete[] data;
+    data = new (std::nothrow) uint8_t[size];
+    *data_size = data ? size : 0;
+    return data;
+}
+
+nsapi_size_or_error_t NetworkStack::socket_sendto_batch(nsapi_socket_t handle, nsapi_datagram_t *datagrams,
+                                                        nsapi_size_t count)
+{
+    // Datagrams of several buffers are gathered into a buffer shared by the batch
+    uint8_t *data = NULL;
+    nsapi_size_t data_size = 0;
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t sent;
+
+    for (sent = 0; sent < count; sent++) {
+        nsapi_datagram_t *datagram = &datagrams[sent];
+
+        if (datagram->iov_count == 1) {
+            ret = socket_sendto(handle, datagram->address, datagram->iov[0].iov_base, datagram->iov[0].iov_len);
+        } else {
+            nsapi_size_t size = iov_size(datagram->iov, datagram->iov_count);
+            data = iov_reserve(data, &data_size, size);
+            if (size && !data) {
+                ret = NSAPI_ERROR_NO_MEMORY;
+                break;
+            }
+
+            nsapi_size_t offset = 0;
+            for (unsigned i = 0; i < datagram->iov_count; i++) {
+                memcpy(data + offset, datagram->iov[i].iov_base, datagram->iov[i].iov_len);
+                offset += datagram->iov[i].iov_len;
+            }
+            ret = socket_sendto(handle, datagram->address, data, size);
+        }
+
+        if (ret < 0) {
+            break;
+        }
+        datagram->size = ret;
+    }
+
+    delete[] data;
+    return sent ? sent : ret;
+}
+
+nsapi_size_or_error_t NetworkStack::socket_recvfrom_batch(nsapi_socket_t handle, nsapi_datagram_t *datagrams,
+                                                          nsapi_size_t count)
+{
+    // Datagrams of several buffers are received into a buffer shared by the batch
+    uint8_t *data = NULL;
+    nsapi_size_t data_size = 0;
+    nsapi_size_or_error_t ret = NSAPI_ERROR_OK;
+    nsapi_size_t received;
+
+    for (received = 0; received < count; received++) {
+        nsapi_datagram_t *datagram = &datagrams[received];
+
+        if (datagram->iov_count == 1) {
+            ret = socket_recvfrom(handle, &datagram->address, datagram->iov[0].iov_base, datagram->iov[0].iov_len);
+        } else {
+            nsapi_size_t size = iov_size(datagram->iov, datagram->iov_count);
+            data = iov_reserve(data, &data_size, size);
+            if (size && !data) {
+                ret = NSAPI_ERROR_NO_MEMORY;
+                break;
+            }
+
+            ret = socket_recvfrom(handle, &datagram->address, data, size);
+
+            nsapi_size_t offset = 0;
+            for (unsigned i = 0; ret > 0 && i < datagram->iov_count && offset < (nsapi_size_t)ret; i++) {
+                nsapi_size_t len = std::min(datagram->iov[i].iov_len, ret - offset);
+                memcpy(datagram->iov[i].iov_base, data + offset, len);
+                offset += len;
+            }
+        }
+
+        if (ret < 0) {
+            break;
+        }
+        datagram->size = ret;
+    }
+
+    delete[] data;
+    return received ? received : ret;
+}
+
 nsapi_error_t NetworkStack::setsockopt(void *handle, int level, int optname, const void *optval, unsigned optlen)
 {
     return NSAPI_ERROR_UNSUPPORTED;
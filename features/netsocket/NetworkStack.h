@@ -25,6 +25,20 @@
 
 // Predeclared classes
 class OnboardNetworkStack;
+class NetStackMemoryManager;
+typedef void net_stack_mem_buf_t;
+
+/** nsapi_datagram structure
+ *
+ *  Datagram of a batch of UDP sends or receives. The data is gathered
+ *  from, or scattered to, the buffers of the iov list in turn.
+ */
+typedef struct nsapi_datagram {
+    SocketAddress address;  /* destination address for sends, source address for receives */
+    nsapi_iovec_t *iov;     /* scatter/gather list of the data */
+    unsigned iov_count;     /* number of buffers in iov */
+    nsapi_size_t size;      /* number of bytes sent or received, set by the call */
+} nsapi_datagram_t;
 
 /** NetworkStack class
  *
@@ -160,6 +174,19 @@ public:
      */
     virtual nsapi_error_t getstackopt(int level, int optname, void *optval, unsigned *optlen);
 
+    /** Get the memory manager of the stack
+     *
+     *  Buffers passed to the zero-copy socket calls, such as UDPSocket::sendto_buf()
+     *  or TCPSocket::recv_buf(), are allocated and freed with this memory manager.
+     *
+     *  Stacks with their own network buffers return their memory manager, so that the
+     *  buffers are passed to and from the stack without copying. By default, buffers
+     *  are allocated from the heap and the data is copied by the stack.
+     *
+     *  @return         Memory manager of the stack
+     */
+    virtual NetStackMemoryManager *get_memory_manager();
+
     /** Dynamic downcast to a OnboardNetworkStack */
     virtual OnboardNetworkStack *onboardNetworkStack()
     {
@@ -321,6 +348,103 @@ protected:
     virtual nsapi_size_or_error_t socket_recvfrom(nsapi_socket_t handle, SocketAddress *address,
                                                   void *buffer, nsapi_size_t size) = 0;
 
+    /** Receive data over a TCP socket into a memory buffer chain
+     *
+     *  The buffer chain is allocated by the stack, with the memory manager
+     *  of the stack, and must be freed by the caller. Stacks with their own
+     *  network buffers hand the received buffers over without copying.
+     *
+     *  This call is non-blocking. If recv would block,
+     *  NSAPI_ERROR_WOULD_BLOCK is returned immediately.
+     *
+     *  @param handle   Socket handle
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received
+     *  @param size     Maximum number of bytes to receive
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recv_buf(nsapi_socket_t handle,
+                                                  net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Send a packet from a memory buffer chain over a UDP socket
+     *
+     *  The buffer chain, allocated with the memory manager of the stack, is
+     *  left to the caller, who frees it. Stacks with their own network buffers
+     *  may reference it until the packet is sent, so it must not be modified.
+     *
+     *  This call is non-blocking. If sendto would block,
+     *  NSAPI_ERROR_WOULD_BLOCK is returned immediately.
+     *
+     *  @param handle   Socket handle
+     *  @param address  The SocketAddress of the remote host
+     *  @param buf      Buffer chain of data to send to the host
+     *  @return         Number of sent bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_sendto_buf(nsapi_socket_t handle, const SocketAddress &address,
+                                                    net_stack_mem_buf_t *buf);
+
+    /** Receive a packet over a UDP socket into a memory buffer chain
+     *
+     *  The buffer chain is allocated by the stack, with the memory manager
+     *  of the stack, and must be freed by the caller. Stacks with their own
+     *  network buffers hand the received buffers over without copying.
+     *  A packet larger than size is truncated.
+     *
+     *  This call is non-blocking. If recvfrom would block,
+     *  NSAPI_ERROR_WOULD_BLOCK is returned immediately.
+     *
+     *  @param handle   Socket handle
+     *  @param address  Destination for the source address or NULL
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received
+     *  @param size     Maximum number of bytes to receive
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recvfrom_buf(nsapi_socket_t handle, SocketAddress *address,
+                                                      net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Send a batch of packets over a UDP socket
+     *
+     *  Sends each datagram to its address in turn, gathering its data from
+     *  the iov list, and sets the size of each datagram sent. Sending stops
+     *  at the first datagram which fails. Stacks override this to send the
+     *  whole batch under a single lock of the stack.
+     *
+     *  This call is non-blocking. If no datagram can be sent,
+     *  NSAPI_ERROR_WOULD_BLOCK is returned immediately.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Datagrams to send
+     *  @param count     Number of datagrams
+     *  @return          Number of sent datagrams on success, or the negative
+     *                   error code of the first datagram on failure
+     */
+    virtual nsapi_size_or_error_t socket_sendto_batch(nsapi_socket_t handle,
+                                                      nsapi_datagram_t *datagrams, nsapi_size_t count);
+
+    /** Receive a batch of packets over a UDP socket
+     *
+     *  Receives datagrams in turn, scattering the data of each one to the
+     *  iov list of the next entry, and sets its source address and size.
+     *  A datagram larger than the iov list is truncated. Receiving stops
+     *  when no more datagrams are pending. Stacks override this to receive
+     *  the whole batch under a single lock of the stack.
+     *
+     *  This call is non-blocking. If no datagram is pending,
+     *  NSAPI_ERROR_WOULD_BLOCK is returned immediately.
+     *
+     *  @param handle    Socket handle
+     *  @param datagrams Destination for the received datagrams
+     *  @param count     Maximum number of datagrams
+     *  @return          Number of received datagrams on success, negative
+     *                   error code on failure
+     */
+    virtual nsapi_size_or_error_t socket_recvfrom_batch(nsapi_socket_t handle,
+                                                        nsapi_datagram_t *datagrams, nsapi_size_t count);
+
     /** Register a callback on state change of the socket
      *
      *  The specified callback will be called on state changes such as when
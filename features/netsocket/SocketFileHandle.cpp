@@ -0,0 +1,140 @@
+/* SocketFileHandle
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SocketFileHandle.h"
+#include "platform/mbed_poll.h"
+#include "platform/mbed_critical.h"
+
+using mbed::callback;
+
+static ssize_t socket_error(nsapi_size_or_error_t err)
+{
+    switch (err) {
+        case NSAPI_ERROR_WOULD_BLOCK:
+            return -EAGAIN;
+        case NSAPI_ERROR_NO_SOCKET:
+            return -EBADF;
+        case NSAPI_ERROR_NO_CONNECTION:
+            return -ENOTCONN;
+        case NSAPI_ERROR_NO_MEMORY:
+            return -ENOMEM;
+        default:
+            return -EIO;
+    }
+}
+
+SocketFileHandle::SocketFileHandle(Socket *socket)
+    : _socket(socket), _blocking(true), _events(POLLIN | POLLOUT), _event_count(0)
+{
+    _socket->sigio(callback(this, &SocketFileHandle::event));
+}
+
+SocketFileHandle::~SocketFileHandle()
+{
+    _socket->sigio(NULL);
+}
+
+ssize_t SocketFileHandle::read(void *buffer, size_t size)
+{
+    unsigned int event_count = _event_count;
+    nsapi_size_or_error_t ret = _socket->recv(buffer, size);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (ret == NSAPI_ERROR_WOULD_BLOCK) {
+        clear_events(POLLIN, event_count);
+    }
+    return socket_error(ret);
+}
+
+ssize_t SocketFileHandle::write(const void *buffer, size_t size)
+{
+    unsigned int event_count = _event_count;
+    nsapi_size_or_error_t ret = _socket->send(buffer, size);
+    if (ret >= 0) {
+        return ret;
+    }
+    if (ret == NSAPI_ERROR_WOULD_BLOCK) {
+        clear_events(POLLOUT, event_count);
+    }
+    return socket_error(ret);
+}
+
+off_t SocketFileHandle::seek(off_t offset, int whence)
+{
+    return -ESPIPE;
+}
+
+int SocketFileHandle::close()
+{
+    nsapi_error_t ret = _socket->close();
+    return ret < 0 ? socket_error(ret) : 0;
+}
+
+int SocketFileHandle::set_blocking(bool blocking)
+{
+    _socket->set_blocking(blocking);
+    _blocking = blocking;
+    return 0;
+}
+
+bool SocketFileHandle::is_blocking() const
+{
+    return _blocking;
+}
+
+short SocketFileHandle::poll(short events) const
+{
+    return _events & events;
+}
+
+bool SocketFileHandle::poll_wakes() const
+{
+    return true;
+}
+
+void SocketFileHandle::sigio(mbed::Callback<void()> func)
+{
+    core_util_critical_section_enter();
+    _sigio_cb = func;
+    if (_sigio_cb && _events) {
+        _sigio_cb();
+    }
+    core_util_critical_section_exit();
+}
+
+void SocketFileHandle::event()
+{
+    core_util_critical_section_enter();
+    _events |= POLLIN | POLLOUT;
+    _event_count++;
+    core_util_critical_section_exit();
+
+    if (_sigio_cb) {
+        _sigio_cb();
+    }
+    mbed::poll_wake(this);
+}
+
+void SocketFileHandle::clear_events(short events, unsigned int event_count)
+{
+    // An event received during the operation may have made the socket ready again
+    core_util_critical_section_enter();
+    if (_event_count == event_count) {
+        _events &= ~events;
+    }
+    core_util_critical_section_exit();
+}
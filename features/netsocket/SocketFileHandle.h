@@ -0,0 +1,130 @@
+/* SocketFileHandle
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file SocketFileHandle.h Socket seen as a file handle */
+/** @addtogroup netsocket
+ * @{
+ */
+
+#ifndef SOCKETFILEHANDLE_H
+#define SOCKETFILEHANDLE_H
+
+#include "netsocket/Socket.h"
+#include "platform/FileHandle.h"
+#include "platform/NonCopyable.h"
+
+/** Socket seen as a file handle, so that it can be waited on with mbed::poll()
+ *
+ *  read() and write() map to recv() and send() of the socket, returning -EAGAIN
+ *  when the socket would block. The events of the socket wake mbed::poll() up.
+ *
+ *  As the network stack does not tell read and write events apart, POLLIN and
+ *  POLLOUT are both reported after any event of the socket, until read() or write()
+ *  returns -EAGAIN. So poll() may return a handle which is not ready yet, and the
+ *  handle should be set to non-blocking mode.
+ *
+ *  The handle takes over the sigio() callback of the socket.
+ */
+class SocketFileHandle : public mbed::FileHandle, private mbed::NonCopyable<SocketFileHandle> {
+public:
+    /** Create a file handle over an open socket
+     *
+     *  @param socket   Socket, which must outlive the file handle
+     */
+    SocketFileHandle(Socket *socket);
+
+    /** Destroy the file handle, releasing the sigio() callback of the socket
+     *
+     *  The socket is not closed.
+     */
+    virtual ~SocketFileHandle();
+
+    /** Receive data from the socket
+     *
+     *  @param buffer   Destination buffer
+     *  @param size     Size of the buffer in bytes
+     *  @return         Number of bytes received, 0 if the connection is closed,
+     *                  -EAGAIN if the socket would block, or another negative error code
+     */
+    virtual ssize_t read(void *buffer, size_t size);
+
+    /** Send data over the socket
+     *
+     *  @param buffer   Data to send
+     *  @param size     Size of the data in bytes
+     *  @return         Number of bytes sent, -EAGAIN if the socket would block,
+     *                  or another negative error code
+     */
+    virtual ssize_t write(const void *buffer, size_t size);
+
+    /** Not supported
+     *
+     *  @return         -ESPIPE
+     */
+    virtual off_t seek(off_t offset, int whence = SEEK_SET);
+
+    /** Close the socket
+     *
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int close();
+
+    /** Set blocking or non-blocking mode of the socket
+     *
+     *  @param blocking true for blocking mode, false for non-blocking mode
+     *  @return         0
+     */
+    virtual int set_blocking(bool blocking);
+
+    /** Check the blocking mode
+     *
+     *  @return         true for blocking mode, false for non-blocking mode
+     */
+    virtual bool is_blocking() const;
+
+    /** Check for poll event flags
+     *
+     *  @param events   Events of interest
+     *  @return         Events which may have occurred
+     */
+    virtual short poll(short events) const;
+
+    /** Events of the socket wake mbed::poll() up
+     *
+     *  @return         true
+     */
+    virtual bool poll_wakes() const;
+
+    /** Register a callback on events of the socket
+     *
+     *  @param func     Function to call on events, or NULL to remove the callback
+     */
+    virtual void sigio(mbed::Callback<void()> func);
+
+private:
+    void event();
+    void clear_events(short events, unsigned int event_count);
+
+    Socket *_socket;
+    bool _blocking;
+    volatile short _events;
+    volatile unsigned int _event_count;
+    mbed::Callback<void()> _sigio_cb;
+};
+
+#endif // SOCKETFILEHANDLE_H
+
+/** @}*/
@@ -0,0 +1,216 @@
+/* SocketSet
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SocketSet.h"
+#include "rtos/Kernel.h"
+#include "platform/mbed_critical.h"
+#include <new>
+
+using mbed::callback;
+
+SocketSet::SocketSet()
+    : _entries(NULL), _ready_head(NULL), _ready_tail(NULL)
+{
+}
+
+SocketSet::~SocketSet()
+{
+    while (_entries) {
+        entry_t *entry = _entries;
+        _entries = entry->next;
+        entry->socket->sigio(NULL);
+        delete entry;
+    }
+}
+
+nsapi_error_t SocketSet::add(Socket *socket, short events)
+{
+    if (!socket) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    _lock.lock();
+    if (find(socket)) {
+        _lock.unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    entry_t *entry = new (std::nothrow) entry_t;
+    if (!entry) {
+        _lock.unlock();
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    entry->set = this;
+    entry->socket = socket;
+    entry->events = events;
+    entry->queued = false;
+    entry->ready_next = NULL;
+    entry->next = _entries;
+    _entries = entry;
+
+    socket->sigio(callback(&SocketSet::socket_event, entry));
+    queue(entry);
+    _lock.unlock();
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t SocketSet::modify(Socket *socket, short events)
+{
+    _lock.lock();
+    entry_t *entry = find(socket);
+    if (!entry) {
+        _lock.unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    entry->events = events;
+    if (events) {
+        queue(entry);
+    } else {
+        unqueue(entry);
+    }
+    _lock.unlock();
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t SocketSet::remove(Socket *socket)
+{
+    _lock.lock();
+    entry_t **prev = &_entries;
+    while (*prev && (*prev)->socket != socket) {
+        prev = &(*prev)->next;
+    }
+    entry_t *entry = *prev;
+    if (!entry) {
+        _lock.unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    *prev = entry->next;
+    socket->sigio(NULL);
+    unqueue(entry);
+    _lock.unlock();
+    delete entry;
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t SocketSet::wait(event_t *events, nsapi_size_t max_events, int timeout)
+{
+    if (!events || !max_events) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    uint64_t deadline = rtos::Kernel::get_ms_count() + timeout;
+    while (true) {
+        nsapi_size_t count = 0;
+
+        _lock.lock();
+        core_util_critical_section_enter();
+        while (_ready_head && count < max_events) {
+            entry_t *entry = _ready_head;
+            _ready_head = entry->ready_next;
+            entry->ready_next = NULL;
+            entry->queued = false;
+            events[count].socket = entry->socket;
+            events[count].revents = entry->events;
+            count++;
+        }
+        bool more = _ready_head != NULL;
+        if (!more) {
+            _ready_tail = NULL;
+        }
+        core_util_critical_section_exit();
+        _lock.unlock();
+
+        if (count) {
+            if (more) {
+                // Let another waiter take the sockets left
+                _event_flag.set(READY_FLAG);
+            }
+            return count;
+        }
+
+        uint32_t wait_time = osWaitForever;
+        if (timeout >= 0) {
+            uint64_t now = rtos::Kernel::get_ms_count();
+            if (now >= deadline) {
+                return 0;
+            }
+            wait_time = deadline - now;
+        }
+
+        // The flag may be left over from sockets already returned, so check the queue again
+        uint32_t flag = _event_flag.wait_any(READY_FLAG, wait_time);
+        if ((flag & osFlagsError) || !(flag & READY_FLAG)) {
+            return 0;
+        }
+    }
+}
+
+void SocketSet::socket_event(entry_t *entry)
+{
+    entry->set->queue(entry);
+}
+
+SocketSet::entry_t *SocketSet::find(Socket *socket)
+{
+    entry_t *entry = _entries;
+    while (entry && entry->socket != socket) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+void SocketSet::queue(entry_t *entry)
+{
+    core_util_critical_section_enter();
+    bool queued = !entry->queued && entry->events;
+    if (queued) {
+        entry->queued = true;
+        entry->ready_next = NULL;
+        if (_ready_tail) {
+            _ready_tail->ready_next = entry;
+        } else {
+            _ready_head = entry;
+        }
+        _ready_tail = entry;
+    }
+    core_util_critical_section_exit();
+
+    if (queued) {
+        _event_flag.set(READY_FLAG);
+    }
+}
+
+void SocketSet::unqueue(entry_t *entry)
+{
+    core_util_critical_section_enter();
+    if (entry->queued) {
+        entry_t **prev = &_ready_head;
+        entry_t *last = NULL;
+        while (*prev != entry) {
+            last = *prev;
+            prev = &(*prev)->ready_next;
+        }
+        *prev = entry->ready_next;
+        if (_ready_tail == entry) {
+            _ready_tail = last;
+        }
+        entry->ready_next = NULL;
+        entry->queued = false;
+    }
+    core_util_critical_section_exit();
+}
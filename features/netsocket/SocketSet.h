@@ -0,0 +1,126 @@
+/* SocketSet
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file SocketSet.h Set of sockets waited on at once */
+/** @addtogroup netsocket
+ * @{
+ */
+
+#ifndef SOCKETSET_H
+#define SOCKETSET_H
+
+#include "netsocket/Socket.h"
+#include "rtos/EventFlags.h"
+#include "rtos/Mutex.h"
+#include "platform/mbed_poll.h"
+#include "platform/NonCopyable.h"
+
+/** Set of sockets waited on at once, in the manner of epoll.
+ *
+ *  Sockets are added with a mask of the events of interest, POLLIN and/or POLLOUT.
+ *  When the network stack reports an event on a socket, the socket is queued in a
+ *  ready list, and wait() returns the queued sockets. The cost of wait() depends on
+ *  the number of ready sockets only, not on the number of sockets in the set, so
+ *  a single thread can serve many sockets.
+ *
+ *  Events are edge-triggered, as the sigio() callback of the sockets is: a socket
+ *  returned by wait() is not returned again before an operation is done on it and a
+ *  new event occurs. So the socket should be set to non-blocking mode, and used until
+ *  it returns NSAPI_ERROR_WOULD_BLOCK. As the network stack does not tell read and
+ *  write events apart, a socket is returned with all the events of its mask.
+ *
+ *  The set takes over the sigio() callback of its sockets, until they are removed.
+ *  A socket must be removed from the set before it is closed or destroyed.
+ */
+class SocketSet : private mbed::NonCopyable<SocketSet> {
+public:
+    /** Ready socket, as returned by wait()
+     */
+    typedef struct {
+        Socket *socket;     /*!< Ready socket */
+        short revents;      /*!< Events which may have occurred (POLLIN/POLLOUT) */
+    } event_t;
+
+    /** Create an empty set
+     */
+    SocketSet();
+
+    /** Destroy the set, removing all the sockets
+     */
+    ~SocketSet();
+
+    /** Add a socket to the set
+     *
+     *  The socket is queued as ready right away, as it may have pending events.
+     *
+     *  @param socket   Socket to add
+     *  @param events   Events of interest, POLLIN and/or POLLOUT
+     *  @return         0 on success, NSAPI_ERROR_PARAMETER if the socket is NULL or
+     *                  already in the set, NSAPI_ERROR_NO_MEMORY if out of memory
+     */
+    nsapi_error_t add(Socket *socket, short events);
+
+    /** Change the events of interest of a socket
+     *
+     *  @param socket   Socket in the set
+     *  @param events   Events of interest, POLLIN and/or POLLOUT
+     *  @return         0 on success, NSAPI_ERROR_PARAMETER if the socket is not in the set
+     */
+    nsapi_error_t modify(Socket *socket, short events);
+
+    /** Remove a socket from the set, releasing its sigio() callback
+     *
+     *  @param socket   Socket in the set
+     *  @return         0 on success, NSAPI_ERROR_PARAMETER if the socket is not in the set
+     */
+    nsapi_error_t remove(Socket *socket);
+
+    /** Wait for sockets of the set to be ready
+     *
+     *  @param events       Returned ready sockets
+     *  @param max_events   Maximum number of ready sockets to return
+     *  @param timeout      Timeout in milliseconds, 0 to return right away or -1 to wait forever
+     *  @return             Number of ready sockets, 0 on timeout, or NSAPI_ERROR_PARAMETER
+     */
+    nsapi_size_or_error_t wait(event_t *events, nsapi_size_t max_events, int timeout = -1);
+
+private:
+    struct entry_t {
+        SocketSet *set;
+        Socket *socket;
+        short events;
+        bool queued;
+        entry_t *next;
+        entry_t *ready_next;
+    };
+
+    static void socket_event(entry_t *entry);
+    entry_t *find(Socket *socket);
+    void queue(entry_t *entry);
+    void unqueue(entry_t *entry);
+
+    entry_t *_entries;
+    entry_t *_ready_head;
+    entry_t *_ready_tail;
+    rtos::EventFlags _event_flag;
+    rtos::Mutex _lock;
+
+    static const int READY_FLAG = 0x1u;
+};
+
+#endif // SOCKETSET_H
+
+/** @}*/
@@ -15,6 +15,7 @@
  */
 
 #include "TCPSocket.h"
+#include "NetStackMemoryManager.h"
 #include "Timer.h"
 #include "mbed_assert.h"
 
@@ -193,7 +194,43 @@ nsapi_size_or_error_t TCPSocket::sendto(const SocketAddress &address, const void
     return send(data, size);
 }
 
+nsapi_size_or_error_t TCPSocket::send_buf(net_stack_mem_buf_t *buf)
+{
+    NetStackMemoryManager *memory_manager = get_memory_manager();
+    if (!memory_manager) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+
+    nsapi_size_t sent = 0;
+    for (; buf; buf = memory_manager->get_next(buf)) {
+        nsapi_size_t len = memory_manager->get_len(buf);
+        if (!len) {
+            continue;
+        }
+        nsapi_size_or_error_t ret = send(memory_manager->get_ptr(buf), len);
+        if (ret < 0) {
+            return sent ? sent : ret;
+        }
+        sent += ret;
+        if ((nsapi_size_t)ret < len) {
+            break;
+        }
+    }
+    return sent;
+}
+
 nsapi_size_or_error_t TCPSocket::recv(void *data, nsapi_size_t size)
+{
+    return recv_internal(data, NULL, size);
+}
+
+nsapi_size_or_error_t TCPSocket::recv_buf(net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    *buf = NULL;
+    return recv_internal(NULL, buf, size);
+}
+
+nsapi_size_or_error_t TCPSocket::recv_internal(void *data, net_stack_mem_buf_t **buf, nsapi_size_t size)
 {
     _lock.lock();
     nsapi_size_or_error_t ret;
@@ -211,7 +248,11 @@ nsapi_size_or_error_t TCPSocket::recv(void *data, nsapi_size_t size)
         }
 
         _pending = 0;
-        ret = _stack->socket_recv(_socket, data, size);
+        if (buf) {
+            ret = _stack->socket_recv_buf(_socket, buf, size);
+        } else {
+            ret = _stack->socket_recv(_socket, data, size);
+        }
         if ((_timeout == 0) || (ret != NSAPI_ERROR_WOULD_BLOCK)) {
             _socket_stats.stats_update_recv_bytes(this, ret);
             break;
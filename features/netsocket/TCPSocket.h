@@ -124,6 +124,36 @@ public:
      */
     virtual nsapi_size_or_error_t recv(void *data, nsapi_size_t size);
 
+    /** Send data from a memory buffer chain over a TCP socket
+     *
+     *  Sends the buffers of the chain in order, as send() does. The chain is
+     *  allocated with get_memory_manager() and is left to the caller, who frees it.
+     *  Composing the data in the buffers avoids copying it in the application,
+     *  but the stack still copies it into its TCP segments.
+     *
+     *  @param buf      Buffer chain of data to send to the host
+     *  @return         Number of sent bytes on success, negative error
+     *                  code on failure
+     */
+    nsapi_size_or_error_t send_buf(net_stack_mem_buf_t *buf);
+
+    /** Receive data over a TCP socket into a memory buffer chain
+     *
+     *  Behaves as recv(), but the data is returned in a buffer chain of the
+     *  stack, which the caller frees with get_memory_manager(). Stacks with their
+     *  own network buffers hand the received buffers over without copying, so
+     *  they should be freed promptly.
+     *
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received
+     *  @param size     Maximum number of bytes to receive
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure. If no data is available to be received
+     *                  and the peer has performed an orderly shutdown,
+     *                  recv_buf() returns 0.
+     */
+    nsapi_size_or_error_t recv_buf(net_stack_mem_buf_t **buf, nsapi_size_t size);
+
     /** Send data on a socket.
      *
      * TCP socket is connection oriented protocol, so address is ignored.
@@ -195,6 +225,8 @@ private:
      *  To be used within accept() function. Close() will clean this up.
      */
     TCPSocket(TCPSocket *parent, nsapi_socket_t socket, SocketAddress address);
+
+    nsapi_size_or_error_t recv_internal(void *data, net_stack_mem_buf_t **buf, nsapi_size_t size);
 };
 
 
@@ -0,0 +1,527 @@
+/* TLSSessionCache
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TLSSessionCache.h"
+#include "KVStore.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+#include <new>
+#include <string.h>
+
+#define TRACE_GROUP "TLSC"
+#include "mbed-trace/mbed_trace.h"
+
+// This class requires Mbed TLS SSL/TLS client code
+#if defined(MBEDTLS_SSL_CLI_C)
+
+using mbed::KVStore;
+
+/* Sessions are serialized as follows, all integers in network byte order:
+ *
+ *   1   format version
+ *   1   Mbed TLS options the layout depends on
+ *   8   start time                          (MBEDTLS_HAVE_TIME)
+ *   4   ciphersuite
+ *   4   compression
+ *   1   session id length
+ *  32   session id
+ *  48   master secret
+ *   4   verification result
+ *   4   ticket lifetime                     (MBEDTLS_SSL_SESSION_TICKETS)
+ *   2   ticket length                       (MBEDTLS_SSL_SESSION_TICKETS)
+ *   1   max fragment length code            (MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+ *   1   truncated HMAC                      (MBEDTLS_SSL_TRUNCATED_HMAC)
+ *   1   encrypt-then-MAC                    (MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+ *   n   ticket                              (MBEDTLS_SSL_SESSION_TICKETS)
+ *
+ * Sessions stored in a KVStore by a firmware with other options are dropped.
+ */
+#define SESSION_FORMAT_VERSION  1
+
+#define SESSION_OPT_TIME        (1 << 0)
+#define SESSION_OPT_TICKETS     (1 << 1)
+#define SESSION_OPT_MFL         (1 << 2)
+#define SESSION_OPT_TRUNC_HMAC  (1 << 3)
+#define SESSION_OPT_ETM         (1 << 4)
+
+static const uint8_t session_options = 0
+#if defined(MBEDTLS_HAVE_TIME)
+                                       | SESSION_OPT_TIME
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+                                       | SESSION_OPT_TICKETS
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+                                       | SESSION_OPT_MFL
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+                                       | SESSION_OPT_TRUNC_HMAC
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+                                       | SESSION_OPT_ETM
+#endif
+                                       ;
+
+static const size_t session_fixed_size = 2
+#if defined(MBEDTLS_HAVE_TIME)
+                                         + 8
+#endif
+                                         + 4 + 4 + 1 + 32 + 48 + 4
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+                                         + 4 + 2
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+                                         + 1
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+                                         + 1
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+                                         + 1
+#endif
+                                         ;
+
+static void session_append_byte(unsigned char **p, uint8_t byte)
+{
+    *(*p)++ = byte;
+}
+
+static void session_append_word32(unsigned char **p, uint32_t word)
+{
+    session_append_byte(p, word >> 24);
+    session_append_byte(p, word >> 16);
+    session_append_byte(p, word >> 8);
+    session_append_byte(p, word);
+}
+
+static void session_append_data(unsigned char **p, const unsigned char *data, size_t size)
+{
+    memcpy(*p, data, size);
+    *p += size;
+}
+
+static uint8_t session_scan_byte(const unsigned char **p)
+{
+    return *(*p)++;
+}
+
+static uint32_t session_scan_word32(const unsigned char **p)
+{
+    uint32_t word = (uint32_t) session_scan_byte(p) << 24;
+    word |= (uint32_t) session_scan_byte(p) << 16;
+    word |= (uint32_t) session_scan_byte(p) << 8;
+    word |= session_scan_byte(p);
+    return word;
+}
+
+static void session_scan_data(const unsigned char **p, unsigned char *data, size_t size)
+{
+    memcpy(data, *p, size);
+    *p += size;
+}
+
+static void session_data_free(unsigned char *data, size_t size)
+{
+    mbedtls_platform_zeroize(data, size);
+    delete[] data;
+}
+
+TLSSessionCache::TLSSessionCache(unsigned size)
+    : _entries(NULL), _size(0), _clock(0), _kvstore(NULL), _prefix(NULL), _create_flags(0)
+{
+    if (size) {
+        _entries = new (std::nothrow) entry_t[size];
+    }
+    if (_entries) {
+        memset(_entries, 0, size * sizeof(entry_t));
+        _size = size;
+    }
+}
+
+TLSSessionCache::~TLSSessionCache()
+{
+    clear();
+    delete[] _entries;
+    delete[] _prefix;
+}
+
+TLSSessionCache *TLSSessionCache::get_default_instance()
+{
+#if MBED_CONF_NSAPI_TLS_SESSION_CACHE_SIZE > 0
+    static TLSSessionCache cache(MBED_CONF_NSAPI_TLS_SESSION_CACHE_SIZE);
+    return &cache;
+#else
+    return NULL;
+#endif
+}
+
+void TLSSessionCache::set_kvstore(KVStore *kvstore, const char *prefix)
+{
+    set_kvstore(kvstore, prefix, KVStore::REQUIRE_CONFIDENTIALITY_FLAG);
+}
+
+void TLSSessionCache::set_kvstore(KVStore *kvstore, const char *prefix, uint32_t create_flags)
+{
+    _mutex.lock();
+
+    delete[] _prefix;
+    _prefix = NULL;
+    _kvstore = NULL;
+
+    if (kvstore && prefix) {
+        _prefix = new (std::nothrow) char[strlen(prefix) + 1];
+        if (_prefix) {
+            strcpy(_prefix, prefix);
+            _kvstore = kvstore;
+            _create_flags = create_flags;
+        }
+    }
+
+    _mutex.unlock();
+}
+
+nsapi_error_t TLSSessionCache::store(const char *hostname, const mbedtls_ssl_context *ssl)
+{
+    if (!hostname || !ssl) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    int ret = mbedtls_ssl_get_session(ssl, &session);
+    if (ret != 0) {
+        mbedtls_ssl_session_free(&session);
+        return ret == MBEDTLS_ERR_SSL_ALLOC_FAILED ? NSAPI_ERROR_NO_MEMORY : NSAPI_ERROR_PARAMETER;
+    }
+
+    size_t size = session_save(&session, NULL, 0);
+    unsigned char *data = new (std::nothrow) unsigned char[size];
+    if (data) {
+        session_save(&session, data, size);
+    }
+    mbedtls_ssl_session_free(&session);
+
+    if (!data) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+
+    _mutex.lock();
+
+    // Avoids rewriting the KVStore when the host resumed the session without changing it
+    entry_t *entry = find(hostname);
+    bool changed = !entry || entry->size != size || memcmp(entry->data, data, size) != 0;
+
+    char key[KVStore::MAX_KEY_SIZE + 1];
+    if (changed && make_key(key, hostname)) {
+        ret = _kvstore->set(key, data, size, _create_flags);
+        if (ret) {
+            tr_warn("Failed to write TLS session of %s to KVStore: %d", hostname, ret);
+        }
+    }
+
+    insert(hostname, data, size);
+
+    _mutex.unlock();
+    return NSAPI_ERROR_OK;
+}
+
+bool TLSSessionCache::load(const char *hostname, mbedtls_ssl_context *ssl)
+{
+    if (!hostname || !ssl) {
+        return false;
+    }
+
+    _mutex.lock();
+
+    const unsigned char *data = NULL;
+    unsigned char *read_data = NULL;
+    size_t size = 0;
+
+    entry_t *entry = find(hostname);
+    if (entry) {
+        entry->accessed = ++_clock;
+        data = entry->data;
+        size = entry->size;
+    } else {
+        read_data = read_kvstore(hostname, &size);
+        data = read_data;
+    }
+
+    bool loaded = false;
+    if (data) {
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+
+        int ret = session_load(&session, data, size);
+        if (ret == 0) {
+            ret = mbedtls_ssl_set_session(ssl, &session);
+            loaded = (ret == 0);
+        } else if (ret == MBEDTLS_ERR_SSL_BAD_INPUT_DATA) {
+            tr_warn("Dropping invalid TLS session of %s", hostname);
+            remove_entry(hostname);
+        }
+        mbedtls_ssl_session_free(&session);
+
+        if (read_data) {
+            if (loaded) {
+                insert(hostname, read_data, size);
+            } else {
+                session_data_free(read_data, size);
+            }
+        }
+    }
+
+    _mutex.unlock();
+    return loaded;
+}
+
+void TLSSessionCache::remove(const char *hostname)
+{
+    if (!hostname) {
+        return;
+    }
+
+    _mutex.lock();
+    remove_entry(hostname);
+    _mutex.unlock();
+}
+
+void TLSSessionCache::clear()
+{
+    _mutex.lock();
+    for (unsigned i = 0; i < _size; i++) {
+        free_entry(&_entries[i]);
+    }
+    _mutex.unlock();
+}
+
+TLSSessionCache::entry_t *TLSSessionCache::find(const char *hostname)
+{
+    for (unsigned i = 0; i < _size; i++) {
+        if (_entries[i].host && strcmp(_entries[i].host, hostname) == 0) {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+void TLSSessionCache::free_entry(entry_t *entry)
+{
+    if (entry->data) {
+        session_data_free(entry->data, entry->size);
+    }
+    delete[] entry->host;
+    memset(entry, 0, sizeof(entry_t));
+}
+
+TLSSessionCache::entry_t *TLSSessionCache::insert(const char *hostname, unsigned char *data, size_t size)
+{
+    entry_t *entry = find(hostname);
+
+    if (entry) {
+        session_data_free(entry->data, entry->size);
+    } else {
+        // Finds free or least recently used entry
+        for (unsigned i = 0; i < _size; i++) {
+            if (!_entries[i].host) {
+                entry = &_entries[i];
+                break;
+            } else if (!entry || _entries[i].accessed < entry->accessed) {
+                entry = &_entries[i];
+            }
+        }
+
+        if (entry) {
+            free_entry(entry);
+            entry->host = new (std::nothrow) char[strlen(hostname) + 1];
+        }
+        if (!entry || !entry->host) {
+            session_data_free(data, size);
+            return NULL;
+        }
+        strcpy(entry->host, hostname);
+    }
+
+    entry->data = data;
+    entry->size = size;
+    entry->accessed = ++_clock;
+    return entry;
+}
+
+void TLSSessionCache::remove_entry(const char *hostname)
+{
+    entry_t *entry = find(hostname);
+    if (entry) {
+        free_entry(entry);
+    }
+
+    char key[KVStore::MAX_KEY_SIZE + 1];
+    if (make_key(key, hostname)) {
+        _kvstore->remove(key);
+    }
+}
+
+unsigned char *TLSSessionCache::read_kvstore(const char *hostname, size_t *size)
+{
+    char key[KVStore::MAX_KEY_SIZE + 1];
+    if (!make_key(key, hostname)) {
+        return NULL;
+    }
+
+    KVStore::info_t info;
+    if (_kvstore->get_info(key, &info) != 0 || info.size < session_fixed_size) {
+        return NULL;
+    }
+
+    unsigned char *data = new (std::nothrow) unsigned char[info.size];
+    if (!data) {
+        return NULL;
+    }
+
+    size_t actual_size = 0;
+    if (_kvstore->get(key, data, info.size, &actual_size) != 0 || actual_size != info.size) {
+        session_data_free(data, info.size);
+        return NULL;
+    }
+
+    *size = actual_size;
+    return data;
+}
+
+bool TLSSessionCache::make_key(char *key, const char *hostname) const
+{
+    if (!_kvstore) {
+        return false;
+    }
+
+    size_t prefix_len = strlen(_prefix);
+    size_t hostname_len = strlen(hostname);
+    if (prefix_len + hostname_len > KVStore::MAX_KEY_SIZE) {
+        return false;
+    }
+
+    memcpy(key, _prefix, prefix_len);
+    memcpy(key + prefix_len, hostname, hostname_len + 1);
+    return _kvstore->is_valid_key(key);
+}
+
+size_t TLSSessionCache::session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t size)
+{
+    size_t needed = session_fixed_size;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    needed += session->ticket_len;
+#endif
+
+    if (!buf || size < needed) {
+        return needed;
+    }
+
+    unsigned char *p = buf;
+    session_append_byte(&p, SESSION_FORMAT_VERSION);
+    session_append_byte(&p, session_options);
+#if defined(MBEDTLS_HAVE_TIME)
+    uint64_t start = (uint64_t) session->start;
+    session_append_word32(&p, start >> 32);
+    session_append_word32(&p, start);
+#endif
+    session_append_word32(&p, session->ciphersuite);
+    session_append_word32(&p, session->compression);
+    session_append_byte(&p, session->id_len);
+    session_append_data(&p, session->id, sizeof(session->id));
+    session_append_data(&p, session->master, sizeof(session->master));
+    session_append_word32(&p, session->verify_result);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session_append_word32(&p, session->ticket_lifetime);
+    session_append_byte(&p, session->ticket_len >> 8);
+    session_append_byte(&p, session->ticket_len);
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session_append_byte(&p, session->mfl_code);
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    session_append_byte(&p, session->trunc_hmac);
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    session_append_byte(&p, session->encrypt_then_mac);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (session->ticket_len) {
+        session_append_data(&p, session->ticket, session->ticket_len);
+    }
+#endif
+
+    return needed;
+}
+
+int TLSSessionCache::session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t size)
+{
+    const unsigned char *p = buf;
+
+    if (size < session_fixed_size ||
+            session_scan_byte(&p) != SESSION_FORMAT_VERSION ||
+            session_scan_byte(&p) != session_options) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    uint64_t start = (uint64_t) session_scan_word32(&p) << 32;
+    start |= session_scan_word32(&p);
+    session->start = (mbedtls_time_t) start;
+#endif
+    session->ciphersuite = (int) session_scan_word32(&p);
+    session->compression = (int) session_scan_word32(&p);
+    session->id_len = session_scan_byte(&p);
+    session_scan_data(&p, session->id, sizeof(session->id));
+    session_scan_data(&p, session->master, sizeof(session->master));
+    session->verify_result = session_scan_word32(&p);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session->ticket_lifetime = session_scan_word32(&p);
+    size_t ticket_len = (size_t) session_scan_byte(&p) << 8;
+    ticket_len |= session_scan_byte(&p);
+#else
+    size_t ticket_len = 0;
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    session->mfl_code = session_scan_byte(&p);
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+    session->trunc_hmac = session_scan_byte(&p);
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+    session->encrypt_then_mac = session_scan_byte(&p);
+#endif
+
+    if (session->id_len > sizeof(session->id) || size != session_fixed_size + ticket_len) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if (ticket_len) {
+        session->ticket = static_cast<unsigned char *>(mbedtls_calloc(1, ticket_len));
+        if (!session->ticket) {
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        session_scan_data(&p, session->ticket, ticket_len);
+        session->ticket_len = ticket_len;
+    }
+#endif
+
+    return 0;
+}
+
+#endif /* MBEDTLS_SSL_CLI_C */
@@ -0,0 +1,159 @@
+/* TLSSessionCache
+ * Copyright (c) 2019 ARM Limited
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file TLSSessionCache.h Client side cache of TLS sessions */
+/** @addtogroup netsocket
+ * @{
+ */
+
+#ifndef TLSSESSIONCACHE_H
+#define TLSSESSIONCACHE_H
+
+#include "netsocket/nsapi_types.h"
+#include "platform/PlatformMutex.h"
+#include "platform/NonCopyable.h"
+#include "mbedtls/ssl.h"
+
+// This class requires Mbed TLS SSL/TLS client code
+#if defined(MBEDTLS_SSL_CLI_C) || defined(DOXYGEN_ONLY)
+
+namespace mbed {
+class KVStore;
+}
+
+/** Client side cache of TLS sessions, keyed by hostname
+ *
+ *  A session stored after a handshake with a host is offered to the host on the
+ *  next handshake, with its session ticket if the host issued one. If the host
+ *  accepts it, the handshake is abbreviated: no certificate exchange, no key
+ *  exchange and one round trip less. If the host does not, Mbed TLS falls back
+ *  to a full handshake, and the new session replaces the stored one.
+ *
+ *  TLSSocketWrapper uses a cache only when given one with set_session_cache().
+ *  Sessions are keyed by hostname only, and a resumed session keeps the
+ *  certificate verification result of the full handshake, so a cache should
+ *  only be shared by sockets using the same CA certificates and the same own
+ *  certificate. Entries are kept in RAM, the least recently used one being
+ *  replaced when the cache is full. The peer certificate is not kept, to save RAM, so
+ *  mbedtls_ssl_get_peer_cert() returns NULL after a resumed handshake.
+ *
+ *  Sessions can also be written to a KVStore, so that they survive a reboot. As a
+ *  session holds the master secret of its connections, the store should provide
+ *  confidentiality, as SecureStore does.
+ */
+class TLSSessionCache : private mbed::NonCopyable<TLSSessionCache> {
+public:
+    /** Create an empty cache
+     *
+     *  @param size     Maximum number of sessions kept in RAM
+     */
+    TLSSessionCache(unsigned size);
+
+    /** Destroy the cache, wiping the sessions kept in RAM
+     */
+    ~TLSSessionCache();
+
+    /** Get a cache shared by the application
+     *
+     *  Its size is set by the nsapi.tls-session-cache-size configuration option.
+     *  It is not used unless passed to TLSSocketWrapper::set_session_cache().
+     *
+     *  @return         Default cache, or NULL if the option is 0
+     */
+    static TLSSessionCache *get_default_instance();
+
+    /** Persist sessions to a KVStore
+     *
+     *  Sessions are written to the store under the prefix followed by the hostname,
+     *  with KVStore::REQUIRE_CONFIDENTIALITY_FLAG, and read back from it when they
+     *  are not in RAM. Hostnames making an invalid key are kept in RAM only.
+     *
+     *  @param kvstore      Initialized store, or NULL to keep sessions in RAM only
+     *  @param prefix       Prefix of the keys, of less than KVStore::MAX_KEY_SIZE characters
+     */
+    void set_kvstore(mbed::KVStore *kvstore, const char *prefix = "tls_");
+
+    /** Persist sessions to a KVStore, with the given flags
+     *
+     *  @param kvstore      Initialized store, or NULL to keep sessions in RAM only
+     *  @param prefix       Prefix of the keys, of less than KVStore::MAX_KEY_SIZE characters
+     *  @param create_flags Flags the sessions are written with
+     */
+    void set_kvstore(mbed::KVStore *kvstore, const char *prefix, uint32_t create_flags);
+
+    /** Store the session of a completed handshake
+     *
+     *  @param hostname Hostname of the remote host
+     *  @param ssl      SSL context which completed a handshake
+     *  @return         0 on success, NSAPI_ERROR_PARAMETER if the context has no
+     *                  session, NSAPI_ERROR_NO_MEMORY if out of memory
+     */
+    nsapi_error_t store(const char *hostname, const mbedtls_ssl_context *ssl);
+
+    /** Offer the stored session of a host on the next handshake
+     *
+     *  @param hostname Hostname of the remote host
+     *  @param ssl      SSL context set up with mbedtls_ssl_setup(), before the handshake
+     *  @return         True if a session was set in the context
+     */
+    bool load(const char *hostname, mbedtls_ssl_context *ssl);
+
+    /** Forget the session of a host, in RAM and in the KVStore
+     *
+     *  @param hostname Hostname of the remote host
+     */
+    void remove(const char *hostname);
+
+    /** Forget all the sessions kept in RAM
+     *
+     *  Sessions in the KVStore are left, as the store may hold other keys under the prefix.
+     */
+    void clear();
+
+private:
+    struct entry_t {
+        char *host;
+        unsigned char *data;
+        size_t size;
+        uint32_t accessed;
+    };
+
+    entry_t *find(const char *hostname);
+    void free_entry(entry_t *entry);
+    entry_t *insert(const char *hostname, unsigned char *data, size_t size);
+    void remove_entry(const char *hostname);
+    unsigned char *read_kvstore(const char *hostname, size_t *size);
+    bool make_key(char *key, const char *hostname) const;
+
+    static size_t session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t size);
+    static int session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t size);
+
+    PlatformMutex _mutex;
+    entry_t *_entries;
+    unsigned _size;
+    uint32_t _clock;
+
+    mbed::KVStore *_kvstore;
+    char *_prefix;
+    uint32_t _create_flags;
+};
+
+#endif /* MBEDTLS_SSL_CLI_C */
+
+#endif
+
+/** @}*/
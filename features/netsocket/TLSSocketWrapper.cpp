@@ -37,6 +37,7 @@ TLSSocketWrapper::TLSSocketWrapper(Socket *transport, const char *hostname, cont
     _clicert(NULL),
 #endif
     _ssl_conf(NULL),
+    _session_cache(NULL),
     _connect_transport(control == TRANSPORT_CONNECT || control == TRANSPORT_CONNECT_AND_CLOSE),
     _close_transport(control == TRANSPORT_CLOSE || control == TRANSPORT_CONNECT_AND_CLOSE),
     _tls_initialized(false),
@@ -189,6 +190,12 @@ nsapi_error_t TLSSocketWrapper::start_handshake(bool first_call)
         return NSAPI_ERROR_PARAMETER;
     }
 
+#ifdef MBEDTLS_X509_CRT_PARSE_C
+    if (_session_cache && _ssl.hostname && _session_cache->load(_ssl.hostname, &_ssl)) {
+        tr_info("Resuming TLS session with %s", _ssl.hostname);
+    }
+#endif
+
     _transport->set_blocking(false);
     _transport->sigio(mbed::callback(this, &TLSSocketWrapper::event));
     mbedtls_ssl_set_bio(&_ssl, this, ssl_send, ssl_recv, NULL);
@@ -237,6 +244,12 @@ nsapi_error_t TLSSocketWrapper::continue_handshake()
         if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
             return NSAPI_ERROR_ALREADY;
         } else {
+#ifdef MBEDTLS_X509_CRT_PARSE_C
+            // Do not offer the session again, in case the host chokes on it
+            if (_session_cache && _ssl.hostname) {
+                _session_cache->remove(_ssl.hostname);
+            }
+#endif
             return NSAPI_ERROR_AUTH_FAILURE;
         }
     }
@@ -266,6 +279,11 @@ nsapi_error_t TLSSocketWrapper::continue_handshake()
         tr_info("Certificate verification passed");
     }
     delete[] buf;
+
+    /* Only sessions with a verified host are resumed */
+    if (_session_cache && _ssl.hostname && flags == 0) {
+        _session_cache->store(_ssl.hostname, &_ssl);
+    }
 #endif
 
     _handshake_completed = true;
@@ -562,6 +580,11 @@ void TLSSocketWrapper::set_ssl_config(mbedtls_ssl_config *conf)
     _ssl_conf = conf;
 }
 
+void TLSSocketWrapper::set_session_cache(TLSSessionCache *cache)
+{
+    _session_cache = cache;
+}
+
 mbedtls_ssl_context *TLSSocketWrapper::get_ssl_context()
 {
     return &_ssl;
@@ -19,6 +19,7 @@
 #define _MBED_HTTPS_TLS_SOCKET_WRAPPER_H_
 
 #include "netsocket/Socket.h"
+#include "netsocket/TLSSessionCache.h"
 #include "rtos/EventFlags.h"
 #include "platform/Callback.h"
 #include "mbedtls/platform.h"
@@ -168,6 +169,21 @@ public:
      */
     void set_ssl_config(mbedtls_ssl_config *conf);
 
+    /** Set the cache of TLS sessions.
+     *
+     * After a handshake with a verified host, its session is stored in the cache,
+     * keyed by the hostname. The next handshake with the same hostname offers the
+     * session to the host, with its session ticket if the host issued one, for an
+     * abbreviated handshake. If the host refuses it, a full handshake is done.
+     *
+     * No cache is used by default. As a resumed session skips the certificate
+     * exchange, a cache should only be shared by sockets using the same CA
+     * certificates and the same own certificate.
+     *
+     * @param cache Cache of TLS sessions, or NULL to always do a full handshake.
+     */
+    void set_session_cache(TLSSessionCache *cache);
+
     /** Get internal Mbed TLS contect structure.
      * @return SSL context
      */
@@ -248,6 +264,7 @@ private:
     mbedtls_x509_crt *_clicert;
 #endif
     mbedtls_ssl_config *_ssl_conf;
+    TLSSessionCache *_session_cache;
 
     bool _connect_transport: 1;
     bool _close_transport: 1;
@@ -15,8 +15,10 @@
  */
 
 #include "UDPSocket.h"
+#include "NetStackMemoryManager.h"
 #include "Timer.h"
 #include "mbed_assert.h"
+#include <algorithm>
 
 UDPSocket::UDPSocket()
 {
@@ -55,6 +57,17 @@ nsapi_size_or_error_t UDPSocket::sendto(const char *host, uint16_t port, const v
 }
 
 nsapi_size_or_error_t UDPSocket::sendto(const SocketAddress &address, const void *data, nsapi_size_t size)
+{
+    return sendto_internal(address, data, NULL, size);
+}
+
+nsapi_size_or_error_t UDPSocket::sendto_buf(const SocketAddress &address, net_stack_mem_buf_t *buf)
+{
+    return sendto_internal(address, NULL, buf, 0);
+}
+
+nsapi_size_or_error_t UDPSocket::sendto_internal(const SocketAddress &address, const void *data,
+                                                 net_stack_mem_buf_t *buf, nsapi_size_t size)
 {
     _lock.lock();
     nsapi_size_or_error_t ret;
@@ -71,7 +84,12 @@ nsapi_size_or_error_t UDPSocket::sendto(const SocketAddress &address, const void
         }
 
         _pending = 0;
-        nsapi_size_or_error_t sent = _stack->socket_sendto(_socket, address, data, size);
+        nsapi_size_or_error_t sent;
+        if (buf) {
+            sent = _stack->socket_sendto_buf(_socket, address, buf);
+        } else {
+            sent = _stack->socket_sendto(_socket, address, data, size);
+        }
         if ((0 == _timeout) || (NSAPI_ERROR_WOULD_BLOCK != sent)) {
             _socket_stats.stats_update_sent_bytes(this, sent);
             ret = sent;
@@ -109,7 +127,27 @@ nsapi_size_or_error_t UDPSocket::send(const void *data, nsapi_size_t size)
     return sendto(_remote_peer, data, size);
 }
 
+nsapi_size_or_error_t UDPSocket::send_buf(net_stack_mem_buf_t *buf)
+{
+    if (!_remote_peer) {
+        return NSAPI_ERROR_NO_ADDRESS;
+    }
+    return sendto_buf(_remote_peer, buf);
+}
+
 nsapi_size_or_error_t UDPSocket::recvfrom(SocketAddress *address, void *buffer, nsapi_size_t size)
+{
+    return recvfrom_internal(address, buffer, NULL, size);
+}
+
+nsapi_size_or_error_t UDPSocket::recvfrom_buf(SocketAddress *address, net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    *buf = NULL;
+    return recvfrom_internal(address, NULL, buf, size);
+}
+
+nsapi_size_or_error_t UDPSocket::recvfrom_internal(SocketAddress *address, void *buffer,
+                                                   net_stack_mem_buf_t **buf, nsapi_size_t size)
 {
     _lock.lock();
     nsapi_size_or_error_t ret;
@@ -131,10 +169,19 @@ nsapi_size_or_error_t UDPSocket::recvfrom(SocketAddress *address, void *buffer,
         }
 
         _pending = 0;
-        nsapi_size_or_error_t recv = _stack->socket_recvfrom(_socket, address, buffer, size);
+        nsapi_size_or_error_t recv;
+        if (buf) {
+            recv = _stack->socket_recvfrom_buf(_socket, address, buf, size);
+        } else {
+            recv = _stack->socket_recvfrom(_socket, address, buffer, size);
+        }
 
         // Filter incomming packets using connected peer address
         if (recv >= 0 && _remote_peer && _remote_peer != *address) {
+            if (buf && *buf) {
+                _stack->get_memory_manager()->free(*buf);
+                *buf = NULL;
+            }
             continue;
         }
 
@@ -175,6 +222,158 @@ nsapi_size_or_error_t UDPSocket::recv(void *buffer, nsapi_size_t size)
     return recvfrom(NULL, buffer, size);
 }
 
+nsapi_size_or_error_t UDPSocket::recv_buf(net_stack_mem_buf_t **buf, nsapi_size_t size)
+{
+    return recvfrom_buf(NULL, buf, size);
+}
+
+nsapi_size_or_error_t UDPSocket::sendto_batch(nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    if (!count) {
+        return 0;
+    }
+
+    _lock.lock();
+    nsapi_size_or_error_t ret;
+    nsapi_size_t sent = 0;
+    nsapi_size_t sent_bytes = 0;
+
+    _writers++;
+    if (_socket) {
+        _socket_stats.stats_update_socket_state(this, SOCK_OPEN);
+        _socket_stats.stats_update_peer(this, datagrams[0].address);
+    }
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+
+        _pending = 0;
+        ret = _stack->socket_sendto_batch(_socket, datagrams + sent, count - sent);
+        if (ret > 0) {
+            for (nsapi_size_t i = sent; i < sent + ret; i++) {
+                sent_bytes += datagrams[i].size;
+            }
+            sent += ret;
+            if (sent == count) {
+                break;
+            }
+            // Try the rest of the batch, the stack stopped on a datagram which may fail
+            continue;
+        }
+
+        if ((0 == _timeout) || (NSAPI_ERROR_WOULD_BLOCK != ret)) {
+            break;
+        } else {
+            uint32_t flag;
+
+            // Release lock before blocking so other threads
+            // accessing this object aren't blocked
+            _lock.unlock();
+            flag = _event_flag.wait_any(WRITE_FLAG, _timeout);
+            _lock.lock();
+
+            if (flag & osFlagsError) {
+                // Timeout break
+                ret = NSAPI_ERROR_WOULD_BLOCK;
+                break;
+            }
+        }
+    }
+    _socket_stats.stats_update_sent_bytes(this, sent_bytes);
+
+    _writers--;
+    if (!_socket || !_writers) {
+        _event_flag.set(FINISHED_FLAG);
+    }
+    _lock.unlock();
+    return sent ? sent : ret;
+}
+
+nsapi_size_or_error_t UDPSocket::recvfrom_batch(nsapi_datagram_t *datagrams, nsapi_size_t count)
+{
+    if (!count) {
+        return 0;
+    }
+
+    _lock.lock();
+    nsapi_size_or_error_t ret;
+    nsapi_size_t received = 0;
+    nsapi_size_t recv_bytes = 0;
+
+    _readers++;
+
+    if (_socket) {
+        _socket_stats.stats_update_socket_state(this, SOCK_OPEN);
+    }
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+
+        _pending = 0;
+        ret = _stack->socket_recvfrom_batch(_socket, datagrams + received, count - received);
+        if (ret > 0) {
+            // Filter incomming packets using connected peer address, keeping
+            // the accepted ones at the front of the batch
+            nsapi_size_t end = received + ret;
+            bool dropped = false;
+            for (nsapi_size_t i = received; i < end; i++) {
+                if (_remote_peer && _remote_peer != datagrams[i].address) {
+                    dropped = true;
+                    continue;
+                }
+                if (i != received) {
+                    std::swap(datagrams[received], datagrams[i]);
+                }
+                recv_bytes += datagrams[received].size;
+                received++;
+            }
+
+            // Look for more datagrams in the place of the dropped ones
+            if (received == count || !dropped) {
+                break;
+            }
+            continue;
+        }
+
+        if (received) {
+            break;
+        }
+
+        // Non-blocking sockets always return. Blocking only returns when success or errors other than WOULD_BLOCK
+        if ((0 == _timeout) || (NSAPI_ERROR_WOULD_BLOCK != ret)) {
+            break;
+        } else {
+            uint32_t flag;
+
+            // Release lock before blocking so other threads
+            // accessing this object aren't blocked
+            _lock.unlock();
+            flag = _event_flag.wait_any(READ_FLAG, _timeout);
+            _lock.lock();
+
+            if (flag & osFlagsError) {
+                // Timeout break
+                ret = NSAPI_ERROR_WOULD_BLOCK;
+                break;
+            }
+        }
+    }
+    _socket_stats.stats_update_peer(this, _remote_peer);
+    _socket_stats.stats_update_recv_bytes(this, recv_bytes);
+
+    _readers--;
+    if (!_socket || !_readers) {
+        _event_flag.set(FINISHED_FLAG);
+    }
+
+    _lock.unlock();
+    return received ? received : ret;
+}
+
 Socket *UDPSocket::accept(nsapi_error_t *error)
 {
     if (error) {
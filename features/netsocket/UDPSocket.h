@@ -156,6 +156,101 @@ public:
      */
     virtual nsapi_size_or_error_t recv(void *data, nsapi_size_t size);
 
+    /** Send a datagram from a memory buffer chain to the specified remote address.
+     *
+     *  Behaves as sendto(). The chain is allocated with get_memory_manager() and is
+     *  left to the caller, who frees it. Stacks with their own network buffers send
+     *  the buffers without copying, and may reference them until the datagram is sent,
+     *  so they must not be modified after the call.
+     *
+     *  @param address  The SocketAddress of the remote host.
+     *  @param buf      Buffer chain of data to send to the host.
+     *  @return         Number of sent bytes on success, negative error
+     *                  code on failure.
+     */
+    nsapi_size_or_error_t sendto_buf(const SocketAddress &address, net_stack_mem_buf_t *buf);
+
+    /** Send a datagram from a memory buffer chain to connected remote address.
+     *
+     *  This is equivalent to calling sendto_buf() with the connected address.
+     *
+     *  @param buf      Buffer chain of data to send to the host.
+     *  @return         Number of sent bytes on success, negative error
+     *                  code on failure.
+     */
+    nsapi_size_or_error_t send_buf(net_stack_mem_buf_t *buf);
+
+    /** Receive a datagram into a memory buffer chain and store the source address
+     *  in address if it's not NULL.
+     *
+     *  Behaves as recvfrom(), but the datagram is returned in a buffer chain of the
+     *  stack, which the caller frees with get_memory_manager(). Stacks with their own
+     *  network buffers hand the received buffers over without copying, so they should
+     *  be freed promptly.
+     *
+     *  @note If the datagram is larger than size, the excess data is silently discarded.
+     *
+     *  @param address  Destination for the source address or NULL.
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received.
+     *  @param size     Maximum number of bytes to receive.
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure.
+     */
+    nsapi_size_or_error_t recvfrom_buf(SocketAddress *address, net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Receive data into a memory buffer chain.
+     *
+     *  This is equivalent to calling recvfrom_buf(NULL, buf, size).
+     *
+     *  @param buf      Destination for the received buffer chain, set to NULL
+     *                  if no data is received.
+     *  @param size     Maximum number of bytes to receive.
+     *  @return         Number of received bytes on success, negative error
+     *                  code on failure.
+     */
+    nsapi_size_or_error_t recv_buf(net_stack_mem_buf_t **buf, nsapi_size_t size);
+
+    /** Send a batch of datagrams, each to its own address.
+     *
+     *  The data of each datagram is gathered from its iov list, and the size
+     *  of each datagram sent is stored in it. The whole batch is passed to the
+     *  network stack at once, so that the socket is locked once for the batch
+     *  and the stack can send it under a single lock.
+     *
+     *  By default, sendto_batch blocks until all datagrams are sent. If socket is
+     *  set to nonblocking or times out, the number of datagrams sent so far is
+     *  returned, or NSAPI_ERROR_WOULD_BLOCK if none was sent.
+     *
+     *  @param datagrams Datagrams to send.
+     *  @param count     Number of datagrams.
+     *  @return          Number of sent datagrams on success, negative error
+     *                   code on failure of the first datagram.
+     */
+    nsapi_size_or_error_t sendto_batch(nsapi_datagram_t *datagrams, nsapi_size_t count);
+
+    /** Receive a batch of datagrams.
+     *
+     *  Each datagram is scattered to the iov list of the next entry, and its
+     *  source address and size are stored in the entry. A datagram larger than
+     *  the iov list is truncated.
+     *
+     *  By default, recvfrom_batch blocks until at least one datagram is received,
+     *  then returns all the datagrams pending, up to count. If socket is set to
+     *  nonblocking or times out with no datagram, NSAPI_ERROR_WOULD_BLOCK
+     *  is returned.
+     *
+     *  @note If socket is connected, only packets coming from connected peer address
+     *  are accepted. The other ones are dropped, and the entries are reordered so
+     *  that the received datagrams come first. Each entry keeps its own iov list.
+     *
+     *  @param datagrams Destination for the received datagrams.
+     *  @param count     Maximum number of datagrams.
+     *  @return          Number of received datagrams on success, negative error
+     *                   code on failure.
+     */
+    nsapi_size_or_error_t recvfrom_batch(nsapi_datagram_t *datagrams, nsapi_size_t count);
+
     /** Not implemented for UDP.
      *
      *  @param error      Not used.
@@ -175,6 +270,12 @@ public:
 protected:
     virtual nsapi_protocol_t get_proto();
 
+private:
+    nsapi_size_or_error_t sendto_internal(const SocketAddress &address, const void *data,
+                                          net_stack_mem_buf_t *buf, nsapi_size_t size);
+    nsapi_size_or_error_t recvfrom_internal(SocketAddress *address, void *data,
+                                            net_stack_mem_buf_t **buf, nsapi_size_t size);
+
 #endif //!defined(DOXYGEN_ONLY)
 };
 
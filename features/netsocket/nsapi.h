@@ -29,6 +29,7 @@
 // entry point for C++ api
 #include "netsocket/SocketAddress.h"
 #include "netsocket/NetworkStack.h"
+#include "netsocket/NetStackMemoryManager.h"
 
 #include "netsocket/NetworkInterface.h"
 #include "netsocket/EthInterface.h"
@@ -44,6 +45,8 @@
 #include "netsocket/DTLSSocketWrapper.h"
 #include "netsocket/TLSSocket.h"
 #include "netsocket/DTLSSocket.h"
+#include "netsocket/SocketSet.h"
+#include "netsocket/SocketFileHandle.h"
 
 #endif // __cplusplus
 
@@ -316,6 +316,15 @@ typedef struct nsapi_ip_mreq {
     nsapi_addr_t imr_interface; /* local IP address of interface */
 } nsapi_ip_mreq_t;
 
+/** nsapi_iovec structure
+ *
+ *  Buffer of a scatter/gather list
+ */
+typedef struct nsapi_iovec {
+    void *iov_base;         /* start of the buffer */
+    nsapi_size_t iov_len;   /* size of the buffer in bytes */
+} nsapi_iovec_t;
+
 /** nsapi_stack_api structure
  *
  *  Common api structure for network stack operations. A network stack
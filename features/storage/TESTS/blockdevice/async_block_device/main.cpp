@@ -0,0 +1,268 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "mbed.h"
+#include "HeapBlockDevice.h"
+#include "SlicingBlockDevice.h"
+#include "ChainingBlockDevice.h"
+#include "BufferedBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include <stdlib.h>
+
+#ifndef MBED_CONF_RTOS_PRESENT
+#error [NOT_SUPPORTED] Asynchronous block device test requires RTOS
+#endif
+
+using namespace utest::v1;
+
+static const bd_size_t block_size = 512;
+static const bd_size_t dev_size = 16 * block_size;
+static const int latency_ms = 50;
+static const int num_requests = 4;
+static const int num_split_requests = 3;
+
+// Block device completing its requests after a fixed latency, with several in flight at once
+class LatencyBlockDevice : public HeapBlockDevice {
+public:
+    LatencyBlockDevice()
+        : HeapBlockDevice(dev_size, block_size), _queue(8 * (EVENTS_EVENT_SIZE + 64))
+    {
+        _thread.start(callback(&_queue, &EventQueue::dispatch_forever));
+    }
+
+    virtual ~LatencyBlockDevice()
+    {
+        _queue.break_dispatch();
+        _thread.join();
+    }
+
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &cb)
+    {
+        return submit(buffer, addr, size, cb, &LatencyBlockDevice::do_read);
+    }
+
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &cb)
+    {
+        return submit(const_cast<void *>(buffer), addr, size, cb, &LatencyBlockDevice::do_program);
+    }
+
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &cb)
+    {
+        return submit(NULL, addr, size, cb, &LatencyBlockDevice::do_erase);
+    }
+
+private:
+    typedef int (LatencyBlockDevice::*op_t)(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    int do_read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return read(buffer, addr, size);
+    }
+
+    int do_program(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return program(buffer, addr, size);
+    }
+
+    int do_erase(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        return erase(addr, size);
+    }
+
+    void run(void *buffer, bd_addr_t addr, bd_size_t size, bd_callback_t cb, op_t op)
+    {
+        cb((this->*op)(buffer, addr, size));
+    }
+
+    int submit(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &cb, op_t op)
+    {
+        if (!_queue.call_in(latency_ms, this, &LatencyBlockDevice::run, buffer, addr, size, cb, op)) {
+            return BD_ERROR_WOULD_BLOCK;
+        }
+        return BD_ERROR_OK;
+    }
+
+    EventQueue _queue;
+    Thread _thread;
+};
+
+static Semaphore done_sem(0);
+static volatile uint32_t done_count;
+static volatile int done_err;
+
+static void done(int err)
+{
+    if (err) {
+        done_err = err;
+    }
+    core_util_atomic_incr_u32((uint32_t *)&done_count, 1);
+    done_sem.release();
+}
+
+static void reset_done()
+{
+    done_count = 0;
+    done_err = 0;
+}
+
+static void wait_done(uint32_t count)
+{
+    while (done_count < count) {
+        TEST_ASSERT_TRUE(done_sem.wait(5000) > 0);
+    }
+    TEST_ASSERT_EQUAL(count, done_count);
+    TEST_ASSERT_EQUAL(0, done_err);
+}
+
+// Erase, program and read back the whole device with several requests in flight,
+// returns the time taken in ms
+static int run_requests(BlockDevice *bd, uint8_t *write_buf, uint8_t *read_buf, int count)
+{
+    bd_size_t chunk = bd->size() / count;
+    Timer timer;
+    timer.start();
+
+    for (int i = 0; i < (int)bd->size(); i++) {
+        write_buf[i] = rand() & 0xff;
+    }
+    memset(read_buf, 0, bd->size());
+
+    reset_done();
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(0, bd->erase_async(i * chunk, chunk, callback(done)));
+    }
+    wait_done(count);
+
+    reset_done();
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(0, bd->program_async(write_buf + i * chunk, i * chunk, chunk, callback(done)));
+    }
+    wait_done(count);
+
+    reset_done();
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(0, bd->read_async(read_buf + i * chunk, i * chunk, chunk, callback(done)));
+    }
+    wait_done(count);
+
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf, read_buf, bd->size());
+    return timer.read_ms();
+}
+
+void test_default_async()
+{
+    HeapBlockDevice heap(dev_size, block_size);
+    uint8_t *write_buf = new (std::nothrow) uint8_t[dev_size];
+    uint8_t *read_buf = new (std::nothrow) uint8_t[dev_size];
+    TEST_SKIP_UNLESS_MESSAGE(write_buf && read_buf, "Not enough memory for test");
+
+    TEST_ASSERT_EQUAL(0, heap.init());
+    run_requests(&heap, write_buf, read_buf, num_requests);
+
+    // Data written asynchronously is visible to the synchronous API
+    memset(read_buf, 0, dev_size);
+    TEST_ASSERT_EQUAL(0, heap.read(read_buf, 0, dev_size));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf, read_buf, dev_size);
+    TEST_ASSERT_EQUAL(0, heap.deinit());
+
+    delete[] write_buf;
+    delete[] read_buf;
+}
+
+void test_native_async()
+{
+    LatencyBlockDevice lat;
+    uint8_t *write_buf = new (std::nothrow) uint8_t[dev_size];
+    uint8_t *read_buf = new (std::nothrow) uint8_t[dev_size];
+    TEST_SKIP_UNLESS_MESSAGE(write_buf && read_buf, "Not enough memory for test");
+
+    TEST_ASSERT_EQUAL(0, lat.init());
+    int elapsed = run_requests(&lat, write_buf, read_buf, num_requests);
+    printf("%d requests of each kind in %d ms, latency %d ms\n", num_requests, elapsed, latency_ms);
+    TEST_ASSERT_TRUE(elapsed < 3 * latency_ms * num_requests / 2);
+    TEST_ASSERT_EQUAL(0, lat.deinit());
+
+    delete[] write_buf;
+    delete[] read_buf;
+}
+
+void test_adapters_async()
+{
+    LatencyBlockDevice lat1, lat2;
+    BlockDevice *bds[] = {&lat1, &lat2};
+    ChainingBlockDevice chain(bds);
+    SlicingBlockDevice slice(&chain, block_size, -(bd_addr_t)block_size);
+    ProfilingBlockDevice prof(&slice);
+    BufferedBlockDevice buffered(&prof);
+
+    bd_size_t size = 2 * dev_size - 2 * block_size;
+    uint8_t *write_buf = new (std::nothrow) uint8_t[size];
+    uint8_t *read_buf = new (std::nothrow) uint8_t[size];
+    TEST_SKIP_UNLESS_MESSAGE(write_buf && read_buf, "Not enough memory for test");
+
+    TEST_ASSERT_EQUAL(0, buffered.init());
+    TEST_ASSERT_EQUAL(size, buffered.size());
+
+    // The middle request spans both chained devices
+    int elapsed = run_requests(&buffered, write_buf, read_buf, num_split_requests);
+    printf("%d requests of each kind in %d ms, latency %d ms\n", num_split_requests, elapsed, latency_ms);
+    TEST_ASSERT_TRUE(elapsed < 3 * latency_ms * num_split_requests / 2);
+    TEST_ASSERT_EQUAL(size, prof.get_read_count());
+    TEST_ASSERT_EQUAL(size, prof.get_program_count());
+    TEST_ASSERT_EQUAL(size, prof.get_erase_count());
+
+    // Latency of asynchronous requests is measured up to their completion
+    int min_bucket = 0;
+    for (uint32_t us = latency_ms * 1000 / 2; us > 1; us >>= 1) {
+        min_bucket++;
+    }
+    uint32_t slow_reads = 0;
+    for (int bucket = min_bucket; bucket < ProfilingBlockDevice::histogram_buckets; bucket++) {
+        slow_reads += prof.get_latency_histogram(ProfilingBlockDevice::OP_READ, bucket);
+    }
+    TEST_ASSERT_TRUE(slow_reads > 0);
+
+    memset(read_buf, 0, size);
+    TEST_ASSERT_EQUAL(0, lat2.read(read_buf, 0, dev_size - block_size));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(write_buf + dev_size - block_size, read_buf, dev_size - block_size);
+    TEST_ASSERT_EQUAL(0, buffered.deinit());
+
+    delete[] write_buf;
+    delete[] read_buf;
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("Async block device default implementation", test_default_async),
+    Case("Async block device native implementation", test_native_async),
+    Case("Async block device adapters pass-through", test_adapters_async),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
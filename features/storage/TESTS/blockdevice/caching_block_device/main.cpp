@@ -0,0 +1,174 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "CachingBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace utest::v1;
+
+static const bd_size_t heap_erase_size = 512;
+static const bd_size_t num_blocks = 4;
+static const bd_size_t dev_size = num_blocks * heap_erase_size;
+
+typedef struct {
+    bd_size_t read_size;
+    bd_size_t prog_size;
+    uint32_t line_count;
+    uint32_t ways;
+} geometry_t;
+
+static const int num_tests = 4;
+
+geometry_t geometries[num_tests] = {
+    {1, 1, 1, 1},
+    {1, 128, 4, 2},
+    {4, 64, 8, 8},
+    {16, 128, 6, 1},
+};
+
+void functionality_test()
+{
+    for (int i = 0; i < num_tests; i++) {
+        geometry_t &geo = geometries[i];
+
+        printf("Testing read size of %lld, prog size of %lld, %d lines, %d ways\n",
+               geo.read_size, geo.prog_size, (int)geo.line_count, (int)geo.ways);
+
+        uint8_t *model = new (std::nothrow) uint8_t[dev_size];
+        TEST_SKIP_UNLESS_MESSAGE(model, "Not enough memory for test");
+        uint8_t *buf = new (std::nothrow) uint8_t[heap_erase_size];
+        TEST_SKIP_UNLESS_MESSAGE(buf, "Not enough memory for test");
+
+        HeapBlockDevice heap_bd(dev_size, geo.read_size, geo.prog_size, heap_erase_size);
+        CachingBlockDevice bd(&heap_bd, geo.line_count, geo.ways);
+
+        int err = bd.init();
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL(1, bd.get_read_size());
+        TEST_ASSERT_EQUAL(1, bd.get_program_size());
+        TEST_ASSERT_EQUAL(heap_erase_size, bd.get_erase_size());
+
+        err = bd.erase(0, dev_size);
+        TEST_ASSERT_EQUAL(0, err);
+        memset(model, 0, dev_size);
+        err = bd.program(model, 0, dev_size);
+        TEST_ASSERT_EQUAL(0, err);
+
+        // Random small accesses, checked against a model of the device contents
+        for (int j = 0; j < 500; j++) {
+            bd_addr_t addr = rand() % dev_size;
+            bd_size_t size = 1 + rand() % std::min(heap_erase_size, dev_size - addr);
+
+            switch (rand() % 4) {
+                case 0:
+                case 1:
+                    err = bd.read(buf, addr, size);
+                    TEST_ASSERT_EQUAL(0, err);
+                    TEST_ASSERT_EQUAL_UINT8_ARRAY(model + addr, buf, size);
+                    break;
+                case 2:
+                    for (bd_size_t k = 0; k < size; k++) {
+                        buf[k] = rand() & 0xff;
+                    }
+                    err = bd.program(buf, addr, size);
+                    TEST_ASSERT_EQUAL(0, err);
+                    memcpy(model + addr, buf, size);
+                    break;
+                default:
+                    err = bd.sync();
+                    TEST_ASSERT_EQUAL(0, err);
+                    break;
+            }
+        }
+
+        // All programmed data reaches the underlying device on sync
+        err = bd.sync();
+        TEST_ASSERT_EQUAL(0, err);
+        for (bd_addr_t addr = 0; addr < dev_size; addr += heap_erase_size) {
+            err = heap_bd.read(buf, addr, heap_erase_size);
+            TEST_ASSERT_EQUAL(0, err);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(model + addr, buf, heap_erase_size);
+        }
+
+        err = bd.deinit();
+        TEST_ASSERT_EQUAL(0, err);
+
+        delete[] model;
+        delete[] buf;
+    }
+}
+
+void stats_test()
+{
+    const bd_size_t prog_size = 64;
+    HeapBlockDevice heap_bd(dev_size, 1, prog_size, heap_erase_size);
+    CachingBlockDevice bd(&heap_bd, 4, 2);
+    uint8_t buf[8] = {0};
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Repeated accesses to the same line miss once
+    for (int i = 0; i < 10; i++) {
+        err = bd.read(buf, 8, sizeof(buf));
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    TEST_ASSERT_EQUAL(1, bd.get_miss_count());
+    TEST_ASSERT_EQUAL(9, bd.get_hit_count());
+    TEST_ASSERT_EQUAL(0, bd.get_evict_count());
+
+    // Lines 0, 2 and 4 share a set of 2 ways, line 0 being the least recently used
+    bd.reset_stats();
+    err = bd.read(buf, 2 * prog_size, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, err);
+    err = bd.read(buf, 4 * prog_size, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(1, bd.get_evict_count());
+    err = bd.read(buf, 2 * prog_size, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(1, bd.get_hit_count());
+    err = bd.read(buf, 0, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(3, bd.get_miss_count());
+    TEST_ASSERT_EQUAL(2, bd.get_evict_count());
+
+    err = bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(30, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("CachingBlockDevice functionality test", functionality_test),
+    Case("CachingBlockDevice statistics test", stats_test),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
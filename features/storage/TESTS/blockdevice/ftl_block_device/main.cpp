@@ -0,0 +1,168 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "FTLBlockDevice.h"
+#include "HeapBlockDevice.h"
+#include "FlashSimBlockDevice.h"
+#include "ExhaustibleBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace utest::v1;
+
+static const bd_size_t unit_size = 4096;
+static const bd_size_t num_units = 8;
+static const bd_size_t sector_size = 512;
+static const uint32_t spare_units = 1;
+static const uint32_t wear_threshold = 4;
+
+static void fill_sector(uint8_t *buf, uint32_t lba, uint32_t version)
+{
+    for (bd_size_t i = 0; i < sector_size; i++) {
+        buf[i] = (uint8_t)(lba * 7 + version * 13 + i);
+    }
+}
+
+// Rewrites sectors, mostly a few hot ones, checking their contents across remounts
+void functionality_test()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_units * unit_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_units * unit_size, 1, 1, unit_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    uint8_t buf[sector_size], read_buf[sector_size];
+
+    FTLBlockDevice *bd = new FTLBlockDevice(&flash_bd, sector_size, spare_units, wear_threshold);
+    int err = bd->init();
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(sector_size, bd->get_erase_size());
+
+    uint32_t num_sectors = bd->size() / sector_size;
+    TEST_ASSERT_TRUE(num_sectors > 0);
+    uint32_t *versions = new uint32_t[num_sectors];
+
+    for (uint32_t lba = 0; lba < num_sectors; lba++) {
+        versions[lba] = 0;
+        fill_sector(buf, lba, 0);
+        err = bd->program(buf, lba * sector_size, sector_size);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    for (int i = 0; i < 2000; i++) {
+        uint32_t lba = (rand() % 4) ? rand() % 4 : rand() % num_sectors;
+        versions[lba]++;
+        fill_sector(buf, lba, versions[lba]);
+        err = bd->program(buf, lba * sector_size, sector_size);
+        TEST_ASSERT_EQUAL(0, err);
+
+        if (i % 500 == 499) {
+            err = bd->deinit();
+            TEST_ASSERT_EQUAL(0, err);
+            delete bd;
+            bd = new FTLBlockDevice(&flash_bd, sector_size, spare_units, wear_threshold);
+            err = bd->init();
+            TEST_ASSERT_EQUAL(0, err);
+
+            for (uint32_t lba = 0; lba < num_sectors; lba++) {
+                err = bd->read(read_buf, lba * sector_size, sector_size);
+                TEST_ASSERT_EQUAL(0, err);
+                fill_sector(buf, lba, versions[lba]);
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(buf, read_buf, sector_size);
+            }
+        }
+    }
+
+    err = bd->deinit();
+    TEST_ASSERT_EQUAL(0, err);
+    delete bd;
+    delete[] versions;
+}
+
+// Measures write amplification and erase count spread, and how much longer a
+// single hot sector lasts than it would when rewritten in place
+void wear_test()
+{
+    const uint32_t erase_cycles = 50;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_units * unit_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_units * unit_size, 1, 1, unit_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    ExhaustibleBlockDevice exhaustible_bd(&flash_bd, erase_cycles);
+    ProfilingBlockDevice profiling_bd(&exhaustible_bd);
+    FTLBlockDevice bd(&profiling_bd, sector_size, spare_units, wear_threshold);
+    uint8_t buf[sector_size], read_buf[sector_size];
+
+    int err = bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    uint32_t num_sectors = bd.size() / sector_size;
+    for (uint32_t lba = 0; lba < num_sectors; lba++) {
+        fill_sector(buf, lba, 0);
+        err = bd.program(buf, lba * sector_size, sector_size);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    // Rewrite sector 0 until the flash wears out
+    profiling_bd.reset();
+    uint32_t writes = 0;
+    while (true) {
+        fill_sector(buf, 0, writes + 1);
+        if (bd.program(buf, 0, sector_size)) {
+            break;
+        }
+        if (bd.read(read_buf, 0, sector_size) || memcmp(buf, read_buf, sector_size)) {
+            break;
+        }
+        writes++;
+        if (writes == erase_cycles * 2) {
+            printf("Write amplification: %d%%\n",
+                   (int)(profiling_bd.get_program_count() * 100 / (writes * sector_size)));
+            printf("Erase counts: %d to %d\n", (int)bd.get_min_erase_count(), (int)bd.get_max_erase_count());
+            TEST_ASSERT_TRUE(bd.get_max_erase_count() - bd.get_min_erase_count() <= 2 * wear_threshold);
+        }
+    }
+
+    printf("Hot sector rewritten %d times, %d erase cycles per unit\n", (int)writes, (int)erase_cycles);
+    TEST_ASSERT_TRUE(writes > 10 * erase_cycles);
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(60, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("FTLBlockDevice functionality test", functionality_test),
+    Case("FTLBlockDevice wear test", wear_test),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
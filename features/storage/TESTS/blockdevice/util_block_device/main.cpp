@@ -22,6 +22,7 @@
 #include "SlicingBlockDevice.h"
 #include "ChainingBlockDevice.h"
 #include "ProfilingBlockDevice.h"
+#include "FlashSimBlockDevice.h"
 #include <stdlib.h>
 
 using namespace utest::v1;
@@ -289,6 +290,63 @@ end:
 }
 
 
+// Test of the histograms and erase map of a profiled flash block device
+void test_profiling_histograms()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[BLOCK_COUNT * BLOCK_SIZE];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    int err;
+    uint8_t buf[16] = {0};
+
+    HeapBlockDevice heap_bd(BLOCK_COUNT * BLOCK_SIZE, 1, 1, BLOCK_SIZE);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    ProfilingBlockDevice profiler(&flash_bd, true);
+
+    err = profiler.init();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = profiler.erase(0, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    err = profiler.erase(0, 3 * BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    for (int i = 0; i < 4; i++) {
+        err = profiler.program(buf, i * sizeof(buf), sizeof(buf));
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    err = profiler.read(buf, 0, 1);
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Sizes of 512 and 1536 bytes fall in buckets 9 and 10, 16 bytes in bucket 4
+    TEST_ASSERT_EQUAL(1, profiler.get_size_histogram(ProfilingBlockDevice::OP_ERASE, 9));
+    TEST_ASSERT_EQUAL(1, profiler.get_size_histogram(ProfilingBlockDevice::OP_ERASE, 10));
+    TEST_ASSERT_EQUAL(4, profiler.get_size_histogram(ProfilingBlockDevice::OP_PROGRAM, 4));
+    TEST_ASSERT_EQUAL(1, profiler.get_size_histogram(ProfilingBlockDevice::OP_READ, 0));
+
+    // Every operation is in exactly one latency bucket
+    uint32_t latency_total = 0;
+    for (int i = 0; i < ProfilingBlockDevice::histogram_buckets; i++) {
+        latency_total += profiler.get_latency_histogram(ProfilingBlockDevice::OP_PROGRAM, i);
+    }
+    TEST_ASSERT_EQUAL(4, latency_total);
+
+    TEST_ASSERT_EQUAL(2, profiler.get_block_erase_count(0));
+    TEST_ASSERT_EQUAL(1, profiler.get_block_erase_count(2 * BLOCK_SIZE + 1));
+    TEST_ASSERT_EQUAL(0, profiler.get_block_erase_count(3 * BLOCK_SIZE));
+
+    err = profiler.dump_csv(stdout);
+    TEST_ASSERT_EQUAL(0, err);
+
+    profiler.reset();
+    TEST_ASSERT_EQUAL(0, profiler.get_block_erase_count(0));
+    TEST_ASSERT_EQUAL(0, profiler.get_size_histogram(ProfilingBlockDevice::OP_PROGRAM, 4));
+
+    err = profiler.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+
 // Test setup
 utest::v1::status_t test_setup(const size_t number_of_cases)
 {
@@ -300,6 +358,7 @@ Case cases[] = {
     Case("Testing slicing of a block device", test_slicing),
     Case("Testing chaining of block devices", test_chaining),
     Case("Testing profiling of block devices", test_profiling),
+    Case("Testing profiling histograms of block devices", test_profiling_histograms),
 };
 
 Specification specification(test_setup, cases);
@@ -20,6 +20,7 @@
 
 #include "HeapBlockDevice.h"
 #include "FATFileSystem.h"
+#include "ProfilingBlockDevice.h"
 #include <stdlib.h>
 #include "mbed_retarget.h"
 
@@ -102,6 +103,251 @@ void test_read_write()
 }
 
 
+// Test random seeks in fragmented files, which go through the cluster link map
+void test_random_seek()
+{
+    TEST_SKIP_UNLESS_MESSAGE(bd, "Not enough heap memory to run test. Test skipped.");
+
+    const int chunk = BLOCK_SIZE;
+    const int chunks = 16;
+    uint8_t buffer[BLOCK_SIZE];
+
+    FATFileSystem fs("fat");
+
+    int err = fs.mount(bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Interleave the writes of two files so their clusters are fragmented
+    File files[2];
+    err = files[0].open(&fs, "test_random_seek_0.dat", O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_EQUAL(0, err);
+    err = files[1].open(&fs, "test_random_seek_1.dat", O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_EQUAL(0, err);
+
+    for (int i = 0; i < chunks; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < chunk; k++) {
+                buffer[k] = 0xff & (i * chunk + k + j * 0x55 + (i * chunk + k) / 251);
+            }
+            ssize_t size = files[j].write(buffer, chunk);
+            TEST_ASSERT_EQUAL(chunk, size);
+            err = files[j].sync();
+            TEST_ASSERT_EQUAL(0, err);
+        }
+    }
+
+    for (int round = 0; round < 3; round++) {
+        off_t file_size = files[0].size();
+
+        srand(round);
+        for (int i = 0; i < 100; i++) {
+            off_t pos = rand() % (file_size - 16);
+            off_t res = files[0].seek(pos, SEEK_SET);
+            TEST_ASSERT_EQUAL(pos, res);
+            ssize_t size = files[0].read(buffer, 16);
+            TEST_ASSERT_EQUAL(16, size);
+            for (int k = 0; k < 16; k++) {
+                TEST_ASSERT_EQUAL(0xff & (pos + k + (pos + k) / 251), buffer[k]);
+            }
+        }
+
+        if (round == 0) {
+            // Grow the file, the map must be rebuilt
+            off_t res = files[0].seek(0, SEEK_END);
+            TEST_ASSERT_EQUAL(file_size, res);
+            for (int k = 0; k < chunk; k++) {
+                buffer[k] = 0xff & (file_size + k + (file_size + k) / 251);
+            }
+            ssize_t size = files[0].write(buffer, chunk);
+            TEST_ASSERT_EQUAL(chunk, size);
+        } else if (round == 1) {
+            // Truncate and regrow to the same size, moving the last clusters
+            err = files[0].truncate(file_size / 2);
+            TEST_ASSERT_EQUAL(0, err);
+            for (int k = 0; k < chunk; k++) {
+                buffer[k] = 0xff & (k * 3);
+            }
+            ssize_t size = files[1].write(buffer, chunk);
+            TEST_ASSERT_EQUAL(chunk, size);
+
+            off_t res = files[0].seek(file_size / 2, SEEK_SET);
+            TEST_ASSERT_EQUAL(file_size / 2, res);
+            for (off_t pos = file_size / 2; pos < file_size; pos += chunk) {
+                for (int k = 0; k < chunk; k++) {
+                    buffer[k] = 0xff & (pos + k + (pos + k) / 251);
+                }
+                size = files[0].write(buffer, chunk);
+                TEST_ASSERT_EQUAL(chunk, size);
+            }
+        }
+    }
+
+    err = files[0].close();
+    TEST_ASSERT_EQUAL(0, err);
+    err = files[1].close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+
+static void sector_cache_pattern(uint8_t *buffer, int file, off_t pos, int size)
+{
+    for (int k = 0; k < size; k++) {
+        buffer[k] = 0xff & (pos + k + file * 0x33 + (pos + k) / 253);
+    }
+}
+
+// Interleaves small accesses to several files, returning the bytes read from the device
+static bd_size_t sector_cache_run(BlockDevice *dev, uint32_t cache_sectors)
+{
+    const int num_files = 3;
+    const int chunk = 40;
+    const int chunks = 64;
+    uint8_t buffer[chunk];
+    uint8_t expected[chunk];
+    char name[32];
+
+    ProfilingBlockDevice profiling_bd(dev);
+    FATFileSystem fs("fat");
+    fs.set_sector_cache(cache_sectors, cache_sectors, cache_sectors);
+
+    int err = fs.mount(&profiling_bd);
+    TEST_ASSERT_EQUAL(0, err);
+    profiling_bd.reset();
+
+    File files[num_files];
+    for (int j = 0; j < num_files; j++) {
+        sprintf(name, "test_sector_cache_%d.dat", j);
+        err = files[j].open(&fs, name, O_RDWR | O_CREAT | O_TRUNC);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    for (int i = 0; i < chunks; i++) {
+        for (int j = 0; j < num_files; j++) {
+            sector_cache_pattern(buffer, j, i * chunk, chunk);
+            ssize_t size = files[j].write(buffer, chunk);
+            TEST_ASSERT_EQUAL(chunk, size);
+        }
+    }
+
+    for (int j = 0; j < num_files; j++) {
+        off_t res = files[j].seek(0, SEEK_SET);
+        TEST_ASSERT_EQUAL(0, res);
+    }
+
+    for (int i = 0; i < chunks; i++) {
+        for (int j = 0; j < num_files; j++) {
+            ssize_t size = files[j].read(buffer, chunk);
+            TEST_ASSERT_EQUAL(chunk, size);
+            sector_cache_pattern(expected, j, i * chunk, chunk);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buffer, chunk);
+        }
+    }
+
+    for (int j = 0; j < num_files; j++) {
+        err = files[j].close();
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+    return profiling_bd.get_read_count();
+}
+
+static uint16_t bpb_u16(const uint8_t *sector, int offset)
+{
+    return sector[offset] | (sector[offset + 1] << 8);
+}
+
+// Test the second FAT copy written back by the sector cache
+void test_sector_cache_mirror()
+{
+    TEST_SKIP_UNLESS_MESSAGE(bd, "Not enough heap memory to run test. Test skipped.");
+
+    HeapBlockDevice mirror_bd(BLOCK_COUNT * BLOCK_SIZE, BLOCK_SIZE);
+    int err = mirror_bd.init();
+    TEST_ASSERT_EQUAL(0, err);
+    err = FATFileSystem::format(&mirror_bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    // Formatting makes a single FAT, add a copy of it in front of the empty root directory
+    uint8_t boot[BLOCK_SIZE];
+    uint8_t sector[BLOCK_SIZE];
+    err = mirror_bd.read(boot, 0, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    TEST_ASSERT_EQUAL(1, boot[16]);
+    bd_addr_t fat_base = bpb_u16(boot, 14);
+    bd_addr_t fat_size = bpb_u16(boot, 22);
+    bd_addr_t root_size = (bpb_u16(boot, 17) * 32 + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    TEST_ASSERT(fat_size > 0);
+
+    boot[16] = 2;
+    err = mirror_bd.program(boot, 0, BLOCK_SIZE);
+    TEST_ASSERT_EQUAL(0, err);
+    for (bd_addr_t i = 0; i < fat_size; i++) {
+        err = mirror_bd.read(sector, (fat_base + i) * BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+        err = mirror_bd.program(sector, (fat_base + fat_size + i) * BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    memset(sector, 0, BLOCK_SIZE);
+    for (bd_addr_t i = 0; i < root_size; i++) {
+        err = mirror_bd.program(sector, (fat_base + 2 * fat_size + i) * BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+
+    // Unmounting writes the deferred updates of the second FAT
+    sector_cache_run(&mirror_bd, 4);
+
+    uint8_t mirror[BLOCK_SIZE];
+    for (bd_addr_t i = 0; i < fat_size; i++) {
+        err = mirror_bd.read(sector, (fat_base + i) * BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+        err = mirror_bd.read(mirror, (fat_base + fat_size + i) * BLOCK_SIZE, BLOCK_SIZE);
+        TEST_ASSERT_EQUAL(0, err);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(sector, mirror, BLOCK_SIZE);
+    }
+
+    err = mirror_bd.deinit();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// Test sector cache
+void test_sector_cache()
+{
+    TEST_SKIP_UNLESS_MESSAGE(bd, "Not enough heap memory to run test. Test skipped.");
+
+    bd_size_t uncached = sector_cache_run(bd, 0);
+    bd_size_t cached = sector_cache_run(bd, 4);
+    printf("Bytes read, uncached: %llu, cached: %llu\n", uncached, cached);
+    TEST_ASSERT(cached < uncached);
+
+    // The files written through the cache read back without it
+    FATFileSystem fs("fat");
+    fs.set_sector_cache(0, 0, 0);
+    int err = fs.mount(bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    File file;
+    uint8_t buffer[BLOCK_SIZE];
+    uint8_t expected[BLOCK_SIZE];
+    err = file.open(&fs, "test_sector_cache_2.dat", O_RDONLY);
+    TEST_ASSERT_EQUAL(0, err);
+    for (off_t pos = 0; pos < file.size(); pos += BLOCK_SIZE) {
+        ssize_t size = file.read(buffer, BLOCK_SIZE);
+        TEST_ASSERT(size > 0);
+        sector_cache_pattern(expected, 2, pos, size);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buffer, size);
+    }
+    err = file.close();
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
 // Simple test for iterating dir entries
 void test_read_dir()
 {
@@ -180,6 +426,9 @@ Case cases[] = {
     Case("Testing formating", test_format),
     Case("Testing read write < block", test_read_write < BLOCK_SIZE / 2 >),
     Case("Testing read write > block", test_read_write<2 * BLOCK_SIZE>),
+    Case("Testing random seeks", test_random_seek),
+    Case("Testing sector cache", test_sector_cache),
+    Case("Testing sector cache FAT mirror", test_sector_cache_mirror),
     Case("Testing dir iteration", test_read_dir),
 };
 
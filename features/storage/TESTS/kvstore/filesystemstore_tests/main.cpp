@@ -26,6 +26,8 @@
 #include "unity.h"
 #include "utest.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 
 #if !KVSTORE_ENABLED
 #error [NOT_SUPPORTED] KVStore needs to be enabled for this test
@@ -492,6 +494,134 @@ void test_file_system_store_multi_threads()
     TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
 }
 
+// Sets, overwrites and removes keys over several store instances, checking
+// the values survive deinit and init
+static void test_store_persistence(bool packed, size_t open_files)
+{
+    char kv_key[16] = {0};
+    char kv_value[32] = {0};
+    char kv_buf[32] = {0};
+    char kv_name[16] = {0};
+    size_t actual_size = 0;
+    const int num_keys = 20;
+    const int num_sets = 300;
+    int i_ind = 0;
+
+    int err = bd->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+
+    FileSystem *fs = FileSystem::get_default_instance();
+
+    err = fs->mount(bd);
+    if (err) {
+        err = fs->reformat(bd);
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    }
+
+    FileSystemStore *fsst = new FileSystemStore(fs, packed, open_files, 1024);
+
+    err = fsst->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+
+    err = fsst->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+
+    /* Overwrite each key many times, values of different sizes */
+    for (int i = 0; i < num_sets; i++) {
+        sprintf(kv_key, "key%d", i % num_keys);
+        sprintf(kv_value, "value%d", i);
+        err = fsst->set(kv_key, kv_value, strlen(kv_value) + 1, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    }
+
+    /* Remove every other key */
+    for (int i = 0; i < num_keys; i += 2) {
+        sprintf(kv_key, "key%d", i);
+        err = fsst->remove(kv_key);
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    }
+
+    /* Shrink a value */
+    err = fsst->set("key1", "v", 2, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < num_keys; i++) {
+            sprintf(kv_key, "key%d", i);
+            err = fsst->get(kv_key, kv_buf, sizeof(kv_buf), &actual_size, 0);
+            if (i % 2 == 0) {
+                TEST_ASSERT_EQUAL_ERROR_CODE(MBED_ERROR_ITEM_NOT_FOUND, err);
+                continue;
+            }
+            TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+            if (i == 1) {
+                TEST_ASSERT_EQUAL_STRING("v", kv_buf);
+            } else {
+                sprintf(kv_value, "value%d", num_sets - num_keys + i);
+                TEST_ASSERT_EQUAL_STRING(kv_value, kv_buf);
+            }
+            TEST_ASSERT_EQUAL(strlen(kv_buf) + 1, actual_size);
+        }
+
+        KVStore::iterator_t kv_it;
+        err = fsst->iterator_open(&kv_it, "key");
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+        i_ind = 0;
+        while (fsst->iterator_next(kv_it, kv_name, sizeof(kv_name)) != MBED_ERROR_ITEM_NOT_FOUND) {
+            i_ind++;
+        }
+        TEST_ASSERT_EQUAL(num_keys / 2, i_ind);
+        fsst->iterator_close(kv_it);
+
+        err = fsst->deinit();
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+        delete fsst;
+
+        fsst = new FileSystemStore(fs, packed, open_files, 1024);
+        err = fsst->init();
+        TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    }
+
+    err = fsst->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    err = fsst->get("key1", kv_buf, sizeof(kv_buf), &actual_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_ERROR_ITEM_NOT_FOUND, err);
+
+    err = fsst->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    delete fsst;
+
+    err = fs->unmount();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+    err = bd->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(0, err);
+}
+
+void test_file_system_store_open_files()
+{
+    utest_printf("Test FileSystemStore Open Files Cache..\n");
+    TEST_SKIP_UNLESS(bd != NULL);
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+    delete[] dummy;
+
+    test_store_persistence(false, 4);
+}
+
+void test_file_system_store_packed()
+{
+    utest_printf("Test FileSystemStore Packed Mode..\n");
+    TEST_SKIP_UNLESS(bd != NULL);
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+    delete[] dummy;
+
+    test_store_persistence(true, 0);
+    test_store_persistence(true, 2);
+}
+
 utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
 {
     greentea_case_failure_abort_handler(source, reason);
@@ -508,7 +638,9 @@ utest::v1::status_t test_setup(const size_t number_of_cases)
 Case cases[] = {
     Case("Testing functionality APIs unit test", test_file_system_store_functionality_unit_test, greentea_failure_handler),
     Case("Testing Edge Cases", test_file_system_store_edge_cases, greentea_failure_handler),
-    Case("Testing Multi Threads Set", test_file_system_store_multi_threads, greentea_failure_handler)
+    Case("Testing Multi Threads Set", test_file_system_store_multi_threads, greentea_failure_handler),
+    Case("Testing Open Files Cache", test_file_system_store_open_files, greentea_failure_handler),
+    Case("Testing Packed Mode", test_file_system_store_packed, greentea_failure_handler)
 };
 
 Specification specification(test_setup, cases);
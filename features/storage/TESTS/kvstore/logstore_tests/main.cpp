@@ -0,0 +1,366 @@
+/* Copyright (c) 2019 ARM Limited
+*
+* SPDX-License-Identifier: Apache-2.0
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "LogStore.h"
+#include "mbed_error.h"
+#include "Timer.h"
+#include "HeapBlockDevice.h"
+#include "FlashSimBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include "greentea-client/test_env.h"
+#include "unity/unity.h"
+#include "utest/utest.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+using namespace mbed;
+using namespace utest::v1;
+
+static const bd_size_t erase_size = 4096;
+static const bd_size_t num_units = 16;
+static const size_t batch_size = 256;
+
+static size_t sample_size(uint32_t ind)
+{
+    return 4 + ind % 13;
+}
+
+static void fill_sample(uint8_t *buf, uint32_t ind)
+{
+    for (size_t i = 0; i < sample_size(ind); i++) {
+        buf[i] = (uint8_t)(ind * 31 + i);
+    }
+}
+
+// Timestamps repeat, two samples per tick
+static uint32_t sample_timestamp(uint32_t ind)
+{
+    return 1000 + ind / 2;
+}
+
+// Fails programs on demand, programming half of the data as an interrupted program would
+class FaultyBlockDevice : public FlashSimBlockDevice {
+public:
+    FaultyBlockDevice(BlockDevice *bd) : FlashSimBlockDevice(bd), fail_programs(0) {}
+
+    virtual int program(const void *b, bd_addr_t addr, bd_size_t size)
+    {
+        if (!fail_programs) {
+            return FlashSimBlockDevice::program(b, addr, size);
+        }
+        fail_programs--;
+        bd_size_t half = size / 2 - (size / 2) % get_program_size();
+        if (half) {
+            FlashSimBlockDevice::program(b, addr, half);
+        }
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint32_t fail_programs;
+};
+
+// Reads a time range, checking the records are the samples of that range
+static void check_range(LogStore &store, uint32_t first_ind, uint32_t last_ind, uint32_t from, uint32_t to)
+{
+    LogStore::iterator_t it;
+    uint8_t buf[32], expected[32];
+    uint32_t timestamp;
+    size_t actual_size;
+
+    int ret = store.iterator_open(&it, from, to);
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+    uint32_t ind = first_ind;
+    while (ind <= last_ind && sample_timestamp(ind) < from) {
+        ind++;
+    }
+
+    while ((ret = store.iterator_next(it, &timestamp, buf, sizeof(buf), &actual_size)) == MBED_SUCCESS) {
+        TEST_ASSERT_TRUE(ind <= last_ind);
+        TEST_ASSERT_EQUAL(sample_timestamp(ind), timestamp);
+        TEST_ASSERT_EQUAL(sample_size(ind), actual_size);
+        fill_sample(expected, ind);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, actual_size);
+        ind++;
+    }
+    TEST_ASSERT_EQUAL(MBED_ERROR_ITEM_NOT_FOUND, ret);
+    TEST_ASSERT_TRUE(ind > last_ind || sample_timestamp(ind) > to);
+
+    ret = store.iterator_close(it);
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+}
+
+void functionality_test()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_units * erase_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_units * erase_size, 1, 1, erase_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    uint8_t buf[32];
+    LogStore::info_t info;
+
+    LogStore *store = new LogStore(&flash_bd, 0, batch_size);
+    int ret = store->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    ret = store->reset();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    ret = store->get_info(&info);
+    TEST_ASSERT_EQUAL(MBED_ERROR_ITEM_NOT_FOUND, ret);
+
+    const uint32_t num_samples = 2000;
+    for (uint32_t ind = 0; ind < num_samples; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+
+    ret = store->append(sample_timestamp(0), buf, 1);
+    TEST_ASSERT_EQUAL(MBED_ERROR_INVALID_ARGUMENT, ret);
+    ret = store->append(sample_timestamp(num_samples), buf, store->get_max_record_size() + 1);
+    TEST_ASSERT_EQUAL(MBED_ERROR_INVALID_SIZE, ret);
+
+    ret = store->get_info(&info);
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    TEST_ASSERT_EQUAL(num_samples, info.num_records);
+    TEST_ASSERT_EQUAL(sample_timestamp(0), info.first_timestamp);
+    TEST_ASSERT_EQUAL(sample_timestamp(num_samples - 1), info.last_timestamp);
+
+    // Ranges read records both programmed and pending
+    check_range(*store, 0, num_samples - 1, 0, 0xFFFFFFFF);
+    check_range(*store, 0, num_samples - 1, sample_timestamp(300), sample_timestamp(301));
+    check_range(*store, 0, num_samples - 1, sample_timestamp(1500), sample_timestamp(num_samples - 1));
+
+    // Synced records survive without deinit
+    ret = store->sync();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    LogStore *other = new LogStore(&flash_bd, 0, batch_size);
+    ret = other->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    check_range(*other, 0, num_samples - 1, sample_timestamp(700), sample_timestamp(1200));
+    delete other;
+
+    // Fill the store several times, the oldest segments are reclaimed
+    uint32_t ind = num_samples;
+    for (int round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < 5000; i++, ind++) {
+            fill_sample(buf, ind);
+            ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+            TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+        }
+
+        ret = store->deinit();
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+        ret = store->init();
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+        ret = store->get_info(&info);
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+        TEST_ASSERT_EQUAL(sample_timestamp(ind - 1), info.last_timestamp);
+        TEST_ASSERT_TRUE(info.first_timestamp > sample_timestamp(0));
+        TEST_ASSERT_TRUE(info.num_records < ind);
+
+        // The records left are the latest ones, starting at a whole tick
+        uint32_t first_ind = ind - info.num_records;
+        if (sample_timestamp(first_ind) != info.first_timestamp) {
+            first_ind++;
+        }
+        check_range(*store, first_ind, ind - 1, info.first_timestamp, 0xFFFFFFFF);
+        check_range(*store, first_ind, ind - 1, sample_timestamp(ind - 1000), sample_timestamp(ind - 900));
+    }
+
+    ret = store->reset();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    ret = store->get_info(&info);
+    TEST_ASSERT_EQUAL(MBED_ERROR_ITEM_NOT_FOUND, ret);
+
+    ret = store->deinit();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    delete store;
+}
+
+void program_failure_test()
+{
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_units * erase_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_units * erase_size, 1, 1, erase_size);
+    FaultyBlockDevice flash_bd(&heap_bd);
+    uint8_t buf[32];
+    uint32_t ind;
+
+    LogStore *store = new LogStore(&flash_bd, 0, batch_size);
+    int ret = store->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    ret = store->reset();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+    for (ind = 0; ind < 100; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    ret = store->sync();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+    // A failed batch stays pending and the records after it go to a fresh segment
+    for (; ind < 110; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    flash_bd.fail_programs = 1;
+    ret = store->sync();
+    TEST_ASSERT_EQUAL(MBED_ERROR_WRITE_FAILED, ret);
+
+    for (; ind < 200; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    ret = store->sync();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+    LogStore *other = new LogStore(&flash_bd, 0, batch_size);
+    ret = other->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    check_range(*other, 0, 199, 0, 0xFFFFFFFF);
+    delete other;
+
+    // Leave a torn batch at the end of the active segment, as a power loss would
+    for (; ind < 210; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    flash_bd.fail_programs = 0xFFFFFFFF;
+    ret = store->deinit();
+    TEST_ASSERT_NOT_EQUAL(MBED_SUCCESS, ret);
+    delete store;
+    flash_bd.fail_programs = 0;
+
+    // Appending after remount doesn't program over the torn batch
+    store = new LogStore(&flash_bd, 0, batch_size);
+    ret = store->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    for (ind = 220; ind < 300; ind++) {
+        fill_sample(buf, ind);
+        ret = store->append(sample_timestamp(ind), buf, sample_size(ind));
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    ret = store->deinit();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+
+    ret = store->init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    check_range(*store, 0, 199, 0, sample_timestamp(199));
+    check_range(*store, 220, 299, sample_timestamp(200), 0xFFFFFFFF);
+
+    ret = store->deinit();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    delete store;
+}
+
+// Appends samples at full speed, reporting throughput and flash usage per sample
+void throughput_test()
+{
+    const uint32_t num_samples = 20000;
+    const size_t size = 16;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_units * erase_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    HeapBlockDevice heap_bd(num_units * erase_size, 1, 1, erase_size);
+    FlashSimBlockDevice flash_bd(&heap_bd);
+    ProfilingBlockDevice bd(&flash_bd);
+    LogStore store(&bd, 0, batch_size);
+    uint8_t buf[size];
+    mbed::Timer timer;
+
+    int ret = store.init();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    ret = store.reset();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    bd.reset();
+
+    timer.start();
+    for (uint32_t ind = 0; ind < num_samples; ind++) {
+        memset(buf, ind, size);
+        ret = store.append(ind, buf, size);
+        TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    }
+    ret = store.sync();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    timer.stop();
+
+    int elapsed = timer.read_ms();
+    printf("Appended %d samples of %d bytes in %d ms (%d samples/s)\n", (int)num_samples, (int)size,
+           elapsed, elapsed ? (int)(num_samples * 1000ULL / elapsed) : 0);
+    printf("Programmed %d bytes per sample, erased %d bytes\n",
+           (int)(bd.get_program_count() / num_samples), (int)bd.get_erase_count());
+    TEST_ASSERT_TRUE(bd.get_program_count() < num_samples * (size + 8));
+
+    // Reading a short range only reads the batches around it
+    LogStore::iterator_t it;
+    uint32_t timestamp;
+    bd.reset();
+    timer.reset();
+    timer.start();
+    ret = store.iterator_open(&it, num_samples - 1000, num_samples - 901);
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+    int count = 0;
+    while (store.iterator_next(it, &timestamp, buf, size) == MBED_SUCCESS) {
+        count++;
+    }
+    store.iterator_close(it);
+    timer.stop();
+    TEST_ASSERT_EQUAL(100, count);
+    printf("Read 100 samples in %d ms, %d bytes read\n", (int)timer.read_ms(), (int)bd.get_read_count());
+    TEST_ASSERT_TRUE(bd.get_read_count() < erase_size);
+
+    ret = store.deinit();
+    TEST_ASSERT_EQUAL(MBED_SUCCESS, ret);
+}
+
+utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
+{
+    greentea_case_failure_abort_handler(source, reason);
+    return STATUS_CONTINUE;
+}
+
+Case cases[] = {
+    Case("LogStore: Functionality test", functionality_test, greentea_failure_handler),
+    Case("LogStore: Program failure test", program_failure_test, greentea_failure_handler),
+    Case("LogStore: Throughput test",    throughput_test,    greentea_failure_handler),
+};
+
+utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(120, "default_auto");
+    return greentea_test_setup_handler(number_of_cases);
+}
+
+Specification specification(greentea_test_setup, cases, greentea_test_teardown_handler);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -395,6 +395,60 @@ static void white_box_test()
 #endif
 }
 
+static void set_get_benchmark_test()
+{
+    const char *const set_val = "Benchmark value!";
+    char key[16];
+    uint8_t get_buf[32];
+    size_t actual_data_size;
+    int result;
+    mbed::Timer timer;
+    int elapsed;
+
+    // Working sets smaller and larger than the derived key cache
+    const int num_keys[] = {2, 16};
+    const int num_ops = 128;
+
+    TDBStore *ul_kv = new TDBStore(&ul_bd);
+    SecureStore *sec_kv = new SecureStore(ul_kv, 0);
+
+    result = sec_kv->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    result = sec_kv->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    timer.start();
+    for (size_t k = 0; k < sizeof(num_keys) / sizeof(num_keys[0]); k++) {
+        timer.reset();
+        for (int i = 0; i < num_ops; i++) {
+            sprintf(key, "bench_key%d", i % num_keys[k]);
+            result = sec_kv->set(key, set_val, strlen(set_val), KVStore::REQUIRE_CONFIDENTIALITY_FLAG);
+            TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        }
+        elapsed = timer.read_ms();
+        printf("%d keys: %d sets in %d ms (%d ops/s)\n", num_keys[k], num_ops, elapsed,
+               num_ops * 1000 / std::max(elapsed, 1));
+
+        timer.reset();
+        for (int i = 0; i < num_ops; i++) {
+            sprintf(key, "bench_key%d", i % num_keys[k]);
+            result = sec_kv->get(key, get_buf, sizeof(get_buf), &actual_data_size);
+            TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+            TEST_ASSERT_EQUAL(strlen(set_val), actual_data_size);
+            TEST_ASSERT_EQUAL_STRING_LEN(set_val, get_buf, actual_data_size);
+        }
+        elapsed = timer.read_ms();
+        printf("%d keys: %d gets in %d ms (%d ops/s)\n", num_keys[k], num_ops, elapsed,
+               num_ops * 1000 / std::max(elapsed, 1));
+    }
+
+    result = sec_kv->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    delete sec_kv;
+    delete ul_kv;
+}
+
 #if 0
 static void multi_set_test()
 {
@@ -516,6 +570,7 @@ utest::v1::status_t greentea_failure_handler(const Case *const source, const fai
 
 Case cases[] = {
     Case("SecureStore: White box test",     white_box_test,    greentea_failure_handler),
+    Case("SecureStore: Set/get benchmark",  set_get_benchmark_test, greentea_failure_handler),
 };
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
@@ -25,6 +25,7 @@
 #include "HeapBlockDevice.h"
 #include "FlashSimBlockDevice.h"
 #include "SlicingBlockDevice.h"
+#include "ProfilingBlockDevice.h"
 #include "greentea-client/test_env.h"
 #include "unity/unity.h"
 #include "utest/utest.h"
@@ -603,6 +604,433 @@ static void error_inject_test()
 }
 
 
+static void many_keys_test()
+{
+    char key[16];
+    uint32_t set_val, get_val;
+    size_t num_keys = 200;
+    size_t set_iters = 3;
+    size_t actual_data_size;
+    int result;
+    mbed::Timer timer;
+    int elapsed;
+    size_t i, key_ind;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+
+#ifdef USE_HEAP_BD
+    // We need to skip the test if we don't have enough memory for the heap block device.
+    // However, this device allocates the erase units on the fly, so "erase" it via the flash
+    // simulator. A failure here means we haven't got enough memory.
+    flash_bd.init();
+    result = flash_bd.erase(0, flash_bd.size());
+    TEST_SKIP_UNLESS_MESSAGE(!result, "Not enough heap to run test");
+    flash_bd.deinit();
+#endif
+
+    delete[] dummy;
+
+    TDBStore *tdbs = new TDBStore(&flash_bd);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    // Every third key is removed on the last iteration, all others keep their last value
+    for (i = 0; i < set_iters; i++) {
+        for (key_ind = 0; key_ind < num_keys; key_ind++) {
+            sprintf(key, "key_%d", key_ind);
+            if ((i == set_iters - 1) && !(key_ind % 3)) {
+                result = tdbs->remove(key);
+            } else {
+                set_val = key_ind * (i + 1);
+                result = tdbs->set(key, &set_val, sizeof(set_val), 0);
+            }
+            TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        }
+    }
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    timer.start();
+    result = tdbs->init();
+    elapsed = timer.read_ms();
+    printf("Elapsed time for init with %d keys is %d ms\n", num_keys, elapsed);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    timer.reset();
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        result = tdbs->get(key, &get_val, sizeof(get_val), &actual_data_size);
+        if (!(key_ind % 3)) {
+            TEST_ASSERT_EQUAL_ERROR_CODE(MBED_ERROR_ITEM_NOT_FOUND, result);
+            continue;
+        }
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        TEST_ASSERT_EQUAL(sizeof(get_val), actual_data_size);
+        TEST_ASSERT_EQUAL(key_ind * set_iters, get_val);
+    }
+    elapsed = timer.read_ms();
+    printf("Elapsed time for %d gets is %d ms\n", num_keys, elapsed);
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    delete tdbs;
+}
+
+static void incremental_gc_test()
+{
+    char key[16];
+    uint8_t *get_buf, *set_buf;
+    size_t num_keys = 64;
+    size_t data_size = 128;
+    size_t step_size = 256;
+    size_t actual_data_size;
+    int result;
+    mbed::Timer timer;
+    int elapsed, full_gc_time, max_step_time = 0, max_get_time = 0, num_steps = 0;
+    size_t key_ind;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+
+#ifdef USE_HEAP_BD
+    // We need to skip the test if we don't have enough memory for the heap block device.
+    // However, this device allocates the erase units on the fly, so "erase" it via the flash
+    // simulator. A failure here means we haven't got enough memory.
+    flash_bd.init();
+    result = flash_bd.erase(0, flash_bd.size());
+    TEST_SKIP_UNLESS_MESSAGE(!result, "Not enough heap to run test");
+    flash_bd.deinit();
+#endif
+
+    delete[] dummy;
+
+    get_buf = new uint8_t[data_size];
+    set_buf = new uint8_t[data_size];
+
+    TDBStore *tdbs = new TDBStore(&flash_bd);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind, data_size);
+        result = tdbs->set(key, set_buf, data_size, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    }
+
+    // Single step covering all records - gets are blocked for the whole GC
+    timer.start();
+    result = tdbs->gc_step(flash_bd.size());
+    full_gc_time = timer.read_ms();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    TEST_ASSERT_FALSE(tdbs->gc_in_progress());
+
+    // Incremental GC - gets are only blocked for one step, and still read the active area
+    do {
+        timer.reset();
+        result = tdbs->gc_step(step_size);
+        elapsed = timer.read_ms();
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        max_step_time = std::max(max_step_time, elapsed);
+        num_steps++;
+
+        key_ind = rand() % num_keys;
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind, data_size);
+        timer.reset();
+        result = tdbs->get(key, get_buf, data_size, &actual_data_size);
+        elapsed = timer.read_ms();
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        TEST_ASSERT_EQUAL(data_size, actual_data_size);
+        TEST_ASSERT_EQUAL_STRING_LEN(set_buf, get_buf, data_size);
+        max_get_time = std::max(max_get_time, elapsed);
+    } while (tdbs->gc_in_progress());
+
+    printf("Worst case get latency with full GC        - %d ms\n", full_gc_time);
+    printf("Worst case get latency with incremental GC - %d ms (%d steps of %d bytes, get %d ms)\n",
+           max_step_time + max_get_time, num_steps, step_size, max_get_time);
+
+    // Set during incremental GC completes it first
+    result = tdbs->gc_step(step_size);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    memset(set_buf, 0xFF, data_size);
+    result = tdbs->set("key_0", set_buf, data_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    TEST_ASSERT_FALSE(tdbs->gc_in_progress());
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind ? key_ind : 0xFF, data_size);
+        result = tdbs->get(key, get_buf, data_size, &actual_data_size);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        TEST_ASSERT_EQUAL_STRING_LEN(set_buf, get_buf, data_size);
+    }
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    delete[] get_buf;
+    delete[] set_buf;
+
+    delete tdbs;
+}
+
+static void gc_profiling_test()
+{
+    char key[16];
+    uint8_t *set_buf;
+    size_t num_keys = 16;
+    size_t data_size = 256;
+    size_t num_blocks = 8;
+    size_t block_size = 4096;
+    int result;
+    mbed::Timer timer;
+    int elapsed;
+    size_t key_ind;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+
+    HeapBlockDevice heap_bd(num_blocks * block_size, 1, 1, block_size);
+    ProfilingBlockDevice profiling_bd(&heap_bd);
+    FlashSimBlockDevice sim_bd(&profiling_bd);
+
+    // We need to skip the test if we don't have enough memory for the heap block device.
+    // However, this device allocates the erase units on the fly, so "erase" it via the flash
+    // simulator. A failure here means we haven't got enough memory.
+    sim_bd.init();
+    result = sim_bd.erase(0, sim_bd.size());
+    TEST_SKIP_UNLESS_MESSAGE(!result, "Not enough heap to run test");
+    sim_bd.deinit();
+
+    delete[] dummy;
+
+    set_buf = new uint8_t[data_size];
+
+    TDBStore *tdbs = new TDBStore(&sim_bd);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind, data_size);
+        result = tdbs->set(key, set_buf, data_size, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    }
+
+    profiling_bd.reset();
+    timer.start();
+    result = tdbs->gc_step(sim_bd.size());
+    elapsed = timer.read_ms();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    printf("GC of %d records with %d bytes work buffer - %d ms, read %d bytes, programmed %d bytes, erased %d bytes\n",
+           num_keys, MBED_CONF_TDBSTORE_WORK_BUF_SIZE, elapsed, (int) profiling_bd.get_read_count(),
+           (int) profiling_bd.get_program_count(), (int) profiling_bd.get_erase_count());
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    delete[] set_buf;
+
+    delete tdbs;
+}
+
+static void batch_test()
+{
+    char key[16];
+    uint8_t *get_buf, *set_buf, *scan_buf;
+    size_t num_keys = 16;
+    size_t data_size = 64;
+    size_t num_blocks = 8;
+    size_t block_size = 4096;
+    size_t actual_data_size;
+    int result;
+    mbed::Timer timer;
+    int set_time, batch_time;
+    bd_size_t set_programs, batch_programs;
+    size_t key_ind;
+    KVStore::batch_handle_t handle;
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[heap_alloc_threshold_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough heap to run test");
+
+    HeapBlockDevice heap_bd(num_blocks * block_size, 1, 1, block_size);
+    ProfilingBlockDevice profiling_bd(&heap_bd);
+    FlashSimBlockDevice sim_bd(&profiling_bd);
+
+    // We need to skip the test if we don't have enough memory for the heap block device.
+    // However, this device allocates the erase units on the fly, so "erase" it via the flash
+    // simulator. A failure here means we haven't got enough memory.
+    sim_bd.init();
+    result = sim_bd.erase(0, sim_bd.size());
+    TEST_SKIP_UNLESS_MESSAGE(!result, "Not enough heap to run test");
+    sim_bd.deinit();
+
+    delete[] dummy;
+
+    get_buf = new uint8_t[data_size];
+    set_buf = new uint8_t[data_size];
+    scan_buf = new uint8_t[block_size];
+
+    TDBStore *tdbs = new TDBStore(&sim_bd);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->reset();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->set(key1, key1_val1, strlen(key1_val1), KVStore::WRITE_ONCE_FLAG);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    // Individual sets, for reference
+    profiling_bd.reset();
+    timer.start();
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind, data_size);
+        result = tdbs->set(key, set_buf, data_size, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    }
+    set_time = timer.read_ms();
+    set_programs = profiling_bd.get_program_count();
+
+    // Same sets in one batch
+    profiling_bd.reset();
+    timer.reset();
+    result = tdbs->batch_begin(&handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind + 1, data_size);
+        result = tdbs->batch_set(handle, key, set_buf, data_size, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    }
+    result = tdbs->batch_commit(handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    batch_time = timer.read_ms();
+    batch_programs = profiling_bd.get_program_count();
+
+    printf("%d sets of %d bytes - individually %d ms, programmed %d bytes - in a batch %d ms, programmed %d bytes\n",
+           num_keys, data_size, set_time, (int) set_programs, batch_time, (int) batch_programs);
+
+    // A write once key fails the whole batch
+    result = tdbs->batch_begin(&handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    memset(set_buf, 0xFF, data_size);
+    result = tdbs->batch_set(handle, "key_0", set_buf, data_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    result = tdbs->batch_set(handle, key1, set_buf, data_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    result = tdbs->batch_commit(handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_ERROR_WRITE_PROTECTED, result);
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind + 1, data_size);
+        result = tdbs->get(key, get_buf, data_size, &actual_data_size);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        TEST_ASSERT_EQUAL(data_size, actual_data_size);
+        TEST_ASSERT_EQUAL_STRING_LEN(set_buf, get_buf, data_size);
+    }
+
+    // Batch interrupted by power loss - corrupt the data of its last record on the underlying device
+    result = tdbs->batch_begin(&handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, 0x80 + key_ind, data_size);
+        result = tdbs->batch_set(handle, key, set_buf, data_size, 0);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    }
+    memset(set_buf, 0xC0, data_size);
+    result = tdbs->batch_set(handle, "new_key", set_buf, data_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    result = tdbs->batch_commit(handle);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->get("new_key", get_buf, data_size, &actual_data_size);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    // Value of "new_key" is the last record of the batch. Scan windows overlap, in case it crosses a block.
+    bool corrupted = false;
+    heap_bd.init();
+    for (bd_addr_t addr = 0; (addr + block_size <= heap_bd.size()) && !corrupted; addr += block_size - data_size) {
+        heap_bd.read(scan_buf, addr, block_size);
+        uint8_t *found = std::search(scan_buf, scan_buf + block_size, set_buf, set_buf + data_size);
+        if (found != scan_buf + block_size) {
+            found[data_size / 2] ^= 0xFF;
+            heap_bd.program(found, addr + (found - scan_buf), data_size);
+            corrupted = true;
+        }
+    }
+    heap_bd.deinit();
+    TEST_ASSERT_TRUE(corrupted);
+
+    result = tdbs->init();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    // None of the sets of the interrupted batch are visible
+    result = tdbs->get("new_key", get_buf, data_size, &actual_data_size);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_ERROR_ITEM_NOT_FOUND, result);
+
+    for (key_ind = 0; key_ind < num_keys; key_ind++) {
+        sprintf(key, "key_%d", key_ind);
+        memset(set_buf, key_ind + 1, data_size);
+        result = tdbs->get(key, get_buf, data_size, &actual_data_size);
+        TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+        TEST_ASSERT_EQUAL_STRING_LEN(set_buf, get_buf, data_size);
+    }
+
+    result = tdbs->get(key1, get_buf, data_size, &actual_data_size);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+    TEST_ASSERT_EQUAL_STRING_LEN(key1_val1, get_buf, strlen(key1_val1));
+
+    // Store is usable after dropping the batch
+    result = tdbs->set("new_key", set_buf, data_size, 0);
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    result = tdbs->deinit();
+    TEST_ASSERT_EQUAL_ERROR_CODE(MBED_SUCCESS, result);
+
+    delete[] get_buf;
+    delete[] set_buf;
+    delete[] scan_buf;
+
+    delete tdbs;
+}
+
 utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason)
 {
     greentea_case_failure_abort_handler(source, reason);
@@ -613,6 +1041,10 @@ Case cases[] = {
     Case("TDBStore: White box test",     white_box_test,    greentea_failure_handler),
     Case("TDBStore: Multiple set test",  multi_set_test,    greentea_failure_handler),
     Case("TDBStore: Error inject test",  error_inject_test, greentea_failure_handler),
+    Case("TDBStore: Many keys test",     many_keys_test,    greentea_failure_handler),
+    Case("TDBStore: Incremental GC test", incremental_gc_test, greentea_failure_handler),
+    Case("TDBStore: GC profiling test",  gc_profiling_test, greentea_failure_handler),
+    Case("TDBStore: Batch test",         batch_test,        greentea_failure_handler),
 };
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
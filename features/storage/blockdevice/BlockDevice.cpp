@@ -0,0 +1,125 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BlockDevice.h"
+
+#ifdef MBED_CONF_RTOS_PRESENT
+#include "events/EventQueue.h"
+#include "rtos/Thread.h"
+#include "platform/SingletonPtr.h"
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_ASYNC_QUEUE_SIZE
+#define MBED_CONF_BLOCKDEVICE_ASYNC_QUEUE_SIZE  8
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_ASYNC_STACK_SIZE
+#define MBED_CONF_BLOCKDEVICE_ASYNC_STACK_SIZE  2048
+#endif
+
+namespace mbed {
+
+namespace {
+
+enum async_op_t {
+    ASYNC_READ,
+    ASYNC_PROGRAM,
+    ASYNC_ERASE
+};
+
+typedef struct {
+    BlockDevice *bd;
+    async_op_t op;
+    void *buffer;
+    bd_addr_t addr;
+    bd_size_t size;
+    bd_callback_t callback;
+} async_request_t;
+
+void run_request(async_request_t req)
+{
+    int err;
+
+    switch (req.op) {
+        case ASYNC_READ:
+            err = req.bd->read(req.buffer, req.addr, req.size);
+            break;
+        case ASYNC_PROGRAM:
+            err = req.bd->program(req.buffer, req.addr, req.size);
+            break;
+        default:
+            err = req.bd->erase(req.addr, req.size);
+            break;
+    }
+
+    req.callback(err);
+}
+
+#ifdef MBED_CONF_RTOS_PRESENT
+// Worker thread running the requests of block devices without native asynchronous support
+class AsyncWorker {
+public:
+    AsyncWorker()
+        : _queue(MBED_CONF_BLOCKDEVICE_ASYNC_QUEUE_SIZE * (EVENTS_EVENT_SIZE + sizeof(async_request_t))),
+          _thread(osPriorityNormal, MBED_CONF_BLOCKDEVICE_ASYNC_STACK_SIZE, NULL, "bd_async")
+    {
+        _thread.start(callback(&_queue, &events::EventQueue::dispatch_forever));
+    }
+
+    int submit(const async_request_t &req)
+    {
+        return _queue.call(run_request, req) ? BD_ERROR_OK : BD_ERROR_WOULD_BLOCK;
+    }
+
+private:
+    events::EventQueue _queue;
+    rtos::Thread _thread;
+};
+
+SingletonPtr<AsyncWorker> async_worker;
+#endif
+
+int submit_request(BlockDevice *bd, async_op_t op, void *buffer, bd_addr_t addr, bd_size_t size,
+                   const bd_callback_t &callback)
+{
+    async_request_t req = {bd, op, buffer, addr, size, callback};
+
+#ifdef MBED_CONF_RTOS_PRESENT
+    return async_worker->submit(req);
+#else
+    run_request(req);
+    return BD_ERROR_OK;
+#endif
+}
+
+} // anonymous namespace
+
+int BlockDevice::read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_request(this, ASYNC_READ, buffer, addr, size, callback);
+}
+
+int BlockDevice::program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_request(this, ASYNC_PROGRAM, const_cast<void *>(buffer), addr, size, callback);
+}
+
+int BlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_request(this, ASYNC_ERASE, NULL, addr, size, callback);
+}
+
+} // namespace mbed
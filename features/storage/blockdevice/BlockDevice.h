@@ -21,6 +21,7 @@
 #define MBED_BLOCK_DEVICE_H
 
 #include <stdint.h>
+#include "platform/Callback.h"
 
 namespace mbed {
 
@@ -31,6 +32,7 @@ namespace mbed {
 enum bd_error {
     BD_ERROR_OK                 = 0,     /*!< no error */
     BD_ERROR_DEVICE_ERROR       = -4001, /*!< device specific error */
+    BD_ERROR_WOULD_BLOCK        = -4002, /*!< too many asynchronous requests in flight */
 };
 
 /** Type representing the address of a specific block
@@ -41,6 +43,13 @@ typedef uint64_t bd_addr_t;
  */
 typedef uint64_t bd_size_t;
 
+/** Completion callback of an asynchronous request
+ *
+ *  Called once with 0 on success or a negative error code on failure. Use an
+ *  event created with EventQueue::event() to handle the completion on a queue.
+ */
+typedef mbed::Callback<void(int)> bd_callback_t;
+
 
 /** A hardware device capable of writing and reading blocks
  */
@@ -138,6 +147,47 @@ public:
         return 0;
     }
 
+    /** Read blocks from a block device asynchronously
+     *
+     *  Block devices without native support run the request on a shared worker
+     *  thread, in submission order. Without an RTOS, the request is run before
+     *  this function returns.
+     *
+     *  @param buffer   Buffer to write blocks to, must stay valid until completion
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @param callback Callback to call with the result of the read
+     *  @return         0 if the request was submitted, in which case callback is
+     *                  always called, or a negative error code on failure
+     */
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Program blocks to a block device asynchronously
+     *
+     *  The blocks must have been erased prior to being programmed. See read_async
+     *  for how requests are run.
+     *
+     *  @param buffer   Buffer of data to write to blocks, must stay valid until completion
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @param callback Callback to call with the result of the program
+     *  @return         0 if the request was submitted, in which case callback is
+     *                  always called, or a negative error code on failure
+     */
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Erase blocks on a block device asynchronously
+     *
+     *  See read_async for how requests are run.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @param callback Callback to call with the result of the erase
+     *  @return         0 if the request was submitted, in which case callback is
+     *                  always called, or a negative error code on failure
+     */
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
     /** Get the size of a readable block
      *
      *  @return         Size of a readable block in bytes
@@ -242,8 +292,10 @@ public:
 using mbed::BlockDevice;
 using mbed::bd_addr_t;
 using mbed::bd_size_t;
+using mbed::bd_callback_t;
 using mbed::BD_ERROR_OK;
 using mbed::BD_ERROR_DEVICE_ERROR;
+using mbed::BD_ERROR_WOULD_BLOCK;
 #endif
 
 #endif
@@ -135,7 +135,7 @@ int BufferedBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
     MBED_ASSERT(_write_cache && _read_buf);
     // Common case - no need to involve write cache or read buffer
     if (_bd->is_valid_read(addr, size) &&
-            ((addr + size <= _write_cache_addr) || (addr > _write_cache_addr + _bd_program_size))) {
+            ((addr + size <= _write_cache_addr) || (addr >= _write_cache_addr + _bd_program_size))) {
         return _bd->read(b, addr, size);
     }
 
@@ -271,6 +271,49 @@ int BufferedBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return _bd->erase(addr, size);
 }
 
+int BufferedBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Reads involving the write cache or the read buffer run through read()
+    if (_bd->is_valid_read(addr, size) &&
+            ((addr + size <= _write_cache_addr) || (addr >= _write_cache_addr + _bd_program_size))) {
+        return _bd->read_async(b, addr, size, callback);
+    }
+    return BlockDevice::read_async(b, addr, size, callback);
+}
+
+int BufferedBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Whole program units bypass the write cache, which they overwrite if they cover it
+    if (_bd->is_valid_program(addr, size)) {
+        if ((_write_cache_addr >= addr) && (_write_cache_addr < addr + size)) {
+            invalidate_write_cache();
+        }
+        return _bd->program_async(b, addr, size, callback);
+    }
+    return BlockDevice::program_async(b, addr, size, callback);
+}
+
+int BufferedBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    if ((_write_cache_addr >= addr) && (_write_cache_addr <= addr + size)) {
+        invalidate_write_cache();
+    }
+    return _bd->erase_async(addr, size, callback);
+}
+
 int BufferedBlockDevice::trim(bd_addr_t addr, bd_size_t size)
 {
     MBED_ASSERT(is_valid_erase(addr, size));
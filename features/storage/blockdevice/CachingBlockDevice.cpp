@@ -0,0 +1,416 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CachingBlockDevice.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include <algorithm>
+#include <string.h>
+
+namespace mbed {
+
+static inline bd_addr_t align_down(bd_addr_t val, bd_size_t size)
+{
+    return val / size * size;
+}
+
+CachingBlockDevice::CachingBlockDevice(BlockDevice *bd, uint32_t line_count, uint32_t ways)
+    : _bd(bd), _line_size(0), _bd_size(0), _line_count(line_count), _ways(ways), _sets(0), _tick(0),
+      _lines(0), _cache(0), _hit_count(0), _miss_count(0), _evict_count(0), _init_ref_count(0),
+      _is_initialized(false)
+{
+    MBED_ASSERT(_line_count);
+    if (!_ways || (_ways > _line_count)) {
+        _ways = _line_count;
+    }
+    MBED_ASSERT(!(_line_count % _ways));
+    _sets = _line_count / _ways;
+}
+
+CachingBlockDevice::~CachingBlockDevice()
+{
+    deinit();
+}
+
+int CachingBlockDevice::init()
+{
+    uint32_t val = core_util_atomic_incr_u32(&_init_ref_count, 1);
+
+    if (val != 1) {
+        return BD_ERROR_OK;
+    }
+
+    int err = _bd->init();
+    if (err) {
+        return err;
+    }
+
+    _line_size = _bd->get_program_size();
+    _bd_size = _bd->size();
+
+    if (!_cache) {
+        _cache = new uint8_t[_line_count * _line_size];
+    }
+
+    if (!_lines) {
+        _lines = new cache_line_t[_line_count];
+    }
+
+    for (uint32_t i = 0; i < _line_count; i++) {
+        _lines[i].valid = false;
+        _lines[i].dirty = false;
+    }
+    _tick = 0;
+
+    _is_initialized = true;
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    uint32_t val = core_util_atomic_decr_u32(&_init_ref_count, 1);
+
+    if (val) {
+        return BD_ERROR_OK;
+    }
+
+    int ret = flush();
+
+    delete[] _cache;
+    _cache = 0;
+    delete[] _lines;
+    _lines = 0;
+    _is_initialized = false;
+
+    int err = _bd->deinit();
+    return ret ? ret : err;
+}
+
+int CachingBlockDevice::find_line(bd_addr_t addr) const
+{
+    uint32_t set = (addr / _line_size) % _sets;
+
+    for (uint32_t way = 0; way < _ways; way++) {
+        int line = way * _sets + set;
+        if (_lines[line].valid && (_lines[line].addr == addr)) {
+            return line;
+        }
+    }
+    return -1;
+}
+
+int CachingBlockDevice::alloc_line(bd_addr_t addr, bool fill, int &line)
+{
+    uint32_t set = (addr / _line_size) % _sets;
+    int victim = -1;
+
+    // Take a free line of the set, otherwise the least recently used one
+    for (uint32_t way = 0; way < _ways; way++) {
+        int cand = way * _sets + set;
+        if (!_lines[cand].valid) {
+            victim = cand;
+            break;
+        }
+        if ((victim < 0) || (_lines[cand].last_used < _lines[victim].last_used)) {
+            victim = cand;
+        }
+    }
+
+    if (_lines[victim].valid) {
+        if (_lines[victim].dirty) {
+            int ret = write_back(victim);
+            if (ret) {
+                return ret;
+            }
+        }
+        _lines[victim].valid = false;
+        _evict_count++;
+    }
+
+    if (fill) {
+        int ret = _bd->read(_cache + victim * _line_size, addr, _line_size);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    _lines[victim].addr = addr;
+    _lines[victim].valid = true;
+    _lines[victim].dirty = false;
+    _lines[victim].last_used = ++_tick;
+    line = victim;
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::write_back(int line)
+{
+    // Lines of the same way in consecutive sets are contiguous in memory, so dirty
+    // neighbours holding consecutive addresses can be programmed in a single call
+    int first = line;
+    while ((first % _sets) && _lines[first - 1].valid && _lines[first - 1].dirty &&
+            (_lines[first - 1].addr + _line_size == _lines[first].addr)) {
+        first--;
+    }
+
+    int last = line;
+    while (((last + 1) % _sets) && _lines[last + 1].valid && _lines[last + 1].dirty &&
+            (_lines[last].addr + _line_size == _lines[last + 1].addr)) {
+        last++;
+    }
+
+    int ret = _bd->program(_cache + first * _line_size, _lines[first].addr, (last - first + 1) * _line_size);
+    if (ret) {
+        return ret;
+    }
+
+    for (int i = first; i <= last; i++) {
+        _lines[i].dirty = false;
+    }
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::flush()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    for (uint32_t i = 0; i < _line_count; i++) {
+        if (_lines[i].valid && _lines[i].dirty) {
+            int ret = write_back(i);
+            if (ret) {
+                return ret;
+            }
+        }
+    }
+    return BD_ERROR_OK;
+}
+
+void CachingBlockDevice::invalidate(bd_addr_t addr, bd_size_t size)
+{
+    for (uint32_t i = 0; i < _line_count; i++) {
+        if (_lines[i].valid && (_lines[i].addr >= addr) && (_lines[i].addr < addr + size)) {
+            _lines[i].valid = false;
+            _lines[i].dirty = false;
+        }
+    }
+}
+
+int CachingBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int ret = flush();
+    if (ret) {
+        return ret;
+    }
+    return _bd->sync();
+}
+
+int CachingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t *buf = static_cast<uint8_t *>(b);
+
+    while (size) {
+        bd_addr_t line_addr = align_down(addr, _line_size);
+        bd_size_t offs = addr - line_addr;
+        bd_size_t chunk = std::min(_line_size - offs, size);
+
+        int line = find_line(line_addr);
+        if (line >= 0) {
+            memcpy(buf, _cache + line * _line_size + offs, chunk);
+            _lines[line].last_used = ++_tick;
+            _hit_count++;
+        } else if (chunk == _line_size) {
+            // Whole lines not in cache are read directly, as many as possible at once
+            while ((chunk + _line_size <= size) && (find_line(line_addr + chunk) < 0)) {
+                chunk += _line_size;
+            }
+            int ret = _bd->read(buf, addr, chunk);
+            if (ret) {
+                return ret;
+            }
+            _miss_count += chunk / _line_size;
+        } else {
+            int ret = alloc_line(line_addr, true, line);
+            if (ret) {
+                return ret;
+            }
+            memcpy(buf, _cache + line * _line_size + offs, chunk);
+            _miss_count++;
+        }
+
+        buf += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t *buf = static_cast<const uint8_t *>(b);
+
+    while (size) {
+        bd_addr_t line_addr = align_down(addr, _line_size);
+        bd_size_t offs = addr - line_addr;
+        bd_size_t chunk = std::min(_line_size - offs, size);
+
+        int line = find_line(line_addr);
+        if (line >= 0) {
+            _hit_count++;
+        } else if (chunk == _line_size) {
+            // Whole lines not in cache are programmed directly, as many as possible at once
+            while ((chunk + _line_size <= size) && (find_line(line_addr + chunk) < 0)) {
+                chunk += _line_size;
+            }
+            int ret = _bd->program(buf, addr, chunk);
+            if (ret) {
+                return ret;
+            }
+            _miss_count += chunk / _line_size;
+
+            buf += chunk;
+            addr += chunk;
+            size -= chunk;
+            continue;
+        } else {
+            // Partially programmed line needs the rest of its contents from the underlying BD
+            int ret = alloc_line(line_addr, true, line);
+            if (ret) {
+                return ret;
+            }
+            _miss_count++;
+        }
+
+        memcpy(_cache + line * _line_size + offs, buf, chunk);
+        _lines[line].dirty = true;
+        _lines[line].last_used = ++_tick;
+
+        buf += chunk;
+        addr += chunk;
+        size -= chunk;
+    }
+
+    return BD_ERROR_OK;
+}
+
+int CachingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    invalidate(addr, size);
+    return _bd->erase(addr, size);
+}
+
+int CachingBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    invalidate(addr, size);
+    return _bd->trim(addr, size);
+}
+
+bd_size_t CachingBlockDevice::get_read_size() const
+{
+    return 1;
+}
+
+bd_size_t CachingBlockDevice::get_program_size() const
+{
+    return 1;
+}
+
+bd_size_t CachingBlockDevice::get_erase_size() const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return _bd->get_erase_size();
+}
+
+bd_size_t CachingBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return _bd->get_erase_size(addr);
+}
+
+int CachingBlockDevice::get_erase_value() const
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return _bd->get_erase_value();
+}
+
+bd_size_t CachingBlockDevice::size() const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return _bd_size;
+}
+
+void CachingBlockDevice::reset_stats()
+{
+    _hit_count = 0;
+    _miss_count = 0;
+    _evict_count = 0;
+}
+
+bd_size_t CachingBlockDevice::get_hit_count() const
+{
+    return _hit_count;
+}
+
+bd_size_t CachingBlockDevice::get_miss_count() const
+{
+    return _miss_count;
+}
+
+bd_size_t CachingBlockDevice::get_evict_count() const
+{
+    return _evict_count;
+}
+
+} // namespace mbed
@@ -0,0 +1,285 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/** \addtogroup storage */
+/** @{*/
+
+#ifndef MBED_CACHING_BLOCK_DEVICE_H
+#define MBED_CACHING_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+#ifndef MBED_CONF_BLOCKDEVICE_CACHING_LINE_COUNT
+#define MBED_CONF_BLOCKDEVICE_CACHING_LINE_COUNT    8
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_CACHING_WAYS
+#define MBED_CONF_BLOCKDEVICE_CACHING_WAYS          2
+#endif
+
+namespace mbed {
+
+/** Block device caching accesses to another block device, allowing minimal read
+ *  and program sizes (of 1) for the underlying BD.
+ *
+ *  The cache is made of lines of the underlying program size, organized as a
+ *  set-associative cache with least recently used replacement. Programmed data
+ *  stays in its line until the line is evicted or the device is synced, adjacent
+ *  dirty lines are then programmed together. Accesses covering whole lines that
+ *  are not cached go straight to the underlying BD, so large transfers don't
+ *  flush the cache.
+ *
+ *  @note Programmed data may only reach the underlying BD on sync.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "HeapBlockDevice.h"
+ *  #include "CachingBlockDevice.h"
+ *
+ *  // Cache 16 program units of a heap block device, 4 per set
+ *  HeapBlockDevice mem(64*512, 1, 16, 512);
+ *  CachingBlockDevice cache(&mem, 16, 4);
+ *
+ *  // do block device work....
+ *
+ *  printf("hits: %lld\n", cache.get_hit_count());
+ *  printf("misses: %lld\n", cache.get_miss_count());
+ *  printf("evictions: %lld\n", cache.get_evict_count());
+ *  @endcode
+ */
+class CachingBlockDevice : public BlockDevice {
+public:
+    /** Lifetime of the caching block device
+     *
+     *  @param bd           Block device to back the CachingBlockDevice
+     *  @param line_count   Number of cache lines, each of the underlying program size
+     *  @param ways         Number of lines per set, must divide line_count
+     */
+    CachingBlockDevice(BlockDevice *bd,
+                       uint32_t line_count = MBED_CONF_BLOCKDEVICE_CACHING_LINE_COUNT,
+                       uint32_t ways = MBED_CONF_BLOCKDEVICE_CACHING_WAYS);
+
+    /** Lifetime of a block device
+     */
+    virtual ~CachingBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  Dirty cache lines are programmed to the underlying BD first.
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  The blocks must have been erased prior to being programmed
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  The state of an erased block is undefined until it has been programmed,
+     *  unless get_erase_value returns a non-negative byte value
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  This function provides a hint to the underlying block device that a region of blocks
+     *  is no longer in use and may be erased without side effects. Erase must still be called
+     *  before programming, but trimming allows flash-translation-layers to schedule erases when
+     *  the device is not busy.
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  If get_erase_value returns a non-negative byte value, the underlying
+     *  storage is set to that value when erased, and storage containing
+     *  that value can be programmed without another erase.
+     *
+     *  @return         The value of storage when erased, or -1 if you can't
+     *                  rely on the value of erased storage
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the underlying device
+     *
+     *  @return         Size of the underlying device in bytes
+     */
+    virtual bd_size_t size() const;
+
+    /** Reset the hit, miss and eviction counts to zero
+     */
+    void reset_stats();
+
+    /** Get number of cache line accesses served from the cache
+     *
+     *  @return The number of cache line accesses served from the cache
+     */
+    bd_size_t get_hit_count() const;
+
+    /** Get number of cache line accesses that went to the underlying block device
+     *
+     *  @return The number of cache line accesses that went to the underlying block device
+     */
+    bd_size_t get_miss_count() const;
+
+    /** Get number of cache lines replaced to make room for others
+     *
+     *  @return The number of cache lines replaced to make room for others
+     */
+    bd_size_t get_evict_count() const;
+
+protected:
+    typedef struct {
+        bd_addr_t addr;
+        uint32_t last_used;
+        bool valid;
+        bool dirty;
+    } cache_line_t;
+
+    BlockDevice *_bd;
+    bd_size_t _line_size;
+    bd_size_t _bd_size;
+    uint32_t _line_count;
+    uint32_t _ways;
+    uint32_t _sets;
+    uint32_t _tick;
+    cache_line_t *_lines;
+    uint8_t *_cache;
+    bd_size_t _hit_count;
+    bd_size_t _miss_count;
+    bd_size_t _evict_count;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    /** Find the cache line holding an address
+     *
+     *  @param addr     Line aligned address
+     *  @return         Index of the line, or -1 if not cached
+     */
+    int find_line(bd_addr_t addr) const;
+
+    /** Allocate a cache line for an address, evicting the least recently used line of its set
+     *
+     *  @param addr     Line aligned address
+     *  @param fill     Whether to read the line contents from the underlying BD
+     *  @param line     Index of the allocated line
+     *  @return         0 on success or a negative error code on failure
+     */
+    int alloc_line(bd_addr_t addr, bool fill, int &line);
+
+    /** Program a dirty cache line, along with the adjacent dirty lines
+     *
+     *  @param line     Index of the line
+     *  @return         0 on success or a negative error code on failure
+     */
+    int write_back(int line);
+
+    /** Program all dirty cache lines
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    int flush();
+
+    /** Drop cache lines in a range without programming them
+     *
+     *  @param addr     Address of the range
+     *  @param size     Size of the range
+     */
+    void invalidate(bd_addr_t addr, bd_size_t size);
+};
+
+} // namespace mbed
+
+// Added "using" for backwards compatibility
+#ifndef MBED_NO_GLOBAL_USING_DIRECTIVE
+using mbed::CachingBlockDevice;
+#endif
+
+#endif
+
+/** @}*/
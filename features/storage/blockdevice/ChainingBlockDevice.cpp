@@ -32,6 +32,44 @@ static bool is_aligned(uint64_t x, uint64_t alignment)
     return (x / alignment) * alignment == x;
 }
 
+enum async_op_t {
+    ASYNC_READ,
+    ASYNC_PROGRAM,
+    ASYNC_ERASE
+};
+
+// Asynchronous request spanning several block devices
+typedef struct {
+    volatile uint32_t pending;
+    volatile int err;
+    bd_callback_t callback;
+} split_request_t;
+
+static void split_request_done(split_request_t *req, int err)
+{
+    if (err) {
+        req->err = err;
+    }
+
+    if (!core_util_atomic_decr_u32(&req->pending, 1)) {
+        req->callback(req->err);
+        delete req;
+    }
+}
+
+static int submit_part(BlockDevice *bd, int op, uint8_t *buffer, bd_addr_t addr, bd_size_t size,
+                       const bd_callback_t &callback)
+{
+    switch (op) {
+        case ASYNC_READ:
+            return bd->read_async(buffer, addr, size, callback);
+        case ASYNC_PROGRAM:
+            return bd->program_async(buffer, addr, size, callback);
+        default:
+            return bd->erase_async(addr, size, callback);
+    }
+}
+
 int ChainingBlockDevice::init()
 {
     int err;
@@ -238,6 +276,94 @@ int ChainingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return 0;
 }
 
+int ChainingBlockDevice::submit_async(int op, uint8_t *buffer, bd_addr_t addr, bd_size_t size,
+                                      const bd_callback_t &callback)
+{
+    split_request_t *req = NULL;
+    size_t parts = 0;
+
+    // Find block devices containing blocks, may span multiple block devices
+    for (size_t i = 0; i < _bd_count && size > 0; i++) {
+        bd_size_t bdsize = _bds[i]->size();
+
+        if (addr < bdsize) {
+            bd_size_t part = size;
+            if (addr + part > bdsize) {
+                part = bdsize - addr;
+            }
+
+            // Common case - request fits in a single block device
+            if (!req && (part == size)) {
+                return submit_part(_bds[i], op, buffer, addr, size, callback);
+            }
+
+            // Parts run concurrently, the submission holds a reference until all are queued
+            if (!req) {
+                req = new split_request_t;
+                req->pending = 1;
+                req->err = 0;
+                req->callback = callback;
+            }
+
+            core_util_atomic_incr_u32(&req->pending, 1);
+            int err = submit_part(_bds[i], op, buffer, addr, part, mbed::callback(split_request_done, req));
+            if (err) {
+                if (!parts) {
+                    delete req;
+                    return err;
+                }
+                // Earlier parts are already in flight, report through the callback
+                split_request_done(req, err);
+                break;
+            }
+            parts++;
+
+            if (buffer) {
+                buffer += part;
+            }
+            addr += part;
+            size -= part;
+        }
+
+        addr -= bdsize;
+    }
+
+    if (req) {
+        split_request_done(req, 0);
+    }
+    return 0;
+}
+
+int ChainingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return submit_async(ASYNC_READ, static_cast<uint8_t *>(b), addr, size, callback);
+}
+
+int ChainingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return submit_async(ASYNC_PROGRAM, static_cast<uint8_t *>(const_cast<void *>(b)), addr, size, callback);
+}
+
+int ChainingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    return submit_async(ASYNC_ERASE, NULL, addr, size, callback);
+}
+
 bd_size_t ChainingBlockDevice::get_read_size() const
 {
     return _read_size;
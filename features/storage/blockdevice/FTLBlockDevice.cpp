@@ -0,0 +1,921 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FTLBlockDevice.h"
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+#include "MbedCRC.h"
+#include <algorithm>
+#include <string.h>
+
+namespace mbed {
+
+// Every erase unit starts with a header, followed by the tags of its slots and their data:
+//
+//   | header | tag 0 | tag 1 | ... | tag N-1 | sector 0 | sector 1 | ... | sector N-1 |
+//
+// A slot is programmed before its tag, so a valid tag always points at complete data.
+// Checkpoint units hold an info block after the header, followed by the remap table entries.
+
+static const uint32_t ftl_magic = 0x314C5446; // "FTL1"
+static const uint16_t ftl_version = 1;
+static const uint32_t initial_crc = 0xFFFFFFFF;
+static const uint32_t unmapped = 0xFFFFFFFF;
+static const uint32_t unknown_erase_count = 0xFFFFFFFF;
+static const bd_size_t min_buf_size = 64;
+
+enum {
+    UNIT_FREE = 0,
+    UNIT_DATA,
+    UNIT_CHECKPOINT
+};
+
+typedef struct {
+    uint32_t magic;
+    uint16_t type;
+    uint16_t version;
+    uint32_t seq;
+    uint32_t erase_count;
+    uint32_t crc;
+} unit_header_t;
+
+typedef struct {
+    uint32_t lba;
+    uint32_t crc;
+} sector_tag_t;
+
+typedef struct {
+    uint32_t lba;
+    uint32_t seq;
+    uint32_t slot;
+} sector_tag_crc_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t part;
+    uint32_t parts;
+    uint32_t sector_count;
+    uint32_t watermark;
+    uint32_t active_ptr;
+    uint32_t map_crc;
+    uint32_t crc;
+} checkpoint_info_t;
+
+static inline bd_size_t align_up(bd_size_t val, bd_size_t size)
+{
+    return (val + size - 1) / size * size;
+}
+
+static uint32_t tag_crc(uint32_t lba, uint32_t seq, uint32_t slot)
+{
+    sector_tag_crc_t crc_data = {lba, seq, slot};
+    return crc32_ansi(initial_crc, sizeof(crc_data), &crc_data);
+}
+
+FTLBlockDevice::FTLBlockDevice(BlockDevice *bd, bd_size_t sector_size, uint32_t spare_units,
+                               uint32_t wear_threshold)
+    : _bd(bd), _sector_size(sector_size), _spare_units(spare_units), _wear_threshold(wear_threshold),
+      _unit_size(0), _header_size(0), _tag_size(0), _data_offset(0), _buf_size(0), _unit_count(0),
+      _slots(0), _sector_count(0), _ckpt_parts(0), _ckpt_entries(0), _seq(0), _active(0),
+      _active_ptr(0), _units_since_ckpt(0), _dirty(false), _in_reclaim(false), _units(0), _map(0),
+      _buf(0), _init_ref_count(0), _is_initialized(false)
+{
+}
+
+FTLBlockDevice::~FTLBlockDevice()
+{
+    deinit();
+}
+
+int FTLBlockDevice::init()
+{
+    int err;
+    uint32_t val = core_util_atomic_incr_u32(&_init_ref_count, 1);
+
+    if (val != 1) {
+        return BD_ERROR_OK;
+    }
+
+    err = _bd->init();
+    if (err) {
+        goto fail;
+    }
+
+    // Geometry, sectors must fit in units along with their tags
+    _unit_size = _bd->get_erase_size();
+    bd_size_t prog_size;
+    prog_size = _bd->get_program_size();
+    if (!_unit_size || (_bd->size() % _unit_size) || (_sector_size % prog_size) ||
+            (_sector_size % _bd->get_read_size())) {
+        err = BD_ERROR_DEVICE_ERROR;
+        goto fail;
+    }
+
+    _header_size = align_up(sizeof(unit_header_t), prog_size);
+    _tag_size = align_up(sizeof(sector_tag_t), prog_size);
+    _buf_size = align_up(min_buf_size, prog_size);
+    _unit_count = _bd->size() / _unit_size;
+    _slots = (_unit_size - _header_size) / (_sector_size + _tag_size);
+    _data_offset = _header_size + _slots * _tag_size;
+    if (!_slots || (_slots > 0xFFFF) || (_unit_size < _header_size + align_up(sizeof(checkpoint_info_t), prog_size) + _buf_size)) {
+        err = BD_ERROR_DEVICE_ERROR;
+        goto fail;
+    }
+
+    // Units are needed for the active unit, a reclaim reserve, the spares and
+    // two checkpoints, as a new one is written before the previous one is dropped
+    bd_size_t ckpt_space;
+    ckpt_space = _unit_size - _header_size - align_up(sizeof(checkpoint_info_t), prog_size);
+    _ckpt_entries = ckpt_space / _buf_size * _buf_size / sizeof(uint32_t);
+    _ckpt_parts = 1;
+    while (true) {
+        uint32_t reserved = 2 + _spare_units + 2 * _ckpt_parts;
+        if (_unit_count <= reserved) {
+            err = BD_ERROR_DEVICE_ERROR;
+            goto fail;
+        }
+        _sector_count = (_unit_count - reserved) * _slots;
+        uint32_t parts = (_sector_count + _ckpt_entries - 1) / _ckpt_entries;
+        if (parts <= _ckpt_parts) {
+            break;
+        }
+        _ckpt_parts = parts;
+    }
+
+    if (!_units) {
+        _units = new unit_info_t[_unit_count];
+    }
+    if (!_map) {
+        _map = new uint32_t[_sector_count];
+    }
+    if (!_buf) {
+        _buf = new uint8_t[_buf_size + _sector_size];
+    }
+
+    err = mount();
+    if (err) {
+        goto fail;
+    }
+
+    _is_initialized = true;
+    return BD_ERROR_OK;
+
+fail:
+    delete[] _units;
+    _units = 0;
+    delete[] _map;
+    _map = 0;
+    delete[] _buf;
+    _buf = 0;
+    _is_initialized = false;
+    _init_ref_count = 0;
+    return err;
+}
+
+int FTLBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    uint32_t val = core_util_atomic_decr_u32(&_init_ref_count, 1);
+
+    if (val) {
+        return BD_ERROR_OK;
+    }
+
+    int ret = BD_ERROR_OK;
+    if (_dirty) {
+        ret = write_checkpoint();
+    }
+
+    delete[] _units;
+    _units = 0;
+    delete[] _map;
+    _map = 0;
+    delete[] _buf;
+    _buf = 0;
+    _is_initialized = false;
+
+    int err = _bd->deinit();
+    return ret ? ret : err;
+}
+
+bd_addr_t FTLBlockDevice::unit_addr(uint32_t unit) const
+{
+    return (bd_addr_t)unit * _unit_size;
+}
+
+int FTLBlockDevice::read_header(uint32_t unit, uint8_t &type, uint32_t &seq, uint32_t &erase_count)
+{
+    unit_header_t header;
+
+    type = UNIT_FREE;
+    int ret = _bd->read(_buf, unit_addr(unit), _header_size);
+    if (ret) {
+        return ret;
+    }
+    memcpy(&header, _buf, sizeof(header));
+
+    if ((header.magic != ftl_magic) || (header.version != ftl_version) ||
+            (header.crc != crc32_ansi(initial_crc, sizeof(header) - sizeof(header.crc), &header))) {
+        return BD_ERROR_OK;
+    }
+
+    type = header.type;
+    seq = header.seq;
+    erase_count = header.erase_count;
+    return BD_ERROR_OK;
+}
+
+uint32_t FTLBlockDevice::free_units() const
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if (_units[i].type == UNIT_FREE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int FTLBlockDevice::alloc_unit(uint8_t type, uint32_t &unit)
+{
+    int ret;
+    int best = -1;
+
+    // Dynamic wear leveling: use the least erased free unit
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if ((_units[i].type == UNIT_FREE) &&
+                ((best < 0) || (_units[i].erase_count < _units[best].erase_count))) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    unit_info_t &info = _units[best];
+    if (!info.erased) {
+        ret = _bd->erase(unit_addr(best), _unit_size);
+        if (ret) {
+            return ret;
+        }
+        info.erase_count++;
+    }
+
+    unit_header_t header;
+    header.magic = ftl_magic;
+    header.type = type;
+    header.version = ftl_version;
+    header.seq = ++_seq;
+    header.erase_count = info.erase_count;
+    header.crc = crc32_ansi(initial_crc, sizeof(header) - sizeof(header.crc), &header);
+
+    memset(_buf, 0, _header_size);
+    memcpy(_buf, &header, sizeof(header));
+    info.erased = false;
+    ret = _bd->program(_buf, unit_addr(best), _header_size);
+    if (ret) {
+        return ret;
+    }
+
+    info.type = type;
+    info.seq = header.seq;
+    info.valid = 0;
+    unit = best;
+    return BD_ERROR_OK;
+}
+
+void FTLBlockDevice::free_unit(uint32_t unit)
+{
+    _units[unit].type = UNIT_FREE;
+    _units[unit].valid = 0;
+    if (unit == _active) {
+        _active = _unit_count;
+    }
+}
+
+int FTLBlockDevice::read_tag(uint32_t unit, uint32_t slot, uint32_t &lba)
+{
+    sector_tag_t tag;
+
+    lba = unmapped;
+    int ret = _bd->read(_buf, unit_addr(unit) + _header_size + slot * _tag_size, _tag_size);
+    if (ret) {
+        return ret;
+    }
+    memcpy(&tag, _buf, sizeof(tag));
+
+    if ((tag.lba < _sector_count) && (tag.crc == tag_crc(tag.lba, _units[unit].seq, slot))) {
+        lba = tag.lba;
+    }
+    return BD_ERROR_OK;
+}
+
+void FTLBlockDevice::unmap(uint32_t lba)
+{
+    uint32_t phys = _map[lba];
+    if (phys != unmapped) {
+        _units[phys / _slots].valid--;
+        _map[lba] = unmapped;
+    }
+}
+
+int FTLBlockDevice::reclaim_unit(uint32_t unit)
+{
+    int ret = BD_ERROR_OK;
+    bool in_reclaim = _in_reclaim;
+    uint8_t *sector_buf = _buf + _buf_size;
+
+    MBED_ASSERT(unit != _active);
+    _in_reclaim = true;
+
+    // Move the sectors whose latest copy is in this unit
+    for (uint32_t slot = 0; (slot < _slots) && _units[unit].valid; slot++) {
+        uint32_t lba;
+        ret = read_tag(unit, slot, lba);
+        if (ret) {
+            break;
+        }
+        if ((lba == unmapped) || (_map[lba] != unit * _slots + slot)) {
+            continue;
+        }
+
+        ret = _bd->read(sector_buf, unit_addr(unit) + _data_offset + slot * _sector_size, _sector_size);
+        if (ret) {
+            break;
+        }
+        ret = write_sector(lba, sector_buf);
+        if (ret) {
+            break;
+        }
+    }
+
+    _in_reclaim = in_reclaim;
+    if (ret) {
+        return ret;
+    }
+
+    free_unit(unit);
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::make_space(uint32_t min_free)
+{
+    // Greedy reclaim of the units with the fewest valid sectors
+    while (free_units() < min_free) {
+        int victim = -1;
+        for (uint32_t i = 0; i < _unit_count; i++) {
+            if ((_units[i].type == UNIT_DATA) && (i != _active) &&
+                    ((victim < 0) || (_units[i].valid < _units[victim].valid))) {
+                victim = i;
+            }
+        }
+        if ((victim < 0) || (_units[victim].valid >= _slots)) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+
+        int ret = reclaim_unit(victim);
+        if (ret) {
+            return ret;
+        }
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::level_wear()
+{
+    // Static wear leveling: move data out of the least erased unit once it lags
+    // too far behind, so that it gets reused
+    int cold = -1;
+    uint32_t max_erase_count = 0;
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        max_erase_count = std::max(max_erase_count, _units[i].erase_count);
+        if ((_units[i].type == UNIT_DATA) && (i != _active) &&
+                ((cold < 0) || (_units[i].erase_count < _units[cold].erase_count))) {
+            cold = i;
+        }
+    }
+    if ((cold < 0) || (max_erase_count - _units[cold].erase_count <= _wear_threshold)) {
+        return BD_ERROR_OK;
+    }
+    return reclaim_unit(cold);
+}
+
+int FTLBlockDevice::write_sector(uint32_t lba, const void *data)
+{
+    int ret;
+
+    while ((_active >= _unit_count) || (_active_ptr >= _slots)) {
+        _active = _unit_count;
+        if (!_in_reclaim) {
+            // Keep one free unit in reserve for the sectors moved by reclaims
+            ret = make_space(2);
+            if (!ret) {
+                ret = level_wear();
+            }
+            if (ret) {
+                return ret;
+            }
+            // Sectors moved by the reclaim may have opened a new unit already
+            if ((_active < _unit_count) && (_active_ptr < _slots)) {
+                break;
+            }
+        }
+        ret = alloc_unit(UNIT_DATA, _active);
+        if (ret) {
+            _active = _unit_count;
+            return ret;
+        }
+        _active_ptr = 0;
+        _units_since_ckpt++;
+    }
+
+    // The slot is consumed even if programming fails, as it may be partially programmed
+    uint32_t slot = _active_ptr++;
+    bd_addr_t addr = unit_addr(_active);
+
+    ret = _bd->program(data, addr + _data_offset + slot * _sector_size, _sector_size);
+    if (ret) {
+        return ret;
+    }
+
+    sector_tag_t tag;
+    tag.lba = lba;
+    tag.crc = tag_crc(lba, _units[_active].seq, slot);
+    memset(_buf, 0, _tag_size);
+    memcpy(_buf, &tag, sizeof(tag));
+    ret = _bd->program(_buf, addr + _header_size + slot * _tag_size, _tag_size);
+    if (ret) {
+        return ret;
+    }
+
+    unmap(lba);
+    _map[lba] = _active * _slots + slot;
+    _units[_active].valid++;
+    _dirty = true;
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::replay_unit(uint32_t unit, uint32_t from_slot)
+{
+    for (uint32_t slot = from_slot; slot < _slots; slot++) {
+        uint32_t lba;
+        int ret = read_tag(unit, slot, lba);
+        if (ret) {
+            return ret;
+        }
+        if (lba != unmapped) {
+            _map[lba] = unit * _slots + slot;
+        }
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::load_checkpoint(uint32_t &watermark, uint32_t &ptr)
+{
+    bd_size_t info_size = align_up(sizeof(checkpoint_info_t), _bd->get_program_size());
+    uint32_t tried = 0xFFFFFFFF;
+
+    // Try the checkpoints from the most recent one, until one is complete
+    while (true) {
+        int first = -1;
+        for (uint32_t i = 0; i < _unit_count; i++) {
+            if ((_units[i].type == UNIT_CHECKPOINT) && (_units[i].seq < tried) &&
+                    ((first < 0) || (_units[i].seq > _units[first].seq))) {
+                first = i;
+            }
+        }
+        if (first < 0) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        uint32_t id = _units[first].seq;
+        tried = id;
+
+        // Parts are allocated one after another, so part p has sequence number id + p
+        uint32_t map_crc = initial_crc;
+        checkpoint_info_t info;
+        bool complete = true;
+        for (uint32_t part = 0; complete && (part < _ckpt_parts); part++) {
+            uint32_t unit = _unit_count;
+            for (uint32_t i = 0; i < _unit_count; i++) {
+                if ((_units[i].type == UNIT_CHECKPOINT) && (_units[i].seq == id + part)) {
+                    unit = i;
+                    break;
+                }
+            }
+            if (unit == _unit_count) {
+                complete = false;
+                break;
+            }
+
+            int ret = _bd->read(_buf, unit_addr(unit) + _header_size, info_size);
+            if (ret) {
+                return ret;
+            }
+            memcpy(&info, _buf, sizeof(info));
+            if ((info.crc != crc32_ansi(initial_crc, sizeof(info) - sizeof(info.crc), &info)) ||
+                    (info.id != id) || (info.part != part) || (info.parts != _ckpt_parts) ||
+                    (info.sector_count != _sector_count)) {
+                complete = false;
+                break;
+            }
+
+            uint32_t start = part * _ckpt_entries;
+            uint32_t count = std::min(_ckpt_entries, _sector_count - start);
+            bd_addr_t addr = unit_addr(unit) + _header_size + info_size;
+            for (uint32_t done = 0; done < count;) {
+                uint32_t chunk = std::min((uint32_t)(_buf_size / sizeof(uint32_t)), count - done);
+                ret = _bd->read(_buf, addr, _buf_size);
+                if (ret) {
+                    return ret;
+                }
+                memcpy(_map + start + done, _buf, chunk * sizeof(uint32_t));
+                map_crc = crc32_ansi(map_crc, chunk * sizeof(uint32_t), _buf);
+                addr += _buf_size;
+                done += chunk;
+            }
+        }
+
+        if (complete && (map_crc == info.map_crc)) {
+            watermark = info.watermark;
+            ptr = info.active_ptr;
+            break;
+        }
+    }
+
+    // Entries pointing to units rewritten since the checkpoint are replayed from those units
+    for (uint32_t lba = 0; lba < _sector_count; lba++) {
+        uint32_t unit = _map[lba] / _slots;
+        if ((_map[lba] != unmapped) &&
+                ((unit >= _unit_count) || (_units[unit].type != UNIT_DATA) || (_units[unit].seq > watermark))) {
+            _map[lba] = unmapped;
+        }
+    }
+
+    // Drop the other checkpoints, older or incomplete
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if ((_units[i].type == UNIT_CHECKPOINT) &&
+                ((_units[i].seq < tried) || (_units[i].seq >= tried + _ckpt_parts))) {
+            _units[i].type = UNIT_FREE;
+        }
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::write_checkpoint()
+{
+    int ret;
+    bd_size_t info_size = align_up(sizeof(checkpoint_info_t), _bd->get_program_size());
+
+    // Free units for the whole checkpoint, plus the reclaim reserve
+    ret = make_space(_ckpt_parts + 1);
+    if (ret) {
+        return ret;
+    }
+
+    checkpoint_info_t info;
+    info.parts = _ckpt_parts;
+    info.sector_count = _sector_count;
+    if (_active < _unit_count) {
+        info.watermark = _units[_active].seq;
+        info.active_ptr = _active_ptr;
+    } else {
+        info.watermark = _seq;
+        info.active_ptr = _slots;
+    }
+    info.map_crc = crc32_ansi(initial_crc, _sector_count * sizeof(uint32_t), _map);
+
+    uint32_t id = 0;
+    for (uint32_t part = 0; part < _ckpt_parts; part++) {
+        uint32_t unit;
+        ret = alloc_unit(UNIT_CHECKPOINT, unit);
+        if (ret) {
+            return ret;
+        }
+        if (!part) {
+            id = _units[unit].seq;
+        }
+
+        info.id = id;
+        info.part = part;
+        info.crc = crc32_ansi(initial_crc, sizeof(info) - sizeof(info.crc), &info);
+        memset(_buf, 0, info_size);
+        memcpy(_buf, &info, sizeof(info));
+        ret = _bd->program(_buf, unit_addr(unit) + _header_size, info_size);
+        if (ret) {
+            return ret;
+        }
+
+        uint32_t start = part * _ckpt_entries;
+        uint32_t count = std::min(_ckpt_entries, _sector_count - start);
+        bd_addr_t addr = unit_addr(unit) + _header_size + info_size;
+        for (uint32_t done = 0; done < count;) {
+            uint32_t chunk = std::min((uint32_t)(_buf_size / sizeof(uint32_t)), count - done);
+            memset(_buf, 0xFF, _buf_size);
+            memcpy(_buf, _map + start + done, chunk * sizeof(uint32_t));
+            ret = _bd->program(_buf, addr, _buf_size);
+            if (ret) {
+                return ret;
+            }
+            addr += _buf_size;
+            done += chunk;
+        }
+    }
+
+    // The new checkpoint is complete, previous ones can go
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if ((_units[i].type == UNIT_CHECKPOINT) && (_units[i].seq < id)) {
+            free_unit(i);
+        }
+    }
+
+    _units_since_ckpt = 0;
+    _dirty = false;
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::mount()
+{
+    int ret;
+    uint32_t known_erase_total = 0;
+    uint32_t known_units = 0;
+
+    _seq = 0;
+    _active = _unit_count;
+    _active_ptr = 0;
+    _in_reclaim = false;
+
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        uint8_t type;
+        uint32_t seq = 0;
+        uint32_t erase_count = unknown_erase_count;
+        ret = read_header(i, type, seq, erase_count);
+        if (ret) {
+            return ret;
+        }
+
+        _units[i].type = type;
+        _units[i].seq = seq;
+        _units[i].erase_count = erase_count;
+        _units[i].valid = 0;
+        _units[i].erased = false;
+        if (type != UNIT_FREE) {
+            _seq = std::max(_seq, seq);
+            known_erase_total += erase_count;
+            known_units++;
+        }
+    }
+
+    // Units without a valid header lost their erase count, assume the average
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if (_units[i].erase_count == unknown_erase_count) {
+            _units[i].erase_count = known_units ? known_erase_total / known_units : 0;
+        }
+    }
+
+    for (uint32_t lba = 0; lba < _sector_count; lba++) {
+        _map[lba] = unmapped;
+    }
+
+    uint32_t watermark = 0;
+    uint32_t ptr = 0;
+    if (load_checkpoint(watermark, ptr)) {
+        watermark = 0;
+        for (uint32_t lba = 0; lba < _sector_count; lba++) {
+            _map[lba] = unmapped;
+        }
+        for (uint32_t i = 0; i < _unit_count; i++) {
+            if (_units[i].type == UNIT_CHECKPOINT) {
+                _units[i].type = UNIT_FREE;
+            }
+        }
+    }
+
+    // Replay the units written since the checkpoint, oldest first
+    uint32_t last_seq = 0;
+    bool first = true;
+    _units_since_ckpt = 0;
+    while (true) {
+        int next = -1;
+        for (uint32_t i = 0; i < _unit_count; i++) {
+            if ((_units[i].type == UNIT_DATA) && (_units[i].seq >= watermark) &&
+                    (first || (_units[i].seq > last_seq)) &&
+                    ((next < 0) || (_units[i].seq < _units[next].seq))) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+
+        last_seq = _units[next].seq;
+        first = false;
+        ret = replay_unit(next, (last_seq == watermark) ? ptr : 0);
+        if (ret) {
+            return ret;
+        }
+        _units_since_ckpt++;
+    }
+
+    for (uint32_t lba = 0; lba < _sector_count; lba++) {
+        if (_map[lba] != unmapped) {
+            _units[_map[lba] / _slots].valid++;
+        }
+    }
+
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if ((_units[i].type == UNIT_DATA) && !_units[i].valid) {
+            _units[i].type = UNIT_FREE;
+        }
+    }
+
+    // Writes always resume in a fresh unit, the previous one may end in a torn slot
+    _dirty = _units_since_ckpt != 0;
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    if (_units_since_ckpt >= MBED_CONF_BLOCKDEVICE_FTL_CHECKPOINT_INTERVAL) {
+        int ret = write_checkpoint();
+        if (ret) {
+            return ret;
+        }
+    }
+    return _bd->sync();
+}
+
+int FTLBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    uint8_t *buf = static_cast<uint8_t *>(b);
+    for (uint32_t lba = addr / _sector_size; size; lba++) {
+        uint32_t phys = _map[lba];
+        if (phys == unmapped) {
+            memset(buf, 0xFF, _sector_size);
+        } else {
+            int ret = _bd->read(buf, unit_addr(phys / _slots) + _data_offset + (phys % _slots) * _sector_size,
+                                _sector_size);
+            if (ret) {
+                return ret;
+            }
+        }
+        buf += _sector_size;
+        size -= _sector_size;
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t *buf = static_cast<const uint8_t *>(b);
+    for (uint32_t lba = addr / _sector_size; size; lba++) {
+        int ret = write_sector(lba, buf);
+        if (ret) {
+            return ret;
+        }
+        buf += _sector_size;
+        size -= _sector_size;
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    return trim(addr, size);
+}
+
+int FTLBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    for (uint32_t lba = addr / _sector_size; size; lba++) {
+        if (_map[lba] != unmapped) {
+            unmap(lba);
+            _dirty = true;
+        }
+        size -= _sector_size;
+    }
+    return BD_ERROR_OK;
+}
+
+int FTLBlockDevice::reclaim()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    // Keep enough free units for a checkpoint and the spares, no more
+    if (free_units() >= _ckpt_parts + 2 + _spare_units) {
+        return 0;
+    }
+
+    int victim = -1;
+    for (uint32_t i = 0; i < _unit_count; i++) {
+        if ((_units[i].type == UNIT_DATA) && (i != _active) &&
+                ((victim < 0) || (_units[i].valid < _units[victim].valid))) {
+            victim = i;
+        }
+    }
+    if ((victim < 0) || (_units[victim].valid >= _slots)) {
+        return 0;
+    }
+
+    int ret = reclaim_unit(victim);
+    if (ret) {
+        return ret;
+    }
+
+    ret = _bd->erase(unit_addr(victim), _unit_size);
+    if (ret) {
+        return ret;
+    }
+    _units[victim].erase_count++;
+    _units[victim].erased = true;
+    return 1;
+}
+
+bd_size_t FTLBlockDevice::get_read_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t FTLBlockDevice::get_program_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t FTLBlockDevice::get_erase_size() const
+{
+    return _sector_size;
+}
+
+bd_size_t FTLBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _sector_size;
+}
+
+int FTLBlockDevice::get_erase_value() const
+{
+    return -1;
+}
+
+bd_size_t FTLBlockDevice::size() const
+{
+    if (!_is_initialized) {
+        return 0;
+    }
+
+    return (bd_size_t)_sector_count * _sector_size;
+}
+
+uint32_t FTLBlockDevice::get_min_erase_count() const
+{
+    uint32_t count = 0xFFFFFFFF;
+    for (uint32_t i = 0; _units && (i < _unit_count); i++) {
+        count = std::min(count, _units[i].erase_count);
+    }
+    return _units ? count : 0;
+}
+
+uint32_t FTLBlockDevice::get_max_erase_count() const
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; _units && (i < _unit_count); i++) {
+        count = std::max(count, _units[i].erase_count);
+    }
+    return count;
+}
+
+} // namespace mbed
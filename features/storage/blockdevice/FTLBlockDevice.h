@@ -0,0 +1,286 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/** \addtogroup storage */
+/** @{*/
+
+#ifndef MBED_FTL_BLOCK_DEVICE_H
+#define MBED_FTL_BLOCK_DEVICE_H
+
+#include "BlockDevice.h"
+
+#ifndef MBED_CONF_BLOCKDEVICE_FTL_SECTOR_SIZE
+#define MBED_CONF_BLOCKDEVICE_FTL_SECTOR_SIZE           512
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_FTL_SPARE_UNITS
+#define MBED_CONF_BLOCKDEVICE_FTL_SPARE_UNITS           2
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_FTL_WEAR_THRESHOLD
+#define MBED_CONF_BLOCKDEVICE_FTL_WEAR_THRESHOLD        16
+#endif
+
+#ifndef MBED_CONF_BLOCKDEVICE_FTL_CHECKPOINT_INTERVAL
+#define MBED_CONF_BLOCKDEVICE_FTL_CHECKPOINT_INTERVAL   16
+#endif
+
+namespace mbed {
+
+/** Flash translation layer, presenting small logical sectors over the large
+ *  erase units of a flash block device, with wear leveling
+ *
+ *  Sectors are written out of place, appended to the current unit along with a
+ *  tag recording their logical address, and a remap table in RAM points to their
+ *  latest copy. Units holding stale copies are reclaimed when free units run low,
+ *  the least erased free unit being used next. Units holding cold data are
+ *  reclaimed as well when the spread of erase counts exceeds a threshold, so that
+ *  they join the wear cycle.
+ *
+ *  The remap table is rebuilt on init from the tags, which makes it safe against
+ *  power loss. Checkpoints of the table are written periodically on sync and on
+ *  deinit, so that only units written since need to be scanned.
+ *
+ *  Erased sectors read as undefined data, and may read back as one of their
+ *  previous contents after a power loss.
+ *
+ *  @code
+ *  #include "mbed.h"
+ *  #include "SPIFBlockDevice.h"
+ *  #include "FTLBlockDevice.h"
+ *  #include "FATFileSystem.h"
+ *
+ *  SPIFBlockDevice spif(MBED_CONF_SPIF_DRIVER_SPI_MOSI, MBED_CONF_SPIF_DRIVER_SPI_MISO,
+ *                       MBED_CONF_SPIF_DRIVER_SPI_CLK, MBED_CONF_SPIF_DRIVER_SPI_CS);
+ *
+ *  // 512 byte sectors over the 4KB erase units of the SPI flash
+ *  FTLBlockDevice ftl(&spif, 512);
+ *  FATFileSystem fs("fs", &ftl);
+ *  @endcode
+ */
+class FTLBlockDevice : public BlockDevice {
+public:
+    /** Lifetime of the flash translation layer
+     *
+     *  @param bd               Block device to back the FTLBlockDevice
+     *  @param sector_size      Size of the logical sectors, must be a multiple of the
+     *                          underlying program size
+     *  @param spare_units      Number of erase units kept free of user data on top of
+     *                          the ones required to operate, more spares reduce
+     *                          write amplification
+     *  @param wear_threshold   Difference in erase counts between units that triggers
+     *                          static wear leveling
+     */
+    FTLBlockDevice(BlockDevice *bd,
+                   bd_size_t sector_size = MBED_CONF_BLOCKDEVICE_FTL_SECTOR_SIZE,
+                   uint32_t spare_units = MBED_CONF_BLOCKDEVICE_FTL_SPARE_UNITS,
+                   uint32_t wear_threshold = MBED_CONF_BLOCKDEVICE_FTL_WEAR_THRESHOLD);
+
+    /** Lifetime of a block device
+     */
+    virtual ~FTLBlockDevice();
+
+    /** Initialize a block device
+     *
+     *  Rebuilds the remap table from the last checkpoint and the units written since.
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int init();
+
+    /** Deinitialize a block device
+     *
+     *  Writes a checkpoint of the remap table if it changed.
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int deinit();
+
+    /** Ensure data on storage is in sync with the driver
+     *
+     *  @return         0 on success or a negative error code on failure
+     */
+    virtual int sync();
+
+    /** Read blocks from a block device
+     *
+     *  @param buffer   Buffer to read blocks into
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int read(void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Program blocks to a block device
+     *
+     *  @param buffer   Buffer of data to write to blocks
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size);
+
+    /** Erase blocks on a block device
+     *
+     *  Only unmaps the sectors, the underlying units are reclaimed later.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int erase(bd_addr_t addr, bd_size_t size);
+
+    /** Mark blocks as no longer in use
+     *
+     *  Unmaps the sectors, so that reclaiming their units doesn't copy them.
+     *
+     *  @param addr     Address of block to mark as unused
+     *  @param size     Size to mark as unused in bytes, must be a multiple of erase block size
+     *  @return         0 on success, negative error code on failure
+     */
+    virtual int trim(bd_addr_t addr, bd_size_t size);
+
+    /** Reclaim one erase unit ahead of time
+     *
+     *  Moves the valid sectors out of the unit holding the most stale ones and
+     *  erases it, so that later writes don't have to. Meant to be called when
+     *  the device is idle, for example from a low priority thread.
+     *
+     *  @return         1 if a unit was reclaimed, 0 if there was nothing to
+     *                  reclaim, negative error code on failure
+     */
+    int reclaim();
+
+    /** Get the size of a readable block
+     *
+     *  @return         Size of a readable block in bytes
+     */
+    virtual bd_size_t get_read_size() const;
+
+    /** Get the size of a programmable block
+     *
+     *  @return         Size of a programmable block in bytes
+     *  @note Must be a multiple of the read size
+     */
+    virtual bd_size_t get_program_size() const;
+
+    /** Get the size of an erasable block
+     *
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size() const;
+
+    /** Get the size of an erasable block given address
+     *
+     *  @param addr     Address within the erasable block
+     *  @return         Size of an erasable block in bytes
+     *  @note Must be a multiple of the program size
+     */
+    virtual bd_size_t get_erase_size(bd_addr_t addr) const;
+
+    /** Get the value of storage when erased
+     *
+     *  @return         -1, erased sectors have undefined contents
+     */
+    virtual int get_erase_value() const;
+
+    /** Get the total size of the logical device
+     *
+     *  @return         Size of the logical device in bytes
+     */
+    virtual bd_size_t size() const;
+
+    /** Get the lowest erase count of the erase units
+     *
+     *  @return         Lowest erase count, as recorded by this layer
+     */
+    uint32_t get_min_erase_count() const;
+
+    /** Get the highest erase count of the erase units
+     *
+     *  @return         Highest erase count, as recorded by this layer
+     */
+    uint32_t get_max_erase_count() const;
+
+private:
+    typedef struct {
+        uint32_t seq;
+        uint32_t erase_count;
+        uint16_t valid;
+        uint8_t type;
+        bool erased;
+    } unit_info_t;
+
+    BlockDevice *_bd;
+    bd_size_t _sector_size;
+    uint32_t _spare_units;
+    uint32_t _wear_threshold;
+    bd_size_t _unit_size;
+    bd_size_t _header_size;
+    bd_size_t _tag_size;
+    bd_size_t _data_offset;
+    bd_size_t _buf_size;
+    uint32_t _unit_count;
+    uint32_t _slots;
+    uint32_t _sector_count;
+    uint32_t _ckpt_parts;
+    uint32_t _ckpt_entries;
+    uint32_t _seq;
+    uint32_t _active;
+    uint32_t _active_ptr;
+    uint32_t _units_since_ckpt;
+    bool _dirty;
+    bool _in_reclaim;
+    unit_info_t *_units;
+    uint32_t *_map;
+    uint8_t *_buf;
+    uint32_t _init_ref_count;
+    bool _is_initialized;
+
+    bd_addr_t unit_addr(uint32_t unit) const;
+    int read_header(uint32_t unit, uint8_t &type, uint32_t &seq, uint32_t &erase_count);
+    int alloc_unit(uint8_t type, uint32_t &unit);
+    void free_unit(uint32_t unit);
+    uint32_t free_units() const;
+    int make_space(uint32_t min_free);
+    int level_wear();
+    int reclaim_unit(uint32_t unit);
+    int write_sector(uint32_t lba, const void *data);
+    void unmap(uint32_t lba);
+    int read_tag(uint32_t unit, uint32_t slot, uint32_t &lba);
+    int replay_unit(uint32_t unit, uint32_t from_slot);
+    int load_checkpoint(uint32_t &watermark, uint32_t &ptr);
+    int write_checkpoint();
+    int mount();
+};
+
+} // namespace mbed
+
+// Added "using" for backwards compatibility
+#ifndef MBED_NO_GLOBAL_USING_DIRECTIVE
+using mbed::FTLBlockDevice;
+#endif
+
+#endif
+
+/** @}*/
@@ -184,6 +184,41 @@ public:
      */
     virtual int erase(bd_addr_t addr, bd_size_t size);
 
+    /** Read blocks from a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device.
+     *
+     *  @param buffer   Buffer to write blocks to, must stay valid until completion
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @param callback Callback to call with the result of the read
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Program blocks to a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device.
+     *
+     *  @param buffer   Buffer of data to write to blocks, must stay valid until completion
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @param callback Callback to call with the result of the program
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Erase blocks on a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @param callback Callback to call with the result of the erase
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
     /** Get the size of a readable block
      *
      *  @return         Size of a readable block in bytes
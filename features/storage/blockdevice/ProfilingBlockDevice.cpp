@@ -15,20 +15,76 @@
  */
 
 #include "ProfilingBlockDevice.h"
+#include "platform/platform.h"
+#include "platform/mbed_assert.h"
+#include <string.h>
+#include <new>
+
+#if DEVICE_USTICKER
+#include "hal/us_ticker_api.h"
+#endif
 
 namespace mbed {
 
-ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd)
+static uint64_t get_time_us()
+{
+#if DEVICE_USTICKER
+    return ticker_read_us(get_us_ticker_data());
+#else
+    return 0;
+#endif
+}
+
+static int log2_bucket(uint64_t val)
+{
+    int bucket = 0;
+    while ((val > 1) && (bucket < ProfilingBlockDevice::histogram_buckets - 1)) {
+        val >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static const char *const op_names[ProfilingBlockDevice::OP_COUNT] = {"read", "program", "erase"};
+
+ProfilingBlockDevice::ProfilingBlockDevice(BlockDevice *bd, bool erase_map)
     : _bd(bd)
     , _read_count(0)
     , _program_count(0)
     , _erase_count(0)
+    , _erase_map_enabled(erase_map)
+    , _erase_map(0)
+    , _erase_map_unit(0)
+    , _erase_map_size(0)
 {
+    memset(_latency_hist, 0, sizeof(_latency_hist));
+    memset(_size_hist, 0, sizeof(_size_hist));
+}
+
+ProfilingBlockDevice::~ProfilingBlockDevice()
+{
+    delete[] _erase_map;
 }
 
 int ProfilingBlockDevice::init()
 {
-    return _bd->init();
+    int err = _bd->init();
+    if (err || !_erase_map_enabled || _erase_map) {
+        return err;
+    }
+
+    // The map is kept across deinit, so that counts survive remounts
+    _erase_map_unit = _bd->get_erase_size();
+    if (_erase_map_unit) {
+        _erase_map_size = _bd->size() / _erase_map_unit;
+        _erase_map = new (std::nothrow) uint32_t[_erase_map_size];
+        if (!_erase_map) {
+            _bd->deinit();
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        memset(_erase_map, 0, _erase_map_size * sizeof(uint32_t));
+    }
+    return BD_ERROR_OK;
 }
 
 int ProfilingBlockDevice::deinit()
@@ -41,33 +97,152 @@ int ProfilingBlockDevice::sync()
     return _bd->sync();
 }
 
+void ProfilingBlockDevice::record(op_t op, bd_size_t size, uint64_t start)
+{
+    _size_hist[op][log2_bucket(size)]++;
+    _latency_hist[op][log2_bucket(get_time_us() - start)]++;
+}
+
+void ProfilingBlockDevice::record_erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!_erase_map) {
+        return;
+    }
+
+    bd_addr_t end = addr + size;
+    while (addr < end) {
+        bd_size_t index = addr / _erase_map_unit;
+        if (index < _erase_map_size) {
+            _erase_map[index]++;
+        }
+        bd_size_t erase_size = _bd->get_erase_size(addr);
+        addr += erase_size ? erase_size : _erase_map_unit;
+    }
+}
+
 int ProfilingBlockDevice::read(void *b, bd_addr_t addr, bd_size_t size)
 {
+    uint64_t start = get_time_us();
     int err = _bd->read(b, addr, size);
     if (!err) {
         _read_count += size;
+        record(OP_READ, size, start);
     }
     return err;
 }
 
 int ProfilingBlockDevice::program(const void *b, bd_addr_t addr, bd_size_t size)
 {
+    uint64_t start = get_time_us();
     int err = _bd->program(b, addr, size);
     if (!err) {
         _program_count += size;
+        record(OP_PROGRAM, size, start);
     }
     return err;
 }
 
 int ProfilingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
 {
+    uint64_t start = get_time_us();
     int err = _bd->erase(addr, size);
     if (!err) {
         _erase_count += size;
+        record(OP_ERASE, size, start);
+        record_erase(addr, size);
     }
     return err;
 }
 
+// Asynchronous requests are recorded on completion, with their own copy of the caller's callback
+struct ProfilingBlockDevice::async_request_t {
+    ProfilingBlockDevice *profiler;
+    op_t op;
+    bd_addr_t addr;
+    bd_size_t size;
+    uint64_t start;
+    bd_callback_t callback;
+
+    void complete(int err)
+    {
+        profiler->complete_async(this, err);
+    }
+};
+
+int ProfilingBlockDevice::submit_async(op_t op, void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    async_request_t *req = new (std::nothrow) async_request_t;
+    if (!req) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    req->profiler = this;
+    req->op = op;
+    req->addr = addr;
+    req->size = size;
+    req->callback = callback;
+    req->start = get_time_us();
+
+    // The request may complete, and be deleted, before the call returns
+    bd_callback_t done = mbed::callback(req, &async_request_t::complete);
+    int err;
+    switch (op) {
+        case OP_READ:
+            err = _bd->read_async(b, addr, size, done);
+            break;
+        case OP_PROGRAM:
+            err = _bd->program_async(b, addr, size, done);
+            break;
+        default:
+            err = _bd->erase_async(addr, size, done);
+            break;
+    }
+
+    if (err) {
+        delete req;
+    }
+    return err;
+}
+
+void ProfilingBlockDevice::complete_async(async_request_t *req, int err)
+{
+    bd_callback_t callback = req->callback;
+
+    if (!err) {
+        switch (req->op) {
+            case OP_READ:
+                _read_count += req->size;
+                break;
+            case OP_PROGRAM:
+                _program_count += req->size;
+                break;
+            default:
+                _erase_count += req->size;
+                record_erase(req->addr, req->size);
+                break;
+        }
+        record(req->op, req->size, req->start);
+    }
+
+    delete req;
+    callback(err);
+}
+
+int ProfilingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_async(OP_READ, b, addr, size, callback);
+}
+
+int ProfilingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_async(OP_PROGRAM, const_cast<void *>(b), addr, size, callback);
+}
+
+int ProfilingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    return submit_async(OP_ERASE, NULL, addr, size, callback);
+}
+
 bd_size_t ProfilingBlockDevice::get_read_size() const
 {
     return _bd->get_read_size();
@@ -103,6 +278,11 @@ void ProfilingBlockDevice::reset()
     _read_count = 0;
     _program_count = 0;
     _erase_count = 0;
+    memset(_latency_hist, 0, sizeof(_latency_hist));
+    memset(_size_hist, 0, sizeof(_size_hist));
+    if (_erase_map) {
+        memset(_erase_map, 0, _erase_map_size * sizeof(uint32_t));
+    }
 }
 
 bd_size_t ProfilingBlockDevice::get_read_count() const
@@ -120,4 +300,55 @@ bd_size_t ProfilingBlockDevice::get_erase_count() const
     return _erase_count;
 }
 
+uint32_t ProfilingBlockDevice::get_latency_histogram(op_t op, int bucket) const
+{
+    MBED_ASSERT((op < OP_COUNT) && (bucket >= 0) && (bucket < histogram_buckets));
+    return _latency_hist[op][bucket];
+}
+
+uint32_t ProfilingBlockDevice::get_size_histogram(op_t op, int bucket) const
+{
+    MBED_ASSERT((op < OP_COUNT) && (bucket >= 0) && (bucket < histogram_buckets));
+    return _size_hist[op][bucket];
+}
+
+uint32_t ProfilingBlockDevice::get_block_erase_count(bd_addr_t addr) const
+{
+    if (!_erase_map || (addr / _erase_map_unit >= _erase_map_size)) {
+        return 0;
+    }
+    return _erase_map[addr / _erase_map_unit];
+}
+
+int ProfilingBlockDevice::dump_csv(FILE *file) const
+{
+    const char *const names[] = {"latency_us", "size"};
+    const uint32_t (*const hists[])[histogram_buckets] = {_latency_hist, _size_hist};
+
+    for (int h = 0; h < 2; h++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (fprintf(file, "%s,%s", names[h], op_names[op]) < 0) {
+                return BD_ERROR_DEVICE_ERROR;
+            }
+            for (int bucket = 0; bucket < histogram_buckets; bucket++) {
+                if (fprintf(file, ",%lu", (unsigned long)hists[h][op][bucket]) < 0) {
+                    return BD_ERROR_DEVICE_ERROR;
+                }
+            }
+            if (fprintf(file, "\n") < 0) {
+                return BD_ERROR_DEVICE_ERROR;
+            }
+        }
+    }
+
+    for (bd_size_t i = 0; _erase_map && (i < _erase_map_size); i++) {
+        if (_erase_map[i] && (fprintf(file, "erases,%llu,%lu\n",
+                                      (unsigned long long)(i * _erase_map_unit),
+                                      (unsigned long)_erase_map[i]) < 0)) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+    }
+    return BD_ERROR_OK;
+}
+
 } // namespace mbed
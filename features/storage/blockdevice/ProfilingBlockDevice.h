@@ -27,6 +27,7 @@
 #define MBED_PROFILING_BLOCK_DEVICE_H
 
 #include "BlockDevice.h"
+#include <stdio.h>
 
 namespace mbed {
 
@@ -47,19 +48,42 @@ namespace mbed {
  *  printf("read count: %lld\n", profiler.get_read_count());
  *  printf("program count: %lld\n", profiler.get_program_count());
  *  printf("erase count: %lld\n", profiler.get_erase_count());
+ *
+ *  // dump latency and size histograms as CSV
+ *  profiler.dump_csv(stdout);
  *  @endcode
+ *
+ *  Besides the byte counts, each operation is recorded in log2 histograms of its
+ *  latency (in microseconds, measured on the us ticker, up to the completion of
+ *  asynchronous operations) and of its size (in bytes). Bucket 0 holds values below 2, bucket n values
+ *  from 2^n up to 2^(n+1) and the last bucket everything above. Erases can
+ *  also be counted per erase block, to locate wear hot spots.
  */
 class ProfilingBlockDevice : public BlockDevice {
 public:
+    /** Profiled operations
+     */
+    enum op_t {
+        OP_READ = 0,
+        OP_PROGRAM,
+        OP_ERASE,
+        OP_COUNT
+    };
+
+    /** Number of buckets of the latency and size histograms
+     */
+    static const int histogram_buckets = 24;
+
     /** Lifetime of the memory block device
      *
-     *  @param bd       Block device to back the ProfilingBlockDevice
+     *  @param bd           Block device to back the ProfilingBlockDevice
+     *  @param erase_map    Count erases per erase block, allocated on init
      */
-    ProfilingBlockDevice(BlockDevice *bd);
+    ProfilingBlockDevice(BlockDevice *bd, bool erase_map = false);
 
     /** Lifetime of a block device
      */
-    virtual ~ProfilingBlockDevice() {};
+    virtual ~ProfilingBlockDevice();
 
     /** Initialize a block device
      *
@@ -112,6 +136,44 @@ public:
      */
     virtual int erase(bd_addr_t addr, bd_size_t size);
 
+    /** Read blocks from a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device, and counted when they
+     *  complete successfully, with their latency from submission to completion.
+     *
+     *  @param buffer   Buffer to write blocks to, must stay valid until completion
+     *  @param addr     Address of block to begin reading from
+     *  @param size     Size to read in bytes, must be a multiple of read block size
+     *  @param callback Callback to call with the result of the read
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int read_async(void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Program blocks to a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device, and counted when they
+     *  complete successfully, with their latency from submission to completion.
+     *
+     *  @param buffer   Buffer of data to write to blocks, must stay valid until completion
+     *  @param addr     Address of block to begin writing to
+     *  @param size     Size to write in bytes, must be a multiple of program block size
+     *  @param callback Callback to call with the result of the program
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int program_async(const void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
+    /** Erase blocks on a block device asynchronously
+     *
+     *  Requests are passed to the underlying block device, and counted when they
+     *  complete successfully, with their latency from submission to completion.
+     *
+     *  @param addr     Address of block to begin erasing
+     *  @param size     Size to erase in bytes, must be a multiple of erase block size
+     *  @param callback Callback to call with the result of the erase
+     *  @return         0 if the request was submitted, negative error code on failure
+     */
+    virtual int erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+
     /** Get the size of a readable block
      *
      *  @return         Size of a readable block in bytes
@@ -179,11 +241,58 @@ public:
      */
     bd_size_t get_erase_count() const;
 
+    /** Get a bucket of the latency histogram of an operation
+     *
+     *  @param op       Operation
+     *  @param bucket   Bucket index, below histogram_buckets
+     *  @return The number of operations whose latency in microseconds falls in the bucket
+     */
+    uint32_t get_latency_histogram(op_t op, int bucket) const;
+
+    /** Get a bucket of the size histogram of an operation
+     *
+     *  @param op       Operation
+     *  @param bucket   Bucket index, below histogram_buckets
+     *  @return The number of operations whose size in bytes falls in the bucket
+     */
+    uint32_t get_size_histogram(op_t op, int bucket) const;
+
+    /** Get number of times an erase block has been erased
+     *
+     *  @param addr     Address within the erase block
+     *  @return The number of erases of the block, 0 if the erase map is disabled
+     */
+    uint32_t get_block_erase_count(bd_addr_t addr) const;
+
+    /** Write the histograms and the erase map as CSV
+     *
+     *  Histogram rows are "latency_us" or "size" followed by the operation and
+     *  the bucket counts, erase map rows are "erases" followed by the block
+     *  address and its erase count, for blocks erased at least once.
+     *
+     *  @param file     File to write to
+     *  @return         0 on success, negative error code on failure
+     */
+    int dump_csv(FILE *file) const;
+
 private:
     BlockDevice *_bd;
     bd_size_t _read_count;
     bd_size_t _program_count;
     bd_size_t _erase_count;
+    uint32_t _latency_hist[OP_COUNT][histogram_buckets];
+    uint32_t _size_hist[OP_COUNT][histogram_buckets];
+    bool _erase_map_enabled;
+    uint32_t *_erase_map;
+    bd_size_t _erase_map_unit;
+    bd_size_t _erase_map_size;
+
+    struct async_request_t;
+
+    void record(op_t op, bd_size_t size, uint64_t start);
+    void record_erase(bd_addr_t addr, bd_size_t size);
+    int submit_async(op_t op, void *buffer, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback);
+    void complete_async(async_request_t *req, int err);
 };
 
 } // namespace mbed
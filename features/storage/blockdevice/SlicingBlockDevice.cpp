@@ -89,6 +89,24 @@ int SlicingBlockDevice::erase(bd_addr_t addr, bd_size_t size)
     return _bd->erase(addr + _start, size);
 }
 
+int SlicingBlockDevice::read_async(void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_read(addr, size));
+    return _bd->read_async(b, addr + _start, size, callback);
+}
+
+int SlicingBlockDevice::program_async(const void *b, bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_program(addr, size));
+    return _bd->program_async(b, addr + _start, size, callback);
+}
+
+int SlicingBlockDevice::erase_async(bd_addr_t addr, bd_size_t size, const bd_callback_t &callback)
+{
+    MBED_ASSERT(is_valid_erase(addr, size));
+    return _bd->erase_async(addr + _start, size, callback);
+}
+
 bd_size_t SlicingBlockDevice::get_read_size() const
 {
     return _bd->get_read_size();
@@ -28,6 +28,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <new>
 
 namespace mbed {
 
@@ -191,21 +192,9 @@ static DWORD disk_get_sector_count(BYTE pdrv)
     return scount;
 }
 
-extern "C" DSTATUS disk_status(BYTE pdrv)
-{
-    debug_if(FFS_DBG, "disk_status on pdrv [%d]\n", pdrv);
-    return RES_OK;
-}
-
-extern "C" DSTATUS disk_initialize(BYTE pdrv)
-{
-    debug_if(FFS_DBG, "disk_initialize on pdrv [%d]\n", pdrv);
-    return (DSTATUS)_ffs[pdrv]->init();
-}
-
-extern "C" DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+// Raw transfers to the block device
+static DRESULT disk_read_sectors(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
 {
-    debug_if(FFS_DBG, "disk_read(sector %lu, count %u) on pdrv [%d]\n", sector, count, pdrv);
     DWORD ssize = disk_get_sector_size(pdrv);
     mbed::bd_addr_t addr = (mbed::bd_addr_t)sector * ssize;
     mbed::bd_size_t size = (mbed::bd_size_t)count * ssize;
@@ -213,9 +202,8 @@ extern "C" DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
     return err ? RES_PARERR : RES_OK;
 }
 
-extern "C" DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+static DRESULT disk_write_sectors(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
 {
-    debug_if(FFS_DBG, "disk_write(sector %lu, count %u) on pdrv [%d]\n", sector, count, pdrv);
     DWORD ssize = disk_get_sector_size(pdrv);
     mbed::bd_addr_t addr = (mbed::bd_addr_t)sector * ssize;
     mbed::bd_size_t size = (mbed::bd_size_t)count * ssize;
@@ -233,6 +221,379 @@ extern "C" DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT co
     return RES_OK;
 }
 
+////// Sector cache //////
+
+// Number of sectors cached per volume for the FAT, directories and file data,
+// 0 disables the pool
+#ifndef MBED_CONF_FAT_CHAN_SECTOR_CACHE_FAT
+#define MBED_CONF_FAT_CHAN_SECTOR_CACHE_FAT 0
+#endif
+
+#ifndef MBED_CONF_FAT_CHAN_SECTOR_CACHE_DIR
+#define MBED_CONF_FAT_CHAN_SECTOR_CACHE_DIR 0
+#endif
+
+#ifndef MBED_CONF_FAT_CHAN_SECTOR_CACHE_DATA
+#define MBED_CONF_FAT_CHAN_SECTOR_CACHE_DATA 0
+#endif
+
+typedef struct {
+    DWORD sector;
+    uint32_t last_used;
+    bool valid;
+    bool mirror_dirty;  // Second FAT copy of the sector not written yet
+} fat_cache_line_t;
+
+// Sectors are written through, except for the updates of the second FAT copy,
+// which are kept as a flag on the cached sector of the first FAT and written on
+// sync, so that a FAT sector updated many times is mirrored once
+typedef struct {
+    FATFS *fs;
+    WORD ssize;
+    bool file_data;     // File data goes through the window of the volume
+    uint32_t tick;
+    uint32_t count[FATFileSystem::FAT_POOL_COUNT];
+    fat_cache_line_t *lines[FATFileSystem::FAT_POOL_COUNT];
+    BYTE *buffers[FATFileSystem::FAT_POOL_COUNT];
+} fat_cache_t;
+
+static fat_cache_t *_ffs_cache[FF_VOLUMES] = {0};
+
+static void fat_cache_destroy(fat_cache_t *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    for (int i = 0; i < FATFileSystem::FAT_POOL_COUNT; i++) {
+        delete[] cache->lines[i];
+        delete[] cache->buffers[i];
+    }
+    delete cache;
+}
+
+static fat_cache_t *fat_cache_create(BYTE pdrv, FATFS *fs, const uint32_t count[FATFileSystem::FAT_POOL_COUNT])
+{
+    if (!count[FATFileSystem::FAT_POOL_FAT] && !count[FATFileSystem::FAT_POOL_DIR] &&
+            !count[FATFileSystem::FAT_POOL_DATA]) {
+        return NULL;
+    }
+
+    fat_cache_t *cache = new (std::nothrow) fat_cache_t;
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->fs = fs;
+    cache->ssize = disk_get_sector_size(pdrv);
+    cache->file_data = false;
+    cache->tick = 0;
+    for (int i = 0; i < FATFileSystem::FAT_POOL_COUNT; i++) {
+        cache->count[i] = count[i];
+        cache->lines[i] = NULL;
+        cache->buffers[i] = NULL;
+    }
+
+    for (int i = 0; i < FATFileSystem::FAT_POOL_COUNT; i++) {
+        if (!count[i]) {
+            continue;
+        }
+
+        cache->lines[i] = new (std::nothrow) fat_cache_line_t[count[i]];
+        cache->buffers[i] = new (std::nothrow) BYTE[count[i] * cache->ssize];
+        if (!cache->lines[i] || !cache->buffers[i]) {
+            fat_cache_destroy(cache);
+            return NULL;
+        }
+
+        for (uint32_t j = 0; j < count[i]; j++) {
+            cache->lines[i][j].valid = false;
+            cache->lines[i][j].mirror_dirty = false;
+        }
+    }
+
+    return cache;
+}
+
+static BYTE *fat_cache_data(fat_cache_t *cache, int pool, uint32_t line)
+{
+    return &cache->buffers[pool][line * cache->ssize];
+}
+
+static bool fat_cache_find(fat_cache_t *cache, DWORD sector, int &pool, uint32_t &line)
+{
+    for (pool = 0; pool < FATFileSystem::FAT_POOL_COUNT; pool++) {
+        for (line = 0; line < cache->count[pool]; line++) {
+            if (cache->lines[pool][line].valid && cache->lines[pool][line].sector == sector) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Sector of the first FAT that a sector of the second FAT mirrors
+static bool fat_cache_mirror_of(fat_cache_t *cache, DWORD sector, DWORD &fat_sector)
+{
+    FATFS *fs = cache->fs;
+    if (!fs->fs_type || fs->n_fats != 2 || sector - fs->fatbase - fs->fsize >= fs->fsize) {
+        return false;
+    }
+
+    fat_sector = sector - fs->fsize;
+    return true;
+}
+
+// Pool a sector is cached in, -1 if it is not cached
+static int fat_cache_classify(fat_cache_t *cache, DWORD sector, const BYTE *buff)
+{
+    FATFS *fs = cache->fs;
+    if (!fs->fs_type) {
+        // Volume not mounted yet, or being formatted
+        return -1;
+    }
+
+    if (sector - fs->fatbase < fs->fsize) {
+        return FATFileSystem::FAT_POOL_FAT;
+    }
+
+    if (sector - fs->fatbase < (DWORD)fs->n_fats * fs->fsize) {
+        // Second FAT, tracked through the sectors of the first one
+        return -1;
+    }
+
+    // Only file data is transferred to other buffers than the window, and
+    // partial sectors of file data go through the window in file operations
+    if (sector >= fs->database && (buff != fs->win || cache->file_data)) {
+        return FATFileSystem::FAT_POOL_DATA;
+    }
+
+    return FATFileSystem::FAT_POOL_DIR;
+}
+
+// Writes the second FAT copies of consecutive sectors of the first FAT
+static DRESULT fat_cache_write_mirrors(BYTE pdrv, fat_cache_t *cache, DWORD sector, UINT count)
+{
+    int pool;
+    uint32_t line;
+    BYTE *buffer = NULL;
+    if (count > 1) {
+        buffer = new (std::nothrow) BYTE[count * cache->ssize];
+        if (!buffer) {
+            // Not enough memory to combine the sectors, write one at a time
+            count = 1;
+        }
+    }
+
+    for (UINT i = 0; i < count; i++) {
+        fat_cache_find(cache, sector + i, pool, line);
+        if (buffer) {
+            memcpy(&buffer[i * cache->ssize], fat_cache_data(cache, pool, line), cache->ssize);
+        }
+    }
+
+    fat_cache_find(cache, sector, pool, line);
+    DRESULT res = disk_write_sectors(pdrv, buffer ? buffer : fat_cache_data(cache, pool, line),
+                                     sector + cache->fs->fsize, count);
+    delete[] buffer;
+    if (res != RES_OK) {
+        return res;
+    }
+
+    for (UINT i = 0; i < count; i++) {
+        fat_cache_find(cache, sector + i, pool, line);
+        cache->lines[pool][line].mirror_dirty = false;
+    }
+    return RES_OK;
+}
+
+// Writes the second FAT copies of the sectors of the first FAT, combining
+// consecutive sectors in single transfers
+static DRESULT fat_cache_flush(BYTE pdrv)
+{
+    fat_cache_t *cache = _ffs_cache[pdrv];
+    if (!cache) {
+        return RES_OK;
+    }
+
+    while (true) {
+        // Lowest sector pending, and the run of consecutive ones following it
+        bool found = false;
+        DWORD first = 0;
+        for (uint32_t i = 0; i < cache->count[FATFileSystem::FAT_POOL_FAT]; i++) {
+            fat_cache_line_t *line = &cache->lines[FATFileSystem::FAT_POOL_FAT][i];
+            if (line->mirror_dirty && (!found || line->sector < first)) {
+                first = line->sector;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            return RES_OK;
+        }
+
+        UINT count = 1;
+        int pool;
+        uint32_t line;
+        while (fat_cache_find(cache, first + count, pool, line) &&
+                pool == FATFileSystem::FAT_POOL_FAT && cache->lines[pool][line].mirror_dirty) {
+            count++;
+        }
+
+        DRESULT res = fat_cache_write_mirrors(pdrv, cache, first, count);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+}
+
+// Marks the window transfers of a volume as file data
+static void fat_cache_file_data(int id, bool file_data)
+{
+    if (_ffs_cache[id]) {
+        _ffs_cache[id]->file_data = file_data;
+    }
+}
+
+// Allocates the least recently used line of a pool to a sector
+static DRESULT fat_cache_insert(BYTE pdrv, fat_cache_t *cache, int pool, DWORD sector, const BYTE *buff)
+{
+    if (!cache->count[pool]) {
+        return RES_OK;
+    }
+
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < cache->count[pool]; i++) {
+        if (!cache->lines[pool][i].valid) {
+            victim = i;
+            break;
+        }
+        if (cache->lines[pool][i].last_used < cache->lines[pool][victim].last_used) {
+            victim = i;
+        }
+    }
+
+    fat_cache_line_t *line = &cache->lines[pool][victim];
+    if (line->valid && line->mirror_dirty) {
+        DRESULT res = fat_cache_write_mirrors(pdrv, cache, line->sector, 1);
+        if (res != RES_OK) {
+            return res;
+        }
+    }
+
+    line->sector = sector;
+    line->last_used = ++cache->tick;
+    line->valid = true;
+    line->mirror_dirty = false;
+    memcpy(fat_cache_data(cache, pool, victim), buff, cache->ssize);
+    return RES_OK;
+}
+
+static DRESULT fat_cache_read(BYTE pdrv, fat_cache_t *cache, BYTE *buff, DWORD sector, UINT count)
+{
+    int pool;
+    uint32_t line;
+    if (count == 1 && fat_cache_find(cache, sector, pool, line)) {
+        cache->lines[pool][line].last_used = ++cache->tick;
+        memcpy(buff, fat_cache_data(cache, pool, line), cache->ssize);
+        return RES_OK;
+    }
+
+    DRESULT res = disk_read_sectors(pdrv, buff, sector, count);
+    if (res != RES_OK) {
+        return res;
+    }
+
+    // Second FAT copies not written yet
+    for (UINT i = 0; i < count; i++) {
+        DWORD fat_sector;
+        if (fat_cache_mirror_of(cache, sector + i, fat_sector) &&
+                fat_cache_find(cache, fat_sector, pool, line) &&
+                cache->lines[pool][line].mirror_dirty) {
+            memcpy(&buff[i * cache->ssize], fat_cache_data(cache, pool, line), cache->ssize);
+        }
+    }
+
+    pool = fat_cache_classify(cache, sector, buff);
+    if (count == 1 && pool >= 0) {
+        return fat_cache_insert(pdrv, cache, pool, sector, buff);
+    }
+
+    return RES_OK;
+}
+
+static DRESULT fat_cache_write(BYTE pdrv, fat_cache_t *cache, const BYTE *buff, DWORD sector, UINT count)
+{
+    int pool;
+    uint32_t line;
+    DWORD fat_sector;
+
+    if (count == 1 && fat_cache_mirror_of(cache, sector, fat_sector) &&
+            fat_cache_find(cache, fat_sector, pool, line) &&
+            memcmp(fat_cache_data(cache, pool, line), buff, cache->ssize) == 0) {
+        // Mirror of a cached sector of the first FAT, deferred until sync
+        cache->lines[pool][line].mirror_dirty = true;
+        return RES_OK;
+    }
+
+    DRESULT res = disk_write_sectors(pdrv, buff, sector, count);
+    if (res != RES_OK) {
+        return res;
+    }
+
+    bool cached = false;
+    for (UINT i = 0; i < count; i++) {
+        if (fat_cache_find(cache, sector + i, pool, line)) {
+            cache->lines[pool][line].last_used = ++cache->tick;
+            memcpy(fat_cache_data(cache, pool, line), &buff[i * cache->ssize], cache->ssize);
+            cached = true;
+        }
+
+        if (fat_cache_mirror_of(cache, sector + i, fat_sector) &&
+                fat_cache_find(cache, fat_sector, pool, line)) {
+            cache->lines[pool][line].mirror_dirty = false;
+        }
+    }
+
+    pool = fat_cache_classify(cache, sector, buff);
+    if (count == 1 && !cached && pool >= 0) {
+        return fat_cache_insert(pdrv, cache, pool, sector, buff);
+    }
+
+    return RES_OK;
+}
+
+// Disk functions called by the FAT driver
+extern "C" DSTATUS disk_status(BYTE pdrv)
+{
+    debug_if(FFS_DBG, "disk_status on pdrv [%d]\n", pdrv);
+    return RES_OK;
+}
+
+extern "C" DSTATUS disk_initialize(BYTE pdrv)
+{
+    debug_if(FFS_DBG, "disk_initialize on pdrv [%d]\n", pdrv);
+    return (DSTATUS)_ffs[pdrv]->init();
+}
+
+extern "C" DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    debug_if(FFS_DBG, "disk_read(sector %lu, count %u) on pdrv [%d]\n", sector, count, pdrv);
+    if (_ffs_cache[pdrv]) {
+        return fat_cache_read(pdrv, _ffs_cache[pdrv], buff, sector, count);
+    }
+    return disk_read_sectors(pdrv, buff, sector, count);
+}
+
+extern "C" DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    debug_if(FFS_DBG, "disk_write(sector %lu, count %u) on pdrv [%d]\n", sector, count, pdrv);
+    if (_ffs_cache[pdrv]) {
+        return fat_cache_write(pdrv, _ffs_cache[pdrv], buff, sector, count);
+    }
+    return disk_write_sectors(pdrv, buff, sector, count);
+}
+
 extern "C" DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 {
     debug_if(FFS_DBG, "disk_ioctl(%d)\n", cmd);
@@ -241,7 +602,7 @@ extern "C" DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
             if (_ffs[pdrv] == NULL) {
                 return RES_NOTRDY;
             } else {
-                return RES_OK;
+                return fat_cache_flush(pdrv);
             }
         case GET_SECTOR_COUNT:
             if (_ffs[pdrv] == NULL) {
@@ -282,6 +643,10 @@ extern "C" DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
 FATFileSystem::FATFileSystem(const char *name, BlockDevice *bd)
     : FileSystem(name), _id(-1)
 {
+    _cache_sectors[FAT_POOL_FAT] = MBED_CONF_FAT_CHAN_SECTOR_CACHE_FAT;
+    _cache_sectors[FAT_POOL_DIR] = MBED_CONF_FAT_CHAN_SECTOR_CACHE_DIR;
+    _cache_sectors[FAT_POOL_DATA] = MBED_CONF_FAT_CHAN_SECTOR_CACHE_DATA;
+
     if (bd) {
         mount(bd);
     }
@@ -315,6 +680,7 @@ int FATFileSystem::mount(BlockDevice *bd, bool mount)
             _fsid[1] = ':';
             _fsid[2] = '\0';
             debug_if(FFS_DBG, "Mounting [%s] on ffs drive [%s]\n", getName(), _fsid);
+            _ffs_cache[_id] = fat_cache_create(_id, &_fs, _cache_sectors);
             FRESULT res = f_mount(&_fs, _fsid, mount);
             unlock();
             return fat_error_remap(res);
@@ -333,7 +699,13 @@ int FATFileSystem::unmount()
         return -EINVAL;
     }
 
+    DRESULT flush = fat_cache_flush(_id);
     FRESULT res = f_mount(NULL, _fsid, 0);
+    if (res == FR_OK && flush != RES_OK) {
+        res = FR_DISK_ERR;
+    }
+    fat_cache_destroy(_ffs_cache[_id]);
+    _ffs_cache[_id] = NULL;
     _ffs[_id] = NULL;
     _id = -1;
     unlock();
@@ -559,6 +931,15 @@ int FATFileSystem::statvfs(const char *path, struct statvfs *buf)
     return 0;
 }
 
+void FATFileSystem::set_sector_cache(uint32_t fat_sectors, uint32_t dir_sectors, uint32_t data_sectors)
+{
+    lock();
+    _cache_sectors[FAT_POOL_FAT] = fat_sectors;
+    _cache_sectors[FAT_POOL_DIR] = dir_sectors;
+    _cache_sectors[FAT_POOL_DATA] = data_sectors;
+    unlock();
+}
+
 void FATFileSystem::lock()
 {
     _ffs_mutex->lock();
@@ -571,11 +952,92 @@ void FATFileSystem::unlock()
 
 
 ////// File operations //////
+
+// Number of entries in the cluster link map table of a file, a table of N entries
+// maps a file split in up to (N-2)/2 fragments
+#ifndef MBED_CONF_FAT_CHAN_FAST_SEEK_SIZE
+#define MBED_CONF_FAT_CHAN_FAST_SEEK_SIZE 64
+#endif
+
+enum fat_clmt_state {
+    FAT_CLMT_NONE,      // Table not built
+    FAT_CLMT_VALID,     // Table maps the cluster chain of the file
+    FAT_CLMT_FULL,      // File too fragmented for the table
+};
+
+// FatFs file object along with its cluster link map table, built on the first
+// seek that would follow the cluster chain and rebuilt when the file size changes
+typedef struct {
+    FIL fil;
+    DWORD *clmt;
+    FSIZE_t clmt_size;
+    int clmt_state;
+} fat_file_t;
+
+// Seeks using the cluster link map table if it saves following the FAT chain
+static FRESULT fat_seek(fat_file_t *fh, FSIZE_t offset)
+{
+    FIL *fil = &fh->fil;
+
+    if (!MBED_CONF_FAT_CHAN_FAST_SEEK_SIZE || offset == 0 || offset > f_size(fil)) {
+        // Seeking past the end extends the file, which the table can't do
+        return f_lseek(fil, offset);
+    }
+
+    // Seeks within the current or to the next cluster are already cheap
+    FSIZE_t cluster_size = (FSIZE_t)fil->obj.fs->csize * fil->obj.fs->ssize;
+    if (fil->fptr > 0 &&
+            (offset - 1) / cluster_size >= (fil->fptr - 1) / cluster_size &&
+            (offset - 1) / cluster_size <= (fil->fptr - 1) / cluster_size + 1) {
+        return f_lseek(fil, offset);
+    }
+
+    if (fh->clmt_state != FAT_CLMT_NONE && fh->clmt_size != f_size(fil)) {
+        fh->clmt_state = FAT_CLMT_NONE;
+    }
+
+    if (fh->clmt_state == FAT_CLMT_NONE) {
+        if (!fh->clmt) {
+            fh->clmt = new (std::nothrow) DWORD[MBED_CONF_FAT_CHAN_FAST_SEEK_SIZE];
+            if (!fh->clmt) {
+                return f_lseek(fil, offset);
+            }
+        }
+
+        fh->clmt[0] = MBED_CONF_FAT_CHAN_FAST_SEEK_SIZE;
+        fil->cltbl = fh->clmt;
+        FRESULT res = f_lseek(fil, CREATE_LINKMAP);
+        fil->cltbl = NULL;
+        if (res == FR_NOT_ENOUGH_CORE) {
+            fh->clmt_state = FAT_CLMT_FULL;
+        } else if (res != FR_OK) {
+            return res;
+        } else {
+            fh->clmt_state = FAT_CLMT_VALID;
+        }
+        fh->clmt_size = f_size(fil);
+    }
+
+    if (fh->clmt_state != FAT_CLMT_VALID) {
+        return f_lseek(fil, offset);
+    }
+
+    // The file object is left in the same state as by a normal seek, so the table
+    // is only attached for the seek and reads and writes keep following the chain
+    fil->cltbl = fh->clmt;
+    FRESULT res = f_lseek(fil, offset);
+    fil->cltbl = NULL;
+    return res;
+}
+
 int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
 {
     debug_if(FFS_DBG, "open(%s) on filesystem [%s], drv [%d]\n", path, getName(), _id);
 
-    FIL *fh = new FIL;
+    fat_file_t *fh = new fat_file_t;
+    fh->clmt = NULL;
+    fh->clmt_size = 0;
+    fh->clmt_state = FAT_CLMT_NONE;
     Deferred<const char *> fpath = fat_path_prefix(_id, path);
 
     /* POSIX flags -> FatFS open mode */
@@ -601,7 +1063,7 @@ int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
     }
 
     lock();
-    FRESULT res = f_open(fh, fpath, openmode);
+    FRESULT res = f_open(&fh->fil, fpath, openmode);
 
     if (res != FR_OK) {
         unlock();
@@ -618,23 +1080,26 @@ int FATFileSystem::file_open(fs_file_t *file, const char *path, int flags)
 
 int FATFileSystem::file_close(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    fat_file_t *fh = static_cast<fat_file_t *>(file);
 
     lock();
-    FRESULT res = f_close(fh);
+    FRESULT res = f_close(&fh->fil);
     unlock();
 
+    delete[] fh->clmt;
     delete fh;
     return fat_error_remap(res);
 }
 
 ssize_t FATFileSystem::file_read(fs_file_t file, void *buffer, size_t len)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
+    fat_cache_file_data(_id, true);
     UINT n;
     FRESULT res = f_read(fh, buffer, len, &n);
+    fat_cache_file_data(_id, false);
     unlock();
 
     if (res != FR_OK) {
@@ -647,11 +1112,13 @@ ssize_t FATFileSystem::file_read(fs_file_t file, void *buffer, size_t len)
 
 ssize_t FATFileSystem::file_write(fs_file_t file, const void *buffer, size_t len)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
+    fat_cache_file_data(_id, true);
     UINT n;
     FRESULT res = f_write(fh, buffer, len, &n);
+    fat_cache_file_data(_id, false);
     unlock();
 
     if (res != FR_OK) {
@@ -664,7 +1131,7 @@ ssize_t FATFileSystem::file_write(fs_file_t file, const void *buffer, size_t len
 
 int FATFileSystem::file_sync(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
     FRESULT res = f_sync(fh);
@@ -678,7 +1145,7 @@ int FATFileSystem::file_sync(fs_file_t file)
 
 off_t FATFileSystem::file_seek(fs_file_t file, off_t offset, int whence)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
     if (whence == SEEK_END) {
@@ -687,7 +1154,7 @@ off_t FATFileSystem::file_seek(fs_file_t file, off_t offset, int whence)
         offset += f_tell(fh);
     }
 
-    FRESULT res = f_lseek(fh, offset);
+    FRESULT res = fat_seek(static_cast<fat_file_t *>(file), offset);
     off_t noffset = fh->fptr;
     unlock();
 
@@ -701,7 +1168,7 @@ off_t FATFileSystem::file_seek(fs_file_t file, off_t offset, int whence)
 
 off_t FATFileSystem::file_tell(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
     off_t res = f_tell(fh);
@@ -712,7 +1179,7 @@ off_t FATFileSystem::file_tell(fs_file_t file)
 
 off_t FATFileSystem::file_size(fs_file_t file)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
     off_t res = f_size(fh);
@@ -723,7 +1190,7 @@ off_t FATFileSystem::file_size(fs_file_t file)
 
 int FATFileSystem::file_truncate(fs_file_t file, off_t length)
 {
-    FIL *fh = static_cast<FIL *>(file);
+    FIL *fh = &static_cast<fat_file_t *>(file)->fil;
 
     lock();
     // save current position
@@ -736,6 +1203,9 @@ int FATFileSystem::file_truncate(fs_file_t file, off_t length)
         return fat_error_remap(res);
     }
 
+    // clusters freed and later reallocated may leave the file size unchanged
+    static_cast<fat_file_t *>(file)->clmt_state = FAT_CLMT_NONE;
+
     res = f_truncate(fh);
     if (res) {
         unlock();
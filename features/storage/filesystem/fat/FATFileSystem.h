@@ -153,6 +153,30 @@ public:
      */
     virtual int statvfs(const char *path, struct statvfs *buf);
 
+    /** Pools of the sector cache
+     */
+    enum cache_pool_t {
+        FAT_POOL_FAT,       /**< Sectors of the first FAT */
+        FAT_POOL_DIR,       /**< Directory and other system sectors */
+        FAT_POOL_DATA,      /**< File data sectors */
+        FAT_POOL_COUNT      /**< Number of pools */
+    };
+
+    /** Configure the sector cache of the filesystem, effective on the next mount
+     *
+     *  Sectors are cached in separate pools for the FAT, directories and file
+     *  data, so that files accessed concurrently don't evict each other's
+     *  sectors or the FAT. Writes go through to the block device, except for
+     *  the second copy of the FAT, which is only written on sync and unmount.
+     *  Defaults to the fat_chan.sector_cache_fat, sector_cache_dir and
+     *  sector_cache_data configuration.
+     *
+     *  @param fat_sectors  Number of FAT sectors to cache, 0 disables the pool
+     *  @param dir_sectors  Number of directory sectors to cache, 0 disables the pool
+     *  @param data_sectors Number of file data sectors to cache, 0 disables the pool
+     */
+    void set_sector_cache(uint32_t fat_sectors, uint32_t dir_sectors, uint32_t data_sectors);
+
 protected:
     /** Open a file on the filesystem
      *
@@ -283,6 +307,7 @@ private:
     FATFS _fs; // Work area (file system object) for logical drive
     char _fsid[sizeof("0:")];
     int _id;
+    uint32_t _cache_sectors[FAT_POOL_COUNT];
 
 protected:
     virtual void lock();
@@ -143,12 +143,14 @@ static int lfs_bd_sync(const struct lfs_config *c)
 // Filesystem implementation (See LittleFileSystem.h)
 LittleFileSystem::LittleFileSystem(const char *name, BlockDevice *bd,
                                    lfs_size_t read_size, lfs_size_t prog_size,
-                                   lfs_size_t block_size, lfs_size_t lookahead)
+                                   lfs_size_t block_size, lfs_size_t lookahead,
+                                   lfs_size_t metadata_cache)
     : FileSystem(name)
     , _read_size(read_size)
     , _prog_size(prog_size)
     , _block_size(block_size)
     , _lookahead(lookahead)
+    , _metadata_cache(metadata_cache)
 {
     if (bd) {
         mount(bd);
@@ -193,9 +195,13 @@ int LittleFileSystem::mount(BlockDevice *bd)
         _config.block_size = _block_size;
     }
     _config.block_count = bd->size() / _config.block_size;
-    _config.lookahead = 32 * ((_config.block_count + 31) / 32);
-    if (_config.lookahead > _lookahead) {
-        _config.lookahead = _lookahead;
+    // littlefs caps the lookahead to the block count, zero covers the whole device
+    _config.lookahead = _lookahead;
+    _config.mcache_count = _metadata_cache;
+    _config.mcache_size = _config.read_size *
+                          ((MBED_LFS_METADATA_CACHE_SIZE + _config.read_size - 1) / _config.read_size);
+    if (_config.mcache_size > _config.block_size) {
+        _config.mcache_size = _config.block_size;
     }
 
     err = lfs_mount(&_lfs, &_config);
@@ -269,10 +275,7 @@ int LittleFileSystem::format(BlockDevice *bd,
         _config.block_size = block_size;
     }
     _config.block_count = bd->size() / _config.block_size;
-    _config.lookahead = 32 * ((_config.block_count + 31) / 32);
-    if (_config.lookahead > lookahead) {
-        _config.lookahead = lookahead;
-    }
+    _config.lookahead = lookahead;
 
     err = lfs_format(&_lfs, &_config);
     if (err) {
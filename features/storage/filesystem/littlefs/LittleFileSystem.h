@@ -54,14 +54,20 @@ public:
      *      Number of blocks to lookahead during block allocation. A larger
      *      lookahead reduces the number of passes required to allocate a block.
      *      The lookahead buffer requires only 1 bit per block so it can be quite
-     *      large with little ram impact. Should be a multiple of 32.
+     *      large with little ram impact. Should be a multiple of 32, zero
+     *      covers the whole device.
+     *  @param metadata_cache
+     *      Number of directory blocks to keep in ram once read, so that path
+     *      lookups don't read them again. Each takes up to
+     *      MBED_LFS_METADATA_CACHE_SIZE bytes, zero disables the cache.
      */
 
     LittleFileSystem(const char *name = NULL, mbed::BlockDevice *bd = NULL,
                      lfs_size_t read_size = MBED_LFS_READ_SIZE,
                      lfs_size_t prog_size = MBED_LFS_PROG_SIZE,
                      lfs_size_t block_size = MBED_LFS_BLOCK_SIZE,
-                     lfs_size_t lookahead = MBED_LFS_LOOKAHEAD);
+                     lfs_size_t lookahead = MBED_LFS_LOOKAHEAD,
+                     lfs_size_t metadata_cache = MBED_LFS_METADATA_CACHE);
 
     virtual ~LittleFileSystem();
 
@@ -86,7 +92,8 @@ public:
      *      Number of blocks to lookahead during block allocation. A larger
      *      lookahead reduces the number of passes required to allocate a block.
      *      The lookahead buffer requires only 1 bit per block so it can be quite
-     *      large with little ram impact. Should be a multiple of 32.
+     *      large with little ram impact. Should be a multiple of 32, zero
+     *      covers the whole device.
      */
     static int format(mbed::BlockDevice *bd,
                       lfs_size_t read_size = MBED_LFS_READ_SIZE,
@@ -294,6 +301,7 @@ private:
     const lfs_size_t _prog_size;
     const lfs_size_t _block_size;
     const lfs_size_t _lookahead;
+    const lfs_size_t _metadata_cache;
 
     // thread-safe locking
     PlatformMutex _mutex;
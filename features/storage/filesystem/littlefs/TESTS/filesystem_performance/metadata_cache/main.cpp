@@ -0,0 +1,175 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "mbed.h"
+#include "greentea-client/test_env.h"
+#include "unity.h"
+#include "utest.h"
+
+#include "LittleFileSystem.h"
+#include "HeapBlockDevice.h"
+#include "ProfilingBlockDevice.h"
+#include <stdio.h>
+
+using namespace utest::v1;
+
+// 1000 files spread over 10 directories, 4 levels deep
+static const bd_size_t block_size = 512;
+static const bd_size_t num_blocks = 512;
+static const int num_dirs = 10;
+static const int files_per_dir = 100;
+static const lfs_size_t cache_blocks = 16;
+
+typedef struct {
+    bd_size_t read_count;
+    int elapsed_ms;
+} bench_result_t;
+
+static void bench_path(char *path, int dir, int file)
+{
+    sprintf(path, "/lfs/a/b/c/d%d/f%03d", dir, file);
+}
+
+static void run_benchmark(lfs_size_t metadata_cache, bench_result_t results[3])
+{
+    HeapBlockDevice heap_bd(num_blocks * block_size, 1, 1, block_size);
+    ProfilingBlockDevice bd(&heap_bd);
+    LittleFileSystem fs("lfs", NULL, MBED_LFS_READ_SIZE, MBED_LFS_PROG_SIZE,
+                        MBED_LFS_BLOCK_SIZE, MBED_LFS_LOOKAHEAD, metadata_cache);
+    char path[32];
+    Timer timer;
+
+    int err = LittleFileSystem::format(&bd);
+    TEST_ASSERT_EQUAL(0, err);
+    err = fs.mount(&bd);
+    TEST_ASSERT_EQUAL(0, err);
+
+    err = mkdir("/lfs/a", 0777);
+    TEST_ASSERT_EQUAL(0, err);
+    err = mkdir("/lfs/a/b", 0777);
+    TEST_ASSERT_EQUAL(0, err);
+    err = mkdir("/lfs/a/b/c", 0777);
+    TEST_ASSERT_EQUAL(0, err);
+    for (int i = 0; i < num_dirs; i++) {
+        sprintf(path, "/lfs/a/b/c/d%d", i);
+        err = mkdir(path, 0777);
+        TEST_ASSERT_EQUAL(0, err);
+
+        for (int j = 0; j < files_per_dir; j++) {
+            bench_path(path, i, j);
+            FILE *f = fopen(path, "w");
+            TEST_ASSERT_NOT_NULL(f);
+            err = fclose(f);
+            TEST_ASSERT_EQUAL(0, err);
+        }
+    }
+
+    // stat
+    bd.reset();
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_dirs; i++) {
+        for (int j = 0; j < files_per_dir; j++) {
+            struct stat st;
+            bench_path(path, i, j);
+            err = stat(path, &st);
+            TEST_ASSERT_EQUAL(0, err);
+        }
+    }
+    timer.stop();
+    results[0].read_count = bd.get_read_count();
+    results[0].elapsed_ms = timer.read_ms();
+
+    // open
+    bd.reset();
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_dirs; i++) {
+        for (int j = 0; j < files_per_dir; j++) {
+            bench_path(path, i, j);
+            FILE *f = fopen(path, "r");
+            TEST_ASSERT_NOT_NULL(f);
+            err = fclose(f);
+            TEST_ASSERT_EQUAL(0, err);
+        }
+    }
+    timer.stop();
+    results[1].read_count = bd.get_read_count();
+    results[1].elapsed_ms = timer.read_ms();
+
+    // readdir
+    bd.reset();
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < num_dirs; i++) {
+        sprintf(path, "/lfs/a/b/c/d%d", i);
+        DIR *dd = opendir(path);
+        TEST_ASSERT_NOT_NULL(dd);
+        int count = 0;
+        while (readdir(dd)) {
+            count++;
+        }
+        TEST_ASSERT_EQUAL(files_per_dir + 2, count);
+        err = closedir(dd);
+        TEST_ASSERT_EQUAL(0, err);
+    }
+    timer.stop();
+    results[2].read_count = bd.get_read_count();
+    results[2].elapsed_ms = timer.read_ms();
+
+    err = fs.unmount();
+    TEST_ASSERT_EQUAL(0, err);
+}
+
+// Compares the block device reads of path lookups and directory reads with and
+// without the metadata cache
+void test_metadata_cache_benchmark()
+{
+    static const char *const ops[3] = {"stat", "open", "readdir"};
+
+    uint8_t *dummy = new (std::nothrow) uint8_t[num_blocks * block_size];
+    TEST_SKIP_UNLESS_MESSAGE(dummy, "Not enough memory for test");
+    delete[] dummy;
+
+    bench_result_t uncached[3];
+    bench_result_t cached[3];
+    run_benchmark(0, uncached);
+    run_benchmark(cache_blocks, cached);
+
+    for (int i = 0; i < 3; i++) {
+        printf("%-8s uncached: %9llu bytes read, %5d ms, cached: %9llu bytes read, %5d ms\n",
+               ops[i], uncached[i].read_count, uncached[i].elapsed_ms,
+               cached[i].read_count, cached[i].elapsed_ms);
+        TEST_ASSERT(cached[i].read_count < uncached[i].read_count);
+    }
+}
+
+// Test setup
+utest::v1::status_t test_setup(const size_t number_of_cases)
+{
+    GREENTEA_SETUP(240, "default_auto");
+    return verbose_test_setup_handler(number_of_cases);
+}
+
+Case cases[] = {
+    Case("Metadata cache benchmark", test_metadata_cache_benchmark),
+};
+
+Specification specification(test_setup, cases);
+
+int main()
+{
+    return !Harness::run(specification);
+}
@@ -122,9 +122,80 @@ static inline void lfs_cache_zero(lfs_t *lfs, lfs_cache_t *pcache) {
     pcache->block = 0xffffffff;
 }
 
+
+/// Metadata cache operations ///
+static lfs_mcache_t *lfs_mcache_find(lfs_t *lfs, lfs_block_t block) {
+    for (lfs_size_t i = 0; i < lfs->cfg->mcache_count; i++) {
+        if (lfs->mcache[i].block == block) {
+            lfs->mcache[i].used = ++lfs->mcache_tick;
+            return &lfs->mcache[i];
+        }
+    }
+
+    return NULL;
+}
+
+static const uint8_t *lfs_mcache_data(lfs_t *lfs, lfs_block_t block,
+        lfs_off_t off, lfs_size_t size) {
+    for (lfs_size_t i = 0; i < lfs->cfg->mcache_count; i++) {
+        if (lfs->mcache[i].block == block &&
+                off + size <= lfs->mcache[i].size) {
+            return &lfs->mcache[i].buffer[off];
+        }
+    }
+
+    return NULL;
+}
+
+static void lfs_mcache_drop(lfs_t *lfs, lfs_block_t block) {
+    // any write to a block makes its cached copy stale
+    for (lfs_size_t i = 0; i < lfs->cfg->mcache_count; i++) {
+        if (lfs->mcache[i].block == block) {
+            lfs->mcache[i].block = 0xffffffff;
+        }
+    }
+}
+
+static int lfs_mcache_load(lfs_t *lfs, lfs_block_t block,
+        lfs_size_t size, lfs_mcache_t **mcache) {
+    *mcache = NULL;
+    if (!lfs->cfg->mcache_count) {
+        return 0;
+    }
+
+    // reuse the block's entry, otherwise the least recently used one
+    lfs_mcache_t *m = lfs_mcache_find(lfs, block);
+    if (!m) {
+        m = &lfs->mcache[0];
+        for (lfs_size_t i = 1; i < lfs->cfg->mcache_count; i++) {
+            if (lfs->mcache[i].used < m->used) {
+                m = &lfs->mcache[i];
+            }
+        }
+    }
+
+    // only read up to the end of the metadata
+    size = lfs_min(lfs->mcache_size, size + lfs->cfg->read_size-1
+            - ((size + lfs->cfg->read_size-1) % lfs->cfg->read_size));
+    m->block = 0xffffffff;
+    int err = lfs_cache_read(lfs, &lfs->rcache, NULL,
+            block, 0, m->buffer, size);
+    if (err) {
+        return err;
+    }
+
+    m->block = block;
+    m->size = size;
+    m->used = ++lfs->mcache_tick;
+    m->checked = false;
+    *mcache = m;
+    return 0;
+}
+
 static int lfs_cache_flush(lfs_t *lfs,
         lfs_cache_t *pcache, lfs_cache_t *rcache) {
     if (pcache->block != 0xffffffff) {
+        lfs_mcache_drop(lfs, pcache->block);
         int err = lfs->cfg->prog(lfs->cfg, pcache->block,
                 pcache->off, pcache->buffer, lfs->cfg->prog_size);
         if (err) {
@@ -186,6 +257,7 @@ static int lfs_cache_prog(lfs_t *lfs, lfs_cache_t *pcache,
                 size >= lfs->cfg->prog_size) {
             // bypass pcache?
             lfs_size_t diff = size - (size % lfs->cfg->prog_size);
+            lfs_mcache_drop(lfs, block);
             int err = lfs->cfg->prog(lfs->cfg, block, off, data, diff);
             if (err) {
                 return err;
@@ -221,6 +293,12 @@ static int lfs_cache_prog(lfs_t *lfs, lfs_cache_t *pcache,
 /// General lfs block device operations ///
 static int lfs_bd_read(lfs_t *lfs, lfs_block_t block,
         lfs_off_t off, void *buffer, lfs_size_t size) {
+    const uint8_t *data = lfs_mcache_data(lfs, block, off, size);
+    if (data) {
+        memcpy(buffer, data, size);
+        return 0;
+    }
+
     // if we ever do more than writes to alternating pairs,
     // this may need to consider pcache
     return lfs_cache_read(lfs, &lfs->rcache, NULL,
@@ -235,15 +313,27 @@ static int lfs_bd_prog(lfs_t *lfs, lfs_block_t block,
 
 static int lfs_bd_cmp(lfs_t *lfs, lfs_block_t block,
         lfs_off_t off, const void *buffer, lfs_size_t size) {
+    const uint8_t *data = lfs_mcache_data(lfs, block, off, size);
+    if (data) {
+        return memcmp(data, buffer, size) == 0;
+    }
+
     return lfs_cache_cmp(lfs, &lfs->rcache, NULL, block, off, buffer, size);
 }
 
 static int lfs_bd_crc(lfs_t *lfs, lfs_block_t block,
         lfs_off_t off, lfs_size_t size, uint32_t *crc) {
+    const uint8_t *data = lfs_mcache_data(lfs, block, off, size);
+    if (data) {
+        lfs_crc(crc, data, size);
+        return 0;
+    }
+
     return lfs_cache_crc(lfs, &lfs->rcache, NULL, block, off, size, crc);
 }
 
 static int lfs_bd_erase(lfs_t *lfs, lfs_block_t block) {
+    lfs_mcache_drop(lfs, block);
     return lfs->cfg->erase(lfs->cfg, block);
 }
 
@@ -317,11 +407,11 @@ static int lfs_alloc(lfs_t *lfs, lfs_block_t *block) {
 
         lfs->free.off = (lfs->free.off + lfs->free.size)
                 % lfs->cfg->block_count;
-        lfs->free.size = lfs_min(lfs->cfg->lookahead, lfs->free.ack);
+        lfs->free.size = lfs_min(lfs->free.lookahead, lfs->free.ack);
         lfs->free.i = 0;
 
         // find mask of free blocks from tree
-        memset(lfs->free.buffer, 0, lfs->cfg->lookahead/8);
+        memset(lfs->free.buffer, 0, lfs->free.lookahead/8);
         int err = lfs_traverse(lfs, lfs_alloc_lookahead, lfs);
         if (err) {
             return err;
@@ -445,6 +535,20 @@ static int lfs_dir_fetch(lfs_t *lfs,
     // check both blocks for the most recent revision
     for (int i = 0; i < 2; i++) {
         struct lfs_disk_dir test;
+        lfs_mcache_t *mcache = lfs_mcache_find(lfs, tpair[i]);
+        if (mcache && mcache->checked) {
+            // already checked since it was last written
+            test.rev = mcache->rev;
+            test.size = mcache->dsize;
+            test.tail[0] = mcache->tail[0];
+            test.tail[1] = mcache->tail[1];
+            if (valid && lfs_scmp(test.rev, dir->d.rev) < 0) {
+                continue;
+            }
+
+            goto found;
+        }
+
         int err = lfs_bd_read(lfs, tpair[i], 0, &test, sizeof(test));
         lfs_dir_fromle32(&test);
         if (err) {
@@ -463,6 +567,15 @@ static int lfs_dir_fetch(lfs_t *lfs,
             continue;
         }
 
+        // keep the block around for the lookups that follow
+        err = lfs_mcache_load(lfs, tpair[i], 0x7fffffff & test.size, &mcache);
+        if (err) {
+            if (err == LFS_ERR_CORRUPT) {
+                continue;
+            }
+            return err;
+        }
+
         uint32_t crc = 0xffffffff;
         lfs_dir_tole32(&test);
         lfs_crc(&crc, &test, sizeof(test));
@@ -477,9 +590,21 @@ static int lfs_dir_fetch(lfs_t *lfs,
         }
 
         if (crc != 0) {
+            if (mcache) {
+                lfs_mcache_drop(lfs, tpair[i]);
+            }
             continue;
         }
 
+        if (mcache) {
+            mcache->checked = true;
+            mcache->rev = test.rev;
+            mcache->dsize = test.size;
+            mcache->tail[0] = test.tail[0];
+            mcache->tail[1] = test.tail[1];
+        }
+
+found:
         valid = true;
 
         // setup dir in case it's valid
@@ -2029,10 +2154,16 @@ static void lfs_deinit(lfs_t *lfs) {
     if (!lfs->cfg->lookahead_buffer) {
         lfs_free(lfs->free.buffer);
     }
+
+    if (lfs->mcache) {
+        lfs_free(lfs->mcache[0].buffer);
+        lfs_free(lfs->mcache);
+    }
 }
 
 static int lfs_init(lfs_t *lfs, const struct lfs_config *cfg) {
     lfs->cfg = cfg;
+    lfs->mcache = NULL;
 
     // setup read cache
     if (lfs->cfg->read_buffer) {
@@ -2058,18 +2189,48 @@ static int lfs_init(lfs_t *lfs, const struct lfs_config *cfg) {
     lfs_cache_zero(lfs, &lfs->rcache);
     lfs_cache_zero(lfs, &lfs->pcache);
 
-    // setup lookahead, round down to nearest 32-bits
+    // setup lookahead, no larger than needed to cover the whole device
     LFS_ASSERT(lfs->cfg->lookahead % 32 == 0);
-    LFS_ASSERT(lfs->cfg->lookahead > 0);
+    lfs->free.lookahead = 32*((lfs->cfg->block_count+31)/32);
+    if (lfs->cfg->lookahead && lfs->cfg->lookahead < lfs->free.lookahead) {
+        lfs->free.lookahead = lfs->cfg->lookahead;
+    }
+
     if (lfs->cfg->lookahead_buffer) {
         lfs->free.buffer = lfs->cfg->lookahead_buffer;
     } else {
-        lfs->free.buffer = lfs_malloc(lfs->cfg->lookahead/8);
+        lfs->free.buffer = lfs_malloc(lfs->free.lookahead/8);
         if (!lfs->free.buffer) {
             goto cleanup;
         }
     }
 
+    // setup metadata cache
+    lfs->mcache_size = lfs->cfg->mcache_size ?
+            lfs->cfg->mcache_size : lfs->cfg->block_size;
+    LFS_ASSERT(lfs->mcache_size % lfs->cfg->read_size == 0);
+    LFS_ASSERT(lfs->mcache_size <= lfs->cfg->block_size);
+    lfs->mcache_tick = 0;
+    if (lfs->cfg->mcache_count) {
+        lfs->mcache = lfs_malloc(lfs->cfg->mcache_count*sizeof(lfs_mcache_t));
+        if (!lfs->mcache) {
+            goto cleanup;
+        }
+
+        uint8_t *buffer = lfs_malloc(lfs->cfg->mcache_count*lfs->mcache_size);
+        if (!buffer) {
+            lfs_free(lfs->mcache);
+            lfs->mcache = NULL;
+            goto cleanup;
+        }
+
+        for (lfs_size_t i = 0; i < lfs->cfg->mcache_count; i++) {
+            lfs->mcache[i].block = 0xffffffff;
+            lfs->mcache[i].used = 0;
+            lfs->mcache[i].buffer = &buffer[i*lfs->mcache_size];
+        }
+    }
+
     // check that program and read sizes are multiples of the block size
     LFS_ASSERT(lfs->cfg->prog_size % lfs->cfg->read_size == 0);
     LFS_ASSERT(lfs->cfg->block_size % lfs->cfg->prog_size == 0);
@@ -2099,9 +2260,9 @@ int lfs_format(lfs_t *lfs, const struct lfs_config *cfg) {
     }
 
     // create free lookahead
-    memset(lfs->free.buffer, 0, lfs->cfg->lookahead/8);
+    memset(lfs->free.buffer, 0, lfs->free.lookahead/8);
     lfs->free.off = 0;
-    lfs->free.size = lfs_min(lfs->cfg->lookahead, lfs->cfg->block_count);
+    lfs->free.size = lfs_min(lfs->free.lookahead, lfs->cfg->block_count);
     lfs->free.i = 0;
     lfs_alloc_ack(lfs);
 
@@ -149,7 +149,9 @@ struct lfs_config {
     // Number of blocks to lookahead during block allocation. A larger
     // lookahead reduces the number of passes required to allocate a block.
     // The lookahead buffer requires only 1 bit per block so it can be quite
-    // large with little ram impact. Should be a multiple of 32.
+    // large with little ram impact. Should be a multiple of 32. Zero sizes
+    // the lookahead to cover the whole device, so the filesystem is only
+    // traversed once per pass over the device.
     lfs_size_t lookahead;
 
     // Optional, statically allocated read buffer. Must be read sized.
@@ -165,6 +167,16 @@ struct lfs_config {
     // Optional, statically allocated buffer for files. Must be program sized.
     // If enabled, only one file may be opened at a time.
     void *file_buffer;
+
+    // Number of metadata blocks to cache. Directory blocks are kept in ram
+    // once read and checked, until they are erased or programmed, so that
+    // path lookups and directory reads don't have to read and checksum them
+    // again. Zero disables the cache.
+    lfs_size_t mcache_count;
+
+    // Number of bytes cached from the start of each metadata block. Must be
+    // a multiple of the read size. Zero caches whole blocks.
+    lfs_size_t mcache_size;
 };
 
 // Optional configuration provided during lfs_file_opencfg
@@ -243,6 +255,17 @@ typedef struct lfs_dir {
     } d;
 } lfs_dir_t;
 
+typedef struct lfs_mcache {
+    lfs_block_t block;
+    lfs_size_t size;
+    uint32_t used;
+    bool checked;
+    uint32_t rev;
+    lfs_size_t dsize;
+    lfs_block_t tail[2];
+    uint8_t *buffer;
+} lfs_mcache_t;
+
 typedef struct lfs_superblock {
     lfs_off_t off;
 
@@ -264,6 +287,7 @@ typedef struct lfs_free {
     lfs_block_t size;
     lfs_block_t i;
     lfs_block_t ack;
+    lfs_size_t lookahead;
     uint32_t *buffer;
 } lfs_free_t;
 
@@ -278,6 +302,10 @@ typedef struct lfs {
     lfs_cache_t rcache;
     lfs_cache_t pcache;
 
+    lfs_mcache_t *mcache;
+    lfs_size_t mcache_size;
+    uint32_t mcache_tick;
+
     lfs_free_t free;
     bool deorphaned;
 } lfs_t;
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KVStore.h"
+#include "mbed_error.h"
+#include <new>
+#include <stdlib.h>
+
+using namespace mbed;
+
+// batch handle
+struct mbed::_opaque_batch_handle {
+    KVStore::batch_item_t *head;
+    KVStore::batch_item_t *tail;
+};
+
+int KVStore::batch_begin(batch_handle_t *handle)
+{
+    if (!handle) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    batch_handle_t batch = new (std::nothrow) _opaque_batch_handle;
+    if (!batch) {
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    batch->head = 0;
+    batch->tail = 0;
+    *handle = batch;
+    return MBED_SUCCESS;
+}
+
+int KVStore::batch_set(batch_handle_t handle, const char *key, const void *buffer, size_t size,
+                       uint32_t create_flags)
+{
+    if (!handle || !is_valid_key(key) || (!buffer && size)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    size_t key_size = strlen(key);
+    batch_item_t *item = new (std::nothrow) batch_item_t;
+    if (!item) {
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    item->next = 0;
+    item->key = new (std::nothrow) char[key_size + 1];
+    item->data = 0;
+    if (size) {
+        item->data = new (std::nothrow) uint8_t[size];
+    }
+    if (!item->key || (size && !item->data)) {
+        delete[] item->key;
+        delete[] static_cast<uint8_t *>(item->data);
+        delete item;
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    memcpy(item->key, key, key_size + 1);
+    if (size) {
+        memcpy(item->data, buffer, size);
+    }
+    item->size = size;
+    item->create_flags = create_flags;
+
+    if (handle->tail) {
+        handle->tail->next = item;
+    } else {
+        handle->head = item;
+    }
+    handle->tail = item;
+    return MBED_SUCCESS;
+}
+
+int KVStore::batch_commit(batch_handle_t handle)
+{
+    if (!handle) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    int ret = MBED_SUCCESS;
+    for (batch_item_t *item = handle->head; item; item = item->next) {
+        ret = set(item->key, item->data, item->size, item->create_flags);
+        if (ret != MBED_SUCCESS) {
+            break;
+        }
+    }
+
+    batch_free(handle);
+    return ret;
+}
+
+int KVStore::batch_abort(batch_handle_t handle)
+{
+    if (!handle) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    batch_free(handle);
+    return MBED_SUCCESS;
+}
+
+KVStore::batch_item_t *KVStore::batch_items(batch_handle_t handle)
+{
+    return handle->head;
+}
+
+void KVStore::batch_free(batch_handle_t handle)
+{
+    batch_item_t *item = handle->head;
+    while (item) {
+        batch_item_t *next = item->next;
+        delete[] item->key;
+        delete[] static_cast<uint8_t *>(item->data);
+        delete item;
+        item = next;
+    }
+    delete handle;
+}
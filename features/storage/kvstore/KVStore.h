@@ -42,6 +42,19 @@ public:
 
     typedef struct _opaque_key_iterator *iterator_t;
 
+    typedef struct _opaque_batch_handle *batch_handle_t;
+
+    /**
+     * Holds a set of a batch, items are kept in order of batch_set calls
+     */
+    typedef struct batch_item {
+        struct batch_item *next;
+        char *key;
+        void *data;
+        size_t size;
+        uint32_t create_flags;
+    } batch_item_t;
+
     /**
      * Holds key information
      */
@@ -190,6 +203,50 @@ public:
      */
     virtual int iterator_close(iterator_t it) = 0;
 
+    /**
+     * @brief Start a batch of sets, committed together by batch_commit.
+     *        Values are copied into the batch until it is committed or aborted.
+     *
+     * @param[out] handle               Returned batch handle.
+     *
+     * @returns MBED_SUCCESS on success or an error code on failure
+     */
+    virtual int batch_begin(batch_handle_t *handle);
+
+    /**
+     * @brief Add a set to a batch. The key is only validated against the store on commit.
+     *
+     * @param[in]  handle               Batch handle.
+     * @param[in]  key                  Key - must not include '*' '/' '?' ':' ';' '\' '"' '|' ' ' '<' '>' '\'.
+     * @param[in]  buffer               Value data buffer.
+     * @param[in]  size                 Value data size.
+     * @param[in]  create_flags         Flag mask.
+     *
+     * @returns MBED_SUCCESS on success or an error code on failure
+     */
+    virtual int batch_set(batch_handle_t handle, const char *key, const void *buffer, size_t size,
+                          uint32_t create_flags);
+
+    /**
+     * @brief Commit a batch and release its handle. Stores supporting it make all the sets of
+     *        the batch visible at once, also across power loss. The default implementation sets
+     *        the keys one by one, in order, and stops at the first failure.
+     *
+     * @param[in]  handle               Batch handle.
+     *
+     * @returns MBED_SUCCESS on success or an error code on failure
+     */
+    virtual int batch_commit(batch_handle_t handle);
+
+    /**
+     * @brief Drop a batch without setting its keys, and release its handle.
+     *
+     * @param[in]  handle               Batch handle.
+     *
+     * @returns MBED_SUCCESS on success or an error code on failure
+     */
+    virtual int batch_abort(batch_handle_t handle);
+
     /** Convenience function for checking key validity.
      *  Key must not include '*' '/' '?' ':' ';' '\' '"' '|' ' ' '<' '>' '\'.
      *
@@ -209,6 +266,22 @@ public:
         return true;
     }
 
+protected:
+    /**
+     * @brief First item of a batch, for implementations of batch_commit.
+     *
+     * @param[in]  handle               Batch handle.
+     *
+     * @returns First item, or NULL if the batch is empty.
+     */
+    static batch_item_t *batch_items(batch_handle_t handle);
+
+    /**
+     * @brief Free a batch and its items.
+     *
+     * @param[in]  handle               Batch handle.
+     */
+    static void batch_free(batch_handle_t handle);
 };
 /** @}*/
 
@@ -20,6 +20,7 @@
 #include "Dir.h"
 #include "File.h"
 #include "BlockDevice.h"
+#include "MbedCRC.h"
 #include "mbed_error.h"
 #include <string.h>
 #include <stdio.h>
@@ -35,7 +36,13 @@
 #define FSST_FOLDER_PATH "kvstore" //default FileSystemStore folder path on fs
 #endif
 
+#define FSST_PACKED_MAGIC 0x46535350 // "FSSP" hex 'magic' signature of packed records
+#define FSST_PACKED_FOLDER "packed" // container files folder, in FileSystemStore folder
+#define FSST_PACKED_DELETE_FLAG 0x1
+
 static const uint32_t supported_flags = mbed::KVStore::WRITE_ONCE_FLAG;
+static const uint32_t initial_crc = 0xFFFFFFFF;
+static const size_t packed_copy_size = 64;
 
 using namespace mbed;
 
@@ -47,12 +54,15 @@ typedef struct {
     uint32_t create_flags;
     size_t data_size;
     File *file_handle;
+    uint32_t record_offset; // packed mode only
+    uint32_t crc; // packed mode only
 } inc_set_handle_t;
 
 // iterator handle
 typedef struct {
     void *dir_handle;
     char *prefix;
+    char *last_key; // packed mode only
 } key_iterator_handle_t;
 
 } // anonymous namespace
@@ -60,10 +70,28 @@ typedef struct {
 // Local Functions
 static char *string_ndup(const char *src, size_t size);
 
+// Make room for one more element in an array, doubling its size when full
+template <typename T>
+static void grow_array(T *&array, size_t count, size_t &max_count, size_t initial_count)
+{
+    if (count < max_count) {
+        return;
+    }
+    max_count = max_count ? max_count * 2 : initial_count;
+    T *new_array = new T[max_count];
+    if (count) {
+        memcpy(new_array, array, count * sizeof(T));
+    }
+    delete[] array;
+    array = new_array;
+}
+
 
 // Class Functions
-FileSystemStore::FileSystemStore(FileSystem *fs) : _fs(fs),
-    _is_initialized(false)
+FileSystemStore::FileSystemStore(FileSystem *fs, bool packed, size_t open_files, size_t packed_file_size) : _fs(fs),
+    _is_initialized(false), _packed(packed), _packed_file_size(packed_file_size), _open_files_size(open_files),
+    _open_files(NULL), _open_files_tick(0), _packed_keys(NULL), _num_packed_keys(0), _max_packed_keys(0),
+    _packed_files(NULL), _num_packed_files(0), _max_packed_files(0), _packed_next_id(1), _packed_active(NULL)
 {
 
 }
@@ -82,6 +110,11 @@ int FileSystemStore::init()
     _full_path_key[_cfg_fs_path_size] = '/';
     _cur_inc_data_size = 0;
     _cur_inc_set_handle = NULL;
+    _open_files_tick = 0;
+    if (_open_files_size > 0) {
+        _open_files = new open_file_t[_open_files_size];
+        memset(_open_files, 0, _open_files_size * sizeof(open_file_t));
+    }
     Dir kv_dir;
 
     if (kv_dir.open(_fs, _cfg_fs_path) != 0) {
@@ -98,6 +131,17 @@ int FileSystemStore::init()
         }
     }
 
+    if (_packed) {
+        status = _packed_init();
+        if (status != MBED_SUCCESS) {
+            _packed_deinit();
+            _close_open_files();
+            delete[] _open_files;
+            _open_files = NULL;
+            goto exit_point;
+        }
+    }
+
     _is_initialized = true;
 exit_point:
 
@@ -110,6 +154,14 @@ exit_point:
 int FileSystemStore::deinit()
 {
     _mutex.lock();
+    if (_is_initialized) {
+        if (_packed) {
+            _packed_deinit();
+        }
+        _close_open_files();
+        delete[] _open_files;
+        _open_files = NULL;
+    }
     _is_initialized = false;
     delete[] _cfg_fs_path;
     delete[] _full_path_key;
@@ -130,6 +182,13 @@ int FileSystemStore::reset()
         goto exit_point;
     }
 
+    _close_open_files();
+
+    if (_packed) {
+        status = _packed_reset();
+        goto exit_point;
+    }
+
     kv_dir.open(_fs, _cfg_fs_path);
 
     while (kv_dir.read(&dir_ent) != 0) {
@@ -193,7 +252,8 @@ int FileSystemStore::get(const char *key, void *buffer, size_t buffer_size, size
 {
     int status = MBED_SUCCESS;
 
-    File kv_file;
+    File *kv_file = NULL;
+    key_metadata_t key_metadata;
     size_t kv_file_size = 0;
     size_t value_actual_size = 0;
 
@@ -204,14 +264,17 @@ int FileSystemStore::get(const char *key, void *buffer, size_t buffer_size, size
         goto exit_point;
     }
 
-    key_metadata_t key_metadata;
+    if (_packed) {
+        status = _packed_get(key, buffer, buffer_size, actual_size, offset);
+        goto exit_point;
+    }
 
     if ((status = _verify_key_file(key, &key_metadata, &kv_file)) != MBED_SUCCESS) {
         tr_error("File Verification failed, status: %d", status);
         goto exit_point;
     }
 
-    kv_file_size = kv_file.size() - key_metadata.metadata_size;
+    kv_file_size = kv_file->size() - key_metadata.metadata_size;
     // Actual size is the minimum of buffer_size and remainder of data in file (file's data size - offset)
     value_actual_size = buffer_size;
     if (offset > kv_file_size) {
@@ -230,14 +293,13 @@ int FileSystemStore::get(const char *key, void *buffer, size_t buffer_size, size
         *actual_size = value_actual_size;
     }
 
-    kv_file.seek(key_metadata.metadata_size + offset, SEEK_SET);
+    kv_file->seek(key_metadata.metadata_size + offset, SEEK_SET);
     // Read remainder of data
-    kv_file.read(buffer, value_actual_size);
+    kv_file->read(buffer, value_actual_size);
 
 exit_point:
-    if ((status == MBED_SUCCESS) ||
-            (status == MBED_ERROR_INVALID_DATA_DETECTED)) {
-        kv_file.close();
+    if (kv_file != NULL) {
+        _put_open_file(key, kv_file, &key_metadata);
     }
     _mutex.unlock();
 
@@ -247,7 +309,8 @@ exit_point:
 int FileSystemStore::get_info(const char *key, info_t *info)
 {
     int status = MBED_SUCCESS;
-    File kv_file;
+    File *kv_file = NULL;
+    key_metadata_t key_metadata;
 
     _mutex.lock();
 
@@ -256,7 +319,10 @@ int FileSystemStore::get_info(const char *key, info_t *info)
         goto exit_point;
     }
 
-    key_metadata_t key_metadata;
+    if (_packed) {
+        status = _packed_get_info(key, info);
+        goto exit_point;
+    }
 
     if ((status = _verify_key_file(key, &key_metadata, &kv_file)) != MBED_SUCCESS) {
         tr_error("File Verification failed, status: %d", status);
@@ -264,14 +330,13 @@ int FileSystemStore::get_info(const char *key, info_t *info)
     }
 
     if (info != NULL) {
-        info->size = kv_file.size() - key_metadata.metadata_size;
+        info->size = kv_file->size() - key_metadata.metadata_size;
         info->flags = key_metadata.user_flags;
     }
 
 exit_point:
-    if ((status == MBED_SUCCESS) ||
-            (status == MBED_ERROR_INVALID_DATA_DETECTED)) {
-        kv_file.close();
+    if (kv_file != NULL) {
+        _put_open_file(key, kv_file, &key_metadata);
     }
     _mutex.unlock();
 
@@ -280,7 +345,7 @@ exit_point:
 
 int FileSystemStore::remove(const char *key)
 {
-    File kv_file;
+    File *kv_file = NULL;
     key_metadata_t key_metadata;
 
     _mutex.lock();
@@ -292,12 +357,17 @@ int FileSystemStore::remove(const char *key)
         goto exit_point;
     }
 
+    if (_packed) {
+        status = _packed_remove(key);
+        goto exit_point;
+    }
+
     /* If File Exists and is Valid, then check its Write Once Flag to verify its disabled before removing */
     /* If File exists and is not valid, or is Valid and not Write-Onced then remove it */
     if ((status = _verify_key_file(key, &key_metadata, &kv_file)) == MBED_SUCCESS) {
         tr_error("File: %s, Exists Verifying Write Once Disabled before setting new value", _full_path_key);
         if (key_metadata.user_flags & KVStore::WRITE_ONCE_FLAG) {
-            kv_file.close();
+            _put_open_file(key, kv_file, &key_metadata);
             status = MBED_ERROR_WRITE_PROTECTED;
             goto exit_point;
         }
@@ -305,7 +375,10 @@ int FileSystemStore::remove(const char *key)
                (status == MBED_ERROR_INVALID_ARGUMENT)) {
         goto exit_point;
     }
-    kv_file.close();
+    if (kv_file != NULL) {
+        kv_file->close();
+        delete kv_file;
+    }
 
     if (0 != _fs->remove(_full_path_key)) {
         status =  MBED_ERROR_FAILED_OPERATION;
@@ -321,9 +394,11 @@ int FileSystemStore::set_start(set_handle_t *handle, const char *key, size_t fin
 {
     int status = MBED_SUCCESS;
     inc_set_handle_t *set_handle = NULL;
-    File *kv_file;
+    File *kv_file = NULL;
     key_metadata_t key_metadata;
     int key_len = 0;
+    uint32_t record_offset = 0;
+    uint32_t crc = 0;
 
     if (create_flags & ~supported_flags) {
         return MBED_ERROR_INVALID_ARGUMENT;
@@ -332,61 +407,104 @@ int FileSystemStore::set_start(set_handle_t *handle, const char *key, size_t fin
     // Only a single key file can be incrementaly editted at a time
     _mutex.lock();
 
-    kv_file = new File;
-
     if (handle == NULL) {
         status = MBED_ERROR_INVALID_ARGUMENT;
         goto exit_point;
     }
 
-    /* If File Exists and is Valid, then check its Write Once Flag to verify its disabled before setting */
-    /* If File exists and is not valid, or is Valid and not Write-Onced then erase it */
-    status = _verify_key_file(key, &key_metadata, kv_file);
-
-    if (status == MBED_ERROR_INVALID_ARGUMENT) {
-        tr_error("File Verification failed, status: %d", status);
-        goto exit_point;
-    }
+    if (_packed) {
+        size_t ind;
+        packed_record_header_t header;
 
-    if (status == MBED_SUCCESS) {
-        tr_info("File: %s, Exists. Verifying Write Once Disabled before setting new value", _full_path_key);
-        if (key_metadata.user_flags & KVStore::WRITE_ONCE_FLAG) {
-            kv_file->close();
+        if (!is_valid_key(key)) {
+            status = MBED_ERROR_INVALID_ARGUMENT;
+            goto exit_point;
+        }
+        if (_packed_find(key, ind) && (_packed_keys[ind].user_flags & KVStore::WRITE_ONCE_FLAG)) {
             status = MBED_ERROR_WRITE_PROTECTED;
             goto exit_point;
         }
-    }
 
-    /* For Success (not write_once) and for corrupted data close file before recreating it as a new file */
-    if (status != MBED_ERROR_ITEM_NOT_FOUND) {
-        kv_file->close();
-    }
+        header.magic = FSST_PACKED_MAGIC;
+        header.header_size = sizeof(packed_record_header_t);
+        header.revision = FSST_REVISION;
+        header.user_flags = create_flags;
+        header.key_size = strlen(key);
+        header.internal_flags = 0;
+        header.data_size = final_data_size;
+        status = _packed_record_start(header, key, record_offset, crc);
+        if (status != MBED_SUCCESS) {
+            goto exit_point;
+        }
+        kv_file = _packed_active;
+    } else {
+        /* If File Exists and is Valid, then check its Write Once Flag to verify its disabled before setting */
+        /* If File exists and is not valid, or is Valid and not Write-Onced then erase it */
+        status = _verify_key_file(key, &key_metadata, &kv_file);
 
-    if ((status = kv_file->open(_fs, _full_path_key, O_WRONLY | O_CREAT | O_TRUNC)) != MBED_SUCCESS) {
-        tr_info("set_start failed to open: %s, for writing, err: %d", _full_path_key, status);
-        status = MBED_ERROR_FAILED_OPERATION ;
-        goto exit_point;
+        if (status == MBED_ERROR_INVALID_ARGUMENT) {
+            tr_error("File Verification failed, status: %d", status);
+            goto exit_point;
+        }
+
+        if (status == MBED_SUCCESS) {
+            tr_info("File: %s, Exists. Verifying Write Once Disabled before setting new value", _full_path_key);
+            if (key_metadata.user_flags & KVStore::WRITE_ONCE_FLAG) {
+                _put_open_file(key, kv_file, &key_metadata);
+                kv_file = NULL;
+                status = MBED_ERROR_WRITE_PROTECTED;
+                goto exit_point;
+            }
+        }
+
+        /* Files kept open by the cache are opened for writing too, rewrite them in place */
+        if ((kv_file != NULL) && (_open_files_size > 0)) {
+            kv_file->seek(0, SEEK_SET);
+            if (kv_file->truncate(0) != 0) {
+                status = MBED_ERROR_FAILED_OPERATION;
+                goto exit_point;
+            }
+        } else {
+            /* For Success (not write_once) and for corrupted data close file before recreating it as a new file */
+            if (kv_file != NULL) {
+                kv_file->close();
+            } else {
+                kv_file = new File;
+            }
+
+            if ((status = kv_file->open(_fs, _full_path_key, (_open_files_size > 0 ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC))
+                    != MBED_SUCCESS) {
+                tr_info("set_start failed to open: %s, for writing, err: %d", _full_path_key, status);
+                status = MBED_ERROR_FAILED_OPERATION ;
+                goto exit_point;
+            }
+        }
+
+        key_metadata.magic = FSST_MAGIC;
+        key_metadata.metadata_size = sizeof(key_metadata_t);
+        key_metadata.revision = FSST_REVISION;
+        key_metadata.user_flags = create_flags;
+        kv_file->write(&key_metadata, sizeof(key_metadata_t));
     }
+    status = MBED_SUCCESS;
     _cur_inc_data_size = 0;
 
     set_handle = new inc_set_handle_t;
     set_handle->create_flags = create_flags;
     set_handle->data_size = final_data_size;
     set_handle->file_handle = kv_file;
+    set_handle->record_offset = record_offset;
+    set_handle->crc = crc;
     key_len = strlen(key);
     set_handle->key = string_ndup(key, key_len);
     *handle = (set_handle_t)set_handle;
     _cur_inc_set_handle = *handle;
 
-    key_metadata.magic = FSST_MAGIC;
-    key_metadata.metadata_size = sizeof(key_metadata_t);
-    key_metadata.revision = FSST_REVISION;
-    key_metadata.user_flags = create_flags;
-    kv_file->write(&key_metadata, sizeof(key_metadata_t));
-
 exit_point:
     if (status != MBED_SUCCESS) {
-        delete kv_file;
+        if (!_packed) {
+            delete kv_file;
+        }
         _mutex.unlock();
     }
     return status;
@@ -413,6 +531,16 @@ int FileSystemStore::set_add_data(set_handle_t handle, const void *value_data, s
         goto exit_point;
     }
 
+    if (_packed) {
+        if (_packed_write(value_data, data_size) != MBED_SUCCESS) {
+            status = MBED_ERROR_FAILED_OPERATION;
+            goto exit_point;
+        }
+        set_handle->crc = crc32_ansi(set_handle->crc, data_size, value_data);
+        _cur_inc_data_size += data_size;
+        goto exit_point;
+    }
+
     kv_file = set_handle->file_handle;
 
     added_data = kv_file->write(value_data, data_size);
@@ -433,6 +561,7 @@ int FileSystemStore::set_finalize(set_handle_t handle)
 {
     int status = MBED_SUCCESS;
     inc_set_handle_t *set_handle = NULL;
+    File *kv_file = NULL;
 
     if ((handle == NULL) || (handle != _cur_inc_set_handle)) {
         status =  MBED_ERROR_INVALID_ARGUMENT;
@@ -440,6 +569,9 @@ int FileSystemStore::set_finalize(set_handle_t handle)
     }
 
     set_handle = (inc_set_handle_t *)handle;
+    if (!_packed) {
+        kv_file = set_handle->file_handle;
+    }
 
     if (set_handle->key == NULL) {
         status = MBED_ERROR_INVALID_DATA_DETECTED;
@@ -448,13 +580,43 @@ int FileSystemStore::set_finalize(set_handle_t handle)
             tr_error("Accumulated Data (%d) size doesn't match set_start final size (%d) - file: %s", _cur_inc_data_size,
                      set_handle->data_size, _full_path_key);
             status = MBED_ERROR_INVALID_SIZE;
-            _fs->remove(_full_path_key);
+            if (_packed) {
+                _packed_truncate(set_handle->record_offset);
+            } else {
+                kv_file->close();
+                _fs->remove(_full_path_key);
+            }
+        } else if (_packed) {
+            packed_record_header_t header;
+            header.magic = FSST_PACKED_MAGIC;
+            header.header_size = sizeof(packed_record_header_t);
+            header.revision = FSST_REVISION;
+            header.user_flags = set_handle->create_flags;
+            header.key_size = strlen(set_handle->key);
+            header.internal_flags = 0;
+            header.data_size = set_handle->data_size;
+            status = _packed_record_finalize(header, set_handle->key, set_handle->record_offset, set_handle->crc);
+        } else if (_open_files_size > 0) {
+            // Keep the key file open for the following operations
+            key_metadata_t key_metadata;
+            key_metadata.magic = FSST_MAGIC;
+            key_metadata.metadata_size = sizeof(key_metadata_t);
+            key_metadata.revision = FSST_REVISION;
+            key_metadata.user_flags = set_handle->create_flags;
+            if (kv_file->sync() == 0) {
+                _put_open_file(set_handle->key, kv_file, &key_metadata);
+                kv_file = NULL;
+            } else {
+                status = MBED_ERROR_FAILED_OPERATION;
+            }
         }
         delete[] set_handle->key;
     }
 
-    set_handle->file_handle->close();
-    delete set_handle->file_handle;
+    if (kv_file != NULL) {
+        kv_file->close();
+        delete kv_file;
+    }
     delete set_handle;
     _cur_inc_data_size = 0;
     _cur_inc_set_handle = NULL;
@@ -485,10 +647,16 @@ int FileSystemStore::iterator_open(iterator_t *it, const char *prefix)
     key_it = new key_iterator_handle_t;
     key_it->dir_handle = NULL;
     key_it->prefix = NULL;
+    key_it->last_key = NULL;
     if (prefix != NULL) {
         key_it->prefix = string_ndup(prefix, KVStore::MAX_KEY_SIZE);
     }
 
+    if (_packed) {
+        *it = (iterator_t)key_it;
+        goto exit_point;
+    }
+
     kv_dir = new Dir;
     if (kv_dir->open(_fs, _cfg_fs_path) != 0) {
         tr_error("KV Dir: %s, doesnt exist", _cfg_fs_path); //TBD verify ERRNO NOEXIST
@@ -530,6 +698,11 @@ int FileSystemStore::iterator_next(iterator_t it, char *key, size_t key_size)
 
     key_it = (key_iterator_handle_t *)it;
 
+    if (_packed) {
+        status = _packed_iterator_next(key_it, key, key_size);
+        goto exit_point;
+    }
+
     if (key_name_size < strlen(key_it->prefix)) {
         status = MBED_ERROR_INVALID_SIZE;
         goto exit_point;
@@ -575,10 +748,10 @@ int FileSystemStore::iterator_close(iterator_t it)
     if (key_it->prefix != NULL) {
         delete[] key_it->prefix;
     }
-
-    ((Dir *)(key_it->dir_handle))->close();
+    delete[] key_it->last_key;
 
     if (key_it->dir_handle != NULL) {
+        ((Dir *)(key_it->dir_handle))->close();
         delete ((Dir *)(key_it->dir_handle));
     }
     delete key_it;
@@ -588,9 +761,12 @@ exit_point:
     return status;
 }
 
-int FileSystemStore::_verify_key_file(const char *key, key_metadata_t *key_metadata, File *kv_file)
+int FileSystemStore::_verify_key_file(const char *key, key_metadata_t *key_metadata, File **kv_file)
 {
     int status = MBED_SUCCESS;
+    File *file = NULL;
+
+    *kv_file = NULL;
 
     if (!is_valid_key(key)) {
         status = MBED_ERROR_INVALID_ARGUMENT;
@@ -599,14 +775,22 @@ int FileSystemStore::_verify_key_file(const char *key, key_metadata_t *key_metad
 
     _build_full_path_key(key);
 
-    if (0 != kv_file->open(_fs, _full_path_key, O_RDONLY)) {
+    *kv_file = _take_open_file(key, key_metadata);
+    if (*kv_file != NULL) {
+        goto exit_point;
+    }
+
+    file = new File;
+    if (0 != file->open(_fs, _full_path_key, _open_files_size > 0 ? O_RDWR : O_RDONLY)) {
         tr_info("Couldn't read: %s", _full_path_key);
+        delete file;
         status = MBED_ERROR_ITEM_NOT_FOUND;
         goto exit_point;
     }
+    *kv_file = file;
 
     //Read Metadata
-    kv_file->read(key_metadata, sizeof(key_metadata_t));
+    file->read(key_metadata, sizeof(key_metadata_t));
 
     if ((key_metadata->magic != FSST_MAGIC) ||
             (key_metadata->revision > FSST_REVISION)) {
@@ -625,6 +809,672 @@ int FileSystemStore::_build_full_path_key(const char *key_src)
     return 0;
 }
 
+// Open files cache
+void FileSystemStore::_put_open_file(const char *name, File *file, const key_metadata_t *metadata)
+{
+    open_file_t *entry = NULL;
+
+    // Corrupted key files aren't kept open
+    if ((_open_files_size == 0) ||
+            (metadata && ((metadata->magic != FSST_MAGIC) || (metadata->revision > FSST_REVISION)))) {
+        file->close();
+        delete file;
+        return;
+    }
+
+    // Free entry, or least recently used one
+    for (size_t i = 0; i < _open_files_size; i++) {
+        if (_open_files[i].file == NULL) {
+            entry = &_open_files[i];
+            break;
+        }
+        if ((entry == NULL) || (_open_files[i].last_used < entry->last_used)) {
+            entry = &_open_files[i];
+        }
+    }
+
+    if (entry->file != NULL) {
+        entry->file->close();
+        delete entry->file;
+        delete[] entry->name;
+    }
+
+    entry->name = string_ndup(name, strlen(name));
+    entry->file = file;
+    if (metadata) {
+        entry->metadata = *metadata;
+    }
+    entry->last_used = ++_open_files_tick;
+}
+
+File *FileSystemStore::_take_open_file(const char *name, key_metadata_t *metadata)
+{
+    for (size_t i = 0; i < _open_files_size; i++) {
+        open_file_t *entry = &_open_files[i];
+        if ((entry->file != NULL) && !strcmp(entry->name, name)) {
+            File *file = entry->file;
+            if (metadata) {
+                *metadata = entry->metadata;
+            }
+            delete[] entry->name;
+            entry->name = NULL;
+            entry->file = NULL;
+            return file;
+        }
+    }
+    return NULL;
+}
+
+void FileSystemStore::_close_open_files()
+{
+    for (size_t i = 0; i < _open_files_size; i++) {
+        open_file_t *entry = &_open_files[i];
+        if (entry->file != NULL) {
+            entry->file->close();
+            delete entry->file;
+            delete[] entry->name;
+            entry->name = NULL;
+            entry->file = NULL;
+        }
+    }
+}
+
+// Packed mode
+int FileSystemStore::_packed_init()
+{
+    Dir packed_dir;
+    struct dirent dir_ent;
+    int status = MBED_SUCCESS;
+
+    _num_packed_keys = 0;
+    _num_packed_files = 0;
+    _packed_next_id = 1;
+    _packed_active = NULL;
+
+    _build_full_path_key(FSST_PACKED_FOLDER);
+    if (packed_dir.open(_fs, _full_path_key) != 0) {
+        if (_fs->mkdir(_full_path_key, 0777) != 0) {
+            tr_error("KV Dir: %s, mkdir failed.. ", _full_path_key);
+            return MBED_ERROR_FAILED_OPERATION;
+        }
+    } else {
+        while (packed_dir.read(&dir_ent) != 0) {
+            char *end;
+            uint32_t id;
+
+            if (dir_ent.d_type != DT_REG) {
+                continue;
+            }
+            id = strtoul(dir_ent.d_name, &end, 16);
+            if ((strlen(dir_ent.d_name) != 8) || (*end != '\0') || (id == 0)) {
+                tr_error("Packed folder should contain only container files - %s", dir_ent.d_name);
+                continue;
+            }
+
+            grow_array(_packed_files, _num_packed_files, _max_packed_files, 4);
+
+            // Keep the container files sorted, oldest first
+            size_t ind = _num_packed_files;
+            while ((ind > 0) && (_packed_files[ind - 1].id > id)) {
+                _packed_files[ind] = _packed_files[ind - 1];
+                ind--;
+            }
+            _packed_files[ind].id = id;
+            _packed_files[ind].size = 0;
+            _packed_files[ind].live_size = 0;
+            _num_packed_files++;
+        }
+        packed_dir.close();
+    }
+
+    for (size_t i = 0; i < _num_packed_files; i++) {
+        status = _packed_scan_file(_packed_files[i]);
+        if (status != MBED_SUCCESS) {
+            return status;
+        }
+        _packed_next_id = _packed_files[i].id + 1;
+    }
+
+    if (_num_packed_files == 0) {
+        return _packed_new_file();
+    }
+
+    // Append to the latest container file, dropping a record torn by a power loss
+    packed_file_t &active = _packed_files[_num_packed_files - 1];
+    char name[20];
+    _packed_file_name(active.id, name);
+    _build_full_path_key(name);
+    _packed_active = new File;
+    if (_packed_active->open(_fs, _full_path_key, O_RDWR) != 0) {
+        delete _packed_active;
+        _packed_active = NULL;
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    if ((uint32_t)_packed_active->size() != active.size) {
+        tr_warning("Truncating container file %s to its last valid record", _full_path_key);
+        _packed_truncate(active.size);
+    }
+
+    return MBED_SUCCESS;
+}
+
+void FileSystemStore::_packed_deinit()
+{
+    if (_packed_active != NULL) {
+        _packed_active->close();
+        delete _packed_active;
+        _packed_active = NULL;
+    }
+    for (size_t i = 0; i < _num_packed_keys; i++) {
+        delete[] _packed_keys[i].key;
+    }
+    delete[] _packed_keys;
+    _packed_keys = NULL;
+    _num_packed_keys = 0;
+    _max_packed_keys = 0;
+    delete[] _packed_files;
+    _packed_files = NULL;
+    _num_packed_files = 0;
+    _max_packed_files = 0;
+}
+
+int FileSystemStore::_packed_reset()
+{
+    char name[20];
+
+    if (_packed_active != NULL) {
+        _packed_active->close();
+        delete _packed_active;
+        _packed_active = NULL;
+    }
+
+    for (size_t i = 0; i < _num_packed_files; i++) {
+        _packed_file_name(_packed_files[i].id, name);
+        _build_full_path_key(name);
+        _fs->remove(_full_path_key);
+    }
+    _num_packed_files = 0;
+
+    for (size_t i = 0; i < _num_packed_keys; i++) {
+        delete[] _packed_keys[i].key;
+    }
+    _num_packed_keys = 0;
+
+    return _packed_new_file();
+}
+
+int FileSystemStore::_packed_get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size,
+                                 size_t offset)
+{
+    size_t ind;
+    size_t value_actual_size;
+
+    if (!is_valid_key(key)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+    if (!_packed_find(key, ind)) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+
+    const packed_key_t &entry = _packed_keys[ind];
+    if (offset > entry.data_size) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    value_actual_size = entry.data_size - offset;
+    if (value_actual_size > buffer_size) {
+        value_actual_size = buffer_size;
+    }
+    if ((buffer == NULL) && (value_actual_size > 0)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+    if (actual_size != NULL) {
+        *actual_size = value_actual_size;
+    }
+
+    return _packed_read(entry.file_id, entry.offset + sizeof(packed_record_header_t) + strlen(entry.key) + offset,
+                        buffer, value_actual_size);
+}
+
+int FileSystemStore::_packed_get_info(const char *key, info_t *info)
+{
+    size_t ind;
+
+    if (!is_valid_key(key)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+    if (!_packed_find(key, ind)) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+
+    if (info != NULL) {
+        info->size = _packed_keys[ind].data_size;
+        info->flags = _packed_keys[ind].user_flags;
+    }
+    return MBED_SUCCESS;
+}
+
+int FileSystemStore::_packed_remove(const char *key)
+{
+    size_t ind;
+    packed_record_header_t header;
+    uint32_t record_offset;
+    uint32_t crc;
+    int status;
+
+    if (!is_valid_key(key)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+    if (!_packed_find(key, ind)) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    if (_packed_keys[ind].user_flags & KVStore::WRITE_ONCE_FLAG) {
+        return MBED_ERROR_WRITE_PROTECTED;
+    }
+
+    // Removal is recorded by a record without data, until the key is compacted out
+    header.magic = FSST_PACKED_MAGIC;
+    header.header_size = sizeof(packed_record_header_t);
+    header.revision = FSST_REVISION;
+    header.user_flags = 0;
+    header.key_size = strlen(key);
+    header.internal_flags = FSST_PACKED_DELETE_FLAG;
+    header.data_size = 0;
+
+    status = _packed_record_start(header, key, record_offset, crc);
+    if (status != MBED_SUCCESS) {
+        return status;
+    }
+    return _packed_record_finalize(header, key, record_offset, crc);
+}
+
+int FileSystemStore::_packed_iterator_next(void *it, char *key, size_t key_size)
+{
+    key_iterator_handle_t *key_it = (key_iterator_handle_t *)it;
+    const char *prefix = key_it->prefix ? key_it->prefix : "";
+    size_t ind;
+
+    // Keys are sorted, continue from the last returned key as the index may have changed since
+    if (key_it->last_key == NULL) {
+        _packed_find(prefix, ind);
+    } else if (_packed_find(key_it->last_key, ind)) {
+        ind++;
+    }
+
+    if ((ind == _num_packed_keys) || strncmp(_packed_keys[ind].key, prefix, strlen(prefix))) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+
+    size_t len = strlen(_packed_keys[ind].key);
+    if (key_size < len + 1) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+    memcpy(key, _packed_keys[ind].key, len + 1);
+
+    delete[] key_it->last_key;
+    key_it->last_key = string_ndup(key, len);
+    return MBED_SUCCESS;
+}
+
+bool FileSystemStore::_packed_find(const char *key, size_t &ind)
+{
+    size_t low = 0;
+    size_t high = _num_packed_keys;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int cmp = strcmp(_packed_keys[mid].key, key);
+        if (cmp == 0) {
+            ind = mid;
+            return true;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    ind = low;
+    return false;
+}
+
+void FileSystemStore::_packed_apply(const char *key, const packed_record_header_t &header, uint32_t file_id,
+                                    uint32_t offset)
+{
+    size_t ind;
+    bool found = _packed_find(key, ind);
+
+    if (found) {
+        packed_key_t &entry = _packed_keys[ind];
+        packed_file_t *packed_file = _packed_file(entry.file_id);
+        if (packed_file) {
+            packed_file->live_size -= _packed_record_size(strlen(entry.key), entry.data_size);
+        }
+    }
+
+    if (header.internal_flags & FSST_PACKED_DELETE_FLAG) {
+        if (found) {
+            delete[] _packed_keys[ind].key;
+            memmove(&_packed_keys[ind], &_packed_keys[ind + 1], (_num_packed_keys - ind - 1) * sizeof(packed_key_t));
+            _num_packed_keys--;
+        }
+        return;
+    }
+
+    if (!found) {
+        grow_array(_packed_keys, _num_packed_keys, _max_packed_keys, 16);
+        memmove(&_packed_keys[ind + 1], &_packed_keys[ind], (_num_packed_keys - ind) * sizeof(packed_key_t));
+        _packed_keys[ind].key = string_ndup(key, header.key_size);
+        _num_packed_keys++;
+    }
+
+    packed_key_t &entry = _packed_keys[ind];
+    entry.file_id = file_id;
+    entry.offset = offset;
+    entry.data_size = header.data_size;
+    entry.user_flags = header.user_flags;
+    _packed_file(file_id)->live_size += _packed_record_size(header.key_size, header.data_size);
+}
+
+int FileSystemStore::_packed_scan_file(packed_file_t &packed_file)
+{
+    packed_record_header_t header;
+    char key[KVStore::MAX_KEY_SIZE];
+    uint8_t buf[packed_copy_size];
+    char name[20];
+    File file;
+    uint32_t offset = 0;
+    uint32_t file_size;
+
+    _packed_file_name(packed_file.id, name);
+    _build_full_path_key(name);
+    if (file.open(_fs, _full_path_key, O_RDONLY) != 0) {
+        tr_error("Couldn't read container file: %s", _full_path_key);
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    file_size = file.size();
+
+    while (file_size - offset >= sizeof(header)) {
+        uint32_t crc, stored_crc, record_size;
+
+        if ((file.read(&header, sizeof(header)) != sizeof(header)) ||
+                (header.magic != FSST_PACKED_MAGIC) || (header.header_size != sizeof(header)) ||
+                (header.revision > FSST_REVISION) ||
+                (header.key_size == 0) || (header.key_size >= KVStore::MAX_KEY_SIZE) ||
+                (header.data_size > file_size)) {
+            break;
+        }
+        record_size = _packed_record_size(header.key_size, header.data_size);
+        if (record_size > file_size - offset) {
+            break;
+        }
+
+        crc = crc32_ansi(initial_crc, sizeof(header), &header);
+        if (file.read(key, header.key_size) != header.key_size) {
+            break;
+        }
+        crc = crc32_ansi(crc, header.key_size, key);
+        key[header.key_size] = '\0';
+
+        uint32_t data_left = header.data_size;
+        while (data_left) {
+            uint32_t chunk_size = data_left < sizeof(buf) ? data_left : sizeof(buf);
+            if (file.read(buf, chunk_size) != (ssize_t)chunk_size) {
+                break;
+            }
+            crc = crc32_ansi(crc, chunk_size, buf);
+            data_left -= chunk_size;
+        }
+        if (data_left || (file.read(&stored_crc, sizeof(stored_crc)) != sizeof(stored_crc)) ||
+                (stored_crc != crc)) {
+            break;
+        }
+
+        _packed_apply(key, header, packed_file.id, offset);
+        offset += record_size;
+    }
+
+    file.close();
+    packed_file.size = offset;
+    return MBED_SUCCESS;
+}
+
+int FileSystemStore::_packed_new_file()
+{
+    char name[20];
+    File *file;
+
+    if (_packed_active != NULL) {
+        _packed_file_name(_packed_files[_num_packed_files - 1].id, name);
+        _put_open_file(name, _packed_active, NULL);
+        _packed_active = NULL;
+    }
+
+    _packed_file_name(_packed_next_id, name);
+    _build_full_path_key(name);
+    file = new File;
+    if (file->open(_fs, _full_path_key, O_RDWR | O_CREAT | O_TRUNC) != 0) {
+        tr_error("Couldn't create container file: %s", _full_path_key);
+        delete file;
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+
+    grow_array(_packed_files, _num_packed_files, _max_packed_files, 4);
+    _packed_files[_num_packed_files].id = _packed_next_id++;
+    _packed_files[_num_packed_files].size = 0;
+    _packed_files[_num_packed_files].live_size = 0;
+    _num_packed_files++;
+    _packed_active = file;
+
+    return MBED_SUCCESS;
+}
+
+int FileSystemStore::_packed_record_start(const packed_record_header_t &header, const char *key,
+                                          uint32_t &record_offset, uint32_t &crc)
+{
+    int status;
+    uint32_t record_size = _packed_record_size(header.key_size, header.data_size);
+
+    if (_packed_active == NULL) {
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+
+    packed_file_t *active = &_packed_files[_num_packed_files - 1];
+    if ((active->size > 0) && (active->size + record_size > _packed_file_size)) {
+        status = _packed_new_file();
+        if (status != MBED_SUCCESS) {
+            return status;
+        }
+        active = &_packed_files[_num_packed_files - 1];
+    }
+
+    record_offset = active->size;
+    if ((_packed_write(&header, sizeof(header)) != MBED_SUCCESS) ||
+            (_packed_write(key, header.key_size) != MBED_SUCCESS)) {
+        _packed_truncate(record_offset);
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+
+    crc = crc32_ansi(initial_crc, sizeof(header), &header);
+    crc = crc32_ansi(crc, header.key_size, key);
+    return MBED_SUCCESS;
+}
+
+int FileSystemStore::_packed_record_finalize(const packed_record_header_t &header, const char *key,
+                                             uint32_t record_offset, uint32_t crc)
+{
+    if ((_packed_write(&crc, sizeof(crc)) != MBED_SUCCESS) || (_packed_active->sync() != 0)) {
+        _packed_truncate(record_offset);
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+
+    _packed_apply(key, header, _packed_files[_num_packed_files - 1].id, record_offset);
+
+    return _packed_compact();
+}
+
+int FileSystemStore::_packed_write(const void *buffer, size_t size)
+{
+    packed_file_t &active = _packed_files[_num_packed_files - 1];
+
+    // Reads may have moved the file position away from the end
+    if (((uint32_t)_packed_active->tell() != active.size) &&
+            (_packed_active->seek(active.size, SEEK_SET) != (off_t)active.size)) {
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    if (_packed_active->write(buffer, size) != (ssize_t)size) {
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+    active.size += size;
+    return MBED_SUCCESS;
+}
+
+int FileSystemStore::_packed_read(uint32_t file_id, uint32_t offset, void *buffer, size_t size)
+{
+    int status = MBED_SUCCESS;
+    File *file = _packed_active;
+    char name[20];
+
+    if (file_id != _packed_files[_num_packed_files - 1].id) {
+        _packed_file_name(file_id, name);
+        file = _take_open_file(name, NULL);
+        if (file == NULL) {
+            _build_full_path_key(name);
+            file = new File;
+            if (file->open(_fs, _full_path_key, O_RDONLY) != 0) {
+                delete file;
+                return MBED_ERROR_FAILED_OPERATION;
+            }
+        }
+    }
+
+    if ((file->seek(offset, SEEK_SET) != (off_t)offset) || (file->read(buffer, size) != (ssize_t)size)) {
+        status = MBED_ERROR_FAILED_OPERATION;
+    }
+
+    if (file != _packed_active) {
+        _put_open_file(name, file, NULL);
+    }
+    return status;
+}
+
+void FileSystemStore::_packed_truncate(uint32_t offset)
+{
+    _packed_active->truncate(offset);
+    _packed_files[_num_packed_files - 1].size = offset;
+}
+
+int FileSystemStore::_packed_compact()
+{
+    uint8_t buf[packed_copy_size];
+    char name[20];
+    size_t max_rounds = _num_packed_files - 1;
+
+    for (size_t round = 0; (round < max_rounds) && (_num_packed_files > 1); round++) {
+        uint32_t total_size = 0;
+        uint32_t live_size = 0;
+        for (size_t i = 0; i < _num_packed_files; i++) {
+            total_size += _packed_files[i].size;
+            live_size += _packed_files[i].live_size;
+        }
+        if (total_size - live_size <= live_size) {
+            break;
+        }
+
+        // Compacting the oldest file first, the removal records it holds can't hide older values
+        uint32_t oldest_id = _packed_files[0].id;
+        File *file;
+        _packed_file_name(oldest_id, name);
+        _build_full_path_key(name);
+        file = _take_open_file(name, NULL);
+        if (file == NULL) {
+            file = new File;
+            if (file->open(_fs, _full_path_key, O_RDONLY) != 0) {
+                delete file;
+                return MBED_ERROR_FAILED_OPERATION;
+            }
+        }
+
+        tr_info("Compacting container file %s, %lu of %lu bytes live", _full_path_key,
+                (unsigned long)_packed_files[0].live_size, (unsigned long)_packed_files[0].size);
+
+        for (size_t i = 0; i < _num_packed_keys; i++) {
+            packed_key_t &entry = _packed_keys[i];
+            if (entry.file_id != oldest_id) {
+                continue;
+            }
+
+            uint32_t record_size = _packed_record_size(strlen(entry.key), entry.data_size);
+            packed_file_t *active = &_packed_files[_num_packed_files - 1];
+            if ((active->size > 0) && (active->size + record_size > _packed_file_size)) {
+                if (_packed_new_file() != MBED_SUCCESS) {
+                    goto fail;
+                }
+                active = &_packed_files[_num_packed_files - 1];
+            }
+
+            // Records are copied as they are, their CRC doesn't depend on their location
+            uint32_t record_offset = active->size;
+            file->seek(entry.offset, SEEK_SET);
+            for (uint32_t copied = 0; copied < record_size;) {
+                uint32_t chunk_size = record_size - copied;
+                if (chunk_size > sizeof(buf)) {
+                    chunk_size = sizeof(buf);
+                }
+                if ((file->read(buf, chunk_size) != (ssize_t)chunk_size) ||
+                        (_packed_write(buf, chunk_size) != MBED_SUCCESS)) {
+                    _packed_truncate(record_offset);
+                    goto fail;
+                }
+                copied += chunk_size;
+            }
+
+            _packed_files[0].live_size -= record_size;
+            _packed_files[_num_packed_files - 1].live_size += record_size;
+            entry.file_id = _packed_files[_num_packed_files - 1].id;
+            entry.offset = record_offset;
+        }
+
+        if (_packed_active->sync() != 0) {
+            goto fail;
+        }
+
+        file->close();
+        delete file;
+        _build_full_path_key(name);
+        _fs->remove(_full_path_key);
+        _num_packed_files--;
+        memmove(&_packed_files[0], &_packed_files[1], _num_packed_files * sizeof(packed_file_t));
+        continue;
+
+fail:
+        file->close();
+        delete file;
+        return MBED_ERROR_FAILED_OPERATION;
+    }
+
+    return MBED_SUCCESS;
+}
+
+FileSystemStore::packed_file_t *FileSystemStore::_packed_file(uint32_t file_id)
+{
+    for (size_t i = 0; i < _num_packed_files; i++) {
+        if (_packed_files[i].id == file_id) {
+            return &_packed_files[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t FileSystemStore::_packed_record_size(uint32_t key_size, uint32_t data_size)
+{
+    return sizeof(packed_record_header_t) + key_size + data_size + sizeof(uint32_t);
+}
+
+void FileSystemStore::_packed_file_name(uint32_t file_id, char *name)
+{
+    sprintf(name, FSST_PACKED_FOLDER "/%08lx", (unsigned long)file_id);
+}
+
 // Local Functions
 static char *string_ndup(const char *src, size_t size)
 {
@@ -633,6 +1483,3 @@ static char *string_ndup(const char *src, size_t size)
     string_copy[size] = '\0';
     return string_copy;
 }
-
-
-
@@ -20,6 +20,19 @@
 
 #include "KVStore.h"
 #include "FileSystem.h"
+#include "File.h"
+
+#ifndef MBED_CONF_FILESYSTEMSTORE_PACKED
+#define MBED_CONF_FILESYSTEMSTORE_PACKED            0
+#endif
+
+#ifndef MBED_CONF_FILESYSTEMSTORE_OPEN_FILES
+#define MBED_CONF_FILESYSTEMSTORE_OPEN_FILES        0
+#endif
+
+#ifndef MBED_CONF_FILESYSTEMSTORE_PACKED_FILE_SIZE
+#define MBED_CONF_FILESYSTEMSTORE_PACKED_FILE_SIZE  4096
+#endif
 
 namespace mbed {
 
@@ -27,6 +40,15 @@ namespace mbed {
  *  This class implements the KVStore interface to
  *  create a key value store over FileSystem.
  *
+ *  By default each key is stored in its own file. In packed mode, keys are
+ *  appended as records to a few container files instead, with an index of the
+ *  keys kept in RAM, so a set costs a file append and sync rather than a file
+ *  creation. When superseded records outweigh the live ones, the oldest
+ *  container file is compacted into the latest one and removed.
+ *
+ *  Files may be kept open between operations in a small cache, saving the
+ *  path lookup of each operation on the same key (or container file).
+ *
  *  @code
  *  ...
  *  @endcode
@@ -36,9 +58,15 @@ class FileSystemStore : public KVStore {
 public:
     /** Create FileSystemStore - A Key Value API on top of FS
      *
-     *  @param fs File system (FAT/LITTLE) on top of which FileSystemStore is adding KV API
+     *  @param fs                   File system (FAT/LITTLE) on top of which FileSystemStore is adding KV API
+     *  @param packed               Store the keys in container files rather than a file per key.
+     *                              Stores of either mode can't be read in the other.
+     *  @param open_files           Number of files kept open between operations, 0 to close them
+     *  @param packed_file_size     Size from which a new container file is started in packed mode
      */
-    FileSystemStore(FileSystem *fs);
+    FileSystemStore(FileSystem *fs, bool packed = MBED_CONF_FILESYSTEMSTORE_PACKED,
+                    size_t open_files = MBED_CONF_FILESYSTEMSTORE_OPEN_FILES,
+                    size_t packed_file_size = MBED_CONF_FILESYSTEMSTORE_PACKED_FILE_SIZE);
 
     /** Destroy FileSystemStore instance
      *
@@ -55,7 +83,7 @@ public:
     virtual int init();
 
     /**
-      * @brief Deinitialize FileSystemStore, release and free resources.
+      * @brief Deinitialize FileSystemStore, closing open files and freeing resources.
       *
       * @returns MBED_SUCCESS                        Success.
       */
@@ -233,6 +261,41 @@ private:
         uint32_t user_flags;
     } key_metadata_t;
 
+    // Record of a container file in packed mode, followed by the key, the data and a CRC
+    typedef struct {
+        uint32_t magic;
+        uint16_t header_size;
+        uint16_t revision;
+        uint32_t user_flags;
+        uint16_t key_size;
+        uint16_t internal_flags;
+        uint32_t data_size;
+    } packed_record_header_t;
+
+    // Cached open file, by key name or container file name
+    typedef struct {
+        char *name;
+        File *file;
+        key_metadata_t metadata;
+        uint32_t last_used;
+    } open_file_t;
+
+    // RAM index entry of a key in packed mode
+    typedef struct {
+        char *key;
+        uint32_t file_id;
+        uint32_t offset;
+        uint32_t data_size;
+        uint32_t user_flags;
+    } packed_key_t;
+
+    // Container file in packed mode
+    typedef struct {
+        uint32_t id;
+        uint32_t size;
+        uint32_t live_size;
+    } packed_file_t;
+
     /**
      * @brief Build Full name class member from Key, as a combination of FSST folder and key name
      *
@@ -243,15 +306,99 @@ private:
     int _build_full_path_key(const char *key_src);
 
     /**
-     * @brief Verify Key file metadata validity and open it if valid
+     * @brief Verify Key file metadata validity and open it if valid, or take it from the open files cache
      *
      * @param[in]  key                  In validated key file name.
      * @param[in]  key_metadata         Returned key file metadata.
-     * @param[in]  kv_file              Opened KV file handle (unless file doesn't exist)
+     * @param[in]  kv_file              Returned KV file handle, NULL unless valid
      *
      * @returns 0 on success or a negative error code on failure
      */
-    int _verify_key_file(const char *key, key_metadata_t *key_metadata, File *kv_file);
+    int _verify_key_file(const char *key, key_metadata_t *key_metadata, File **kv_file);
+
+    /**
+     * @brief Return a file to the open files cache, or close it if there is no cache
+     *
+     * @param[in]  name                 Key or container file name.
+     * @param[in]  file                 Open file handle, allocated with new.
+     * @param[in]  metadata             Key file metadata, NULL for container files.
+     */
+    void _put_open_file(const char *name, File *file, const key_metadata_t *metadata);
+
+    /**
+     * @brief Take a file out of the open files cache
+     *
+     * @param[in]  name                 Key or container file name.
+     * @param[out] metadata             Returned key file metadata, may be NULL.
+     *
+     * @returns File handle, or NULL if the file isn't in the cache
+     */
+    File *_take_open_file(const char *name, key_metadata_t *metadata);
+
+    /**
+     * @brief Close all files of the open files cache
+     */
+    void _close_open_files();
+
+    // Packed mode
+    int _packed_init();
+    void _packed_deinit();
+    int _packed_reset();
+    int _packed_get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size, size_t offset);
+    int _packed_get_info(const char *key, info_t *info);
+    int _packed_remove(const char *key);
+    int _packed_iterator_next(void *key_it, char *key, size_t key_size);
+
+    /**
+     * @brief Find a key in the RAM index
+     *
+     * @param[in]  key                  Key.
+     * @param[out] ind                  Index of the key, or where it would be inserted.
+     *
+     * @returns true if the key was found
+     */
+    bool _packed_find(const char *key, size_t &ind);
+
+    /**
+     * @brief Apply a record to the RAM index and the live sizes of the container files
+     */
+    void _packed_apply(const char *key, const packed_record_header_t &header, uint32_t file_id, uint32_t offset);
+
+    /**
+     * @brief Read the records of a container file into the RAM index
+     */
+    int _packed_scan_file(packed_file_t &packed_file);
+
+    /**
+     * @brief Close the active container file and start a new one
+     */
+    int _packed_new_file();
+
+    /**
+     * @brief Write a record header and key at the end of the active container file,
+     *        starting a new one if the record doesn't fit
+     */
+    int _packed_record_start(const packed_record_header_t &header, const char *key,
+                             uint32_t &record_offset, uint32_t &crc);
+
+    /**
+     * @brief Write the record CRC, sync the active container file and apply the record
+     */
+    int _packed_record_finalize(const packed_record_header_t &header, const char *key,
+                                uint32_t record_offset, uint32_t crc);
+
+    int _packed_write(const void *buffer, size_t size);
+    int _packed_read(uint32_t file_id, uint32_t offset, void *buffer, size_t size);
+    void _packed_truncate(uint32_t offset);
+
+    /**
+     * @brief Compact the oldest container files while superseded records outweigh live ones
+     */
+    int _packed_compact();
+
+    packed_file_t *_packed_file(uint32_t file_id);
+    static uint32_t _packed_record_size(uint32_t key_size, uint32_t data_size);
+    void _packed_file_name(uint32_t file_id, char *name);
 
     FileSystem *_fs;
     PlatformMutex _mutex;
@@ -263,6 +410,20 @@ private:
     char *_full_path_key; /* Full name of Key file currently working on */
     size_t _cur_inc_data_size; /* Amount of data added to Key file so far, during incremental add data */
     set_handle_t _cur_inc_set_handle; /* handle of currently key file under incremental set process */
+
+    bool _packed; /* Keys stored in container files */
+    size_t _packed_file_size; /* Size from which a new container file is started */
+    size_t _open_files_size; /* Number of entries of the open files cache */
+    open_file_t *_open_files;
+    uint32_t _open_files_tick;
+    packed_key_t *_packed_keys; /* RAM index, sorted by key */
+    size_t _num_packed_keys;
+    size_t _max_packed_keys;
+    packed_file_t *_packed_files; /* Container files, oldest first, the last one is active */
+    size_t _num_packed_files;
+    size_t _max_packed_files;
+    uint32_t _packed_next_id;
+    File *_packed_active; /* Active container file, open for appending */
 #endif
 };
 
@@ -50,6 +50,57 @@ int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t
     return ret;
 }
 
+int kv_set_batch(const kv_batch_item_t *items, size_t num_items)
+{
+    if (!items || !num_items) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    int ret = kv_init_storage_config();
+    if (MBED_SUCCESS != ret) {
+        return ret;
+    }
+
+    KVMap &kv_map = KVMap::get_instance();
+    KVStore *kv_instance = NULL;
+    KVStore::batch_handle_t handle;
+    uint32_t flags_mask = 0;
+    size_t key_index = 0;
+    ret = kv_map.lookup(items[0].full_name_key, &kv_instance, &key_index, &flags_mask);
+    if (ret != MBED_SUCCESS) {
+        return ret;
+    }
+
+    ret = kv_instance->batch_begin(&handle);
+    if (ret != MBED_SUCCESS) {
+        return ret;
+    }
+
+    for (size_t i = 0; i < num_items; i++) {
+        KVStore *item_instance = NULL;
+        ret = kv_map.lookup(items[i].full_name_key, &item_instance, &key_index, &flags_mask);
+        if (ret != MBED_SUCCESS) {
+            goto fail;
+        }
+        // A batch is committed by a single KVStore instance
+        if (item_instance != kv_instance) {
+            ret = MBED_ERROR_INVALID_ARGUMENT;
+            goto fail;
+        }
+        ret = kv_instance->batch_set(handle, items[i].full_name_key + key_index, items[i].buffer, items[i].size,
+                                     items[i].create_flags & flags_mask);
+        if (ret != MBED_SUCCESS) {
+            goto fail;
+        }
+    }
+
+    return kv_instance->batch_commit(handle);
+
+fail:
+    kv_instance->batch_abort(handle);
+    return ret;
+}
+
 int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size)
 {
     int ret = kv_init_storage_config();
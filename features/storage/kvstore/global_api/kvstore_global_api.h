@@ -49,6 +49,28 @@ typedef struct info {
     uint32_t flags;
 } kv_info_t;
 
+/**
+ * One item of a batch of sets
+ */
+typedef struct kv_batch_item {
+    /**
+     * /Partition_path/Key. Must not include '*' '/' '?' ':' ';' '\' '"' '|' ' ' '<' '>' '\'.
+     */
+    const char *full_name_key;
+    /**
+     * Value data buffer
+     */
+    const void *buffer;
+    /**
+     * Value data size
+     */
+    size_t size;
+    /**
+     * Flag mask
+     */
+    uint32_t create_flags;
+} kv_batch_item_t;
+
 /**
  * @brief Set one KVStore item, given key and value.
  *
@@ -61,6 +83,18 @@ typedef struct info {
  */
 int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags);
 
+/**
+ * @brief Set several KVStore items in one batch. All the keys must belong to the same partition.
+ *        On KVStore instances supporting it (TDBStore), either all the items are set or none of
+ *        them, also across power loss. Otherwise the items are set in order, up to the first failure.
+ *
+ * @param[in]  items                Items to set.
+ * @param[in]  num_items            Number of items.
+ *
+ * @returns MBED_SUCCESS on success or an error code from underlying KVStore instances
+ */
+int kv_set_batch(const kv_batch_item_t *items, size_t num_items);
+
 /**
  * @brief Get one KVStore item by given key.
  *
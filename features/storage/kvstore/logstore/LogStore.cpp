@@ -0,0 +1,978 @@
+/*
+ * Copyright (c) 2019 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ----------------------------------------------------------- Includes -----------------------------------------------------------
+
+#include "LogStore.h"
+
+#include <algorithm>
+#include <string.h>
+#include "mbed_error.h"
+#include "MbedCRC.h"
+#include "BufferedBlockDevice.h"
+
+using namespace mbed;
+
+// --------------------------------------------------------- Definitions ----------------------------------------------------------
+
+namespace {
+
+// Segment layout: header, batches of records, footer at the end of the segment
+typedef struct {
+    uint32_t magic;
+    uint16_t header_size;
+    uint16_t revision;
+    uint32_t seq;
+    uint32_t crc;
+} segment_header_t;
+
+typedef struct {
+    uint16_t magic;
+    uint16_t size;          // Size of the records following the header
+    uint32_t crc;           // Seeded with the segment sequence number, so stale batches don't match
+} batch_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t first_timestamp;
+    uint32_t last_timestamp;
+    uint32_t num_records;
+    uint32_t end_offset;
+    uint32_t index_count;
+    uint32_t crc;           // Covers the footer and the sparse index following it
+} segment_footer_t;
+
+// Records are packed in batches as a timestamp and a size followed by the data
+static const uint32_t record_header_size = sizeof(uint32_t) + sizeof(uint16_t);
+
+static const uint32_t segment_magic = 0x4C4F4753; // "LOGS" in ASCII
+static const uint32_t footer_magic = 0x4C4F4746;  // "LOGF" in ASCII
+static const uint16_t batch_magic = 0x4C42;       // "LB" in ASCII
+static const uint16_t logstore_revision = 1;
+
+static const uint32_t index_entries = MBED_CONF_LOGSTORE_INDEX_ENTRIES;
+static const uint32_t initial_crc = 0xFFFFFFFF;
+
+typedef enum {
+    LOGSTORE_ITER_FLASH = 0,
+    LOGSTORE_ITER_PENDING,
+    LOGSTORE_ITER_DONE,
+} iterator_state_e;
+
+// iterator handle
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    int state;
+    uint32_t segment;
+    uint32_t seq;
+    uint32_t offset;
+    // Write position when the iterator was opened
+    uint32_t end_segment;
+    uint32_t end_seq;
+    uint32_t end_offset;
+    uint8_t *buf;
+    uint32_t buf_size;
+    uint32_t buf_pos;
+    uint8_t *pending;
+    uint32_t pending_size;
+} log_iterator_handle_t;
+
+} // anonymous namespace
+
+// -------------------------------------------------- Functions Implementation ----------------------------------------------------
+
+static inline uint32_t align_up(uint32_t val, uint32_t size)
+{
+    return (((val - 1) / size) + 1) * size;
+}
+
+static uint32_t segment_crc_seed(uint32_t seq)
+{
+    return crc32_ansi(initial_crc, sizeof(seq), &seq);
+}
+
+static void parse_record(const uint8_t *buf, uint32_t &timestamp, uint16_t &size)
+{
+    memcpy(&timestamp, buf, sizeof(timestamp));
+    memcpy(&size, buf + sizeof(timestamp), sizeof(size));
+}
+
+// Class member functions
+
+LogStore::LogStore(BlockDevice *bd, bd_size_t segment_size, size_t batch_size) :
+    _bd(bd), _segment_size(segment_size), _batch_size(batch_size), _is_initialized(false),
+    _prog_size(0), _num_segments(0), _header_size(0), _footer_size(0), _data_end(0),
+    _index_stride(0), _segments(0), _active(0), _active_crc_seed(0), _index(0), _index_count(0),
+    _batch_buf(0), _pending_size(0), _pending_records(0), _pending_first_timestamp(0),
+    _last_timestamp(0), _num_records(0), _seq(0), _work_buf(0), _buff_bd(0)
+{
+}
+
+LogStore::~LogStore()
+{
+    deinit();
+}
+
+bd_addr_t LogStore::segment_addr(uint32_t segment) const
+{
+    return (bd_addr_t) segment * _segment_size;
+}
+
+size_t LogStore::get_max_record_size() const
+{
+    size_t batch_size = _is_initialized ? _batch_size : align_up(_batch_size, std::max(_bd->get_program_size(), (bd_size_t) 1));
+    if (batch_size < sizeof(batch_header_t) + record_header_size) {
+        return 0;
+    }
+    return std::min(batch_size - sizeof(batch_header_t) - record_header_size, (size_t) 0xFFFF);
+}
+
+int LogStore::read_batch(uint32_t segment, uint32_t offset, uint8_t *buf, uint32_t &size)
+{
+    batch_header_t header;
+    bd_addr_t addr = segment_addr(segment) + offset;
+
+    if (offset + sizeof(header) > _data_end) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    if (_buff_bd->read(&header, addr, sizeof(header))) {
+        return MBED_ERROR_READ_FAILED;
+    }
+
+    if ((header.magic != batch_magic) || !header.size || (header.size > _batch_size - sizeof(header)) ||
+            (offset + align_up(sizeof(header) + header.size, _prog_size) > _data_end)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    if (_buff_bd->read(buf, addr + sizeof(header), header.size)) {
+        return MBED_ERROR_READ_FAILED;
+    }
+
+    uint32_t crc = crc32_ansi(segment_crc_seed(_segments[segment].seq), sizeof(header) - sizeof(header.crc), &header);
+    crc = crc32_ansi(crc, header.size, buf);
+    if (crc != header.crc) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    size = header.size;
+    return MBED_SUCCESS;
+}
+
+void LogStore::add_index_entry(uint32_t offset, uint32_t timestamp)
+{
+    if (!_index_stride || (_index_count == index_entries) ||
+            (offset < _header_size + _index_count * _index_stride)) {
+        return;
+    }
+
+    _index[_index_count].timestamp = timestamp;
+    _index[_index_count].offset = offset;
+    _index_count++;
+}
+
+int LogStore::scan_segment(uint32_t segment, bool build_index)
+{
+    segment_t *seg = &_segments[segment];
+    uint32_t offset = _header_size;
+
+    seg->first_timestamp = 0;
+    seg->last_timestamp = 0;
+    seg->num_records = 0;
+    seg->indexed = false;
+    if (build_index) {
+        _index_count = 0;
+    }
+
+    while (true) {
+        uint32_t size;
+        int ret = read_batch(segment, offset, _work_buf, size);
+        if (ret == MBED_ERROR_INVALID_DATA_DETECTED) {
+            break;
+        }
+        if (ret) {
+            return ret;
+        }
+
+        for (uint32_t pos = 0; pos + record_header_size <= size;) {
+            uint32_t timestamp;
+            uint16_t record_size;
+            parse_record(_work_buf + pos, timestamp, record_size);
+            if (!seg->num_records) {
+                seg->first_timestamp = timestamp;
+            }
+            if (build_index && !pos) {
+                add_index_entry(offset, timestamp);
+            }
+            seg->last_timestamp = timestamp;
+            seg->num_records++;
+            pos += record_header_size + record_size;
+        }
+
+        offset += align_up(sizeof(batch_header_t) + size, _prog_size);
+    }
+
+    seg->end_offset = offset;
+    seg->closed = false;
+
+    // Programming over a torn batch would corrupt the next one, check the area it may span
+    int erase_value = _bd->get_erase_value();
+    uint32_t size = std::min((uint32_t) _batch_size, _data_end - offset);
+    if ((erase_value != -1) && size) {
+        if (_buff_bd->read(_work_buf, segment_addr(segment) + offset, size)) {
+            return MBED_ERROR_READ_FAILED;
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            if (_work_buf[i] != (uint8_t) erase_value) {
+                seg->closed = true;
+                break;
+            }
+        }
+    }
+
+    return MBED_SUCCESS;
+}
+
+int LogStore::read_footer(uint32_t segment, index_entry_t *index, uint32_t &index_count)
+{
+    segment_footer_t footer;
+    bd_addr_t addr = segment_addr(segment) + _data_end;
+
+    if (_buff_bd->read(&footer, addr, sizeof(footer))) {
+        return MBED_ERROR_READ_FAILED;
+    }
+
+    if ((footer.magic != footer_magic) || (footer.seq != _segments[segment].seq) ||
+            (footer.index_count > index_entries) || (footer.end_offset > _data_end)) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    // Read the index in chunks, so that callers checking the footer need no buffer for it
+    uint32_t crc = crc32_ansi(initial_crc, sizeof(footer) - sizeof(footer.crc), &footer);
+    addr += sizeof(footer);
+    for (uint32_t i = 0; i < footer.index_count;) {
+        index_entry_t chunk[8];
+        uint32_t count = std::min(footer.index_count - i, (uint32_t)(sizeof(chunk) / sizeof(chunk[0])));
+        if (_buff_bd->read(chunk, addr, count * sizeof(index_entry_t))) {
+            return MBED_ERROR_READ_FAILED;
+        }
+        crc = crc32_ansi(crc, count * sizeof(index_entry_t), chunk);
+        if (index) {
+            memcpy(&index[i], chunk, count * sizeof(index_entry_t));
+        }
+        addr += count * sizeof(index_entry_t);
+        i += count;
+    }
+
+    if (crc != footer.crc) {
+        return MBED_ERROR_INVALID_DATA_DETECTED;
+    }
+
+    segment_t *seg = &_segments[segment];
+    seg->first_timestamp = footer.first_timestamp;
+    seg->last_timestamp = footer.last_timestamp;
+    seg->num_records = footer.num_records;
+    seg->end_offset = footer.end_offset;
+    seg->indexed = true;
+    index_count = footer.index_count;
+    return MBED_SUCCESS;
+}
+
+int LogStore::seal_segment()
+{
+    segment_t *seg = &_segments[_active];
+    segment_footer_t footer;
+    bd_addr_t addr = segment_addr(_active) + _data_end;
+
+    footer.magic = footer_magic;
+    footer.seq = seg->seq;
+    footer.first_timestamp = seg->first_timestamp;
+    footer.last_timestamp = seg->last_timestamp;
+    footer.num_records = seg->num_records;
+    footer.end_offset = seg->end_offset;
+    footer.index_count = _index_count;
+    footer.crc = crc32_ansi(initial_crc, sizeof(footer) - sizeof(footer.crc), &footer);
+    footer.crc = crc32_ansi(footer.crc, _index_count * sizeof(index_entry_t), _index);
+
+    // Sealed from now on, whether programming the footer succeeds or not
+    seg->indexed = true;
+
+    if (_buff_bd->program(&footer, addr, sizeof(footer))) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    if (_index_count && _buff_bd->program(_index, addr + sizeof(footer), _index_count * sizeof(index_entry_t))) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    if (_buff_bd->sync()) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+
+    return MBED_SUCCESS;
+}
+
+int LogStore::open_segment()
+{
+    uint32_t segment = (_active + 1) % _num_segments;
+    segment_t *seg = &_segments[segment];
+
+    // Reclaim the oldest records
+    if (seg->valid) {
+        _num_records -= seg->num_records;
+    }
+    seg->valid = false;
+
+    if (_buff_bd->erase(segment_addr(segment), _segment_size)) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+
+    segment_header_t header;
+    header.magic = segment_magic;
+    header.header_size = sizeof(header);
+    header.revision = logstore_revision;
+    header.seq = ++_seq;
+    header.crc = crc32_ansi(initial_crc, sizeof(header) - sizeof(header.crc), &header);
+
+    if (_buff_bd->program(&header, segment_addr(segment), sizeof(header))) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    if (_buff_bd->sync()) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+
+    seg->seq = header.seq;
+    seg->first_timestamp = 0;
+    seg->last_timestamp = 0;
+    seg->num_records = 0;
+    seg->end_offset = _header_size;
+    seg->valid = true;
+    seg->indexed = false;
+    seg->closed = false;
+
+    _active = segment;
+    _active_crc_seed = segment_crc_seed(seg->seq);
+    _index_count = 0;
+    return MBED_SUCCESS;
+}
+
+int LogStore::flush_batch()
+{
+    int ret;
+
+    if (!_pending_size) {
+        return MBED_SUCCESS;
+    }
+
+    uint32_t total_size = align_up(sizeof(batch_header_t) + _pending_size, _prog_size);
+    segment_t *seg = &_segments[_active];
+
+    if (!seg->valid || seg->indexed || seg->closed || (seg->end_offset + total_size > _data_end)) {
+        if (seg->valid && !seg->indexed) {
+            // A segment left without footer is scanned on init, its records aren't lost
+            seal_segment();
+        }
+
+        ret = open_segment();
+        if (ret) {
+            return ret;
+        }
+        seg = &_segments[_active];
+    }
+
+    batch_header_t header;
+    header.magic = batch_magic;
+    header.size = _pending_size;
+    header.crc = crc32_ansi(_active_crc_seed, sizeof(header) - sizeof(header.crc), &header);
+    header.crc = crc32_ansi(header.crc, _pending_size, _batch_buf + sizeof(header));
+    memcpy(_batch_buf, &header, sizeof(header));
+    memset(_batch_buf + sizeof(header) + _pending_size, 0xFF, total_size - sizeof(header) - _pending_size);
+
+    uint32_t offset = seg->end_offset;
+
+    // Never program the same area twice, nor past a failed batch, which a scan can't cross.
+    // The batch stays pending, to be programmed in a fresh segment.
+    if (_buff_bd->program(_batch_buf, segment_addr(_active) + offset, total_size) || _buff_bd->sync()) {
+        seg->closed = true;
+        return MBED_ERROR_WRITE_FAILED;
+    }
+
+    seg->end_offset += total_size;
+    add_index_entry(offset, _pending_first_timestamp);
+    if (!seg->num_records) {
+        seg->first_timestamp = _pending_first_timestamp;
+    }
+    seg->last_timestamp = _last_timestamp;
+    seg->num_records += _pending_records;
+
+    _pending_size = 0;
+    _pending_records = 0;
+    return MBED_SUCCESS;
+}
+
+uint32_t LogStore::oldest_segment() const
+{
+    for (uint32_t i = 1; i <= _num_segments; i++) {
+        uint32_t segment = (_active + i) % _num_segments;
+        if (_segments[segment].valid && _segments[segment].num_records) {
+            return segment;
+        }
+    }
+    return _num_segments;
+}
+
+int LogStore::seek_segment(uint32_t segment, uint32_t timestamp, uint32_t &offset)
+{
+    offset = _header_size;
+
+    const index_entry_t *index = _index;
+    uint32_t index_count = _index_count;
+    index_entry_t *footer_index = 0;
+
+    if (segment != _active) {
+        if (!_segments[segment].indexed) {
+            return MBED_SUCCESS;
+        }
+
+        footer_index = new index_entry_t[index_entries];
+        int ret = read_footer(segment, footer_index, index_count);
+        if (ret) {
+            delete[] footer_index;
+            return (ret == MBED_ERROR_INVALID_DATA_DETECTED) ? MBED_SUCCESS : ret;
+        }
+        index = footer_index;
+    }
+
+    // Records before a batch starting with a lower timestamp are all lower
+    for (uint32_t i = 0; i < index_count && index[i].timestamp < timestamp; i++) {
+        offset = index[i].offset;
+    }
+
+    delete[] footer_index;
+    return MBED_SUCCESS;
+}
+
+int LogStore::init()
+{
+    int ret = MBED_SUCCESS;
+
+    _mutex.lock();
+
+    if (_is_initialized) {
+        goto end;
+    }
+
+    _buff_bd = new BufferedBlockDevice(_bd);
+    if (_buff_bd->init()) {
+        delete _buff_bd;
+        _buff_bd = 0;
+        ret = MBED_ERROR_READ_FAILED;
+        goto end;
+    }
+
+    _prog_size = _bd->get_program_size();
+    if (!_segment_size) {
+        _segment_size = _bd->get_erase_size();
+    }
+    _batch_size = align_up(_batch_size, _prog_size);
+    _num_segments = _bd->size() / _segment_size;
+    _header_size = align_up(sizeof(segment_header_t), _prog_size);
+    _footer_size = align_up(sizeof(segment_footer_t) + index_entries * sizeof(index_entry_t), _prog_size);
+
+    if ((_segment_size % _bd->get_erase_size()) || (_num_segments < 2) ||
+            (_batch_size <= sizeof(batch_header_t) + record_header_size) ||
+            (_batch_size - sizeof(batch_header_t) > 0xFFFF) ||
+            (_header_size + _batch_size + _footer_size > _segment_size)) {
+        _buff_bd->deinit();
+        delete _buff_bd;
+        _buff_bd = 0;
+        ret = MBED_ERROR_INVALID_SIZE;
+        goto end;
+    }
+
+    _data_end = _segment_size - _footer_size;
+    _index_stride = index_entries ? (_data_end - _header_size) / index_entries : 0;
+
+    _segments = new segment_t[_num_segments];
+    _index = new index_entry_t[std::max(index_entries, (uint32_t) 1)];
+    _batch_buf = new uint8_t[_batch_size];
+    _work_buf = new uint8_t[_batch_size];
+    _pending_size = 0;
+    _pending_records = 0;
+    _index_count = 0;
+    _num_records = 0;
+    _seq = 0;
+    _active = _num_segments - 1;
+
+    for (uint32_t segment = 0; segment < _num_segments; segment++) {
+        segment_header_t header;
+        segment_t *seg = &_segments[segment];
+
+        seg->seq = 0;
+        seg->valid = false;
+        seg->indexed = false;
+        seg->closed = false;
+        seg->num_records = 0;
+        seg->end_offset = _header_size;
+
+        if (_buff_bd->read(&header, segment_addr(segment), sizeof(header))) {
+            ret = MBED_ERROR_READ_FAILED;
+            goto fail;
+        }
+
+        if ((header.magic != segment_magic) || (header.revision != logstore_revision) ||
+                (header.crc != crc32_ansi(initial_crc, sizeof(header) - sizeof(header.crc), &header))) {
+            continue;
+        }
+
+        seg->seq = header.seq;
+        seg->valid = true;
+        if (!_seq || (header.seq > _seq)) {
+            _seq = header.seq;
+            _active = segment;
+        }
+    }
+
+    for (uint32_t segment = 0; segment < _num_segments; segment++) {
+        segment_t *seg = &_segments[segment];
+        if (!seg->valid) {
+            continue;
+        }
+
+        // Segments without a valid footer (the active one, or one which sealing was interrupted) are scanned
+        uint32_t index_count;
+        ret = read_footer(segment, (segment == _active) ? _index : 0, index_count);
+        if (ret == MBED_ERROR_INVALID_DATA_DETECTED) {
+            ret = scan_segment(segment, segment == _active);
+        } else if (!ret && (segment == _active)) {
+            _index_count = index_count;
+        }
+        if (ret) {
+            ret = MBED_ERROR_READ_FAILED;
+            goto fail;
+        }
+
+        _num_records += seg->num_records;
+    }
+
+    _last_timestamp = 0;
+    for (uint32_t i = 0; i < _num_segments; i++) {
+        // Latest segment holding records, going back from the active one
+        uint32_t segment = (_active + _num_segments - i) % _num_segments;
+        if (_segments[segment].valid && _segments[segment].num_records) {
+            _last_timestamp = _segments[segment].last_timestamp;
+            break;
+        }
+    }
+
+    if (_segments[_active].valid) {
+        _active_crc_seed = segment_crc_seed(_segments[_active].seq);
+    }
+
+    _is_initialized = true;
+    ret = MBED_SUCCESS;
+    goto end;
+
+fail:
+    delete[] _segments;
+    delete[] _index;
+    delete[] _batch_buf;
+    delete[] _work_buf;
+    _segments = 0;
+    _index = 0;
+    _batch_buf = 0;
+    _work_buf = 0;
+    _buff_bd->deinit();
+    delete _buff_bd;
+    _buff_bd = 0;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::deinit()
+{
+    int ret = MBED_SUCCESS;
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        goto end;
+    }
+
+    ret = flush_batch();
+
+    _buff_bd->deinit();
+    delete _buff_bd;
+    _buff_bd = 0;
+
+    delete[] _segments;
+    delete[] _index;
+    delete[] _batch_buf;
+    delete[] _work_buf;
+    _segments = 0;
+    _index = 0;
+    _batch_buf = 0;
+    _work_buf = 0;
+
+    _is_initialized = false;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::reset()
+{
+    int ret = MBED_SUCCESS;
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+        goto end;
+    }
+
+    for (uint32_t segment = 0; segment < _num_segments; segment++) {
+        segment_header_t header;
+        memset(&header, 0, sizeof(header));
+
+        _segments[segment].valid = false;
+        _segments[segment].num_records = 0;
+
+        if (_buff_bd->erase(segment_addr(segment), _segment_size)) {
+            ret = MBED_ERROR_WRITE_FAILED;
+            goto end;
+        }
+
+        // Erasing may not clear the device, invalidate the header explicitly
+        if ((_bd->get_erase_value() == -1) &&
+                _buff_bd->program(&header, segment_addr(segment), sizeof(header))) {
+            ret = MBED_ERROR_WRITE_FAILED;
+            goto end;
+        }
+    }
+
+    if (_buff_bd->sync()) {
+        ret = MBED_ERROR_WRITE_FAILED;
+        goto end;
+    }
+
+    // Sequence numbers keep increasing, stale batches never match new segments
+    _active = _num_segments - 1;
+    _index_count = 0;
+    _pending_size = 0;
+    _pending_records = 0;
+    _num_records = 0;
+    _last_timestamp = 0;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::append(uint32_t timestamp, const void *data, size_t size)
+{
+    int ret = MBED_SUCCESS;
+    uint16_t record_size = size;
+    uint8_t *record;
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+        goto end;
+    }
+
+    if (size > get_max_record_size()) {
+        ret = MBED_ERROR_INVALID_SIZE;
+        goto end;
+    }
+
+    if ((!data && size) || (_num_records && (timestamp < _last_timestamp))) {
+        ret = MBED_ERROR_INVALID_ARGUMENT;
+        goto end;
+    }
+
+    if (sizeof(batch_header_t) + _pending_size + record_header_size + size > _batch_size) {
+        ret = flush_batch();
+        if (ret) {
+            goto end;
+        }
+    }
+
+    record = _batch_buf + sizeof(batch_header_t) + _pending_size;
+    memcpy(record, &timestamp, sizeof(timestamp));
+    memcpy(record + sizeof(timestamp), &record_size, sizeof(record_size));
+    if (size) {
+        memcpy(record + record_header_size, data, size);
+    }
+
+    if (!_pending_records) {
+        _pending_first_timestamp = timestamp;
+    }
+    _pending_size += record_header_size + size;
+    _pending_records++;
+    _last_timestamp = timestamp;
+    _num_records++;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::sync()
+{
+    int ret;
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+    } else {
+        ret = flush_batch();
+    }
+
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::get_info(info_t *info)
+{
+    int ret = MBED_SUCCESS;
+    uint32_t oldest;
+
+    if (!info) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+        goto end;
+    }
+
+    if (!_num_records) {
+        ret = MBED_ERROR_ITEM_NOT_FOUND;
+        goto end;
+    }
+
+    oldest = oldest_segment();
+    info->first_timestamp = (oldest < _num_segments) ? _segments[oldest].first_timestamp : _pending_first_timestamp;
+    info->last_timestamp = _last_timestamp;
+    info->num_records = _num_records;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::iterator_open(iterator_t *it, uint32_t from, uint32_t to)
+{
+    int ret = MBED_SUCCESS;
+    log_iterator_handle_t *handle;
+    uint32_t oldest;
+
+    if (!it || (to < from)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+        goto end;
+    }
+
+    handle = new log_iterator_handle_t;
+    handle->from = from;
+    handle->to = to;
+    handle->buf = new uint8_t[_batch_size];
+    handle->buf_size = 0;
+    handle->buf_pos = 0;
+
+    // Records not synced yet are returned from a copy
+    handle->pending = 0;
+    handle->pending_size = _pending_size;
+    if (_pending_size) {
+        handle->pending = new uint8_t[_pending_size];
+        memcpy(handle->pending, _batch_buf + sizeof(batch_header_t), _pending_size);
+    }
+
+    handle->end_segment = _active;
+    handle->end_seq = _segments[_active].seq;
+    handle->end_offset = _segments[_active].end_offset;
+    handle->state = LOGSTORE_ITER_PENDING;
+
+    // First segment with records in range, going forward from the oldest one
+    oldest = oldest_segment();
+    if (oldest < _num_segments) {
+        for (uint32_t i = 0; i < _num_segments; i++) {
+            uint32_t segment = (oldest + i) % _num_segments;
+            segment_t *seg = &_segments[segment];
+
+            if (seg->valid && seg->num_records && (seg->last_timestamp >= from)) {
+                ret = seek_segment(segment, from, handle->offset);
+                if (ret) {
+                    delete[] handle->buf;
+                    delete[] handle->pending;
+                    delete handle;
+                    goto end;
+                }
+                handle->segment = segment;
+                handle->seq = seg->seq;
+                handle->state = LOGSTORE_ITER_FLASH;
+                break;
+            }
+
+            if (segment == _active) {
+                break;
+            }
+        }
+    }
+
+    *it = reinterpret_cast<iterator_t>(handle);
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::iterator_next(iterator_t it, uint32_t *timestamp, void *buffer, size_t buffer_size,
+                            size_t *actual_size)
+{
+    int ret = MBED_SUCCESS;
+    log_iterator_handle_t *handle = reinterpret_cast<log_iterator_handle_t *>(it);
+
+    if (!handle || !timestamp || (!buffer && buffer_size)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    _mutex.lock();
+
+    if (!_is_initialized) {
+        ret = MBED_ERROR_NOT_READY;
+        goto end;
+    }
+
+    while (true) {
+        if (handle->buf_pos < handle->buf_size) {
+            uint32_t record_timestamp;
+            uint16_t record_size;
+            const uint8_t *record = handle->buf + handle->buf_pos;
+
+            parse_record(record, record_timestamp, record_size);
+            handle->buf_pos += record_header_size + record_size;
+
+            if (record_timestamp < handle->from) {
+                continue;
+            }
+
+            if (record_timestamp > handle->to) {
+                handle->state = LOGSTORE_ITER_DONE;
+                handle->buf_size = 0;
+                break;
+            }
+
+            *timestamp = record_timestamp;
+            memcpy(buffer, record + record_header_size, std::min((size_t) record_size, buffer_size));
+            if (actual_size) {
+                *actual_size = record_size;
+            }
+            goto end;
+        }
+
+        if (handle->state == LOGSTORE_ITER_FLASH) {
+            segment_t *seg = &_segments[handle->segment];
+
+            if (!seg->valid || (seg->seq != handle->seq)) {
+                // Segment reclaimed since, carry on with the oldest records left
+                uint32_t oldest = oldest_segment();
+                if ((oldest == _num_segments) || (_segments[handle->end_segment].seq != handle->end_seq)) {
+                    handle->state = LOGSTORE_ITER_PENDING;
+                    continue;
+                }
+                handle->segment = oldest;
+                handle->seq = _segments[oldest].seq;
+                handle->offset = _header_size;
+                continue;
+            }
+
+            bool last = (handle->segment == handle->end_segment);
+            if (handle->offset >= (last ? handle->end_offset : seg->end_offset)) {
+                if (last) {
+                    handle->state = LOGSTORE_ITER_PENDING;
+                    continue;
+                }
+                handle->segment = (handle->segment + 1) % _num_segments;
+                handle->seq = _segments[handle->segment].seq;
+                handle->offset = _header_size;
+                continue;
+            }
+
+            uint32_t size;
+            ret = read_batch(handle->segment, handle->offset, handle->buf, size);
+            if (ret == MBED_ERROR_INVALID_DATA_DETECTED) {
+                // Skip the rest of a corrupt segment
+                handle->offset = seg->end_offset;
+                ret = MBED_SUCCESS;
+                continue;
+            }
+            if (ret) {
+                goto end;
+            }
+
+            handle->buf_size = size;
+            handle->buf_pos = 0;
+            handle->offset += align_up(sizeof(batch_header_t) + size, _prog_size);
+            continue;
+        }
+
+        if (handle->state == LOGSTORE_ITER_PENDING) {
+            handle->state = LOGSTORE_ITER_DONE;
+            if (handle->pending_size) {
+                memcpy(handle->buf, handle->pending, handle->pending_size);
+                handle->buf_size = handle->pending_size;
+                handle->buf_pos = 0;
+            }
+            continue;
+        }
+
+        break;
+    }
+
+    ret = MBED_ERROR_ITEM_NOT_FOUND;
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+int LogStore::iterator_close(iterator_t it)
+{
+    log_iterator_handle_t *handle = reinterpret_cast<log_iterator_handle_t *>(it);
+
+    if (!handle) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    delete[] handle->buf;
+    delete[] handle->pending;
+    delete handle;
+    return MBED_SUCCESS;
+}
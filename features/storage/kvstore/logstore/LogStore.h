@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2019 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MBED_LOGSTORE_H
+#define MBED_LOGSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BlockDevice.h"
+#include "PlatformMutex.h"
+
+#ifndef MBED_CONF_LOGSTORE_SEGMENT_SIZE
+#define MBED_CONF_LOGSTORE_SEGMENT_SIZE     0
+#endif
+
+#ifndef MBED_CONF_LOGSTORE_BATCH_SIZE
+#define MBED_CONF_LOGSTORE_BATCH_SIZE       256
+#endif
+
+#ifndef MBED_CONF_LOGSTORE_INDEX_ENTRIES
+#define MBED_CONF_LOGSTORE_INDEX_ENTRIES    16
+#endif
+
+namespace mbed {
+
+/** LogStore class
+ *
+ *  Append only storage of timestamped records over a block device, for time
+ *  series such as sensor samples.
+ *
+ *  Records are collected in RAM and programmed in batches, each batch protected
+ *  by a CRC. The device is split in segments of one or more erase units, which
+ *  are filled in turn. A full segment is sealed with a footer holding its time
+ *  range and a sparse index of the timestamps of its batches, so that reading a
+ *  time range only reads the batches it covers. When the device is full, the
+ *  oldest segment is erased and reused.
+ *
+ *  Timestamps are in units chosen by the application, and must not decrease
+ *  between records.
+ */
+class LogStore {
+public:
+    typedef struct _opaque_log_iterator *iterator_t;
+
+    /** Holds information about the stored records
+     */
+    typedef struct {
+        uint32_t first_timestamp;   // Timestamp of the oldest record
+        uint32_t last_timestamp;    // Timestamp of the latest record
+        size_t num_records;         // Number of records, including records not synced yet
+    } info_t;
+
+    /**
+     * @brief Class constructor
+     *
+     * @param[in]  bd                   Underlying block device.
+     * @param[in]  segment_size         Size of the segments, a multiple of the erase size of the
+     *                                  block device, or 0 for one erase unit per segment.
+     *                                  At least two segments must fit in the block device.
+     * @param[in]  batch_size           Size of the batches of records programmed at once,
+     *                                  rounded up to the program size of the block device.
+     *                                  Limits the size of a record.
+     *
+     * @returns none
+     */
+    LogStore(BlockDevice *bd, bd_size_t segment_size = MBED_CONF_LOGSTORE_SEGMENT_SIZE,
+             size_t batch_size = MBED_CONF_LOGSTORE_BATCH_SIZE);
+
+    /**
+     * @brief Class destructor
+     *
+     * @returns none
+     */
+    virtual ~LogStore();
+
+    /**
+     * @brief Initialize LogStore. Finds the latest segment, and the end of its records
+     *        if it isn't sealed.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_INVALID_SIZE             Block device geometry doesn't fit the segment and batch sizes.
+     *          MBED_ERROR_READ_FAILED              Unable to read from media.
+     */
+    int init();
+
+    /**
+     * @brief Deinitialize LogStore, programming records not synced yet.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     */
+    int deinit();
+
+    /**
+     * @brief Remove all records.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     */
+    int reset();
+
+    /**
+     * @brief Append a record. The record is programmed when its batch is full, or on sync.
+     *
+     * @param[in]  timestamp            Timestamp of the record, not lower than the previous one.
+     * @param[in]  data                 Record data.
+     * @param[in]  size                 Record size, up to get_max_record_size().
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_INVALID_ARGUMENT         Timestamp lower than the previous one.
+     *          MBED_ERROR_INVALID_SIZE             Record too large.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     */
+    int append(uint32_t timestamp, const void *data, size_t size);
+
+    /**
+     * @brief Program the records not synced yet.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     */
+    int sync();
+
+    /**
+     * @brief Get information about the stored records.
+     *
+     * @param[out] info                 Returned information.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_ITEM_NOT_FOUND           No records stored.
+     */
+    int get_info(info_t *info);
+
+    /**
+     * @brief Get the largest record size accepted by append.
+     *
+     * @returns Size in bytes.
+     */
+    size_t get_max_record_size() const;
+
+    /**
+     * @brief Start iterating over the records of a time range, oldest first.
+     *        Records appended after the iterator is opened are not returned, and
+     *        records reclaimed while it is open are skipped.
+     *
+     * @param[out] it                   Allocated iterator handle.
+     * @param[in]  from                 Lowest timestamp of the range.
+     * @param[in]  to                   Highest timestamp of the range.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_INVALID_ARGUMENT         Invalid argument given in function arguments.
+     *          MBED_ERROR_READ_FAILED              Unable to read from media.
+     */
+    int iterator_open(iterator_t *it, uint32_t from = 0, uint32_t to = 0xFFFFFFFF);
+
+    /**
+     * @brief Get the next record in iteration.
+     *
+     * @param[in]  it                   Iterator handle.
+     * @param[out] timestamp            Timestamp of the record.
+     * @param[in]  buffer               Buffer for the record data, truncated to buffer_size.
+     * @param[in]  buffer_size          Buffer size.
+     * @param[out] actual_size          Record size, may be NULL.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_INVALID_ARGUMENT         Invalid argument given in function arguments.
+     *          MBED_ERROR_READ_FAILED              Unable to read from media.
+     *          MBED_ERROR_ITEM_NOT_FOUND           No more records in range.
+     */
+    int iterator_next(iterator_t it, uint32_t *timestamp, void *buffer, size_t buffer_size,
+                      size_t *actual_size = NULL);
+
+    /**
+     * @brief Close iteration.
+     *
+     * @param[in]  it                   Iterator handle.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_INVALID_ARGUMENT         Invalid argument given in function arguments.
+     */
+    int iterator_close(iterator_t it);
+
+private:
+    typedef struct {
+        uint32_t timestamp;
+        uint32_t offset;
+    } index_entry_t;
+
+    typedef struct {
+        uint32_t seq;
+        uint32_t first_timestamp;
+        uint32_t last_timestamp;
+        uint32_t num_records;
+        uint32_t end_offset;
+        bool valid;
+        bool indexed;
+        bool closed;        // Ends in a failed or torn batch, no more batches may be programmed
+    } segment_t;
+
+    PlatformMutex _mutex;
+    BlockDevice *_bd;
+    bd_size_t _segment_size;
+    size_t _batch_size;
+    bool _is_initialized;
+    uint32_t _prog_size;
+    uint32_t _num_segments;
+    uint32_t _header_size;
+    uint32_t _footer_size;
+    uint32_t _data_end;
+    uint32_t _index_stride;
+    segment_t *_segments;
+    uint32_t _active;
+    uint32_t _active_crc_seed;
+    index_entry_t *_index;
+    uint32_t _index_count;
+    uint8_t *_batch_buf;
+    uint32_t _pending_size;
+    uint32_t _pending_records;
+    uint32_t _pending_first_timestamp;
+    uint32_t _last_timestamp;
+    size_t _num_records;
+    uint32_t _seq;
+    uint8_t *_work_buf;
+    BlockDevice *_buff_bd;
+
+    /**
+     * @brief Address of a segment on the block device.
+     */
+    bd_addr_t segment_addr(uint32_t segment) const;
+
+    /**
+     * @brief Read and check the batch at an offset of a segment.
+     *
+     * @param[in]  segment              Segment.
+     * @param[in]  offset               Offset of the batch in the segment.
+     * @param[in]  buf                  Buffer for the records of the batch, of the batch size.
+     * @param[out] size                 Size of the records of the batch.
+     *
+     * @returns MBED_SUCCESS, MBED_ERROR_INVALID_DATA_DETECTED if there is no valid batch
+     *          or MBED_ERROR_READ_FAILED.
+     */
+    int read_batch(uint32_t segment, uint32_t offset, uint8_t *buf, uint32_t &size);
+
+    /**
+     * @brief Find the records of a segment without a valid footer. The segment is closed
+     *        if the scan stops on data that isn't erased, like a batch torn by a power loss.
+     *
+     * @param[in]  segment              Segment.
+     * @param[in]  build_index          Rebuild the sparse index of the active segment.
+     *
+     * @returns MBED_SUCCESS or MBED_ERROR_READ_FAILED.
+     */
+    int scan_segment(uint32_t segment, bool build_index);
+
+    /**
+     * @brief Add a batch of the active segment to its sparse index if it starts a new stride.
+     *
+     * @param[in]  offset               Offset of the batch in the segment.
+     * @param[in]  timestamp            Timestamp of the first record of the batch.
+     */
+    void add_index_entry(uint32_t offset, uint32_t timestamp);
+
+    /**
+     * @brief Read the footer of a segment into its segment information.
+     *
+     * @param[in]  segment              Segment.
+     * @param[in]  index                Buffer for the sparse index, may be NULL.
+     * @param[out] index_count          Number of index entries.
+     *
+     * @returns MBED_SUCCESS, MBED_ERROR_INVALID_DATA_DETECTED if the footer isn't valid
+     *          or MBED_ERROR_READ_FAILED.
+     */
+    int read_footer(uint32_t segment, index_entry_t *index, uint32_t &index_count);
+
+    /**
+     * @brief Seal the active segment with its footer.
+     */
+    int seal_segment();
+
+    /**
+     * @brief Erase the segment following the active one, reclaiming its records, and make it active.
+     */
+    int open_segment();
+
+    /**
+     * @brief Program the pending batch.
+     */
+    int flush_batch();
+
+    /**
+     * @brief Oldest segment holding records, or the number of segments if there is none.
+     */
+    uint32_t oldest_segment() const;
+
+    /**
+     * @brief Offset in a segment of the first batch that may hold a timestamp.
+     */
+    int seek_segment(uint32_t segment, uint32_t timestamp, uint32_t &offset);
+};
+
+} // namespace mbed
+
+#endif
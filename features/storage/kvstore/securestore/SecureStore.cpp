@@ -23,6 +23,7 @@
 #include "aes.h"
 #include "cmac.h"
 #include "entropy.h"
+#include "platform_util.h"
 #include "DeviceKey.h"
 #include "mbed_assert.h"
 #include "mbed_wait_api.h"
@@ -43,6 +44,14 @@ static const uint32_t iv_size           = 8;
 static const uint32_t scratch_buf_size  = 256;
 static const uint32_t derived_key_size  = 16;
 
+#ifndef MBED_CONF_SECURESTORE_KEY_CACHE_SIZE
+#define MBED_CONF_SECURESTORE_KEY_CACHE_SIZE 4
+#endif
+
+static const uint32_t key_cache_size    = MBED_CONF_SECURESTORE_KEY_CACHE_SIZE;
+// With caching disabled, a single entry serves the current operation only
+static const uint32_t key_cache_entries = key_cache_size ? key_cache_size : 1;
+
 static const char *const enc_prefix  = "ENC";
 static const char *const auth_prefix = "AUTH";
 
@@ -58,14 +67,30 @@ typedef struct {
     uint8_t  iv[iv_size];
 } record_metadata_t;
 
+// Contexts set with the keys derived for a single KV key. As the salts are built of
+// constant prefixes and the key name, the name alone identifies them.
+typedef struct {
+    char *key;
+    uint32_t last_used;
+    bool enc_ready;
+    bool auth_ready;
+    mbedtls_aes_context enc_ctx;
+    mbedtls_cipher_context_t auth_ctx;
+} key_cache_entry_t;
+
+// LRU cache of derived key contexts
+typedef struct {
+    uint32_t use_count;
+    key_cache_entry_t entries[key_cache_entries];
+} key_cache_t;
+
 // incremental set handle
 typedef struct {
     record_metadata_t metadata;
     char *key;
     uint32_t offset_in_data;
     uint8_t ctr_buf[enc_block_size];
-    mbedtls_aes_context enc_ctx;
-    mbedtls_cipher_context_t auth_ctx;
+    key_cache_entry_t *cache_entry;
     KVStore::set_handle_t underlying_handle;
 } inc_set_handle_t;
 
@@ -81,23 +106,79 @@ typedef struct {
 
 // -------------------------------------------------- Functions Implementation ----------------------------------------------------
 
-int encrypt_decrypt_start(mbedtls_aes_context &enc_aes_ctx, uint8_t *iv, const char *key,
-                          uint8_t *ctr_buf, uint8_t *salt_buf, int salt_buf_size)
+void key_cache_evict(key_cache_entry_t &entry)
+{
+    // Free functions zeroize the key material held by the contexts
+    if (entry.enc_ready) {
+        mbedtls_aes_free(&entry.enc_ctx);
+    }
+    if (entry.auth_ready) {
+        mbedtls_cipher_free(&entry.auth_ctx);
+    }
+    delete[] entry.key;
+    entry.key = 0;
+    entry.last_used = 0;
+    entry.enc_ready = false;
+    entry.auth_ready = false;
+}
+
+key_cache_entry_t *key_cache_get(key_cache_t *cache, const char *key)
+{
+    key_cache_entry_t *victim = &cache->entries[0];
+
+    for (uint32_t i = 0; i < key_cache_entries; i++) {
+        key_cache_entry_t *entry = &cache->entries[i];
+        if (entry->key && !strcmp(entry->key, key)) {
+            entry->last_used = ++cache->use_count;
+            return entry;
+        }
+        // Prefer a free entry, otherwise the least recently used one
+        if (victim->key && (!entry->key || (entry->last_used < victim->last_used))) {
+            victim = entry;
+        }
+    }
+
+    key_cache_evict(*victim);
+    victim->key = new char[strlen(key) + 1];
+    strcpy(victim->key, key);
+    victim->last_used = ++cache->use_count;
+    return victim;
+}
+
+void key_cache_release(key_cache_entry_t *entry)
+{
+    if (!key_cache_size) {
+        key_cache_evict(*entry);
+    }
+}
+
+int derive_key(const char *prefix, const char *key, uint8_t *salt_buf, int salt_buf_size,
+               uint8_t *derived_key)
 {
     DeviceKey &devkey = DeviceKey::get_instance();
     char *salt = reinterpret_cast<char *>(salt_buf);
-    uint8_t encrypt_key[derived_key_size];
-    strcpy(salt, enc_prefix);
-    int pos = strlen(enc_prefix);
+    strcpy(salt, prefix);
+    int pos = strlen(prefix);
     strncpy(salt + pos, key, salt_buf_size - pos - 1);
     salt_buf[salt_buf_size - 1] = 0;
-    int os_ret = devkey.generate_derived_key(salt_buf, strlen(salt), encrypt_key,  DEVICE_KEY_16BYTE);
-    if (os_ret) {
-        return os_ret;
-    }
+    return devkey.generate_derived_key(salt_buf, strlen(salt), derived_key, DEVICE_KEY_16BYTE);
+}
 
-    mbedtls_aes_init(&enc_aes_ctx);
-    mbedtls_aes_setkey_enc(&enc_aes_ctx, encrypt_key, enc_block_size * 8);
+int encrypt_decrypt_start(key_cache_entry_t &entry, uint8_t *iv, const char *key,
+                          uint8_t *ctr_buf, uint8_t *salt_buf, int salt_buf_size)
+{
+    if (!entry.enc_ready) {
+        uint8_t encrypt_key[derived_key_size];
+        int os_ret = derive_key(enc_prefix, key, salt_buf, salt_buf_size, encrypt_key);
+        if (os_ret) {
+            return os_ret;
+        }
+
+        mbedtls_aes_init(&entry.enc_ctx);
+        mbedtls_aes_setkey_enc(&entry.enc_ctx, encrypt_key, enc_block_size * 8);
+        mbedtls_platform_zeroize(encrypt_key, derived_key_size);
+        entry.enc_ready = true;
+    }
 
     memcpy(ctr_buf, iv, iv_size);
     memset(ctr_buf + iv_size, 0, iv_size);
@@ -114,33 +195,35 @@ int encrypt_decrypt_data(mbedtls_aes_context &enc_aes_ctx, const uint8_t *in_buf
                                  stream_block, in_buf, out_buf);
 }
 
-int cmac_calc_start(mbedtls_cipher_context_t &auth_ctx, const char *key, uint8_t *salt_buf, int salt_buf_size)
+int cmac_calc_start(key_cache_entry_t &entry, const char *key, uint8_t *salt_buf, int salt_buf_size)
 {
-    DeviceKey &devkey = DeviceKey::get_instance();
-    char *salt = reinterpret_cast<char *>(salt_buf);
+    // Key is already set, only restart the calculation
+    if (entry.auth_ready) {
+        return mbedtls_cipher_cmac_reset(&entry.auth_ctx);
+    }
+
     uint8_t auth_key[derived_key_size];
-    strcpy(salt, auth_prefix);
-    int pos = strlen(auth_prefix);
-    strncpy(salt + pos, key, salt_buf_size - pos - 1);
-    salt_buf[salt_buf_size - 1] = 0;
-    int os_ret = devkey.generate_derived_key(salt_buf, strlen(salt), auth_key, DEVICE_KEY_16BYTE);
+    int os_ret = derive_key(auth_prefix, key, salt_buf, salt_buf_size, auth_key);
     if (os_ret) {
         return os_ret;
     }
 
     const mbedtls_cipher_info_t *cipher_info = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB);
 
-    mbedtls_cipher_init(&auth_ctx);
+    mbedtls_cipher_init(&entry.auth_ctx);
 
-    if ((os_ret = mbedtls_cipher_setup(&auth_ctx, cipher_info)) != 0) {
-        return os_ret;
+    os_ret = mbedtls_cipher_setup(&entry.auth_ctx, cipher_info);
+    if (!os_ret) {
+        os_ret = mbedtls_cipher_cmac_starts(&entry.auth_ctx, auth_key, cmac_size * 8);
     }
+    mbedtls_platform_zeroize(auth_key, derived_key_size);
 
-    os_ret = mbedtls_cipher_cmac_starts(&auth_ctx, auth_key, cmac_size * 8);
-    if (os_ret != 0) {
+    if (os_ret) {
+        mbedtls_cipher_free(&entry.auth_ctx);
         return os_ret;
     }
 
+    entry.auth_ready = true;
     return 0;
 }
 
@@ -168,7 +251,7 @@ int cmac_calc_finish(mbedtls_cipher_context_t &auth_ctx, uint8_t *output)
 
 SecureStore::SecureStore(KVStore *underlying_kv, KVStore *rbp_kv) :
     _is_initialized(false), _underlying_kv(underlying_kv), _rbp_kv(rbp_kv), _entropy(0),
-    _inc_set_handle(0), _scratch_buf(0)
+    _inc_set_handle(0), _scratch_buf(0), _key_cache(0)
 {
 }
 
@@ -184,7 +267,6 @@ int SecureStore::set_start(set_handle_t *handle, const char *key, size_t final_d
     int ret, os_ret;
     inc_set_handle_t *ih;
     info_t info;
-    bool enc_started = false, auth_started = false;
 
     if (!_is_initialized) {
         return MBED_ERROR_NOT_READY;
@@ -199,6 +281,8 @@ int SecureStore::set_start(set_handle_t *handle, const char *key, size_t final_d
 
     _mutex.lock();
 
+    ih->cache_entry = 0;
+
     ret = _underlying_kv->get(key, &ih->metadata, sizeof(record_metadata_t));
     if (ret == MBED_SUCCESS) {
         // Must not remove RP flag
@@ -235,6 +319,8 @@ int SecureStore::set_start(set_handle_t *handle, const char *key, size_t final_d
     ih->metadata.metadata_size = sizeof(record_metadata_t);
     ih->metadata.revision = securestore_revision;
 
+    ih->cache_entry = key_cache_get(static_cast<key_cache_t *>(_key_cache), key);
+
     if (create_flags & REQUIRE_CONFIDENTIALITY_FLAG) {
         // generate a new random iv
         os_ret = mbedtls_entropy_func(_entropy, ih->metadata.iv, iv_size);
@@ -242,30 +328,28 @@ int SecureStore::set_start(set_handle_t *handle, const char *key, size_t final_d
             ret = MBED_ERROR_FAILED_OPERATION;
             goto fail;
         }
-        os_ret = encrypt_decrypt_start(ih->enc_ctx, ih->metadata.iv, key, ih->ctr_buf, _scratch_buf,
+        os_ret = encrypt_decrypt_start(*ih->cache_entry, ih->metadata.iv, key, ih->ctr_buf, _scratch_buf,
                                        scratch_buf_size);
         if (os_ret) {
             ret = MBED_ERROR_FAILED_OPERATION;
             goto fail;
         }
-        enc_started = true;
     } else {
         memset(ih->metadata.iv, 0, iv_size);
     }
 
-    os_ret = cmac_calc_start(ih->auth_ctx, key, _scratch_buf, scratch_buf_size);
+    os_ret = cmac_calc_start(*ih->cache_entry, key, _scratch_buf, scratch_buf_size);
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto fail;
     }
-    auth_started = true;
     // Although name is not part of the data, we calculate CMAC on it as well
-    os_ret = cmac_calc_data(ih->auth_ctx, key, strlen(key));
+    os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, key, strlen(key));
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto fail;
     }
-    os_ret = cmac_calc_data(ih->auth_ctx, &ih->metadata, sizeof(record_metadata_t));
+    os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, &ih->metadata, sizeof(record_metadata_t));
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto fail;
@@ -296,12 +380,8 @@ int SecureStore::set_start(set_handle_t *handle, const char *key, size_t final_d
     goto end;
 
 fail:
-    if (enc_started) {
-        mbedtls_aes_free(&ih->enc_ctx);
-    }
-
-    if (auth_started) {
-        mbedtls_cipher_free(&ih->auth_ctx);
+    if (ih->cache_entry) {
+        key_cache_release(ih->cache_entry);
     }
 
     // mark handle as invalid by clearing metadata size field in header
@@ -346,7 +426,7 @@ int SecureStore::set_add_data(set_handle_t handle, const void *value_data, size_
             // Encrypt the data chunk by chunk
             chunk_size = std::min((uint32_t) data_size, scratch_buf_size);
             dst_ptr = _scratch_buf;
-            os_ret = encrypt_decrypt_data(ih->enc_ctx, src_ptr, _scratch_buf,
+            os_ret = encrypt_decrypt_data(ih->cache_entry->enc_ctx, src_ptr, _scratch_buf,
                                           chunk_size, ih->ctr_buf, aes_offs);
             if (os_ret) {
                 ret = MBED_ERROR_FAILED_OPERATION;
@@ -357,7 +437,7 @@ int SecureStore::set_add_data(set_handle_t handle, const void *value_data, size_
             dst_ptr = static_cast <const uint8_t *>(value_data);
         }
 
-        os_ret = cmac_calc_data(ih->auth_ctx, dst_ptr, chunk_size);
+        os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, dst_ptr, chunk_size);
         if (os_ret) {
             ret = MBED_ERROR_FAILED_OPERATION;
             goto fail;
@@ -378,11 +458,7 @@ fail:
     if (ih->key) {
         delete[] ih->key;
     }
-    if (ih->metadata.create_flags & REQUIRE_CONFIDENTIALITY_FLAG) {
-        mbedtls_aes_free(&ih->enc_ctx);
-    }
-
-    mbedtls_cipher_free(&ih->auth_ctx);
+    key_cache_release(ih->cache_entry);
 
     // mark handle as invalid by clearing metadata size field in header
     ih->metadata.metadata_size = 0;
@@ -413,7 +489,7 @@ int SecureStore::set_finalize(set_handle_t handle)
         goto end;
     }
 
-    os_ret = cmac_calc_finish(ih->auth_ctx, cmac);
+    os_ret = cmac_calc_finish(ih->cache_entry->auth_ctx, cmac);
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto end;
@@ -444,11 +520,7 @@ int SecureStore::set_finalize(set_handle_t handle)
 end:
     // mark handle as invalid by clearing metadata size field in header
     ih->metadata.metadata_size = 0;
-    if (ih->metadata.create_flags & REQUIRE_CONFIDENTIALITY_FLAG) {
-        mbedtls_aes_free(&ih->enc_ctx);
-    }
-
-    mbedtls_cipher_free(&ih->auth_ctx);
+    key_cache_release(ih->cache_entry);
 
     _mutex.unlock();
     return ret;
@@ -527,7 +599,6 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
     uint32_t chunk_size;
     uint32_t enc_lead_size;
     uint8_t *dest_buf;
-    bool enc_started = false, auth_started = false;
     uint32_t create_flags;
 
     if (!is_valid_key(key)) {
@@ -537,6 +608,7 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
     // Use member variable _inc_set_handle as no set operation is used now,
     // and it saves us the need to define all members on stack
     inc_set_handle_t *ih = static_cast<inc_set_handle_t *>(_inc_set_handle);
+    ih->cache_entry = 0;
 
     if (_rbp_kv) {
         ret = _rbp_kv->get(key, rbp_cmac, cmac_size, 0);
@@ -568,33 +640,33 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
         goto end;
     }
 
-    os_ret = cmac_calc_start(ih->auth_ctx, key, _scratch_buf, scratch_buf_size);
+    ih->cache_entry = key_cache_get(static_cast<key_cache_t *>(_key_cache), key);
+
+    os_ret = cmac_calc_start(*ih->cache_entry, key, _scratch_buf, scratch_buf_size);
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto end;
     }
-    auth_started = true;
 
     // Although name is not part of the data, we calculate CMAC on it as well
-    os_ret = cmac_calc_data(ih->auth_ctx, key, strlen(key));
+    os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, key, strlen(key));
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto end;
     }
-    os_ret = cmac_calc_data(ih->auth_ctx, &ih->metadata, sizeof(record_metadata_t));
+    os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, &ih->metadata, sizeof(record_metadata_t));
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto end;
     }
 
     if (create_flags & REQUIRE_CONFIDENTIALITY_FLAG) {
-        os_ret = encrypt_decrypt_start(ih->enc_ctx, ih->metadata.iv, key, ih->ctr_buf, _scratch_buf,
+        os_ret = encrypt_decrypt_start(*ih->cache_entry, ih->metadata.iv, key, ih->ctr_buf, _scratch_buf,
                                        scratch_buf_size);
         if (os_ret) {
             ret = MBED_ERROR_FAILED_OPERATION;
             goto end;
         }
-        enc_started = true;
     }
 
     data_size = ih->metadata.data_size;
@@ -632,7 +704,7 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
             goto end;
         }
 
-        os_ret = cmac_calc_data(ih->auth_ctx, dest_buf, chunk_size);
+        os_ret = cmac_calc_data(ih->cache_entry->auth_ctx, dest_buf, chunk_size);
         if (os_ret) {
             ret = MBED_ERROR_FAILED_OPERATION;
             goto end;
@@ -640,7 +712,7 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
 
         if (create_flags & REQUIRE_CONFIDENTIALITY_FLAG) {
             // Decrypt data in place
-            os_ret = encrypt_decrypt_data(ih->enc_ctx, dest_buf, dest_buf, chunk_size, ih->ctr_buf,
+            os_ret = encrypt_decrypt_data(ih->cache_entry->enc_ctx, dest_buf, dest_buf, chunk_size, ih->ctr_buf,
                                           aes_offs);
             if (os_ret) {
                 ret = MBED_ERROR_FAILED_OPERATION;
@@ -662,7 +734,7 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
     }
 
     uint8_t calc_cmac[cmac_size], read_cmac[cmac_size];
-    os_ret = cmac_calc_finish(ih->auth_ctx, calc_cmac);
+    os_ret = cmac_calc_finish(ih->cache_entry->auth_ctx, calc_cmac);
     if (os_ret) {
         ret = MBED_ERROR_FAILED_OPERATION;
         goto end;
@@ -699,12 +771,8 @@ int SecureStore::do_get(const char *key, void *buffer, size_t buffer_size, size_
 end:
     ih->metadata.metadata_size = 0;
 
-    if (enc_started) {
-        mbedtls_aes_free(&ih->enc_ctx);
-    }
-
-    if (auth_started) {
-        mbedtls_cipher_free(&ih->auth_ctx);
+    if (ih->cache_entry) {
+        key_cache_release(ih->cache_entry);
     }
 
     return ret;
@@ -743,6 +811,7 @@ int SecureStore::init()
 
     _scratch_buf = new uint8_t[scratch_buf_size];
     _inc_set_handle = new inc_set_handle_t;
+    _key_cache = new key_cache_t();
 
     ret = _underlying_kv->init();
     if (ret) {
@@ -770,7 +839,12 @@ int SecureStore::deinit()
         mbedtls_entropy_free(static_cast<mbedtls_entropy_context *>(_entropy));
         delete static_cast<mbedtls_entropy_context *>(_entropy);
         delete static_cast<inc_set_handle_t *>(_inc_set_handle);
-        delete _scratch_buf;
+        delete[] _scratch_buf;
+        key_cache_t *key_cache = static_cast<key_cache_t *>(_key_cache);
+        for (uint32_t i = 0; i < key_cache_entries; i++) {
+            key_cache_evict(key_cache->entries[i]);
+        }
+        delete key_cache;
         // TODO: Deinit member KVs?
     }
 
@@ -276,6 +276,7 @@ private:
     void *_entropy;
     void *_inc_set_handle;
     uint8_t *_scratch_buf;
+    void *_key_cache;
 
     /**
      * @brief Actual get function, serving get and get_info APIs.
@@ -46,7 +46,6 @@ static int calc_area_params(FlashIAP *flash, uint32_t tdb_start_offset, uint32_t
                             tdbstore_area_data_t *area_params);
 static int reserved_data_get(FlashIAP *flash, tdbstore_area_data_t *area_params, void *reserved_data_buf,
                              size_t reserved_data_buf_size, size_t *actual_data_size_ptr);
-static uint32_t calc_crc(uint32_t init_crc, uint32_t data_size, const void *data_buf);
 
 // -------------------------------------------------- API Functions Implementation ----------------------------------------------------
 int direct_access_to_devicekey(uint32_t tdb_start_offset, uint32_t tdb_end_offset, void *data_buf,
@@ -184,7 +183,7 @@ static int reserved_data_get(FlashIAP *flash, tdbstore_area_data_t *area_params,
         goto exit_point;
     }
 
-    crc = calc_crc(crc, (uint32_t)actual_size, buf);
+    crc = crc32_ansi(crc, (uint32_t)actual_size, buf);
     if (crc != trailer.crc) {
         status = MBED_ERROR_INVALID_DATA_DETECTED;
     }
@@ -193,11 +192,3 @@ exit_point:
 
     return status;
 }
-
-static uint32_t calc_crc(uint32_t init_crc, uint32_t data_size, const void *data_buf)
-{
-    uint32_t crc;
-    MbedCRC<POLY_32BIT_ANSI, 32> ct(init_crc, 0x0, true, false);
-    ct.compute(const_cast<void *>(data_buf), data_size, &crc);
-    return crc;
-}
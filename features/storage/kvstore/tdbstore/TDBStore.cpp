@@ -24,13 +24,16 @@
 #include "mbed_error.h"
 #include "mbed_wait_api.h"
 #include "MbedCRC.h"
+#include "mbed_trace.h"
+#define TRACE_GROUP "TDBS"
 
 using namespace mbed;
 
 // --------------------------------------------------------- Definitions ----------------------------------------------------------
 
 static const uint32_t delete_flag = (1UL << 31);
-static const uint32_t internal_flags = delete_flag;
+static const uint32_t batch_flag = (1UL << 30);
+static const uint32_t internal_flags = delete_flag | batch_flag;
 static const uint32_t supported_flags = KVStore::WRITE_ONCE_FLAG;
 
 namespace {
@@ -48,9 +51,13 @@ typedef struct {
 
 typedef struct {
     uint32_t  hash;
+    uint32_t  gc_offset;    // Offset of record copy in standby area during incremental GC
     bd_size_t bd_offset;
 } ram_table_entry_t;
 
+// While building the RAM table, entries of delete records are marked with this offset bit
+static const bd_size_t ram_table_delete_mark = (bd_size_t) 1 << 63;
+
 static const char *master_rec_key = "TDBS";
 static const uint32_t tdbstore_magic = 0x54686683; // "TDBS" in ASCII
 static const uint32_t tdbstore_revision = 1;
@@ -61,6 +68,14 @@ typedef struct {
     uint32_t reserved;
 } master_record_data_t;
 
+// Batch record, preceding the records of a batch
+static const char *batch_rec_key = "TDBB";
+
+typedef struct {
+    uint32_t num_records;
+    uint32_t batch_size;    // Size of the records following the batch record
+} batch_record_data_t;
+
 typedef enum {
     TDBSTORE_AREA_STATE_NONE = 0,
     TDBSTORE_AREA_STATE_EMPTY,
@@ -73,7 +88,11 @@ typedef struct {
     uint32_t crc;
 } reserved_trailer_t;
 
+#ifdef MBED_CONF_TDBSTORE_WORK_BUF_SIZE
+static const uint32_t work_buf_size = MBED_CONF_TDBSTORE_WORK_BUF_SIZE;
+#else
 static const uint32_t work_buf_size = 64;
+#endif
 static const uint32_t initial_crc = 0xFFFFFFFF;
 static const uint32_t initial_max_keys = 16;
 
@@ -108,12 +127,13 @@ static inline uint32_t align_up(uint32_t val, uint32_t size)
 }
 
 
-static uint32_t calc_crc(uint32_t init_crc, uint32_t data_size, const void *data_buf)
+// RAM table order: descending hash, latest record first for equal hashes
+static bool ram_table_entry_before(const ram_table_entry_t &a, const ram_table_entry_t &b)
 {
-    uint32_t crc;
-    MbedCRC<POLY_32BIT_ANSI, 32> ct(init_crc, 0x0, true, false);
-    ct.compute(const_cast<void *>(data_buf), data_size, &crc);
-    return crc;
+    if (a.hash != b.hash) {
+        return a.hash > b.hash;
+    }
+    return (a.bd_offset & ~ram_table_delete_mark) > (b.bd_offset & ~ram_table_delete_mark);
 }
 
 // Class member functions
@@ -121,7 +141,8 @@ static uint32_t calc_crc(uint32_t init_crc, uint32_t data_size, const void *data
 TDBStore::TDBStore(BlockDevice *bd) : _ram_table(0), _max_keys(0),
     _num_keys(0), _bd(bd), _buff_bd(0),  _free_space_offset(0), _master_record_offset(0),
     _master_record_size(0), _is_initialized(false), _active_area(0), _active_area_version(0), _size(0),
-    _prog_size(0), _work_buf(0), _key_buf(0), _variant_bd_erase_unit_size(false), _inc_set_handle(0)
+    _prog_size(0), _work_buf(0), _key_buf(0), _variant_bd_erase_unit_size(false), _inc_set_handle(0),
+    _gc_in_progress(false), _gc_ram_table_ind(0), _gc_to_offset(0)
 {
 }
 
@@ -252,7 +273,7 @@ int TDBStore::read_record(uint8_t area, uint32_t offset, char *key,
 
     if (validate) {
         // Calculate CRC on header (excluding CRC itself)
-        crc = calc_crc(crc, sizeof(record_header_t) - sizeof(crc), &header);
+        crc = crc32_ansi(crc, sizeof(record_header_t) - sizeof(crc), &header);
         curr_data_offset = 0;
     } else {
         // Non validation case: No need to read the key, nor the parts before data_offset
@@ -305,7 +326,7 @@ int TDBStore::read_record(uint8_t area, uint32_t offset, char *key,
 
         if (validate) {
             // calculate CRC on current read chunk
-            crc = calc_crc(crc, chunk_size, dest_buf);
+            crc = crc32_ansi(crc, chunk_size, dest_buf);
         }
 
         if (key_size) {
@@ -317,7 +338,7 @@ int TDBStore::read_record(uint8_t area, uint32_t offset, char *key,
             }
 
             if (calc_hash) {
-                hash = calc_crc(hash, chunk_size, dest_buf);
+                hash = crc32_ansi(hash, chunk_size, dest_buf);
             }
 
             user_key_ptr += chunk_size;
@@ -352,16 +373,25 @@ int TDBStore::find_record(uint8_t area, const char *key, uint32_t &offset,
     int ret = MBED_ERROR_ITEM_NOT_FOUND;
     uint32_t actual_data_size;
     uint32_t flags, dummy_hash, next_offset;
+    uint32_t low = 0, high = _num_keys;
+
 
+    hash = crc32_ansi(initial_crc, strlen(key), key);
 
-    hash = calc_crc(initial_crc, strlen(key), key);
+    // RAM table is sorted by descending hash. Binary search for the first entry with our hash
+    // (or the place to insert it), then scan the entries sharing it in case of hash collisions.
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (ram_table[mid].hash > hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
 
-    for (ram_table_ind = 0; ram_table_ind < _num_keys; ram_table_ind++) {
+    for (ram_table_ind = low; ram_table_ind < _num_keys; ram_table_ind++) {
         entry = &ram_table[ram_table_ind];
         offset = entry->bd_offset;
-        if (hash < entry->hash)  {
-            continue;
-        }
         if (hash > entry->hash)  {
             return MBED_ERROR_ITEM_NOT_FOUND;
         }
@@ -376,6 +406,76 @@ int TDBStore::find_record(uint8_t area, const char *key, uint32_t &offset,
     return ret;
 }
 
+void TDBStore::update_ram_table(uint32_t flags, bool new_key, uint32_t ram_table_ind, uint32_t hash,
+                                uint32_t offset)
+{
+    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
+    ram_table_entry_t *entry;
+
+    if (flags & delete_flag) {
+        _num_keys--;
+        if (ram_table_ind < _num_keys) {
+            memmove(&ram_table[ram_table_ind], &ram_table[ram_table_ind + 1],
+                    sizeof(ram_table_entry_t) * (_num_keys - ram_table_ind));
+        }
+        update_all_iterators(false, ram_table_ind);
+        return;
+    }
+
+    if (new_key) {
+        if (ram_table_ind < _num_keys) {
+            memmove(&ram_table[ram_table_ind + 1], &ram_table[ram_table_ind],
+                    sizeof(ram_table_entry_t) * (_num_keys - ram_table_ind));
+        }
+        _num_keys++;
+        update_all_iterators(true, ram_table_ind);
+    }
+    entry = &ram_table[ram_table_ind];
+    entry->hash = hash;
+    entry->bd_offset = offset;
+}
+
+int TDBStore::write_record(uint32_t offset, const char *key, const void *data_buf, uint32_t data_size,
+                           uint32_t flags, uint32_t &next_offset)
+{
+    record_header_t header;
+    uint32_t header_size = align_up(sizeof(record_header_t), _prog_size);
+    int ret;
+
+    header.magic = tdbstore_magic;
+    header.header_size = sizeof(record_header_t);
+    header.revision = tdbstore_revision;
+    header.flags = flags;
+    header.key_size = strlen(key);
+    header.reserved = 0;
+    header.data_size = data_size;
+    header.crc = crc32_ansi(initial_crc, sizeof(record_header_t) - sizeof(header.crc), &header);
+    header.crc = crc32_ansi(header.crc, header.key_size, key);
+    if (data_size) {
+        header.crc = crc32_ansi(header.crc, data_size, data_buf);
+    }
+
+    ret = write_area(_active_area, offset, sizeof(record_header_t), &header);
+    if (ret) {
+        return ret;
+    }
+
+    ret = write_area(_active_area, offset + header_size, header.key_size, key);
+    if (ret) {
+        return ret;
+    }
+
+    if (data_size) {
+        ret = write_area(_active_area, offset + header_size + header.key_size, data_size, data_buf);
+        if (ret) {
+            return ret;
+        }
+    }
+
+    next_offset = align_up(offset + header_size + header.key_size + data_size, _prog_size);
+    return MBED_SUCCESS;
+}
+
 uint32_t TDBStore::record_size(const char *key, uint32_t data_size)
 {
     return align_up(sizeof(record_header_t), _prog_size) +
@@ -413,7 +513,8 @@ int TDBStore::set_start(set_handle_t *handle, const char *key, size_t final_data
 
         // A valid magic in the header means that this function has been called after an aborted
         // incremental set process. This means that our media may be in a bad state - call GC.
-        if (ih->header.magic == tdbstore_magic) {
+        // Also complete a pending incremental GC, as records it already copied may be overridden now.
+        if ((ih->header.magic == tdbstore_magic) || _gc_in_progress) {
             ret = garbage_collection();
             if (ret) {
                 goto fail;
@@ -479,8 +580,8 @@ int TDBStore::set_start(set_handle_t *handle, const char *key, size_t final_data
     ih->header.reserved = 0;
     ih->header.data_size = final_data_size;
     // Calculate CRC on header and key
-    ih->header.crc = calc_crc(initial_crc, sizeof(record_header_t) - sizeof(ih->header.crc), &ih->header);
-    ih->header.crc = calc_crc(ih->header.crc, ih->header.key_size, key);
+    ih->header.crc = crc32_ansi(initial_crc, sizeof(record_header_t) - sizeof(ih->header.crc), &ih->header);
+    ih->header.crc = crc32_ansi(ih->header.crc, ih->header.key_size, key);
 
     // Write key now
     ret = write_area(_active_area, ih->bd_curr_offset, ih->header.key_size, key);
@@ -527,7 +628,7 @@ int TDBStore::set_add_data(set_handle_t handle, const void *value_data, size_t d
     }
 
     // Update CRC with data chunk
-    ih->header.crc = calc_crc(ih->header.crc, data_size, value_data);
+    ih->header.crc = crc32_ansi(ih->header.crc, data_size, value_data);
 
     // Write the data chunk
     ret = write_area(_active_area, ih->bd_curr_offset, data_size, value_data);
@@ -546,8 +647,6 @@ int TDBStore::set_finalize(set_handle_t handle)
 {
     int os_ret, ret = MBED_SUCCESS;
     inc_set_handle_t *ih;
-    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
-    ram_table_entry_t *entry;
 
     if (handle != _inc_set_handle) {
         return MBED_ERROR_INVALID_ARGUMENT;
@@ -586,27 +685,7 @@ int TDBStore::set_finalize(set_handle_t handle)
         goto end;
     }
 
-    // Update RAM table
-    if (ih->header.flags & delete_flag) {
-        _num_keys--;
-        if (ih->ram_table_ind < _num_keys) {
-            memmove(&ram_table[ih->ram_table_ind], &ram_table[ih->ram_table_ind + 1],
-                    sizeof(ram_table_entry_t) * (_num_keys - ih->ram_table_ind));
-        }
-        update_all_iterators(false, ih->ram_table_ind);
-    } else {
-        if (ih->new_key) {
-            if (ih->ram_table_ind < _num_keys) {
-                memmove(&ram_table[ih->ram_table_ind + 1], &ram_table[ih->ram_table_ind],
-                        sizeof(ram_table_entry_t) * (_num_keys - ih->ram_table_ind));
-            }
-            _num_keys++;
-            update_all_iterators(true, ih->ram_table_ind);
-        }
-        entry = &ram_table[ih->ram_table_ind];
-        entry->hash = ih->hash;
-        entry->bd_offset = ih->bd_base_offset;
-    }
+    update_ram_table(ih->header.flags, ih->new_key, ih->ram_table_ind, ih->hash, ih->bd_base_offset);
 
     _free_space_offset = align_up(ih->bd_curr_offset, _prog_size);
 
@@ -650,6 +729,139 @@ int TDBStore::remove(const char *key)
     return set(key, 0, 0, delete_flag);
 }
 
+int TDBStore::batch_commit(batch_handle_t handle)
+{
+    inc_set_handle_t *ih = reinterpret_cast<inc_set_handle_t *>(_inc_set_handle);
+    batch_item_t *item, *prev;
+    batch_record_data_t batch_rec;
+    record_header_t header;
+    uint32_t offset, next_offset, batch_start, batch_rec_size;
+    uint32_t hash, ram_table_ind;
+    bool written = false;
+    int os_ret, ret;
+
+    if (!handle) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (!_is_initialized) {
+        batch_free(handle);
+        return MBED_ERROR_NOT_READY;
+    }
+
+    if (!batch_items(handle)) {
+        batch_free(handle);
+        return MBED_SUCCESS;
+    }
+
+    _mutex.lock();
+
+    // Validate all the sets before writing anything, so the batch is either written whole or not at all
+    batch_rec.num_records = 0;
+    batch_rec.batch_size = 0;
+    for (item = batch_items(handle); item; item = item->next) {
+        if (item->create_flags & ~supported_flags) {
+            ret = MBED_ERROR_INVALID_ARGUMENT;
+            goto end;
+        }
+
+        // An earlier set of the same key in this batch overrides the stored record
+        for (prev = batch_items(handle); prev != item; prev = prev->next) {
+            if (!strcmp(prev->key, item->key) && (prev->create_flags & WRITE_ONCE_FLAG)) {
+                ret = MBED_ERROR_WRITE_PROTECTED;
+                goto end;
+            }
+        }
+
+        ret = find_record(_active_area, item->key, offset, ram_table_ind, hash);
+        if (ret == MBED_SUCCESS) {
+            ret = read_area(_active_area, offset, sizeof(header), &header);
+            if (ret) {
+                goto end;
+            }
+            if (header.flags & WRITE_ONCE_FLAG) {
+                ret = MBED_ERROR_WRITE_PROTECTED;
+                goto end;
+            }
+        } else if (ret != MBED_ERROR_ITEM_NOT_FOUND) {
+            goto end;
+        }
+
+        batch_rec.num_records++;
+        batch_rec.batch_size += record_size(item->key, item->size);
+    }
+
+    // Same as in set_start: recover from an aborted incremental set and complete a pending
+    // incremental GC first, then make room for the whole batch.
+    batch_rec_size = record_size(batch_rec_key, sizeof(batch_rec));
+    if ((ih->header.magic == tdbstore_magic) || _gc_in_progress ||
+            (_free_space_offset + batch_rec_size + batch_rec.batch_size > _size)) {
+        ret = garbage_collection();
+        if (ret) {
+            goto end;
+        }
+        ih->header.magic = 0;
+    }
+
+    if (_free_space_offset + batch_rec_size + batch_rec.batch_size > _size) {
+        ret = MBED_ERROR_MEDIA_FULL;
+        goto end;
+    }
+
+    batch_start = _free_space_offset;
+    ret = check_erase_before_write(_active_area, batch_start, batch_rec_size + batch_rec.batch_size);
+    if (ret) {
+        goto end;
+    }
+
+    // Batch record first, then all the records back to back, synced once
+    written = true;
+    ret = write_record(batch_start, batch_rec_key, &batch_rec, sizeof(batch_rec), batch_flag, offset);
+    if (ret) {
+        goto end;
+    }
+
+    for (item = batch_items(handle); item; item = item->next) {
+        ret = write_record(offset, item->key, item->data, item->size, item->create_flags, next_offset);
+        if (ret) {
+            goto end;
+        }
+        offset = next_offset;
+    }
+
+    os_ret = _buff_bd->sync();
+    if (os_ret) {
+        ret = MBED_ERROR_WRITE_FAILED;
+        goto end;
+    }
+    written = false;
+    _free_space_offset = offset;
+
+    // Batch is on media, records become visible now
+    offset = batch_start + batch_rec_size;
+    for (item = batch_items(handle); item; item = item->next) {
+        ret = find_record(_active_area, item->key, next_offset, ram_table_ind, hash);
+        if ((ret != MBED_SUCCESS) && (ret != MBED_ERROR_ITEM_NOT_FOUND)) {
+            goto end;
+        }
+        if ((ret == MBED_ERROR_ITEM_NOT_FOUND) && (_num_keys >= _max_keys)) {
+            increment_max_keys();
+        }
+        update_ram_table(item->create_flags, ret == MBED_ERROR_ITEM_NOT_FOUND, ram_table_ind, hash, offset);
+        offset += record_size(item->key, item->size);
+    }
+    ret = MBED_SUCCESS;
+
+end:
+    if (ret && written) {
+        // Need GC as otherwise our storage is left in a non-usable state
+        garbage_collection();
+    }
+    _mutex.unlock();
+    batch_free(handle);
+    return ret;
+}
+
 int TDBStore::get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size, size_t offset)
 {
     int ret;
@@ -736,61 +948,85 @@ int TDBStore::copy_record(uint8_t from_area, uint32_t from_offset, uint32_t to_o
 {
     int ret;
     record_header_t header;
-    uint32_t total_size;
-    uint16_t chunk_size;
+    uint32_t total_size, header_size, crc_end;
+    uint32_t offset, chunk_size, copy_size;
+    uint32_t crc;
 
     ret = read_area(from_area, from_offset, sizeof(header), &header);
     if (ret) {
         return ret;
     }
 
-    total_size = align_up(sizeof(record_header_t), _prog_size) +
-                 align_up(header.key_size + header.data_size, _prog_size);;
-
+    header_size = align_up(sizeof(record_header_t), _prog_size);
+    total_size = header_size + align_up(header.key_size + header.data_size, _prog_size);
 
     ret = check_erase_before_write(1 - from_area, to_offset, total_size);
     if (ret) {
         return ret;
     }
 
-    chunk_size = align_up(sizeof(record_header_t), _prog_size);
-    ret = write_area(1 - from_area, to_offset, chunk_size, &header);
-    if (ret) {
-        return ret;
+    // Copy whole record in chunks of complete program units (if work buffer is large enough),
+    // so buffered BD passes them to the underlying BD as is.
+    copy_size = work_buf_size;
+    if (copy_size >= _prog_size) {
+        copy_size -= copy_size % _prog_size;
     }
 
-    from_offset += chunk_size;
-    to_offset += chunk_size;
-    total_size -= chunk_size;
+    // Validate record CRC in the same pass (key and data following the header)
+    crc = crc32_ansi(initial_crc, sizeof(record_header_t) - sizeof(header.crc), &header);
+    crc_end = header_size + header.key_size + header.data_size;
 
-    while (total_size) {
-        chunk_size = std::min(total_size, work_buf_size);
-        ret = read_area(from_area, from_offset, chunk_size, _work_buf);
+    for (offset = 0; offset < total_size; offset += chunk_size) {
+        chunk_size = std::min(total_size - offset, copy_size);
+        ret = read_area(from_area, from_offset + offset, chunk_size, _work_buf);
         if (ret) {
             return ret;
         }
 
-        ret = write_area(1 - from_area, to_offset, chunk_size, _work_buf);
+        if ((offset + chunk_size > header_size) && (offset < crc_end)) {
+            uint32_t crc_start = std::max(offset, header_size);
+            crc = crc32_ansi(crc, std::min(offset + chunk_size, crc_end) - crc_start, _work_buf + crc_start - offset);
+        }
+
+        ret = write_area(1 - from_area, to_offset + offset, chunk_size, _work_buf);
         if (ret) {
             return ret;
         }
+    }
 
-        from_offset += chunk_size;
-        to_offset += chunk_size;
-        total_size -= chunk_size;
+    // Copied as is, reading it keeps reporting the corruption
+    if (crc != header.crc) {
+        tr_warning("Copied record at offset %lu with a CRC mismatch", (unsigned long) from_offset);
     }
 
-    to_next_offset = align_up(to_offset, _prog_size);
+    to_next_offset = align_up(to_offset + total_size, _prog_size);
     return MBED_SUCCESS;
 }
 
 int TDBStore::garbage_collection()
 {
-    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
-    uint32_t to_offset, to_next_offset;
+    int ret;
+
+    if (!_gc_in_progress) {
+        ret = gc_prepare();
+        if (ret) {
+            return ret;
+        }
+    }
+
+    ret = gc_copy_records(0);
+    if (ret) {
+        return ret;
+    }
+
+    return gc_complete();
+}
+
+int TDBStore::gc_prepare()
+{
+    uint32_t to_offset;
     uint32_t chunk_size, reserved_size;
     int ret;
-    size_t ind;
 
     ret = check_erase_before_write(1 - _active_area, 0, _master_record_offset + _master_record_size);
     if (ret) {
@@ -819,25 +1055,55 @@ int TDBStore::garbage_collection()
         }
     }
 
-    to_offset = _master_record_offset + _master_record_size;
+    _gc_ram_table_ind = 0;
+    _gc_to_offset = _master_record_offset + _master_record_size;
+    _gc_in_progress = true;
 
-    // Initialize in case table is empty
-    to_next_offset = to_offset;
+    return MBED_SUCCESS;
+}
 
-    // Go over ram table and copy all entries to opposite area
-    for (ind = 0; ind < _num_keys; ind++) {
-        uint32_t from_offset = ram_table[ind].bd_offset;
-        ret = copy_record(_active_area, from_offset, to_offset, to_next_offset);
+int TDBStore::gc_copy_records(uint32_t max_copy_size)
+{
+    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
+    uint32_t to_next_offset, copied_size = 0;
+    int ret;
+
+    // Go over ram table and copy entries to opposite area. Active area entries are kept
+    // until the GC completes, so records are still read from there in the meantime.
+    while (_gc_ram_table_ind < _num_keys) {
+        if (max_copy_size && (copied_size >= max_copy_size)) {
+            break;
+        }
+        ret = copy_record(_active_area, ram_table[_gc_ram_table_ind].bd_offset, _gc_to_offset, to_next_offset);
         if (ret) {
+            // Start over on the next attempt, as the standby area now holds a partial record
+            _gc_in_progress = false;
             return ret;
         }
-        // Update RAM table
-        ram_table[ind].bd_offset = to_offset;
-        to_offset = to_next_offset;
+        ram_table[_gc_ram_table_ind].gc_offset = _gc_to_offset;
+        copied_size += to_next_offset - _gc_to_offset;
+        _gc_to_offset = to_next_offset;
+        _gc_ram_table_ind++;
+    }
+
+    return MBED_SUCCESS;
+}
+
+int TDBStore::gc_complete()
+{
+    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
+    uint32_t to_offset;
+    size_t ind;
+    int ret;
+
+    // Update RAM table
+    for (ind = 0; ind < _num_keys; ind++) {
+        ram_table[ind].bd_offset = ram_table[ind].gc_offset;
     }
 
-    to_offset = to_next_offset;
-    _free_space_offset = to_next_offset;
+    to_offset = _gc_to_offset;
+    _free_space_offset = _gc_to_offset;
+    _gc_in_progress = false;
 
     // Now we can switch to the new active area
     _active_area = 1 - _active_area;
@@ -858,17 +1124,57 @@ int TDBStore::garbage_collection()
     return MBED_SUCCESS;
 }
 
+int TDBStore::gc_step(size_t max_copy_size)
+{
+    int ret;
+
+    if (!_is_initialized) {
+        return MBED_ERROR_NOT_READY;
+    }
+
+    _mutex.lock();
+
+    if (!_gc_in_progress) {
+        ret = gc_prepare();
+        if (ret) {
+            goto end;
+        }
+    }
+
+    ret = gc_copy_records(std::max(max_copy_size, (size_t) 1));
+    if (ret) {
+        goto end;
+    }
+
+    if (_gc_ram_table_ind >= _num_keys) {
+        ret = gc_complete();
+    }
+
+end:
+    _mutex.unlock();
+    return ret;
+}
+
+bool TDBStore::gc_in_progress()
+{
+    return _gc_in_progress;
+}
+
 
 int TDBStore::build_ram_table()
 {
     ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
-    uint32_t offset, next_offset = 0, dummy;
-    int ret = MBED_SUCCESS;
+    uint32_t offset, next_offset = 0;
+    int ret = MBED_SUCCESS, compact_ret;
     uint32_t hash;
     uint32_t flags;
     uint32_t actual_data_size;
-    uint32_t ram_table_ind;
+    batch_record_data_t batch_rec;
+    uint32_t batch_start = 0, batch_end = 0;
+    size_t batch_num_keys = 0;
 
+    // Collect all records first and sort them in bulk, instead of looking up each record
+    // and inserting it in place.
     _num_keys = 0;
     offset = _master_record_offset;
 
@@ -877,45 +1183,86 @@ int TDBStore::build_ram_table()
                           true, false, false, true, hash, flags, next_offset);
 
         if (ret) {
-            goto end;
+            break;
         }
 
-        ret = find_record(_active_area, _key_buf, dummy, ram_table_ind, hash);
-
-        if ((ret != MBED_SUCCESS) && (ret != MBED_ERROR_ITEM_NOT_FOUND)) {
-            goto end;
+        if (batch_end && (offset >= batch_end)) {
+            if (offset != batch_end) {
+                ret = MBED_ERROR_INVALID_DATA_DETECTED;
+                break;
+            }
+            batch_end = 0;
         }
 
-        uint32_t save_offset = offset;
-        offset = next_offset;
+        if (flags & batch_flag) {
+            if (batch_end) {
+                ret = MBED_ERROR_INVALID_DATA_DETECTED;
+                break;
+            }
 
-        if (ret == MBED_ERROR_ITEM_NOT_FOUND) {
-            // Key doesn't exist, need to add it to RAM table
-            ret = MBED_SUCCESS;
+            // Records of a batch are only taken once all of them are found valid
+            ret = read_record(_active_area, offset, _key_buf, &batch_rec, sizeof(batch_rec), actual_data_size, 0,
+                              false, true, false, false, hash, flags, next_offset);
+            if (ret) {
+                break;
+            }
+            if (actual_data_size != sizeof(batch_rec)) {
+                ret = MBED_ERROR_INVALID_DATA_DETECTED;
+                break;
+            }
+            batch_start = offset;
+            batch_end = next_offset + batch_rec.batch_size;
+            batch_num_keys = _num_keys;
+            offset = next_offset;
+            continue;
+        }
 
-            if (flags & delete_flag) {
-                continue;
+        if ((_num_keys >= _max_keys) && batch_end) {
+            // Pending batch entries may still be dropped, so they can't be compacted yet
+            resize_ram_table(_max_keys * 2);
+            ram_table = (ram_table_entry_t *) _ram_table;
+        } else if (_num_keys >= _max_keys) {
+            // Table is full of collected records - drop the overridden ones, and make sure at least
+            // half of the table is free, so compaction cost is amortized over the collected records.
+            ret = compact_ram_table();
+            if (ret) {
+                goto end;
             }
-            if (_num_keys >= _max_keys) {
-                // In order to avoid numerous reallocations of ram table,
-                // Add a chunk of entries now
-                increment_max_keys(reinterpret_cast<void **>(&ram_table));
+            if (_num_keys > _max_keys / 2) {
+                resize_ram_table(_num_keys * 2 + initial_max_keys);
             }
-            memmove(&ram_table[ram_table_ind + 1], &ram_table[ram_table_ind],
-                    sizeof(ram_table_entry_t) * (_num_keys - ram_table_ind));
+            ram_table = (ram_table_entry_t *) _ram_table;
+        }
 
-            _num_keys++;
-        } else if (flags & delete_flag) {
-            _num_keys--;
-            memmove(&ram_table[ram_table_ind], &ram_table[ram_table_ind + 1],
-                    sizeof(ram_table_entry_t) * (_num_keys - ram_table_ind));
+        ram_table[_num_keys].hash = hash;
+        ram_table[_num_keys].bd_offset = offset;
+        if (flags & delete_flag) {
+            ram_table[_num_keys].bd_offset |= ram_table_delete_mark;
+        }
+        _num_keys++;
 
-            continue;
+        offset = next_offset;
+    }
+
+    if (batch_end && (offset != batch_end)) {
+        // Incomplete batch - drop it, so GC at init reclaims its space
+        _num_keys = batch_num_keys;
+        next_offset = batch_start;
+        if (ret == MBED_SUCCESS) {
+            ret = MBED_ERROR_INVALID_DATA_DETECTED;
         }
+    }
+
+    // Keep the error of the record scan (end of records is detected as invalid data)
+    compact_ret = compact_ram_table();
+    if (compact_ret) {
+        ret = compact_ret;
+        goto end;
+    }
 
-        // update record parameters
-        ram_table[ram_table_ind].hash = hash;
-        ram_table[ram_table_ind].bd_offset = save_offset;
+    // Release the room used for collecting records
+    if (_max_keys > _num_keys + initial_max_keys) {
+        resize_ram_table(_num_keys + initial_max_keys);
     }
 
 end:
@@ -923,18 +1270,72 @@ end:
     return ret;
 }
 
-int TDBStore::increment_max_keys(void **ram_table)
+int TDBStore::compact_ram_table()
 {
-    // Reallocate ram table with new size
-    ram_table_entry_t *old_ram_table = (ram_table_entry_t *) _ram_table;
-    ram_table_entry_t *new_ram_table = new ram_table_entry_t[_max_keys + 1];
+    ram_table_entry_t *ram_table = (ram_table_entry_t *) _ram_table;
+    uint32_t actual_data_size, flags, hash, next_offset;
+    size_t group_start, group_end, out = 0, ind, winner;
+    int ret;
 
-    // Copy old content to new table
-    memcpy(new_ram_table, old_ram_table, sizeof(ram_table_entry_t) * _max_keys);
-    _max_keys++;
+    std::sort(ram_table, ram_table + _num_keys, ram_table_entry_before);
 
-    _ram_table = new_ram_table;
-    delete[] old_ram_table;
+    for (group_start = 0; group_start < _num_keys; group_start = group_end) {
+        size_t group_out = out;
+
+        for (group_end = group_start + 1;
+                (group_end < _num_keys) && (ram_table[group_end].hash == ram_table[group_start].hash);
+                group_end++) {
+        }
+
+        // Latest record of each key in this group wins. As the hash is shared, key of each
+        // older record has to be compared with the winners found so far.
+        for (ind = group_start; ind < group_end; ind++) {
+            bool overridden = false;
+
+            if (ind != group_start) {
+                ret = read_record(_active_area, ram_table[ind].bd_offset & ~ram_table_delete_mark, _key_buf,
+                                  0, 0, actual_data_size, 0, true, false, false, false,
+                                  hash, flags, next_offset);
+                if (ret) {
+                    return ret;
+                }
+
+                for (winner = group_out; winner < out; winner++) {
+                    ret = read_record(_active_area, ram_table[winner].bd_offset & ~ram_table_delete_mark, _key_buf,
+                                      0, 0, actual_data_size, 0, false, false, true, false,
+                                      hash, flags, next_offset);
+                    if (ret == MBED_SUCCESS) {
+                        overridden = true;
+                        break;
+                    }
+                    if (ret != MBED_ERROR_ITEM_NOT_FOUND) {
+                        return ret;
+                    }
+                }
+            }
+
+            if (!overridden) {
+                ram_table[out++] = ram_table[ind];
+            }
+        }
+
+        // Deleted keys are no longer needed, as all their older records were overridden
+        for (ind = winner = group_out; ind < out; ind++) {
+            if (!(ram_table[ind].bd_offset & ram_table_delete_mark)) {
+                ram_table[winner++] = ram_table[ind];
+            }
+        }
+        out = winner;
+    }
+
+    _num_keys = out;
+    return MBED_SUCCESS;
+}
+
+int TDBStore::increment_max_keys(void **ram_table)
+{
+    // Reallocate ram table with a chunk of new entries, to avoid numerous reallocations
+    resize_ram_table(_max_keys + initial_max_keys);
 
     if (ram_table) {
         *ram_table = _ram_table;
@@ -942,6 +1343,19 @@ int TDBStore::increment_max_keys(void **ram_table)
     return MBED_SUCCESS;
 }
 
+void TDBStore::resize_ram_table(size_t max_keys)
+{
+    ram_table_entry_t *old_ram_table = (ram_table_entry_t *) _ram_table;
+    ram_table_entry_t *new_ram_table = new ram_table_entry_t[max_keys];
+
+    // Copy old content to new table
+    memcpy(new_ram_table, old_ram_table, sizeof(ram_table_entry_t) * _num_keys);
+    _max_keys = max_keys;
+
+    _ram_table = new_ram_table;
+    delete[] old_ram_table;
+}
+
 
 int TDBStore::init()
 {
@@ -1104,6 +1518,7 @@ int TDBStore::deinit()
         delete[] _key_buf;
     }
 
+    _gc_in_progress = false;
     _is_initialized = false;
     _mutex.unlock();
 
@@ -1138,6 +1553,7 @@ int TDBStore::reset()
     _active_area = 0;
     _num_keys = 0;
     _free_space_offset = _master_record_offset;
+    _gc_in_progress = false;
     _active_area_version = 1;
 
     // Write an initial master record on active area
@@ -1284,6 +1700,14 @@ int TDBStore::reserved_data_set(const void *reserved_data, size_t reserved_data_
 
     _mutex.lock();
 
+    // Pending incremental GC has already copied the reserved area
+    if (_gc_in_progress) {
+        ret = garbage_collection();
+        if (ret) {
+            goto end;
+        }
+    }
+
     ret = do_reserved_data_get(0, RESERVED_AREA_SIZE);
     if ((ret == MBED_SUCCESS) || (ret == MBED_ERROR_INVALID_DATA_DETECTED)) {
         ret = MBED_ERROR_WRITE_FAILED;
@@ -1299,7 +1723,7 @@ int TDBStore::reserved_data_set(const void *reserved_data, size_t reserved_data_
 
     trailer.trailer_size = sizeof(trailer);
     trailer.data_size = reserved_data_buf_size;
-    trailer.crc = calc_crc(initial_crc, reserved_data_buf_size, reserved_data);
+    trailer.crc = crc32_ansi(initial_crc, reserved_data_buf_size, reserved_data);
 
     ret = write_area(_active_area, RESERVED_AREA_SIZE, sizeof(trailer), &trailer);
     if (ret) {
@@ -1363,18 +1787,20 @@ int TDBStore::do_reserved_data_get(void *reserved_data, size_t reserved_data_buf
 
     while (actual_size) {
         uint32_t chunk = std::min(work_buf_size, (uint32_t) actual_size);
-        ret = read_area(_active_area, offset, chunk, buf);
+        // User buffer is filled up, work buffer is reused for each chunk
+        uint8_t *chunk_buf = reserved_data ? buf + offset : buf;
+        ret = read_area(_active_area, offset, chunk, chunk_buf);
         if (ret) {
             return ret;
         }
         for (uint32_t i = 0; i < chunk; i++) {
-            if (buf[i] != blank) {
+            if (chunk_buf[i] != blank) {
                 erased = false;
                 break;
             }
         }
 
-        crc = calc_crc(crc, chunk, buf + offset);
+        crc = crc32_ansi(crc, chunk, chunk_buf);
         offset += chunk;
         actual_size -= chunk;
     }
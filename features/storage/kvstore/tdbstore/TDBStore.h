@@ -203,6 +203,23 @@ public:
      */
     virtual int set_finalize(set_handle_t handle);
 
+    /**
+     * @brief Commit a batch of sets and release its handle. All the records of the batch are
+     *        programmed in one pass, after a batch record holding their total size, and synced once.
+     *        On init, a batch whose records are not all valid is dropped as a whole.
+     *
+     * @param[in]  handle               Batch handle.
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_READ_FAILED              Unable to read from media.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     *          MBED_ERROR_INVALID_ARGUMENT         Invalid argument given in function arguments.
+     *          MBED_ERROR_MEDIA_FULL               Not enough room on media.
+     *          MBED_ERROR_WRITE_PROTECTED          Already stored with "write once" flag.
+     */
+    virtual int batch_commit(batch_handle_t handle);
+
     /**
      * @brief Start an iteration over KVStore keys.
      *        There are no issues with any other operations while iterator is open.
@@ -280,6 +297,31 @@ public:
     virtual int reserved_data_get(void *reserved_data, size_t reserved_data_buf_size,
                                   size_t *actual_data_size = 0);
 
+    /**
+     * @brief Perform one step of incremental garbage collection, starting one if none is in progress.
+     *        Each step copies records to the standby area until the given size is copied, and
+     *        the last step switches areas. Between steps, other operations are not blocked.
+     *        Get and iterator operations keep reading from the active area, while set and remove
+     *        operations complete the pending garbage collection before they proceed.
+     *        Steps can be called directly, or posted to an EventQueue until gc_in_progress()
+     *        returns false.
+     *
+     * @param[in]  max_copy_size        Number of bytes to copy in this step (at least one record is copied).
+     *
+     * @returns MBED_SUCCESS                        Success.
+     *          MBED_ERROR_NOT_READY                Not initialized.
+     *          MBED_ERROR_READ_FAILED              Unable to read from media.
+     *          MBED_ERROR_WRITE_FAILED             Unable to write to media.
+     */
+    int gc_step(size_t max_copy_size);
+
+    /**
+     * @brief Check whether an incremental garbage collection is in progress.
+     *
+     * @returns true if gc_step has started a garbage collection that is not completed yet.
+     */
+    bool gc_in_progress();
+
 #if !defined(DOXYGEN_ONLY)
 private:
 
@@ -312,6 +354,9 @@ private:
     bool _variant_bd_erase_unit_size;
     void *_inc_set_handle;
     void *_iterator_table[_max_open_iterators];
+    bool _gc_in_progress;
+    uint32_t _gc_ram_table_ind;
+    uint32_t _gc_to_offset;
 
     /**
      * @brief Read a block from an area.
@@ -413,11 +458,35 @@ private:
 
     /**
      * @brief Garbage collection (compact all records from active area to the standby one).
+     *        Completes an incremental garbage collection if one is in progress.
      *
      * @returns 0 for success, nonzero for failure.
      */
     int garbage_collection();
 
+    /**
+     * @brief Start garbage collection (prepare standby area and copy reserved data).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_prepare();
+
+    /**
+     * @brief Copy the next records of the RAM table to the standby area.
+     *
+     * @param[in]  max_copy_size          Number of bytes to copy (0 for all remaining records).
+     *
+     * @returns 0 for success, nonzero for failure. On failure, the garbage collection is aborted.
+     */
+    int gc_copy_records(uint32_t max_copy_size);
+
+    /**
+     * @brief Complete garbage collection (switch to standby area once all records are copied).
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int gc_complete();
+
     /**
      * @brief Return record size given key and data size.
      *
@@ -441,6 +510,35 @@ private:
      */
     int find_record(uint8_t area, const char *key, uint32_t &offset,
                     uint32_t &ram_table_ind, uint32_t &hash);
+
+    /**
+     * @brief Update RAM table with a record written at a given offset.
+     *
+     * @param[in]  flags                  Record flags.
+     * @param[in]  new_key                Key isn't in RAM table yet.
+     * @param[in]  ram_table_ind          Index in RAM table, as returned by find_record.
+     * @param[in]  hash                   Key hash.
+     * @param[in]  offset                 Offset of record.
+     *
+     * @returns none
+     */
+    void update_ram_table(uint32_t flags, bool new_key, uint32_t ram_table_ind, uint32_t hash,
+                          uint32_t offset);
+
+    /**
+     * @brief Write a complete record, header included.
+     *
+     * @param[in]  offset                 Offset of record.
+     * @param[in]  key                    Key.
+     * @param[in]  data_buf               Data buffer.
+     * @param[in]  data_size              Data size (bytes).
+     * @param[in]  flags                  Record flags.
+     * @param[out] next_offset            Offset following the record.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int write_record(uint32_t offset, const char *key, const void *data_buf, uint32_t data_size,
+                     uint32_t flags, uint32_t &next_offset);
     /**
      * @brief Actual logics of get API (also covers all other get APIs).
      *
@@ -476,6 +574,14 @@ private:
      */
     int build_ram_table();
 
+    /**
+     * @brief Sort RAM table entries collected by build_ram_table and keep only the latest
+     *        record of each key, dropping deleted keys.
+     *
+     * @returns 0 for success, nonzero for failure.
+     */
+    int compact_ram_table();
+
     /**
      * @brief Increment maximum number of keys and reallocate RAM table accordingly.
      *
@@ -485,6 +591,15 @@ private:
      */
     int increment_max_keys(void **ram_table = 0);
 
+    /**
+     * @brief Reallocate RAM table to a given number of keys.
+     *
+     * @param[in]  max_keys              New maximum number of keys (not below current number of keys).
+     *
+     * @returns none
+     */
+    void resize_ram_table(size_t max_keys);
+
     /**
      * @brief Calculate offset from start of erase unit.
      *
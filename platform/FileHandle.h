@@ -236,6 +236,18 @@ public:
         return POLLIN | POLLOUT;
     }
 
+    /** Check whether events are signalled to mbed::poll().
+     *  Derived classes returning true must call mbed::poll_wake() whenever an
+     *  event occurs, so that poll() blocks until then. Other file handles are
+     *  checked again by poll() every millisecond.
+     *
+     * @returns             true if events are signalled with mbed::poll_wake().
+     */
+    virtual bool poll_wakes() const
+    {
+        return false;
+    }
+
     /** Definition depends on the subclass implementing FileHandle.
      *  For example, if the FileHandle is of type Stream, writable() could return
      *  true when there is ample buffer space available for write() calls.
@@ -17,8 +17,9 @@
 #include "mbed_poll.h"
 #include "FileHandle.h"
 #if MBED_CONF_RTOS_PRESENT
+#include "platform/mbed_critical.h"
 #include "rtos/Kernel.h"
-#include "rtos/ThisThread.h"
+#include "rtos/Semaphore.h"
 using namespace rtos;
 #else
 #include "drivers/Timer.h"
@@ -27,24 +28,109 @@ using namespace rtos;
 
 namespace mbed {
 
+#if MBED_CONF_RTOS_PRESENT
+namespace {
+
+// Thread blocked in poll(), released by poll_wake() on any of its file handles
+struct poll_waiter {
+    poll_waiter(const pollfh *fhs, unsigned nfhs) : next(NULL), fhs(fhs), nfhs(nfhs), sem(0, 1)
+    {
+    }
+
+    poll_waiter *next;
+    const pollfh *fhs;
+    unsigned nfhs;
+    Semaphore sem;
+};
+
+// Protected by critical section, as poll_wake() may be called from interrupts
+poll_waiter *poll_waiters;
+
+void add_waiter(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    waiter->next = poll_waiters;
+    poll_waiters = waiter;
+    core_util_critical_section_exit();
+}
+
+void remove_waiter(poll_waiter *waiter)
+{
+    core_util_critical_section_enter();
+    poll_waiter **prev = &poll_waiters;
+    while (*prev != waiter) {
+        prev = &(*prev)->next;
+    }
+    *prev = waiter->next;
+    core_util_critical_section_exit();
+}
+
+} // anonymous namespace
+#endif // MBED_CONF_RTOS_PRESENT
+
+/* Scan the file handles, checking whether all of them signal their events */
+static int scan(pollfh fhs[], unsigned nfhs, bool &all_wake)
+{
+    int count = 0;
+    all_wake = true;
+    for (unsigned n = 0; n < nfhs; n++) {
+        FileHandle *fh = fhs[n].fh;
+        short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
+        if (fh) {
+            fhs[n].revents = fh->poll(mask) & mask;
+            all_wake = all_wake && fh->poll_wakes();
+        } else {
+            fhs[n].revents = POLLNVAL;
+        }
+        if (fhs[n].revents) {
+            count++;
+        }
+    }
+    return count;
+}
+
 // timeout -1 forever, or milliseconds
 int poll(pollfh fhs[], unsigned nfhs, int timeout)
 {
+    bool all_wake;
+    int count = scan(fhs, nfhs, all_wake);
+    if (count || timeout == 0) {
+        return count;
+    }
+
+#if MBED_CONF_RTOS_PRESENT
     /*
-     * TODO Proper wake-up mechanism.
-     * In order to correctly detect availability of read/write a FileHandle, we needed
-     * a select or poll mechanisms. We opted for poll as POSIX defines in
-     * http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html Currently,
-     * mbed::poll() just spins and scans filehandles looking for any events we are
-     * interested in. In future, his spinning behaviour will be replaced with
-     * condition variables.
+     * Block until a file handle signals an event with poll_wake(), then scan again. The waiter
+     * is registered before scanning, so events occurring in between aren't lost. File handles
+     * that don't signal their events are checked again every millisecond.
      */
-#if MBED_CONF_RTOS_PRESENT
-    uint64_t start_time = 0;
-    if (timeout > 0) {
-        start_time = Kernel::get_ms_count();
+    uint64_t deadline = Kernel::get_ms_count() + timeout;
+    poll_waiter waiter(fhs, nfhs);
+    add_waiter(&waiter);
+
+    for (;;) {
+        count = scan(fhs, nfhs, all_wake);
+        if (count) {
+            break;
+        }
+
+        if (timeout < 0) {
+            waiter.sem.wait(all_wake ? osWaitForever : 1);
+            continue;
+        }
+
+        uint64_t now = Kernel::get_ms_count();
+        if (now >= deadline) {
+            break;
+        }
+        if (all_wake) {
+            waiter.sem.wait_until(deadline);
+        } else {
+            waiter.sem.wait(1);
+        }
     }
-#define TIME_ELAPSED() int64_t(Kernel::get_ms_count() - start_time)
+
+    remove_waiter(&waiter);
 #else
 #if MBED_CONF_PLATFORM_POLL_USE_LOWPOWER_TIMER
     LowPowerTimer timer;
@@ -54,40 +140,36 @@ int poll(pollfh fhs[], unsigned nfhs, int timeout)
     if (timeout > 0) {
         timer.start();
     }
-#define TIME_ELAPSED() timer.read_ms()
-#endif // MBED_CONF_RTOS_PRESENT
 
-    int count = 0;
+    /* No RTOS to block on - spin until an event occurs or the timeout expires */
     for (;;) {
-        /* Scan the file handles */
-        for (unsigned n = 0; n < nfhs; n++) {
-            FileHandle *fh = fhs[n].fh;
-            short mask = fhs[n].events | POLLERR | POLLHUP | POLLNVAL;
-            if (fh) {
-                fhs[n].revents = fh->poll(mask) & mask;
-            } else {
-                fhs[n].revents = POLLNVAL;
-            }
-            if (fhs[n].revents) {
-                count++;
-            }
-        }
-
+        count = scan(fhs, nfhs, all_wake);
         if (count) {
             break;
         }
-
-        /* Nothing selected - this is where timeout handling would be needed */
-        if (timeout == 0 || (timeout > 0 && TIME_ELAPSED() > timeout)) {
+        if (timeout > 0 && timer.read_ms() > timeout) {
             break;
         }
-#ifdef MBED_CONF_RTOS_PRESENT
-        // TODO - proper blocking
-        // wait for condition variable, wait queue whatever here
-        rtos::ThisThread::sleep_for(1);
-#endif
     }
+#endif // MBED_CONF_RTOS_PRESENT
+
     return count;
 }
 
+void poll_wake(FileHandle *fh)
+{
+#if MBED_CONF_RTOS_PRESENT
+    core_util_critical_section_enter();
+    for (poll_waiter *waiter = poll_waiters; waiter; waiter = waiter->next) {
+        for (unsigned n = 0; n < waiter->nfhs; n++) {
+            if (waiter->fhs[n].fh == fh) {
+                waiter->sem.release();
+                break;
+            }
+        }
+    }
+    core_util_critical_section_exit();
+#endif
+}
+
 } // namespace mbed
@@ -52,6 +52,16 @@ struct pollfh {
  */
 int poll(pollfh fhs[], unsigned nfhs, int timeout);
 
+/** Wake the threads blocked in poll() on a file handle, so they check it again.
+ * FileHandle implementations returning true from FileHandle::poll_wakes() must call this
+ * whenever an event occurs, along with the sigio() callback.
+ *
+ * @param fh      file handle whose events may have changed
+ *
+ * @note You may call this function from ISR context.
+ */
+void poll_wake(FileHandle *fh);
+
 /**@}*/
 
 /**@}*/